@@ -0,0 +1,501 @@
+#include <type_traits> // std::common_type_t
+#include <algorithm>   // std::min(), std::max(), std::find()
+#include <stdexcept>
+#include <cstddef>     // std::ptrdiff_t
+#include <cstdint>     // std::uint8_t
+#include <initializer_list>
+#include <utility>     // std::swap()
+#include <vector>
+#include <array>
+export module p3.grid.automaton;
+/*
+	Cellular automaton module, part of github/TeraFlint/pitrilib.
+	Daniel Wiegert (Pitri), 2021.
+*/
+
+export import p3.grid.stencil;
+// import <type_traits>; // std::common_type_t
+// import <algorithm>;   // std::min(), std::max(), std::find()
+// import <stdexcept>;
+// import <cstddef>;     // std::ptrdiff_t
+// import <cstdint>;     // std::uint8_t
+// import <initializer_list>;
+// import <utility>;     // std::swap()
+// import <vector>;
+// import <array>;
+
+namespace p3
+{
+#pragma region rules
+
+	export
+	enum class neighborhood
+	{
+		moore,       // every cell within the radius along each axis (the 8 surrounding cells in 2d, for radius 1).
+		von_neumann, // every cell within the radius in manhattan distance (the 4 direct neighbors in 2d, for radius 1).
+	};
+
+	namespace automaton_rule
+	{
+		export
+		/*
+			binary automata, with cells being either 0 or 1. a dead cell with a neighbor count listed in birth comes alive,
+			a living cell survives with a count listed in survive, everything else dies. life_like({ 3 }, { 2, 3 }) is conway's game of life.
+		*/
+		class life_like
+		{
+		public:
+			life_like(std::initializer_list<size_t> birth, std::initializer_list<size_t> survive)
+			{
+				for (const size_t count : birth)
+				{
+					set(m_birth, count);
+				}
+				for (const size_t count : survive)
+				{
+					set(m_survive, count);
+				}
+			}
+
+			template <typename data_type, typename sum_type>
+			[[nodiscard]] data_type operator()(const data_type &cell, const sum_type &count) const
+			{
+				const auto &table = cell ? m_survive : m_birth;
+				const auto index = static_cast<size_t>(count);
+				return static_cast<data_type>(index < table.size() && table[index]);
+			}
+
+		private:
+			static void set(std::vector<std::uint8_t> &table, size_t count)
+			{
+				if (table.size() <= count)
+				{
+					table.resize(count + 1);
+				}
+				table[count] = 1;
+			}
+
+			std::vector<std::uint8_t> m_birth, m_survive;
+		};
+
+		export
+		[[nodiscard]] inline life_like game_of_life()
+		{
+			return life_like({ 3 }, { 2, 3 });
+		}
+	}
+
+#pragma endregion
+#pragma region automaton
+
+	export
+	/*
+		steps a grid through generations of a neighborhood rule: new_cell = rule(cell, sum of all neighbors).
+		the automaton owns two grids and swaps them after every step, so nothing gets reallocated between generations.
+
+		the grid is split into tiles. a tile only gets computed if one of the tiles its neighborhood reaches into has changed in
+		the previous generation. otherwise its result is already known: the back buffer still holds the generation before,
+		which is identical. sparse activity on a large grid (a few gliders on an empty plane) only costs the active tiles.
+		multi-threaded steps hand out bands of tile rows (along the first axis) to the threads.
+	*/
+	template <typename data_type, size_t dimensions>
+	class automaton
+	{
+		static_assert(dimensions > 0, "automaton: grids need at least one dimension.");
+
+	public:
+		using sum_type = std::common_type_t<data_type, int>;
+		using grid_type = grid<data_type, dimensions>;
+
+		// edge length of the tiles. grows to the radius, so a neighborhood never skips a tile.
+		static constexpr size_t default_tile_edge = 32;
+
+	#pragma region constructors
+
+	public:
+		explicit automaton(grid_type initial, neighborhood shape = neighborhood::moore, size_t radius = 1,
+			const stencil_boundary<data_type> &boundary = stencil_boundary<data_type>::wrap())
+			: m_buffer{ std::move(initial) }, m_boundary{ boundary }, m_radius{ radius }, m_edge{ std::max(default_tile_edge, radius) }
+		{
+			if (radius == 0)
+			{
+				throw std::invalid_argument("automaton: the radius has to be at least 1.");
+			}
+
+			grid_size<dimensions> span{};
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				span[axis] = 2 * radius + 1;
+			}
+
+			for (grid_pos<dimensions> pos{ span }; pos.valid(); ++pos)
+			{
+				grid_stride<dimensions> offset{};
+				size_t manhattan = 0;
+				for (size_t axis = 0; axis < dimensions; ++axis)
+				{
+					offset[axis] = static_cast<std::ptrdiff_t>(pos.pos_at(axis)) - static_cast<std::ptrdiff_t>(radius);
+					manhattan += static_cast<size_t>(offset[axis] < 0 ? -offset[axis] : offset[axis]);
+				}
+
+				if (manhattan > 0 && (shape == neighborhood::moore || manhattan <= radius))
+				{
+					m_offsets.push_back(offset);
+				}
+			}
+
+			setup_tiles();
+		}
+
+	#pragma endregion
+	#pragma region accessors
+
+	public:
+		[[nodiscard]] const grid_type &state() const
+		{
+			return m_buffer.front();
+		}
+
+		// replaces the state. without a history, the next step computes every tile again.
+		void reset(grid_type state)
+		{
+			m_buffer.front() = std::move(state);
+			m_buffer.back().resize(m_buffer.front().dim());
+			m_generation = 0;
+			setup_tiles();
+		}
+
+		// amount of steps since construction (or the last reset).
+		[[nodiscard]] size_t generation() const
+		{
+			return m_generation;
+		}
+
+		[[nodiscard]] size_t neighbors() const
+		{
+			return m_offsets.size();
+		}
+
+		[[nodiscard]] size_t tile_count() const
+		{
+			return m_changed.size();
+		}
+
+		// tiles that actually got computed in the last step, the rest got skipped.
+		[[nodiscard]] size_t tiles_computed() const
+		{
+			return m_computed;
+		}
+
+	#pragma endregion
+	#pragma region stepping
+
+	public:
+		// computes the next generation, with rule(cell, neighbor_sum) returning the new cell.
+		template <typename rule_type>
+		void step(rule_type &&rule)
+		{
+			const auto offsets = linear_offsets();
+			const auto counts = process_bands(rule, offsets, 0, m_tiles[0]);
+			finish_step(counts);
+		}
+
+		// multi-threaded version. the policy's chunk size counts elements.
+		template <typename rule_type>
+		void step(rule_type &&rule, const parallel_policy &policy)
+		{
+			const auto offsets = linear_offsets();
+			const size_t band_size = m_edge * (m_tiles[0] ? state().size() / state().dim_at(0) : 0);
+
+			parallel_policy band_policy = policy;
+			band_policy.chunk_size = std::max<size_t>(policy.chunk_size / std::max<size_t>(band_size, 1), 1);
+
+			std::vector<size_t> computed(band_policy.chunk_count(m_tiles[0]));
+			parallel_for(m_tiles[0], band_policy, [&](size_t begin, size_t end)
+			{
+				computed[begin / band_policy.chunk_size] = process_bands(rule, offsets, begin, end);
+			});
+
+			size_t total = 0;
+			for (const size_t count : computed)
+			{
+				total += count;
+			}
+			finish_step(total);
+		}
+
+		template <typename rule_type>
+		void run(size_t generations, rule_type &&rule)
+		{
+			for (size_t index = 0; index < generations; ++index)
+			{
+				step(rule);
+			}
+		}
+
+		template <typename rule_type>
+		void run(size_t generations, rule_type &&rule, const parallel_policy &policy)
+		{
+			for (size_t index = 0; index < generations; ++index)
+			{
+				step(rule, policy);
+			}
+		}
+
+	#pragma endregion
+
+	private:
+		void setup_tiles()
+		{
+			using mode = typename stencil_boundary<data_type>::mode;
+			const auto &dim = state().dim();
+
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				m_tiles[axis] = (dim[axis] + m_edge - 1) / m_edge;
+
+				// the tiles each tile of this axis reads from, following the boundary rules.
+				auto &reach = m_reach[axis];
+				reach.assign(m_tiles[axis], {});
+				const auto size = static_cast<std::ptrdiff_t>(dim[axis]);
+				const auto radius = static_cast<std::ptrdiff_t>(m_radius);
+				for (size_t tile = 0; tile < m_tiles[axis]; ++tile)
+				{
+					const auto begin = static_cast<std::ptrdiff_t>(tile * m_edge);
+					const auto end = std::min(begin + static_cast<std::ptrdiff_t>(m_edge), size);
+					for (auto coord = begin - radius; coord < end + radius; ++coord)
+					{
+						auto mapped = coord;
+						if (coord < 0 || coord >= size)
+						{
+							if (m_boundary.get_mode() == mode::constant)
+							{
+								continue;
+							}
+							mapped = m_boundary.get_mode() == mode::wrap ? (coord % size + size) % size : std::clamp<std::ptrdiff_t>(coord, 0, size - 1);
+						}
+
+						const size_t neighbor = static_cast<size_t>(mapped) / m_edge;
+						if (std::find(reach[tile].begin(), reach[tile].end(), neighbor) == reach[tile].end())
+						{
+							reach[tile].push_back(neighbor);
+						}
+					}
+				}
+			}
+
+			// without a history, everything counts as changed.
+			m_changed.assign(m_tiles.elements(), 1);
+			m_next_changed.assign(m_tiles.elements(), 0);
+			m_computed = 0;
+		}
+
+		[[nodiscard]] std::vector<std::ptrdiff_t> linear_offsets() const
+		{
+			const auto &stride = state().stride();
+			std::vector<std::ptrdiff_t> result;
+			result.reserve(m_offsets.size());
+			for (const auto &offset : m_offsets)
+			{
+				std::ptrdiff_t linear = 0;
+				for (size_t axis = 0; axis < dimensions; ++axis)
+				{
+					linear += offset[axis] * stride[axis];
+				}
+				result.push_back(linear);
+			}
+			return result;
+		}
+
+		void finish_step(size_t computed)
+		{
+			m_buffer.swap();
+			std::swap(m_changed, m_next_changed);
+			m_computed = computed;
+			++m_generation;
+		}
+
+		// true if any tile the neighborhood of this tile reaches into has changed during the last step.
+		[[nodiscard]] bool needs_update(const grid_size<dimensions> &tile) const
+		{
+			grid_size<dimensions> choices{};
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				choices[axis] = m_reach[axis][tile[axis]].size();
+			}
+
+			for (grid_pos<dimensions> pos{ choices }; pos.valid(); ++pos)
+			{
+				grid_size<dimensions> neighbor{};
+				for (size_t axis = 0; axis < dimensions; ++axis)
+				{
+					neighbor[axis] = m_reach[axis][tile[axis]][pos.pos_at(axis)];
+				}
+				if (m_changed[m_tiles.index_of(neighbor)])
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// processes all tiles in the bands [band_begin, band_end) along the first axis. returns the amount of computed tiles.
+		template <typename rule_type>
+		size_t process_bands(rule_type &rule, const std::vector<std::ptrdiff_t> &offsets, size_t band_begin, size_t band_end)
+		{
+			auto band_tiles = m_tiles;
+			band_tiles[0] = band_end - band_begin;
+
+			size_t computed = 0;
+			for (grid_pos<dimensions> pos{ band_tiles }; pos.valid(); ++pos)
+			{
+				auto tile = pos.pos();
+				tile[0] += band_begin;
+
+				const size_t index = m_tiles.index_of(tile);
+				if (!needs_update(tile))
+				{
+					m_next_changed[index] = 0;
+					continue;
+				}
+				m_next_changed[index] = process_tile(rule, offsets, tile);
+				++computed;
+			}
+			return computed;
+		}
+
+		// computes one tile row by row. returns whether any cell changed.
+		template <typename rule_type>
+		bool process_tile(rule_type &rule, const std::vector<std::ptrdiff_t> &offsets, const grid_size<dimensions> &tile)
+		{
+			const grid_type &source = m_buffer.front();
+			data_type *output = m_buffer.back().data();
+			const data_type *input = source.data();
+			const auto &dim = source.dim();
+
+			grid_size<dimensions> begin{}, rows{};
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				begin[axis] = tile[axis] * m_edge;
+				rows[axis] = std::min(begin[axis] + m_edge, dim[axis]) - begin[axis];
+			}
+			const size_t width = rows[dimensions - 1];
+			rows[dimensions - 1] = 1;
+
+			// columns in which the whole neighborhood lies inside of the grid.
+			const size_t last = dimensions - 1;
+			const size_t inner_begin = std::clamp(m_radius, begin[last], begin[last] + width);
+			const size_t inner_end = std::clamp(dim[last] > m_radius ? dim[last] - m_radius : 0, inner_begin, begin[last] + width);
+
+			bool changed = false;
+			std::vector<sum_type> sums(width);
+			for (grid_pos<dimensions> row{ rows }; row.valid(); ++row)
+			{
+				auto pos = begin;
+				bool inner_row = true;
+				for (size_t axis = 0; axis < last; ++axis)
+				{
+					pos[axis] += row.pos_at(axis);
+					inner_row = inner_row && pos[axis] >= m_radius && pos[axis] + m_radius < dim[axis];
+				}
+
+				const size_t base = source.index_of(pos);
+				const size_t fast_begin = inner_row ? inner_begin : begin[last] + width;
+				const size_t fast_end = inner_row ? inner_end : begin[last] + width;
+
+				const auto store = [&](size_t column, const sum_type &sum)
+				{
+					const size_t index = base + column - begin[last];
+					const data_type next = static_cast<data_type>(rule(input[index], sum));
+					changed |= !(next == input[index]);
+					output[index] = next;
+				};
+
+				const auto border = [&](size_t column)
+				{
+					pos[last] = column;
+					store(column, border_sum(source, pos));
+				};
+
+				for (size_t column = begin[last]; column < fast_begin; ++column)
+				{
+					border(column);
+				}
+
+				// fast path: one neighbor at a time over the whole segment, like the stencil does.
+				const size_t count = fast_end - fast_begin;
+				const data_type *segment = input + (base + fast_begin - begin[last]);
+				std::fill_n(sums.begin(), count, sum_type{});
+				for (const std::ptrdiff_t offset : offsets)
+				{
+					const data_type *neighbors = segment + offset;
+					for (size_t column = 0; column < count; ++column)
+					{
+						sums[column] += neighbors[column];
+					}
+				}
+
+				// plain locals instead of the lambda: byte sized cells may alias anything the lambda captured by reference.
+				const sum_type *sum = sums.data();
+				data_type *target = output + (segment - input);
+				bool differs = false;
+				for (size_t column = 0; column < count; ++column)
+				{
+					const data_type next = static_cast<data_type>(rule(segment[column], sum[column]));
+					differs |= !(next == segment[column]);
+					target[column] = next;
+				}
+				changed |= differs;
+
+				for (size_t column = fast_end; column < begin[last] + width; ++column)
+				{
+					border(column);
+				}
+			}
+			return changed;
+		}
+
+		// slow path for cells near the border: resolves every neighbor on its own.
+		[[nodiscard]] sum_type border_sum(const grid_type &source, const grid_size<dimensions> &pos) const
+		{
+			using mode = typename stencil_boundary<data_type>::mode;
+			const auto &dim = source.dim();
+
+			sum_type sum{};
+			for (const auto &offset : m_offsets)
+			{
+				grid_size<dimensions> neighbor{};
+				bool outside = false;
+				for (size_t axis = 0; axis < dimensions; ++axis)
+				{
+					const auto size = static_cast<std::ptrdiff_t>(dim[axis]);
+					auto coord = static_cast<std::ptrdiff_t>(pos[axis]) + offset[axis];
+					if (coord < 0 || coord >= size)
+					{
+						switch (m_boundary.get_mode())
+						{
+						case mode::clamp:    coord = std::clamp<std::ptrdiff_t>(coord, 0, size - 1); break;
+						case mode::wrap:     coord = (coord % size + size) % size; break;
+						case mode::constant: outside = true; break;
+						}
+					}
+					neighbor[axis] = static_cast<size_t>(coord);
+				}
+				sum += outside ? m_boundary.value() : source.at(neighbor);
+			}
+			return sum;
+		}
+
+		grid_double_buffer<data_type, dimensions> m_buffer;
+		stencil_boundary<data_type> m_boundary;
+		size_t m_radius, m_edge;
+		std::vector<grid_stride<dimensions>> m_offsets;
+
+		grid_size<dimensions> m_tiles{};
+		std::array<std::vector<std::vector<size_t>>, dimensions> m_reach;
+		std::vector<std::uint8_t> m_changed, m_next_changed;
+		size_t m_computed = 0, m_generation = 0;
+	};
+
+#pragma endregion
+}
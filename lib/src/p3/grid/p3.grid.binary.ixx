@@ -0,0 +1,795 @@
+#include <type_traits> // std::is_trivially_copyable_v
+#include <filesystem>
+#include <stdexcept>
+#include <algorithm>   // std::reverse()
+#include <fstream>
+#include <cstring>     // std::memcpy()
+#include <cstdint>
+#include <limits>      // std::numeric_limits
+#include <cstddef>     // std::byte
+#include <utility>     // std::exchange()
+#include <vector>
+#include <array>
+#include <span>
+#include <bit>         // std::endian
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+export module p3.grid.binary;
+/*
+	Binary grid module, part of github/TeraFlint/pitrilib.
+	Daniel Wiegert (Pitri), 2021.
+*/
+
+export import p3.grid;
+export import p3.persistence;
+// import <type_traits>; // std::is_trivially_copyable_v
+// import <filesystem>;
+// import <stdexcept>;
+// import <algorithm>;   // std::reverse()
+// import <fstream>;
+// import <cstring>;     // std::memcpy()
+// import <cstdint>;
+// import <limits>;      // std::numeric_limits
+// import <cstddef>;     // std::byte
+// import <utility>;     // std::exchange()
+// import <vector>;
+// import <array>;
+// import <span>;
+// import <bit>;         // std::endian
+
+namespace p3
+{
+#pragma region crc32
+
+	// lookup tables for slicing-by-8, reflected polynomial 0xEDB88320.
+	constexpr auto crc32_tables = []()
+	{
+		std::array<std::array<uint32_t, 256>, 8> result{};
+		for (uint32_t value = 0; value < 256; ++value)
+		{
+			uint32_t crc = value;
+			for (size_t bit = 0; bit < 8; ++bit)
+			{
+				crc = crc & 1 ? 0xEDB88320U ^ (crc >> 1) : crc >> 1;
+			}
+			result[0][value] = crc;
+		}
+		for (size_t table = 1; table < result.size(); ++table)
+		{
+			for (size_t value = 0; value < 256; ++value)
+			{
+				const uint32_t previous = result[table - 1][value];
+				result[table][value] = (previous >> 8) ^ result[0][previous & 0xFF];
+			}
+		}
+		return result;
+	}();
+
+	export
+	// the common crc-32 (zip, png, ethernet). pass the result of the previous call to continue a checksum.
+	[[nodiscard]] uint32_t crc32(std::span<const std::byte> bytes, uint32_t previous = 0)
+	{
+		const auto &table = crc32_tables;
+		const auto word = [](const std::byte *data)
+		{
+			return static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 | static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24;
+		};
+
+		uint32_t crc = ~previous;
+		const std::byte *data = bytes.data();
+		size_t remaining = bytes.size();
+		for (; remaining >= 8; remaining -= 8, data += 8)
+		{
+			const uint32_t low = word(data) ^ crc, high = word(data + 4);
+			crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^ table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+				table[3][high & 0xFF] ^ table[2][(high >> 8) & 0xFF] ^ table[1][(high >> 16) & 0xFF] ^ table[0][high >> 24];
+		}
+		for (; remaining > 0; --remaining, ++data)
+		{
+			crc = table[0][(crc ^ static_cast<uint32_t>(*data)) & 0xFF] ^ (crc >> 8);
+		}
+		return ~crc;
+	}
+
+#pragma endregion
+#pragma region binary format
+
+	/*
+		file layout (all numbers in the byte order of the machine that wrote the file):
+
+		offset  size        content
+		     0     8        magic "p3grid" + version (1) + 0
+		     8     2        byte order marker 0x0102
+		    10     1        element kind (raw, signed, unsigned, floating)
+		    11     1        element size in bytes
+		    12     4        rank
+		    16     8        data offset
+		    24     8*rank   dimensions
+		     -     -        zero padding up to the data offset (a multiple of 64)
+		  data     -        elements in row-major order
+	*/
+
+	export
+	class binary_grid_error : public std::exception { using std::exception::exception; };
+
+	export
+	enum class binary_element_kind : uint8_t
+	{
+		raw,      // any other trivially copyable type. can't be converted between byte orders.
+		signed_integer,
+		unsigned_integer,
+		floating_point,
+	};
+
+	export
+	struct binary_grid_header
+	{
+		static constexpr std::array<char, 8> magic{ 'p', '3', 'g', 'r', 'i', 'd', 1, 0 };
+		static constexpr uint16_t byte_order_marker = 0x0102;
+		static constexpr size_t fixed_size = 24;
+		static constexpr size_t alignment = 64;
+		// far beyond any real grid, it only keeps corrupted headers from allocating.
+		static constexpr uint32_t max_rank = 64;
+
+		binary_element_kind kind = binary_element_kind::raw;
+		uint8_t element_size = 0;
+		uint64_t data_offset = 0;
+		std::vector<uint64_t> dim;
+
+		// true if the file was written with the other byte order.
+		bool swapped = false;
+
+		template <typename data_type>
+		[[nodiscard]] static constexpr binary_element_kind kind_of()
+		{
+			if constexpr (std::is_floating_point_v<data_type>)
+			{
+				return binary_element_kind::floating_point;
+			}
+			else if constexpr (std::is_integral_v<data_type> && std::is_signed_v<data_type>)
+			{
+				return binary_element_kind::signed_integer;
+			}
+			else if constexpr (std::is_integral_v<data_type>)
+			{
+				return binary_element_kind::unsigned_integer;
+			}
+			else
+			{
+				return binary_element_kind::raw;
+			}
+		}
+
+		template <typename data_type, size_t dimensions>
+		[[nodiscard]] static binary_grid_header describe(const grid_size<dimensions> &size)
+		{
+			binary_grid_header result;
+			result.kind = kind_of<data_type>();
+			result.element_size = static_cast<uint8_t>(sizeof(data_type));
+			result.dim.assign(size.begin(), size.end());
+			result.data_offset = data_offset_for(dimensions);
+			return result;
+		}
+
+		[[nodiscard]] static constexpr uint64_t data_offset_for(size_t rank)
+		{
+			return (fixed_size + 8 * rank + alignment - 1) / alignment * alignment;
+		}
+
+		// throws binary_grid_error if the count doesn't fit into size_t.
+		[[nodiscard]] uint64_t elements() const
+		{
+			uint64_t result = 1;
+			for (const auto &extent : dim)
+			{
+				if (extent != 0 && result > std::numeric_limits<size_t>::max() / extent)
+				{
+					throw binary_grid_error("binary grid: the dimensions are too large.");
+				}
+				result *= extent;
+			}
+			return result;
+		}
+
+		// checks whether the file content fits a grid<data_type, dimensions>. throws binary_grid_error otherwise.
+		template <typename data_type, size_t dimensions>
+		void expect() const
+		{
+			if (dim.size() != dimensions)
+			{
+				throw binary_grid_error("binary grid: rank mismatch.");
+			}
+			if (kind != kind_of<data_type>() || element_size != sizeof(data_type))
+			{
+				throw binary_grid_error("binary grid: element type mismatch.");
+			}
+			if (swapped && kind == binary_element_kind::raw)
+			{
+				throw binary_grid_error("binary grid: raw elements can't be converted from a foreign byte order.");
+			}
+			if (elements() > std::numeric_limits<size_t>::max() / sizeof(data_type))
+			{
+				throw binary_grid_error("binary grid: the dimensions are too large.");
+			}
+		}
+
+		template <size_t dimensions>
+		[[nodiscard]] grid_size<dimensions> size() const
+		{
+			grid_size<dimensions> result{};
+			for (size_t axis = 0; axis < dimensions && axis < dim.size(); ++axis)
+			{
+				result[axis] = static_cast<size_t>(dim[axis]);
+			}
+			return result;
+		}
+
+		[[nodiscard]] std::vector<std::byte> serialize() const
+		{
+			std::vector<std::byte> result(static_cast<size_t>(data_offset));
+			const uint32_t rank = static_cast<uint32_t>(dim.size());
+			const uint8_t kind_value = static_cast<uint8_t>(kind);
+
+			std::memcpy(result.data(), magic.data(), magic.size());
+			std::memcpy(result.data() + 8, &byte_order_marker, 2);
+			std::memcpy(result.data() + 10, &kind_value, 1);
+			std::memcpy(result.data() + 11, &element_size, 1);
+			std::memcpy(result.data() + 12, &rank, 4);
+			std::memcpy(result.data() + 16, &data_offset, 8);
+			std::memcpy(result.data() + fixed_size, dim.data(), 8 * dim.size());
+			return result;
+		}
+
+		// parses the fixed part of the header. returns the rank, the dimensions follow with parse_dim().
+		[[nodiscard]] static binary_grid_header parse_fixed(std::span<const std::byte> bytes, uint32_t &rank)
+		{
+			if (bytes.size() < fixed_size || std::memcmp(bytes.data(), magic.data(), magic.size()) != 0)
+			{
+				throw binary_grid_error("binary grid: not a grid file.");
+			}
+
+			binary_grid_header result;
+			uint16_t marker = 0;
+			uint8_t kind_value = 0;
+			std::memcpy(&marker, bytes.data() + 8, 2);
+			std::memcpy(&kind_value, bytes.data() + 10, 1);
+			std::memcpy(&result.element_size, bytes.data() + 11, 1);
+			std::memcpy(&rank, bytes.data() + 12, 4);
+			std::memcpy(&result.data_offset, bytes.data() + 16, 8);
+
+			if (marker != byte_order_marker)
+			{
+				if (marker != swap_bytes(byte_order_marker))
+				{
+					throw binary_grid_error("binary grid: invalid byte order marker.");
+				}
+				result.swapped = true;
+				rank = swap_bytes(rank);
+				result.data_offset = swap_bytes(result.data_offset);
+			}
+
+			if (kind_value > static_cast<uint8_t>(binary_element_kind::floating_point) || rank > max_rank ||
+				result.data_offset < fixed_size + 8ULL * rank || result.data_offset > data_offset_for(rank) + alignment)
+			{
+				throw binary_grid_error("binary grid: corrupted header.");
+			}
+			result.kind = static_cast<binary_element_kind>(kind_value);
+			return result;
+		}
+
+		void parse_dim(std::span<const std::byte> bytes, uint32_t rank)
+		{
+			dim.resize(rank);
+			std::memcpy(dim.data(), bytes.data(), 8 * rank);
+			if (swapped)
+			{
+				for (auto &extent : dim)
+				{
+					extent = swap_bytes(extent);
+				}
+			}
+		}
+
+		template <typename type>
+		[[nodiscard]] static constexpr type swap_bytes(type value)
+		{
+			auto bytes = std::bit_cast<std::array<std::byte, sizeof(type)>>(value);
+			std::reverse(bytes.begin(), bytes.end());
+			return std::bit_cast<type>(bytes);
+		}
+	};
+
+	export
+	// writes the header, followed by the elements in row-major order (no matter the layout of the grid).
+	template <typename data_type, size_t dimensions, typename layout_type, typename allocator_type>
+	void write_binary(std::ostream &stream, const grid<data_type, dimensions, layout_type, allocator_type> &source)
+	{
+		static_assert(std::is_trivially_copyable_v<data_type>, "write_binary: the elements must be trivially copyable.");
+		static_assert(sizeof(data_type) < 256, "write_binary: the element size doesn't fit into the header.");
+
+		const auto header = binary_grid_header::describe<data_type>(source.dim());
+		const auto bytes = header.serialize();
+		stream.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+
+		if constexpr (layout_type::is_row_major)
+		{
+			stream.write(reinterpret_cast<const char *>(source.data()), source.size() * sizeof(data_type));
+		}
+		else
+		{
+			for (grid_pos<dimensions> pos{ source.dim() }; pos.valid(); ++pos)
+			{
+				stream.write(reinterpret_cast<const char *>(&source.at(pos.pos())), sizeof(data_type));
+			}
+		}
+
+		if (!stream)
+		{
+			throw binary_grid_error("write_binary: writing failed.");
+		}
+	}
+
+	export
+	[[nodiscard]] binary_grid_header read_binary_header(std::istream &stream)
+	{
+		std::array<std::byte, binary_grid_header::fixed_size> fixed{};
+		stream.read(reinterpret_cast<char *>(fixed.data()), fixed.size());
+		if (!stream)
+		{
+			throw binary_grid_error("read_binary: unexpected end of the stream.");
+		}
+
+		uint32_t rank = 0;
+		auto header = binary_grid_header::parse_fixed(fixed, rank);
+
+		std::vector<std::byte> remaining(static_cast<size_t>(header.data_offset) - fixed.size());
+		stream.read(reinterpret_cast<char *>(remaining.data()), remaining.size());
+		if (!stream)
+		{
+			throw binary_grid_error("read_binary: unexpected end of the stream.");
+		}
+		header.parse_dim(remaining, rank);
+		return header;
+	}
+
+	// the number of bytes between the current position and the end of the stream, or false if the stream can't seek.
+	[[nodiscard]] inline bool remaining_bytes(std::istream &stream, uint64_t &result)
+	{
+		const auto start = stream.tellg();
+		if (start == std::istream::pos_type(-1) || !stream.seekg(0, std::ios::end))
+		{
+			stream.clear();
+			return false;
+		}
+		const auto end = stream.tellg();
+		stream.seekg(start);
+		if (end == std::istream::pos_type(-1) || end < start || !stream)
+		{
+			stream.clear();
+			stream.seekg(start);
+			return false;
+		}
+		result = static_cast<uint64_t>(end - start);
+		return true;
+	}
+
+	export
+	/*
+		reads a grid written by write_binary(). files of the other byte order get converted.
+		the header can't claim more elements than the stream holds: seekable streams get measured up front,
+		the others are read in pieces of bounded size before the grid gets allocated.
+	*/
+	template <typename data_type, size_t dimensions>
+	[[nodiscard]] grid<data_type, dimensions> read_binary(std::istream &stream)
+	{
+		static_assert(std::is_trivially_copyable_v<data_type>, "read_binary: the elements must be trivially copyable.");
+		constexpr size_t piece_size = size_t{ 1 } << 20;
+
+		const auto header = read_binary_header(stream);
+		header.expect<data_type, dimensions>();
+		const size_t byte_count = static_cast<size_t>(header.elements()) * sizeof(data_type);
+
+		grid<data_type, dimensions> result;
+		uint64_t available = 0;
+		if (remaining_bytes(stream, available))
+		{
+			if (byte_count > available)
+			{
+				throw binary_grid_error("read_binary: unexpected end of the stream.");
+			}
+			result = grid<data_type, dimensions>(header.size<dimensions>());
+			stream.read(reinterpret_cast<char *>(result.data()), static_cast<std::streamsize>(byte_count));
+		}
+		else
+		{
+			std::vector<std::byte> bytes;
+			while (stream && bytes.size() < byte_count)
+			{
+				const size_t offset = bytes.size();
+				bytes.resize(offset + std::min(piece_size, byte_count - offset));
+				stream.read(reinterpret_cast<char *>(bytes.data() + offset), static_cast<std::streamsize>(bytes.size() - offset));
+			}
+			if (stream && byte_count != 0)
+			{
+				result = grid<data_type, dimensions>(header.size<dimensions>());
+				std::memcpy(result.data(), bytes.data(), byte_count);
+			}
+		}
+		if (!stream)
+		{
+			throw binary_grid_error("read_binary: unexpected end of the stream.");
+		}
+
+		if (header.swapped)
+		{
+			for (auto &val : result)
+			{
+				val = binary_grid_header::swap_bytes(val);
+			}
+		}
+		return result;
+	}
+
+	export
+	/*
+		same format as above, into a byte_writer. the elements of row-major grids don't get copied, they're appended
+		by reference (byte_writer::write_external()), so the grid has to stay unchanged until the output has been used.
+	*/
+	template <typename data_type, size_t dimensions, typename layout_type, typename allocator_type>
+	void write_binary(byte_writer &writer, const grid<data_type, dimensions, layout_type, allocator_type> &source)
+	{
+		static_assert(std::is_trivially_copyable_v<data_type>, "write_binary: the elements must be trivially copyable.");
+		static_assert(sizeof(data_type) < 256, "write_binary: the element size doesn't fit into the header.");
+
+		writer.write(binary_grid_header::describe<data_type>(source.dim()).serialize());
+
+		if constexpr (layout_type::is_row_major)
+		{
+			writer.write_external(std::as_bytes(std::span(source.data(), source.size())));
+		}
+		else
+		{
+			for (grid_pos<dimensions> pos{ source.dim() }; pos.valid(); ++pos)
+			{
+				writer.write_value(source.at(pos.pos()));
+			}
+		}
+	}
+
+	export
+	template <typename data_type, size_t dimensions>
+	[[nodiscard]] grid<data_type, dimensions> read_binary(byte_reader &reader)
+	{
+		static_assert(std::is_trivially_copyable_v<data_type>, "read_binary: the elements must be trivially copyable.");
+
+		uint32_t rank = 0;
+		auto header = binary_grid_header::parse_fixed(reader.view(binary_grid_header::fixed_size), rank);
+		const auto remaining = reader.view(static_cast<size_t>(header.data_offset) - binary_grid_header::fixed_size);
+		if (!reader.good())
+		{
+			throw binary_grid_error("read_binary: unexpected end of the input.");
+		}
+		header.parse_dim(remaining, rank);
+		header.expect<data_type, dimensions>();
+		if (header.elements() > reader.remaining() / sizeof(data_type))
+		{
+			throw binary_grid_error("read_binary: unexpected end of the input.");
+		}
+
+		grid<data_type, dimensions> result(header.size<dimensions>());
+		if (!reader.read(std::as_writable_bytes(std::span(result.data(), result.size()))))
+		{
+			throw binary_grid_error("read_binary: unexpected end of the input.");
+		}
+
+		if (header.swapped)
+		{
+			for (auto &val : result)
+			{
+				val = binary_grid_header::swap_bytes(val);
+			}
+		}
+		return result;
+	}
+
+	export
+	template <typename data_type, size_t dimensions, typename layout_type, typename allocator_type>
+	void save_binary(const std::filesystem::path &location, const grid<data_type, dimensions, layout_type, allocator_type> &source)
+	{
+		std::ofstream file(location, std::ios::binary);
+		if (!file)
+		{
+			throw binary_grid_error("save_binary: can't open the file.");
+		}
+		write_binary(file, source);
+	}
+
+	export
+	template <typename data_type, size_t dimensions>
+	[[nodiscard]] grid<data_type, dimensions> load_binary(const std::filesystem::path &location)
+	{
+		std::ifstream file(location, std::ios::binary);
+		if (!file)
+		{
+			throw binary_grid_error("load_binary: can't open the file.");
+		}
+		return read_binary<data_type, dimensions>(file);
+	}
+
+#pragma endregion
+#pragma region memory mapping
+
+	export
+	enum class map_mode
+	{
+		read_only,      // the pages are shared with the file and can't be written.
+		copy_on_write,  // writing creates private copies of the touched pages. the file never changes.
+	};
+
+	export
+	/*
+		maps a whole file into memory. the operating system loads the pages lazily on first access,
+		so opening even huge files takes no time.
+	*/
+	class mapped_file
+	{
+	public:
+		explicit mapped_file(const std::filesystem::path &location, map_mode mode = map_mode::read_only)
+		{
+#if defined(_WIN32)
+			m_file = CreateFileW(location.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (m_file == INVALID_HANDLE_VALUE)
+			{
+				throw binary_grid_error("mapped_file: can't open the file.");
+			}
+
+			LARGE_INTEGER size{};
+			GetFileSizeEx(m_file, &size);
+			m_size = static_cast<size_t>(size.QuadPart);
+
+			if (m_size > 0)
+			{
+				m_mapping = CreateFileMappingW(m_file, nullptr, mode == map_mode::read_only ? PAGE_READONLY : PAGE_WRITECOPY, 0, 0, nullptr);
+				m_address = m_mapping ? MapViewOfFile(m_mapping, mode == map_mode::read_only ? FILE_MAP_READ : FILE_MAP_COPY, 0, 0, 0) : nullptr;
+				if (!m_address)
+				{
+					close();
+					throw binary_grid_error("mapped_file: mapping failed.");
+				}
+			}
+#else
+			const int file = ::open(location.c_str(), O_RDONLY);
+			if (file < 0)
+			{
+				throw binary_grid_error("mapped_file: can't open the file.");
+			}
+
+			struct stat info{};
+			::fstat(file, &info);
+			m_size = static_cast<size_t>(info.st_size);
+
+			if (m_size > 0)
+			{
+				const int protection = mode == map_mode::read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+				void *address = ::mmap(nullptr, m_size, protection, MAP_PRIVATE, file, 0);
+				m_address = address == MAP_FAILED ? nullptr : address;
+			}
+			// the mapping stays valid without the descriptor.
+			::close(file);
+
+			if (m_size > 0 && !m_address)
+			{
+				throw binary_grid_error("mapped_file: mapping failed.");
+			}
+#endif
+		}
+
+		mapped_file(mapped_file &&other) noexcept
+			: m_address{ std::exchange(other.m_address, nullptr) }, m_size{ std::exchange(other.m_size, 0) }
+#if defined(_WIN32)
+			, m_file{ std::exchange(other.m_file, INVALID_HANDLE_VALUE) }, m_mapping{ std::exchange(other.m_mapping, nullptr) }
+#endif
+		{
+		}
+
+		mapped_file &operator=(mapped_file &&other) noexcept
+		{
+			if (this != &other)
+			{
+				close();
+				m_address = std::exchange(other.m_address, nullptr);
+				m_size = std::exchange(other.m_size, 0);
+#if defined(_WIN32)
+				m_file = std::exchange(other.m_file, INVALID_HANDLE_VALUE);
+				m_mapping = std::exchange(other.m_mapping, nullptr);
+#endif
+			}
+			return *this;
+		}
+
+		~mapped_file()
+		{
+			close();
+		}
+
+		[[nodiscard]] std::byte *data()
+		{
+			return static_cast<std::byte *>(m_address);
+		}
+
+		[[nodiscard]] const std::byte *data() const
+		{
+			return static_cast<const std::byte *>(m_address);
+		}
+
+		[[nodiscard]] size_t size() const
+		{
+			return m_size;
+		}
+
+	private:
+		void close()
+		{
+#if defined(_WIN32)
+			if (m_address)
+			{
+				UnmapViewOfFile(m_address);
+			}
+			if (m_mapping)
+			{
+				CloseHandle(m_mapping);
+			}
+			if (m_file != INVALID_HANDLE_VALUE)
+			{
+				CloseHandle(m_file);
+			}
+			m_mapping = nullptr;
+			m_file = INVALID_HANDLE_VALUE;
+#else
+			if (m_address)
+			{
+				::munmap(m_address, m_size);
+			}
+#endif
+			m_address = nullptr;
+			m_size = 0;
+		}
+
+		void *m_address = nullptr;
+		size_t m_size = 0;
+#if defined(_WIN32)
+		HANDLE m_file = INVALID_HANDLE_VALUE;
+		HANDLE m_mapping = nullptr;
+#endif
+	};
+
+	export
+	/*
+		a binary grid file (see write_binary()), mapped into memory instead of being read.
+		the elements are used right where they lie, which requires a file written with the native byte order.
+		read-only grids share their pages with the file cache, copy-on-write grids may be modified without touching the file.
+	*/
+	template <typename data_type, size_t dimensions>
+	class mapped_grid
+	{
+		static_assert(std::is_trivially_copyable_v<data_type>, "mapped_grid: the elements must be trivially copyable.");
+		static_assert(alignof(data_type) <= binary_grid_header::alignment, "mapped_grid: the elements are aligned too strictly.");
+
+	public:
+		explicit mapped_grid(const std::filesystem::path &location, map_mode mode = map_mode::read_only)
+			: m_file(location, mode), m_mode{ mode }
+		{
+			const std::span<const std::byte> bytes(m_file.data(), m_file.size());
+			uint32_t rank = 0;
+			auto header = binary_grid_header::parse_fixed(bytes, rank);
+			if (bytes.size() < header.data_offset)
+			{
+				throw binary_grid_error("mapped_grid: truncated header.");
+			}
+			header.parse_dim(bytes.subspan(binary_grid_header::fixed_size), rank);
+			header.expect<data_type, dimensions>();
+
+			if (header.swapped)
+			{
+				throw binary_grid_error("mapped_grid: the file has a foreign byte order, use read_binary() instead.");
+			}
+			if (header.data_offset % binary_grid_header::alignment != 0)
+			{
+				throw binary_grid_error("mapped_grid: the element data is misaligned.");
+			}
+			if (header.elements() > (bytes.size() - header.data_offset) / sizeof(data_type))
+			{
+				throw binary_grid_error("mapped_grid: truncated element data.");
+			}
+
+			m_dim = header.size<dimensions>();
+			m_data = reinterpret_cast<data_type *>(m_file.data() + header.data_offset);
+		}
+
+		[[nodiscard]] constexpr size_t rank() const
+		{
+			return dimensions;
+		}
+
+		[[nodiscard]] grid_size<dimensions> dim() const
+		{
+			return m_dim;
+		}
+
+		[[nodiscard]] size_t size() const
+		{
+			return m_dim.elements();
+		}
+
+		[[nodiscard]] map_mode mode() const
+		{
+			return m_mode;
+		}
+
+		[[nodiscard]] const data_type *data() const
+		{
+			return m_data;
+		}
+
+		[[nodiscard]] const data_type &at(const grid_size<dimensions> &pos) const
+		{
+			return m_data[m_dim.index_of(pos)];
+		}
+
+		// writable access, only for copy-on-write mappings.
+		[[nodiscard]] data_type &at(const grid_size<dimensions> &pos)
+		{
+			return writable()[m_dim.index_of(pos)];
+		}
+
+		[[nodiscard]] grid_view<const data_type, dimensions> view() const
+		{
+			return grid_view<const data_type, dimensions>(m_data, m_dim);
+		}
+
+		// writable view, only for copy-on-write mappings.
+		[[nodiscard]] grid_view<data_type, dimensions> view()
+		{
+			return grid_view<data_type, dimensions>(writable(), m_dim);
+		}
+
+		template <typename function_type>
+		void iterate(function_type &&function) const
+		{
+			view().iterate(function);
+		}
+
+		// copies the elements into a regular grid.
+		[[nodiscard]] grid<data_type, dimensions> to_grid() const
+		{
+			return grid<data_type, dimensions>(view());
+		}
+
+	private:
+		data_type *writable()
+		{
+			if (m_mode != map_mode::copy_on_write)
+			{
+				throw binary_grid_error("mapped_grid: read-only mapping.");
+			}
+			return m_data;
+		}
+
+		mapped_file m_file;
+		map_mode m_mode;
+		grid_size<dimensions> m_dim{};
+		data_type *m_data = nullptr;
+	};
+
+#pragma endregion
+}
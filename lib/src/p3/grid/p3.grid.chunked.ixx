@@ -0,0 +1,603 @@
+#include <type_traits> // std::is_trivially_copyable_v
+#include <filesystem>
+#include <algorithm>   // std::fill_n(), std::min()
+#include <iostream>
+#include <fstream>
+#include <cstring>     // std::memcpy(), std::memcmp()
+#include <cstdint>
+#include <limits>      // std::numeric_limits
+#include <cstddef>     // std::byte
+#include <utility>     // std::move()
+#include <vector>
+#include <array>
+#include <span>
+
+export module p3.grid.chunked;
+/*
+	Chunked grid module, part of github/TeraFlint/pitrilib.
+	Daniel Wiegert (Pitri), 2021.
+*/
+
+export import p3.grid;
+export import p3.grid.binary;
+export import p3.persistence;
+// import <type_traits>; // std::is_trivially_copyable_v
+// import <filesystem>;
+// import <algorithm>;   // std::fill_n(), std::min()
+// import <iostream>;
+// import <fstream>;
+// import <cstring>;     // std::memcpy(), std::memcmp()
+// import <cstdint>;
+// import <limits>;      // std::numeric_limits
+// import <cstddef>;     // std::byte
+// import <utility>;     // std::move()
+// import <vector>;
+// import <array>;
+// import <span>;
+
+namespace p3
+{
+#pragma region chunked format
+
+	/*
+		container layout (all numbers in the byte order of the machine that wrote it, offsets relative to the container start):
+
+		offset  size        content
+		     0     8        magic "p3chunk" + version (1)
+		     8     2        byte order marker 0x0102
+		    10     1        element kind (see binary_element_kind)
+		    11     1        element size in bytes
+		    12     4        rank
+		    16     8        index offset
+		    24     8*rank   dimensions
+		     -     8*rank   chunk dimensions
+		     -     -        zero padding up to a multiple of 64
+		     -     -        the chunks, one after another
+		 index    24*n      per chunk (row-major chunk order): offset (8), stored size (8), crc-32 (4), encoding (1), zero (3)
+		     -     4        crc-32 of the index table
+
+		every chunk covers chunk dimensions elements (less at the far edges), stored in row-major order inside of the chunk.
+		chunks consisting of a single repeated value only store that value.
+	*/
+
+	export
+	enum class chunk_encoding : uint8_t
+	{
+		raw,     // all elements of the chunk.
+		uniform, // one element, repeated over the whole chunk.
+	};
+
+	export
+	/*
+		grid container made of independently stored chunks, each one with its own checksum.
+		besides loading and saving everything (file_access, stream_access), load_region() only reads the chunks
+		overlapping a region, which makes slices of huge grids cheap. the streams have to be seekable.
+	*/
+	template <typename data_type, size_t dimensions>
+	class chunked_grid_file : public file_access, public stream_access
+	{
+		static_assert(std::is_trivially_copyable_v<data_type>, "chunked_grid_file: the elements must be trivially copyable.");
+		static_assert(sizeof(data_type) < 256, "chunked_grid_file: the element size doesn't fit into the header.");
+		static_assert(dimensions > 0, "chunked_grid_file: grids need at least one dimension.");
+
+	public:
+		using grid_type = grid<data_type, dimensions>;
+
+		struct statistics
+		{
+			size_t chunks_read = 0; // chunks decoded by the reads so far.
+			size_t bytes_read = 0;  // bytes read for these chunks, without header and index.
+		};
+
+		static constexpr std::array<char, 8> magic{ 'p', '3', 'c', 'h', 'u', 'n', 'k', 1 };
+		static constexpr uint16_t byte_order_marker = 0x0102;
+		static constexpr size_t alignment = 64;
+
+		explicit chunked_grid_file(const grid_size<dimensions> &chunk)
+			: m_chunk{ chunk }
+		{
+			check_chunk();
+		}
+
+		chunked_grid_file(grid_type content, const grid_size<dimensions> &chunk)
+			: m_content{ std::move(content) }, m_chunk{ chunk }
+		{
+			m_file_dim = m_content.dim();
+			m_region = grid_box<dimensions>::whole(m_file_dim);
+			check_chunk();
+		}
+
+		[[nodiscard]] grid_type &content()
+		{
+			return m_content;
+		}
+
+		[[nodiscard]] const grid_type &content() const
+		{
+			return m_content;
+		}
+
+		[[nodiscard]] grid_size<dimensions> chunk_dim() const
+		{
+			return m_chunk;
+		}
+
+		// dimensions of the whole grid in the container that was read last.
+		[[nodiscard]] grid_size<dimensions> file_dim() const
+		{
+			return m_file_dim;
+		}
+
+		// the part of the stored grid that content() holds after the last read.
+		[[nodiscard]] grid_box<dimensions> region() const
+		{
+			return m_region;
+		}
+
+		[[nodiscard]] statistics stats() const
+		{
+			return m_stats;
+		}
+
+		void reset_stats()
+		{
+			m_stats = {};
+		}
+
+		// replaces content() with the box [low, high) of the stored grid, reading only the chunks that overlap with it.
+		void load_region(const path_type &location, const grid_size<dimensions> &low, const grid_size<dimensions> &high)
+		{
+			std::ifstream file(location, std::ios::binary);
+			if (!file)
+			{
+				throw no_file("chunked_grid_file: can't open the file.");
+			}
+			read_region(file, { low, high });
+		}
+
+		// same as load_region(), for a container starting at the current position of the stream.
+		void read_region(std::istream &stream, const grid_box<dimensions> &box)
+		{
+			const auto start = stream.tellg();
+			const header info = read_header(stream, start);
+			if (!grid_box<dimensions>::whole(info.dim).contains(box))
+			{
+				throw binary_grid_error("chunked_grid_file: the region reaches outside of the grid.");
+			}
+
+			const auto index = read_index(stream, start, info);
+			grid_type result(box.dim());
+			std::vector<data_type> elements;
+			std::vector<std::byte> bytes;
+
+			// the chunks overlapping with the box.
+			grid_box<dimensions> chunks{};
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				chunks.low[axis] = box.low[axis] / info.chunk[axis];
+				chunks.high[axis] = box.empty() ? chunks.low[axis] : (box.high[axis] - 1) / info.chunk[axis] + 1;
+			}
+
+			auto position = stream.tellg();
+			for (grid_pos<dimensions> chunk_pos{ chunks.dim() }; !box.empty() && chunk_pos.valid(); ++chunk_pos)
+			{
+				grid_size<dimensions> chunk = chunk_pos.pos();
+				for (size_t axis = 0; axis < dimensions; ++axis)
+				{
+					chunk[axis] += chunks.low[axis];
+				}
+
+				const index_entry &entry = index[info.chunk_grid().index_of(chunk)];
+				const auto chunk_box = info.chunk_box(chunk);
+				if (entry.size != stored_size(entry.encoding, chunk_box.elements()))
+				{
+					throw binary_grid_error("chunked_grid_file: chunk size mismatch.");
+				}
+				if (position != start + static_cast<std::streamoff>(entry.offset))
+				{
+					// consecutive chunks are read without seeking, so the stream buffer survives.
+					position = start + static_cast<std::streamoff>(entry.offset);
+					stream.seekg(position);
+				}
+				bytes.resize(static_cast<size_t>(entry.size));
+				stream.read(reinterpret_cast<char *>(bytes.data()), bytes.size());
+				position += static_cast<std::streamoff>(bytes.size());
+				if (!stream)
+				{
+					throw binary_grid_error("chunked_grid_file: unexpected end of the stream.");
+				}
+				if (crc32(bytes) != entry.crc)
+				{
+					throw binary_grid_error("chunked_grid_file: checksum mismatch, the chunk is corrupted.");
+				}
+
+				decode(entry, bytes, chunk_box.elements(), info.swapped, elements);
+
+				const auto overlap = chunk_box.intersect(box);
+				copy_region(grid_view<const data_type, dimensions>(elements.data(), chunk_box.dim()).region(relative(overlap, chunk_box.low)),
+					result.view().region(relative(overlap, box.low)));
+
+				++m_stats.chunks_read;
+				m_stats.bytes_read += bytes.size();
+			}
+
+			m_content = std::move(result);
+			m_chunk = info.chunk;
+			m_file_dim = info.dim;
+			m_region = box;
+		}
+
+	protected:
+		bool on_load(const path_type &location) override
+		{
+			std::ifstream file(location, std::ios::binary);
+			read(file);
+			return true;
+		}
+
+		bool on_save(const path_type &location) const override
+		{
+			std::ofstream file(location, std::ios::binary);
+			write(file);
+			return static_cast<bool>(file);
+		}
+
+		bool on_read(std::istream &stream) override
+		{
+			const auto start = stream.tellg();
+			const header info = read_header(stream, start);
+			stream.seekg(start);
+			read_region(stream, grid_box<dimensions>::whole(info.dim));
+			return true;
+		}
+
+		bool on_write(std::ostream &stream) const override
+		{
+			const auto start = stream.tellp();
+			if (start == std::ostream::pos_type(-1))
+			{
+				throw binary_grid_error("chunked_grid_file: the stream has to be seekable.");
+			}
+
+			header info{ m_content.dim(), m_chunk };
+			auto bytes = info.serialize();
+			stream.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+
+			const auto chunk_grid = info.chunk_grid();
+			std::vector<index_entry> index(chunk_grid.elements());
+			std::vector<data_type> elements;
+			uint64_t offset = bytes.size();
+
+			for (grid_pos<dimensions> chunk{ chunk_grid }; chunk.valid(); ++chunk)
+			{
+				const auto box = info.chunk_box(chunk.pos());
+				elements.resize(box.elements());
+				copy_region(m_content.view().region(box), grid_view<data_type, dimensions>(elements.data(), box.dim()));
+
+				index_entry &entry = index[chunk.index()];
+				entry.encoding = is_uniform(elements) ? chunk_encoding::uniform : chunk_encoding::raw;
+				entry.offset = offset;
+				entry.size = stored_size(entry.encoding, elements.size());
+
+				const std::span<const std::byte> stored(reinterpret_cast<const std::byte *>(elements.data()), static_cast<size_t>(entry.size));
+				entry.crc = crc32(stored);
+				stream.write(reinterpret_cast<const char *>(stored.data()), stored.size());
+				offset += entry.size;
+			}
+
+			const auto table = serialize_index(index);
+			stream.write(reinterpret_cast<const char *>(table.data()), table.size());
+			const auto end = stream.tellp();
+
+			// now that the index position is known, the header gets completed.
+			info.index_offset = offset;
+			bytes = info.serialize();
+			stream.seekp(start);
+			stream.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+			stream.seekp(end);
+			return static_cast<bool>(stream);
+		}
+
+	private:
+		static constexpr size_t fixed_size = 24;
+		static constexpr size_t entry_size = 24;
+
+		struct index_entry
+		{
+			uint64_t offset = 0, size = 0;
+			uint32_t crc = 0;
+			chunk_encoding encoding = chunk_encoding::raw;
+		};
+
+		struct header
+		{
+			grid_size<dimensions> dim{}, chunk{};
+			uint64_t index_offset = 0;
+			uint64_t stream_size = 0; // from the start of the container to the end of the stream, only set by read_header().
+			bool swapped = false;
+
+			[[nodiscard]] grid_size<dimensions> chunk_grid() const
+			{
+				grid_size<dimensions> result{};
+				for (size_t axis = 0; axis < dimensions; ++axis)
+				{
+					result[axis] = dim[axis] / chunk[axis] + (dim[axis] % chunk[axis] != 0);
+				}
+				return result;
+			}
+
+			[[nodiscard]] grid_box<dimensions> chunk_box(const grid_size<dimensions> &chunk_pos) const
+			{
+				grid_box<dimensions> result{};
+				for (size_t axis = 0; axis < dimensions; ++axis)
+				{
+					result.low[axis] = chunk_pos[axis] * chunk[axis];
+					result.high[axis] = std::min(result.low[axis] + chunk[axis], dim[axis]);
+				}
+				return result;
+			}
+
+			[[nodiscard]] static constexpr size_t size()
+			{
+				return (fixed_size + 16 * dimensions + alignment - 1) / alignment * alignment;
+			}
+
+			[[nodiscard]] std::vector<std::byte> serialize() const
+			{
+				std::vector<std::byte> result(size());
+				const uint8_t kind = static_cast<uint8_t>(binary_grid_header::kind_of<data_type>()), element_size = sizeof(data_type);
+				const uint32_t rank = dimensions;
+				std::array<uint64_t, 2 * dimensions> extents{};
+				for (size_t axis = 0; axis < dimensions; ++axis)
+				{
+					extents[axis] = dim[axis];
+					extents[dimensions + axis] = chunk[axis];
+				}
+
+				std::memcpy(result.data(), magic.data(), magic.size());
+				std::memcpy(result.data() + 8, &byte_order_marker, 2);
+				std::memcpy(result.data() + 10, &kind, 1);
+				std::memcpy(result.data() + 11, &element_size, 1);
+				std::memcpy(result.data() + 12, &rank, 4);
+				std::memcpy(result.data() + 16, &index_offset, 8);
+				std::memcpy(result.data() + fixed_size, extents.data(), sizeof(extents));
+				return result;
+			}
+		};
+
+		void check_chunk() const
+		{
+			if (m_chunk.elements() == 0)
+			{
+				throw binary_grid_error("chunked_grid_file: chunks can't be empty.");
+			}
+		}
+
+		template <typename type>
+		[[nodiscard]] static type swapped_if(type value, bool swap)
+		{
+			return swap ? binary_grid_header::swap_bytes(value) : value;
+		}
+
+		[[nodiscard]] static header read_header(std::istream &stream, std::istream::pos_type start)
+		{
+			if (start == std::istream::pos_type(-1))
+			{
+				throw binary_grid_error("chunked_grid_file: the stream has to be seekable.");
+			}
+
+			std::array<std::byte, header::size()> bytes{};
+			stream.read(reinterpret_cast<char *>(bytes.data()), bytes.size());
+			if (!stream || std::memcmp(bytes.data(), magic.data(), magic.size()) != 0)
+			{
+				throw binary_grid_error("chunked_grid_file: not a chunked grid.");
+			}
+
+			header result;
+			uint16_t marker = 0;
+			uint8_t kind = 0, element_size = 0;
+			uint32_t rank = 0;
+			std::array<uint64_t, 2 * dimensions> extents{};
+			std::memcpy(&marker, bytes.data() + 8, 2);
+			std::memcpy(&kind, bytes.data() + 10, 1);
+			std::memcpy(&element_size, bytes.data() + 11, 1);
+			std::memcpy(&rank, bytes.data() + 12, 4);
+			std::memcpy(&result.index_offset, bytes.data() + 16, 8);
+			std::memcpy(extents.data(), bytes.data() + fixed_size, sizeof(extents));
+
+			if (marker != byte_order_marker)
+			{
+				if (marker != binary_grid_header::swap_bytes(byte_order_marker))
+				{
+					throw binary_grid_error("chunked_grid_file: invalid byte order marker.");
+				}
+				result.swapped = true;
+			}
+
+			if (swapped_if(rank, result.swapped) != dimensions)
+			{
+				throw binary_grid_error("chunked_grid_file: rank mismatch.");
+			}
+			if (kind != static_cast<uint8_t>(binary_grid_header::kind_of<data_type>()) || element_size != sizeof(data_type))
+			{
+				throw binary_grid_error("chunked_grid_file: element type mismatch.");
+			}
+			if (result.swapped && kind == static_cast<uint8_t>(binary_element_kind::raw))
+			{
+				throw binary_grid_error("chunked_grid_file: raw elements can't be converted from a foreign byte order.");
+			}
+
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				result.dim[axis] = static_cast<size_t>(swapped_if(extents[axis], result.swapped));
+				result.chunk[axis] = static_cast<size_t>(swapped_if(extents[dimensions + axis], result.swapped));
+			}
+			if (result.chunk.elements() == 0)
+			{
+				throw binary_grid_error("chunked_grid_file: corrupted header.");
+			}
+			result.index_offset = swapped_if(result.index_offset, result.swapped);
+
+			// the products below must not wrap around before they get compared with the stream length.
+			if (element_count(result.dim) > std::numeric_limits<size_t>::max() / sizeof(data_type))
+			{
+				throw binary_grid_error("chunked_grid_file: the dimensions are too large.");
+			}
+
+			const auto position = stream.tellg();
+			stream.seekg(0, std::ios::end);
+			const auto end = stream.tellg();
+			stream.seekg(position);
+			if (!stream || end == std::istream::pos_type(-1))
+			{
+				throw binary_grid_error("chunked_grid_file: the stream has to be seekable.");
+			}
+			result.stream_size = static_cast<uint64_t>(end - start);
+
+			const uint64_t count = element_count(result.chunk_grid());
+			if (result.index_offset < header::size() || result.index_offset > result.stream_size ||
+				count > (result.stream_size - result.index_offset) / entry_size)
+			{
+				throw binary_grid_error("chunked_grid_file: corrupted header.");
+			}
+			return result;
+		}
+
+		// the number of elements, or the maximum of uint64_t if it doesn't fit.
+		[[nodiscard]] static uint64_t element_count(const grid_size<dimensions> &size)
+		{
+			uint64_t result = 1;
+			for (const auto &extent : size)
+			{
+				if (extent != 0 && result > std::numeric_limits<uint64_t>::max() / extent)
+				{
+					return std::numeric_limits<uint64_t>::max();
+				}
+				result *= extent;
+			}
+			return result;
+		}
+
+		[[nodiscard]] static std::vector<index_entry> read_index(std::istream &stream, std::istream::pos_type start, const header &info)
+		{
+			// read_header() bounded the count by the stream length, so the product can't wrap around.
+			const size_t count = info.chunk_grid().elements();
+			if (count * entry_size + 4 > info.stream_size - info.index_offset)
+			{
+				throw binary_grid_error("chunked_grid_file: unexpected end of the stream.");
+			}
+			std::vector<std::byte> table(count * entry_size + 4);
+			stream.seekg(start + static_cast<std::streamoff>(info.index_offset));
+			stream.read(reinterpret_cast<char *>(table.data()), table.size());
+			if (!stream)
+			{
+				throw binary_grid_error("chunked_grid_file: unexpected end of the stream.");
+			}
+
+			uint32_t checksum = 0;
+			std::memcpy(&checksum, table.data() + count * entry_size, 4);
+			if (crc32(std::span(table).first(count * entry_size)) != swapped_if(checksum, info.swapped))
+			{
+				throw binary_grid_error("chunked_grid_file: checksum mismatch, the index is corrupted.");
+			}
+
+			std::vector<index_entry> result(count);
+			for (size_t chunk = 0; chunk < count; ++chunk)
+			{
+				const std::byte *source = table.data() + chunk * entry_size;
+				index_entry &entry = result[chunk];
+				uint8_t encoding = 0;
+				std::memcpy(&entry.offset, source, 8);
+				std::memcpy(&entry.size, source + 8, 8);
+				std::memcpy(&entry.crc, source + 16, 4);
+				std::memcpy(&encoding, source + 20, 1);
+				entry.offset = swapped_if(entry.offset, info.swapped);
+				entry.size = swapped_if(entry.size, info.swapped);
+				entry.crc = swapped_if(entry.crc, info.swapped);
+
+				if (encoding > static_cast<uint8_t>(chunk_encoding::uniform) || entry.offset < header::size() ||
+					entry.offset > info.index_offset || entry.size > info.index_offset - entry.offset)
+				{
+					throw binary_grid_error("chunked_grid_file: corrupted index.");
+				}
+				entry.encoding = static_cast<chunk_encoding>(encoding);
+			}
+			return result;
+		}
+
+		[[nodiscard]] static std::vector<std::byte> serialize_index(const std::vector<index_entry> &index)
+		{
+			std::vector<std::byte> result(index.size() * entry_size + 4);
+			for (size_t chunk = 0; chunk < index.size(); ++chunk)
+			{
+				std::byte *target = result.data() + chunk * entry_size;
+				const uint8_t encoding = static_cast<uint8_t>(index[chunk].encoding);
+				std::memcpy(target, &index[chunk].offset, 8);
+				std::memcpy(target + 8, &index[chunk].size, 8);
+				std::memcpy(target + 16, &index[chunk].crc, 4);
+				std::memcpy(target + 20, &encoding, 1);
+			}
+
+			const uint32_t checksum = crc32(std::span(result).first(index.size() * entry_size));
+			std::memcpy(result.data() + index.size() * entry_size, &checksum, 4);
+			return result;
+		}
+
+		[[nodiscard]] static uint64_t stored_size(chunk_encoding encoding, size_t count)
+		{
+			return (encoding == chunk_encoding::uniform ? 1 : count) * uint64_t{ sizeof(data_type) };
+		}
+
+		// the size of the bytes has been checked against stored_size() already.
+		static void decode(const index_entry &entry, const std::vector<std::byte> &bytes, size_t count, bool swapped, std::vector<data_type> &elements)
+		{
+			elements.resize(count);
+			if (entry.encoding == chunk_encoding::uniform)
+			{
+				data_type value;
+				std::memcpy(&value, bytes.data(), sizeof(data_type));
+				std::fill_n(elements.data(), count, swapped_if(value, swapped));
+				return;
+			}
+
+			std::memcpy(elements.data(), bytes.data(), bytes.size());
+			if (swapped)
+			{
+				for (auto &value : elements)
+				{
+					value = binary_grid_header::swap_bytes(value);
+				}
+			}
+		}
+
+		[[nodiscard]] static bool is_uniform(const std::vector<data_type> &elements)
+		{
+			for (const auto &value : elements)
+			{
+				if (std::memcmp(&value, elements.data(), sizeof(data_type)) != 0)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		[[nodiscard]] static grid_box<dimensions> relative(const grid_box<dimensions> &box, const grid_size<dimensions> &origin)
+		{
+			grid_box<dimensions> result = box;
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				result.low[axis] -= origin[axis];
+				result.high[axis] -= origin[axis];
+			}
+			return result;
+		}
+
+		grid_type m_content;
+		grid_size<dimensions> m_chunk{}, m_file_dim{};
+		grid_box<dimensions> m_region{};
+		statistics m_stats;
+	};
+
+#pragma endregion
+}
@@ -0,0 +1,542 @@
+#include <type_traits> // std::conditional_t
+#include <algorithm>   // std::find(), std::fill(), std::copy_n(), std::min()
+#include <utility>    // std::as_const()
+#include <cstring>    // std::memcpy()
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <array>
+export module p3.grid.compressed;
+/*
+	Compressed grid module, part of github/TeraFlint/pitrilib.
+	Daniel Wiegert (Pitri), 2021.
+*/
+
+export import p3.grid;
+// import <type_traits>; // std::conditional_t
+// import <algorithm>;  // std::find(), std::fill(), std::copy_n(), std::min()
+// import <utility>;    // std::as_const()
+// import <cstring>;    // std::memcpy()
+// import <atomic>;
+// import <chrono>;
+// import <cstdint>;
+// import <vector>;
+// import <array>;
+
+namespace p3
+{
+#pragma region compressed grid
+
+	export
+	enum class block_encoding : std::uint8_t
+	{
+		uniform,    // one single value for the whole block.
+		palette,    // up to 256 distinct values, the elements are packed 1, 2, 4 or 8 bit indices into the palette.
+		run_length, // runs of equal values in row-major block order.
+		raw,        // every element on its own, for blocks nothing else fits.
+	};
+
+	export
+	/*
+		n dimensional grid for low-entropy data (terrain, masks, label maps): the grid is split into hypercubic blocks of
+		block_edge^dimensions elements, and every block is stored in whatever encoding takes the fewest bytes.
+
+		reading a single element decodes its whole block into a small per-thread cache, so neighboring reads are cheap and
+		concurrent reads from multiple threads don't interfere. uniform blocks are answered without decoding anything.
+		set() re-encodes the touched block right away. for large edits, build a dense grid and compress it as a whole.
+		writes are not synchronized with reads from other threads.
+	*/
+	template <typename data_type, size_t dimensions, size_t block_edge = 16>
+	class compressed_grid
+	{
+		static_assert(dimensions > 0, "compressed_grid: grids need at least one dimension.");
+		static_assert(block_edge > 0, "compressed_grid: the block edge can't be 0.");
+
+	#pragma region types
+
+	public:
+		using this_type = compressed_grid<data_type, dimensions, block_edge>;
+
+		struct statistics
+		{
+			size_t uniform = 0, palette = 0, run_length = 0, raw = 0; // blocks per encoding.
+			size_t memory_footprint = 0;                               // bytes occupied by the blocks.
+			double compression_ratio = 0;                              // dense size / memory footprint.
+		};
+
+		// decoding work of the calling thread, across all compressed grids of this type.
+		struct decode_statistics
+		{
+			size_t hits = 0;            // block was still in the cache.
+			size_t misses = 0;          // block had to be decoded.
+			size_t decoded_bytes = 0;   // dense bytes produced by decoding.
+			double decode_seconds = 0;  // time spent decoding.
+
+			[[nodiscard]] double throughput() const
+			{
+				return decode_seconds > 0 ? decoded_bytes / decode_seconds : 0;
+			}
+		};
+
+		static constexpr size_t block_elements = []()
+		{
+			size_t result = 1;
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				result *= block_edge;
+			}
+			return result;
+		}();
+
+		// decoded blocks kept per thread.
+		static constexpr size_t cache_slots = 16;
+
+	private:
+		// exclusive end of a run inside of the block, as small as the block size allows.
+		using run_end_type = std::conditional_t<(block_elements <= 0xFFFF), std::uint16_t, std::uint32_t>;
+
+		struct block
+		{
+			// unique among all blocks ever encoded, so a cached block can't be confused with another one (or an older state).
+			std::uint64_t version = 0;
+			block_encoding encoding = block_encoding::uniform;
+			std::uint8_t index_bits = 0;
+			// uniform: the value, palette: the palette, run_length: one value per run, raw: all elements.
+			std::vector<data_type> values;
+			// palette: the packed indices, run_length: the run ends.
+			std::vector<std::uint8_t> payload;
+		};
+
+		struct cache_entry
+		{
+			std::uint64_t version = 0;
+			std::vector<data_type> elements;
+		};
+
+		struct thread_cache
+		{
+			std::array<cache_entry, cache_slots> entries;
+			size_t next = 0;
+			decode_statistics stats;
+		};
+
+	#pragma endregion
+	#pragma region constructors
+
+	public:
+		compressed_grid() = default;
+
+		// every element starts out as value, in uniform blocks.
+		explicit compressed_grid(const grid_size<dimensions> &size, const data_type &value = {})
+			: m_dim{ size }, m_block_dim{ blocks_for(size) }, m_blocks(m_block_dim.elements())
+		{
+			for (auto &item : m_blocks)
+			{
+				item.version = next_version();
+				item.values.assign(1, value);
+			}
+		}
+
+		template <typename layout_type, typename allocator_type>
+		explicit compressed_grid(const grid<data_type, dimensions, layout_type, allocator_type> &dense)
+			: m_dim{ dense.dim() }, m_block_dim{ blocks_for(m_dim) }, m_blocks(m_block_dim.elements())
+		{
+			compress_blocks(dense, 0, m_blocks.size());
+		}
+
+		// multi-threaded compression. the policy's chunk size counts blocks.
+		template <typename layout_type, typename allocator_type>
+		explicit compressed_grid(const grid<data_type, dimensions, layout_type, allocator_type> &dense, const parallel_policy &policy)
+			: m_dim{ dense.dim() }, m_block_dim{ blocks_for(m_dim) }, m_blocks(m_block_dim.elements())
+		{
+			parallel_for(m_blocks.size(), policy, [&](size_t begin, size_t end) { compress_blocks(dense, begin, end); });
+		}
+
+	#pragma endregion
+	#pragma region meta data
+
+	public:
+		[[nodiscard]] constexpr size_t rank() const
+		{
+			return dimensions;
+		}
+
+		[[nodiscard]] constexpr grid_size<dimensions> dim() const
+		{
+			return m_dim;
+		}
+
+		[[nodiscard]] constexpr size_t dim_at(size_t axis) const
+		{
+			return m_dim[axis];
+		}
+
+		[[nodiscard]] constexpr size_t size() const
+		{
+			return m_dim.elements();
+		}
+
+		[[nodiscard]] size_t block_count() const
+		{
+			return m_blocks.size();
+		}
+
+		[[nodiscard]] block_encoding encoding_of(const grid_size<dimensions> &pos) const
+		{
+			return m_blocks[block_index(pos)].encoding;
+		}
+
+		// bytes occupied by the blocks, including their bookkeeping.
+		[[nodiscard]] size_t memory_footprint() const
+		{
+			size_t result = m_blocks.capacity() * sizeof(block);
+			for (const auto &item : m_blocks)
+			{
+				result += item.values.capacity() * sizeof(data_type) + item.payload.capacity();
+			}
+			return result;
+		}
+
+		[[nodiscard]] statistics stats() const
+		{
+			statistics result{};
+			for (const auto &item : m_blocks)
+			{
+				switch (item.encoding)
+				{
+				case block_encoding::uniform:    ++result.uniform; break;
+				case block_encoding::palette:    ++result.palette; break;
+				case block_encoding::run_length: ++result.run_length; break;
+				case block_encoding::raw:        ++result.raw; break;
+				}
+			}
+			result.memory_footprint = memory_footprint();
+			result.compression_ratio = result.memory_footprint ? static_cast<double>(size() * sizeof(data_type)) / result.memory_footprint : 0;
+			return result;
+		}
+
+		[[nodiscard]] static decode_statistics decode_stats()
+		{
+			return cache().stats;
+		}
+
+		static void reset_decode_stats()
+		{
+			cache().stats = {};
+		}
+
+	#pragma endregion
+	#pragma region accessors
+
+	public:
+		// read access by value, as the element doesn't exist on its own.
+		[[nodiscard]] data_type at(const grid_size<dimensions> &pos) const
+		{
+			const block &item = m_blocks[block_index(pos)];
+			if (item.encoding == block_encoding::uniform)
+			{
+				return item.values[0];
+			}
+			return decoded(item)[inner_index(pos)];
+		}
+
+		// writes a single element and re-encodes its block.
+		void set(const grid_size<dimensions> &pos, const data_type &value)
+		{
+			block &item = m_blocks[block_index(pos)];
+			const size_t inner = inner_index(pos);
+			if (item.encoding == block_encoding::uniform && item.values[0] == value)
+			{
+				return;
+			}
+
+			std::vector<data_type> elements(block_elements);
+			decode(item, elements.data());
+			elements[inner] = value;
+			item = encode(elements.data());
+		}
+
+	#pragma endregion
+	#pragma region manipulators
+
+	public:
+		/*
+			read-only iteration over every position (with position information). the blocks get visited one after another,
+			each of them decoded once, so the order is block by block, row-major inside of each block.
+		*/
+		template <typename function_type>
+		void iterate(function_type &&function) const
+		{
+			std::vector<data_type> elements(block_elements);
+
+			grid_pos<dimensions> pos{ m_dim };
+			for (grid_pos<dimensions> block_pos{ m_block_dim }; block_pos.valid(); ++block_pos)
+			{
+				const block &item = m_blocks[block_pos.index()];
+				decode(item, elements.data());
+
+				const auto box = block_box(block_pos.pos());
+				const size_t width = box.dim()[dimensions - 1];
+				auto rows = box.dim();
+				rows[dimensions - 1] = 1;
+
+				for (grid_pos<dimensions> row{ rows }; row.valid(); ++row)
+				{
+					auto start = box.low;
+					for (size_t axis = 0; axis + 1 < dimensions; ++axis)
+					{
+						start[axis] += row.pos_at(axis);
+					}
+					pos.jump(start);
+
+					const data_type *source = elements.data() + inner_index(start);
+					for (size_t column = 0; column < width; ++column, pos.next())
+					{
+						function(std::as_const(pos), source[column]);
+					}
+				}
+			}
+		}
+
+		[[nodiscard]] grid<data_type, dimensions> to_grid() const
+		{
+			grid<data_type, dimensions> result(m_dim);
+			iterate([&](const auto &pos, const auto &value) { result.at(pos.pos()) = value; });
+			return result;
+		}
+
+	#pragma endregion
+	#pragma region blocks
+
+	private:
+		[[nodiscard]] static grid_size<dimensions> blocks_for(const grid_size<dimensions> &size)
+		{
+			grid_size<dimensions> result{};
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				result[axis] = (size[axis] + block_edge - 1) / block_edge;
+			}
+			return result;
+		}
+
+		[[nodiscard]] grid_box<dimensions> block_box(const grid_size<dimensions> &block_pos) const
+		{
+			grid_box<dimensions> result{};
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				result.low[axis] = block_pos[axis] * block_edge;
+				result.high[axis] = std::min(result.low[axis] + block_edge, m_dim[axis]);
+			}
+			return result;
+		}
+
+		[[nodiscard]] size_t block_index(const grid_size<dimensions> &pos) const
+		{
+			size_t result = 0;
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				result = result * m_block_dim[axis] + pos[axis] / block_edge;
+			}
+			return result;
+		}
+
+		// row-major index inside of the block.
+		[[nodiscard]] static constexpr size_t inner_index(const grid_size<dimensions> &pos)
+		{
+			size_t result = 0;
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				result = result * block_edge + pos[axis] % block_edge;
+			}
+			return result;
+		}
+
+		[[nodiscard]] static std::uint64_t next_version()
+		{
+			static std::atomic<std::uint64_t> counter{ 0 };
+			return ++counter;
+		}
+
+		[[nodiscard]] static thread_cache &cache()
+		{
+			static thread_local thread_cache instance;
+			return instance;
+		}
+
+		template <typename dense_type>
+		void compress_blocks(const dense_type &dense, size_t begin, size_t end)
+		{
+			std::vector<data_type> elements(block_elements);
+
+			grid_size<dimensions> edge{};
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				edge[axis] = block_edge;
+			}
+
+			for (size_t index = begin; index < end; ++index)
+			{
+				// padding outside of the grid repeats the closest element, which keeps uniform blocks uniform.
+				const auto box = block_box(grid_size<dimensions>::from_index(index, m_block_dim));
+				size_t inner = 0;
+				for (grid_pos<dimensions> pos{ edge }; pos.valid(); ++pos, ++inner)
+				{
+					grid_size<dimensions> source{};
+					for (size_t axis = 0; axis < dimensions; ++axis)
+					{
+						source[axis] = std::min(box.low[axis] + pos.pos_at(axis), box.high[axis] - 1);
+					}
+					elements[inner] = dense.at(source);
+				}
+				m_blocks[index] = encode(elements.data());
+			}
+		}
+
+		// picks the smallest encoding for the elements of one block.
+		[[nodiscard]] static block encode(const data_type *elements)
+		{
+			block result;
+			result.version = next_version();
+
+			std::vector<data_type> palette;
+			bool fits_palette = true;
+			size_t runs = 1;
+			for (size_t index = 0; index < block_elements; ++index)
+			{
+				if (index > 0 && !(elements[index] == elements[index - 1]))
+				{
+					++runs;
+				}
+				if (fits_palette && std::find(palette.begin(), palette.end(), elements[index]) == palette.end())
+				{
+					fits_palette = palette.size() < 256;
+					palette.push_back(elements[index]);
+				}
+			}
+
+			if (fits_palette && palette.size() == 1)
+			{
+				result.values = std::move(palette);
+				return result;
+			}
+
+			const size_t bits = !fits_palette ? 0 : palette.size() <= 2 ? 1 : palette.size() <= 4 ? 2 : palette.size() <= 16 ? 4 : 8;
+			const size_t raw_bytes = block_elements * sizeof(data_type);
+			const size_t run_bytes = runs * (sizeof(data_type) + sizeof(run_end_type));
+			const size_t palette_bytes = fits_palette ? palette.size() * sizeof(data_type) + (block_elements * bits + 7) / 8 : raw_bytes;
+
+			if (run_bytes < raw_bytes && run_bytes <= palette_bytes)
+			{
+				result.encoding = block_encoding::run_length;
+				result.values.reserve(runs);
+				result.payload.resize(runs * sizeof(run_end_type));
+				for (size_t index = 0; index < block_elements; ++index)
+				{
+					if (index + 1 == block_elements || !(elements[index] == elements[index + 1]))
+					{
+						const auto end = static_cast<run_end_type>(index + 1);
+						std::memcpy(result.payload.data() + result.values.size() * sizeof(run_end_type), &end, sizeof(run_end_type));
+						result.values.push_back(elements[index]);
+					}
+				}
+			}
+			else if (palette_bytes < raw_bytes)
+			{
+				result.encoding = block_encoding::palette;
+				result.index_bits = static_cast<std::uint8_t>(bits);
+				result.payload.assign((block_elements * bits + 7) / 8, 0);
+				for (size_t index = 0; index < block_elements; ++index)
+				{
+					const size_t entry = static_cast<size_t>(std::find(palette.begin(), palette.end(), elements[index]) - palette.begin());
+					const size_t bit = index * bits;
+					result.payload[bit / 8] |= static_cast<std::uint8_t>(entry << (bit % 8));
+				}
+				result.values = std::move(palette);
+			}
+			else
+			{
+				result.encoding = block_encoding::raw;
+				result.values.assign(elements, elements + block_elements);
+			}
+			return result;
+		}
+
+		static void decode(const block &item, data_type *elements)
+		{
+			switch (item.encoding)
+			{
+			case block_encoding::uniform:
+				std::fill_n(elements, block_elements, item.values[0]);
+				break;
+
+			case block_encoding::palette:
+			{
+				const size_t bits = item.index_bits, mask = (size_t{ 1 } << bits) - 1;
+				for (size_t index = 0; index < block_elements; ++index)
+				{
+					const size_t bit = index * bits;
+					elements[index] = item.values[(item.payload[bit / 8] >> (bit % 8)) & mask];
+				}
+				break;
+			}
+
+			case block_encoding::run_length:
+			{
+				size_t index = 0;
+				for (size_t run = 0; run < item.values.size(); ++run)
+				{
+					run_end_type end;
+					std::memcpy(&end, item.payload.data() + run * sizeof(run_end_type), sizeof(run_end_type));
+					std::fill(elements + index, elements + end, item.values[run]);
+					index = end;
+				}
+				break;
+			}
+
+			case block_encoding::raw:
+				std::copy_n(item.values.data(), block_elements, elements);
+				break;
+			}
+		}
+
+		// the decoded elements of a block, out of (or into) the calling thread's cache.
+		[[nodiscard]] static const data_type *decoded(const block &item)
+		{
+			thread_cache &local = cache();
+			for (const auto &entry : local.entries)
+			{
+				if (entry.version == item.version)
+				{
+					++local.stats.hits;
+					return entry.elements.data();
+				}
+			}
+
+			cache_entry &entry = local.entries[local.next];
+			local.next = (local.next + 1) % cache_slots;
+
+			const auto start = std::chrono::steady_clock::now();
+			entry.elements.resize(block_elements);
+			decode(item, entry.elements.data());
+			entry.version = item.version;
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+			++local.stats.misses;
+			local.stats.decoded_bytes += block_elements * sizeof(data_type);
+			local.stats.decode_seconds += elapsed.count();
+			return entry.elements.data();
+		}
+
+	#pragma endregion
+	#pragma region member variables
+
+	private:
+		grid_size<dimensions> m_dim{}, m_block_dim{};
+		std::vector<block> m_blocks;
+
+	#pragma endregion
+	};
+
+#pragma endregion
+}
@@ -0,0 +1,439 @@
+#include <type_traits> // std::is_trivially_copyable_v
+#include <filesystem>
+#include <algorithm>   // std::min(), std::equal()
+#include <fstream>
+#include <cstring>     // std::memcpy(), std::memcmp()
+#include <cstdint>
+#include <cstddef>     // std::byte
+#include <utility>     // std::move()
+#include <vector>
+#include <array>
+#include <span>
+
+export module p3.grid.delta;
+/*
+	Delta grid module, part of github/TeraFlint/pitrilib.
+	Daniel Wiegert (Pitri), 2021.
+*/
+
+export import p3.grid.tracked;
+export import p3.grid.binary;
+// import <type_traits>; // std::is_trivially_copyable_v
+// import <filesystem>;
+// import <algorithm>;   // std::min(), std::equal()
+// import <fstream>;
+// import <cstring>;     // std::memcpy(), std::memcmp()
+// import <cstdint>;
+// import <cstddef>;     // std::byte
+// import <utility>;     // std::move()
+// import <vector>;
+// import <array>;
+// import <span>;
+
+namespace p3
+{
+#pragma region delta log format
+
+	/*
+		a snapshot consists of two files: the whole grid in the format of write_binary(), and a log of the blocks that
+		changed since then (see tracked_grid). the log lies next to the snapshot, with ".delta" appended.
+
+		log layout (all numbers in the byte order of the machine that wrote it, which has to be the reading one):
+
+		offset  size        content
+		     0     8        magic "p3delta" + version (1)
+		     8     2        byte order marker 0x0102
+		    10     1        element kind (see binary_element_kind)
+		    11     1        element size in bytes
+		    12     4        rank
+		    16     8        block size in elements
+		    24     4        crc-32 of the snapshot's elements, the log only applies to that one
+		    28     4        zero
+		    32     8*rank   dimensions
+		     -     -        one batch per incremental save:
+		                    8      block count n
+		                    n *    block index (8), followed by the elements of the block (the last one may be shorter)
+		                    4      crc-32 of the batch
+	*/
+
+	struct delta_log_header
+	{
+		static constexpr std::array<char, 8> magic{ 'p', '3', 'd', 'e', 'l', 't', 'a', 1 };
+		static constexpr size_t fixed_size = 32;
+
+		binary_element_kind kind = binary_element_kind::raw;
+		uint8_t element_size = 0;
+		uint64_t block_size = 0;
+		uint32_t base_crc = 0;
+		std::vector<uint64_t> dim;
+
+		[[nodiscard]] size_t bytes() const
+		{
+			return fixed_size + 8 * dim.size();
+		}
+
+		template <size_t dimensions>
+		[[nodiscard]] bool fits(const grid_size<dimensions> &size) const
+		{
+			return dim.size() == dimensions && std::equal(dim.begin(), dim.end(), size.begin());
+		}
+
+		[[nodiscard]] std::vector<std::byte> serialize() const
+		{
+			std::vector<std::byte> result(bytes());
+			const uint16_t marker = binary_grid_header::byte_order_marker;
+			const uint32_t rank = static_cast<uint32_t>(dim.size());
+
+			std::memcpy(result.data(), magic.data(), magic.size());
+			std::memcpy(result.data() + 8, &marker, 2);
+			std::memcpy(result.data() + 10, &kind, 1);
+			std::memcpy(result.data() + 11, &element_size, 1);
+			std::memcpy(result.data() + 12, &rank, 4);
+			std::memcpy(result.data() + 16, &block_size, 8);
+			std::memcpy(result.data() + 24, &base_crc, 4);
+			std::memcpy(result.data() + fixed_size, dim.data(), 8 * dim.size());
+			return result;
+		}
+
+		// false if the stream doesn't start with a complete log header.
+		[[nodiscard]] bool read(std::istream &stream)
+		{
+			std::array<std::byte, fixed_size> fixed{};
+			stream.read(reinterpret_cast<char *>(fixed.data()), fixed.size());
+			if (!stream || std::memcmp(fixed.data(), magic.data(), magic.size()) != 0)
+			{
+				return false;
+			}
+
+			uint16_t marker = 0;
+			uint32_t rank = 0;
+			std::memcpy(&marker, fixed.data() + 8, 2);
+			std::memcpy(&kind, fixed.data() + 10, 1);
+			std::memcpy(&element_size, fixed.data() + 11, 1);
+			std::memcpy(&rank, fixed.data() + 12, 4);
+			std::memcpy(&block_size, fixed.data() + 16, 8);
+			std::memcpy(&base_crc, fixed.data() + 24, 4);
+
+			if (marker != binary_grid_header::byte_order_marker)
+			{
+				throw binary_grid_error("delta log: foreign byte order, the log has to be read on the machine that wrote it.");
+			}
+			// nothing to replay in a log of another rank, the limit keeps a broken header from allocating.
+			if (rank > 64)
+			{
+				return false;
+			}
+
+			dim.resize(rank);
+			stream.read(reinterpret_cast<char *>(dim.data()), 8 * rank);
+			return static_cast<bool>(stream);
+		}
+	};
+
+#pragma endregion
+#pragma region grid snapshot
+
+	export
+	/*
+		incremental saves of a grid. save() writes the whole grid and starts an empty log, save_increment() appends only
+		the blocks that became dirty since the previous save. load() reads the snapshot and replays the log on top.
+		both saves clear the dirty blocks of the grid.
+
+		save_increment() turns into a full save() if there's no snapshot to refer to (nothing saved or loaded through
+		this object yet), if the dimensions or the block size changed, or if the log would outgrow the snapshot.
+
+		an interrupted save() leaves either the old files or the new snapshot with a stale log, which load() ignores.
+		a batch that wasn't written completely gets ignored as well, and cut off by the next save_increment().
+	*/
+	template <typename data_type, size_t dimensions>
+	class grid_snapshot
+	{
+		static_assert(std::is_trivially_copyable_v<data_type>, "grid_snapshot: the elements must be trivially copyable.");
+		static_assert(sizeof(data_type) < 256, "grid_snapshot: the element size doesn't fit into the header.");
+
+	public:
+		using grid_type = tracked_grid<data_type, dimensions>;
+		using content_type = grid<data_type, dimensions>;
+		using path_type = std::filesystem::path;
+
+		explicit grid_snapshot(path_type location)
+			: m_location{ std::move(location) }
+		{
+		}
+
+		[[nodiscard]] const path_type &location() const
+		{
+			return m_location;
+		}
+
+		[[nodiscard]] path_type log_location() const
+		{
+			path_type result = m_location;
+			result += ".delta";
+			return result;
+		}
+
+		// size of the valid part of the log, 0 if the next save_increment() is going to be a full save.
+		[[nodiscard]] uint64_t log_size() const
+		{
+			return m_attached ? m_log_size : 0;
+		}
+
+		void save(grid_type &source)
+		{
+			// until both files are written, the log on disk may still belong to the previous snapshot.
+			m_attached = false;
+			const uint32_t crc = crc32(elements(source.content()));
+
+			replace(m_location, [&](std::ofstream &file) { write_binary(file, source.content()); });
+
+			delta_log_header header = describe(source);
+			header.base_crc = crc;
+			const auto bytes = header.serialize();
+			replace(log_location(), [&](std::ofstream &file) { file.write(reinterpret_cast<const char *>(bytes.data()), bytes.size()); });
+
+			source.clear_dirty();
+			attach(header, bytes.size(), source.dim());
+		}
+
+		// returns false if it had to write a full snapshot instead.
+		bool save_increment(grid_type &source)
+		{
+			if (!m_attached || source.dim() != m_dim || source.block_size() != m_block_size || !log_intact())
+			{
+				save(source);
+				return false;
+			}
+
+			const auto blocks = source.dirty_blocks();
+			if (blocks.empty())
+			{
+				return true;
+			}
+
+			uint64_t batch_size = 8 + 4;
+			for (const size_t block : blocks)
+			{
+				batch_size += 8 + block_bytes(block, source.size());
+			}
+			if (m_log_size + batch_size > m_snapshot_size)
+			{
+				save(source);
+				return false;
+			}
+
+			// whatever lies behind the last complete batch is the rest of an interrupted one.
+			const auto log = log_location();
+			if (std::filesystem::file_size(log) != m_log_size)
+			{
+				std::filesystem::resize_file(log, m_log_size);
+			}
+
+			std::ofstream file(log, std::ios::binary | std::ios::app);
+			uint32_t crc = 0;
+			const auto put = [&](std::span<const std::byte> bytes)
+			{
+				file.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+				crc = crc32(bytes, crc);
+			};
+
+			const uint64_t count = blocks.size();
+			put(std::as_bytes(std::span(&count, 1)));
+			for (const size_t block : blocks)
+			{
+				const uint64_t index = block;
+				put(std::as_bytes(std::span(&index, 1)));
+				put({ reinterpret_cast<const std::byte *>(source.data() + block * m_block_size), block_bytes(block, source.size()) });
+			}
+			file.write(reinterpret_cast<const char *>(&crc), 4);
+			file.flush();
+			if (!file)
+			{
+				throw binary_grid_error("grid_snapshot: writing the log failed.");
+			}
+
+			m_log_size += batch_size;
+			source.clear_dirty();
+			return true;
+		}
+
+		// the snapshot with every complete batch of its log applied.
+		[[nodiscard]] grid_type load()
+		{
+			m_attached = false;
+			content_type content = load_binary<data_type, dimensions>(m_location);
+			const uint32_t crc = crc32(elements(content));
+			m_snapshot_size = std::filesystem::file_size(m_location);
+
+			std::ifstream file(log_location(), std::ios::binary);
+			delta_log_header header;
+			if (!file || !header.read(file) || header.base_crc != crc || !header.fits(content.dim()) || header.block_size == 0)
+			{
+				// no log, or one that belongs to another snapshot: the snapshot is all there is.
+				return grid_type(std::move(content));
+			}
+			if (header.kind != binary_grid_header::kind_of<data_type>() || header.element_size != sizeof(data_type))
+			{
+				throw binary_grid_error("grid_snapshot: element type mismatch in the log.");
+			}
+
+			grid_type result(std::move(content), static_cast<size_t>(header.block_size));
+			if (result.block_size() != header.block_size)
+			{
+				throw binary_grid_error("grid_snapshot: corrupted log header.");
+			}
+
+			m_block_size = result.block_size();
+			uint64_t valid = header.bytes();
+			result.modify([&](content_type &target)
+			{
+				std::vector<std::byte> batch;
+				while (replay(file, target, batch))
+				{
+					valid += batch.size() + 4;
+				}
+			});
+
+			result.clear_dirty();
+			attach(header, valid, result.dim());
+			return result;
+		}
+
+	private:
+		[[nodiscard]] static std::span<const std::byte> elements(const content_type &source)
+		{
+			return std::as_bytes(std::span(source.data(), source.size()));
+		}
+
+		// the last block of the grid may be shorter.
+		[[nodiscard]] size_t block_bytes(size_t block, size_t elements) const
+		{
+			return std::min(m_block_size, elements - block * m_block_size) * sizeof(data_type);
+		}
+
+		[[nodiscard]] delta_log_header describe(const grid_type &source) const
+		{
+			delta_log_header result;
+			result.kind = binary_grid_header::kind_of<data_type>();
+			result.element_size = static_cast<uint8_t>(sizeof(data_type));
+			result.block_size = source.block_size();
+			const auto dim = source.dim();
+			result.dim.assign(dim.begin(), dim.end());
+			return result;
+		}
+
+		void attach(const delta_log_header &header, uint64_t log_size, const grid_size<dimensions> &dim)
+		{
+			m_base_crc = header.base_crc;
+			m_block_size = static_cast<size_t>(header.block_size);
+			m_log_size = log_size;
+			m_dim = dim;
+			m_snapshot_size = std::filesystem::file_size(m_location);
+			m_attached = true;
+		}
+
+		// false if someone else replaced the log in the meantime.
+		[[nodiscard]] bool log_intact() const
+		{
+			std::error_code error;
+			const auto size = std::filesystem::file_size(log_location(), error);
+			std::ifstream file(log_location(), std::ios::binary);
+			delta_log_header header;
+			return !error && size >= m_log_size && header.read(file) && header.base_crc == m_base_crc && header.block_size == m_block_size;
+		}
+
+		// writes a temporary file next to the destination, which then replaces it once it's on the disk.
+		template <typename function_type>
+		static void replace(const path_type &location, function_type &&write)
+		{
+			const path_type temporary = file_access::temporary_path(location);
+			try
+			{
+				{
+					std::ofstream file(temporary, std::ios::binary);
+					if (!file)
+					{
+						throw binary_grid_error("grid_snapshot: can't open the file.");
+					}
+					write(file);
+					file.flush();
+					if (!file)
+					{
+						throw binary_grid_error("grid_snapshot: writing failed.");
+					}
+				}
+				if (!sync_to_disk(temporary))
+				{
+					throw binary_grid_error("grid_snapshot: the file couldn't be synced to the disk.");
+				}
+				std::filesystem::rename(temporary, location);
+			}
+			catch (...)
+			{
+				std::error_code error;
+				std::filesystem::remove(temporary, error);
+				throw;
+			}
+		}
+
+		/*
+			reads the next batch into the buffer and applies it once its checksum matches. false at the end of the log,
+			or at a batch that wasn't written completely.
+		*/
+		[[nodiscard]] bool replay(std::istream &file, content_type &target, std::vector<std::byte> &batch) const
+		{
+			const size_t blocks = (target.size() + m_block_size - 1) / m_block_size;
+			uint64_t count = 0;
+			if (!file.read(reinterpret_cast<char *>(&count), 8) || count > blocks)
+			{
+				return false;
+			}
+
+			batch.resize(8);
+			std::memcpy(batch.data(), &count, 8);
+			for (uint64_t record = 0; record < count; ++record)
+			{
+				uint64_t index = 0;
+				if (!file.read(reinterpret_cast<char *>(&index), 8) || index >= blocks)
+				{
+					return false;
+				}
+				const size_t length = block_bytes(static_cast<size_t>(index), target.size());
+				const size_t offset = batch.size();
+				batch.resize(offset + 8 + length);
+				std::memcpy(batch.data() + offset, &index, 8);
+				if (!file.read(reinterpret_cast<char *>(batch.data() + offset + 8), length))
+				{
+					return false;
+				}
+			}
+
+			uint32_t crc = 0;
+			if (!file.read(reinterpret_cast<char *>(&crc), 4) || crc != crc32(batch))
+			{
+				return false;
+			}
+
+			auto *elements = reinterpret_cast<std::byte *>(target.data());
+			for (size_t offset = 8; offset < batch.size();)
+			{
+				uint64_t index = 0;
+				std::memcpy(&index, batch.data() + offset, 8);
+				const size_t length = block_bytes(static_cast<size_t>(index), target.size());
+				std::memcpy(elements + static_cast<size_t>(index) * m_block_size * sizeof(data_type), batch.data() + offset + 8, length);
+				offset += 8 + length;
+			}
+			return true;
+		}
+
+		path_type m_location;
+		bool m_attached = false;
+		uint32_t m_base_crc = 0;
+		size_t m_block_size = 0;
+		uint64_t m_log_size = 0;
+		uint64_t m_snapshot_size = 0;
+		grid_size<dimensions> m_dim{};
+	};
+
+#pragma endregion
+}
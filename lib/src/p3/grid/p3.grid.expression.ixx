@@ -0,0 +1,560 @@
+#include <type_traits> // std::invoke_result_t, std::common_type_t
+#include <functional>  // std::plus<>, std::minus<>, ...
+#include <stdexcept>
+#include <cmath>
+export module p3.grid.expression;
+/*
+	Grid expression module, part of github/TeraFlint/pitrilib.
+	Daniel Wiegert (Pitri), 2021.
+*/
+
+export import p3.grid;
+// import <type_traits>; // std::invoke_result_t, std::common_type_t
+// import <functional>;  // std::plus<>, std::minus<>, ...
+// import <stdexcept>;
+// import <cmath>;
+
+namespace p3
+{
+#pragma region expression nodes
+
+	/*
+		element-wise arithmetic on grids. combining grids (a + b * c) doesn't compute anything yet, it builds a light-weight tree
+		of expression nodes instead. the tree gets evaluated as soon as it's assigned to a grid (or used to construct one):
+		one single pass over the memory, no temporary grids in between.
+
+		the nodes only hold pointers into the source grids, so they must not outlive them. store the result in a grid instead of
+		keeping expressions around.
+	*/
+	namespace grid_expr
+	{
+		export
+		// leaf node, reading the storage of a grid.
+		template <typename data_type, size_t dims, typename layout>
+		class terminal
+		{
+		public:
+			static constexpr bool is_grid_expression = true;
+			static constexpr size_t dimensions = dims;
+			using layout_type = layout;
+			using value_type = data_type;
+
+			template <typename allocator_type>
+			constexpr explicit terminal(const grid<data_type, dims, layout, allocator_type> &source)
+				: m_data{ source.data() }, m_dim{ source.dim() }
+			{
+			}
+
+			[[nodiscard]] constexpr grid_size<dims> dim() const
+			{
+				return m_dim;
+			}
+
+			[[nodiscard]] constexpr const data_type &operator[](size_t index) const
+			{
+				return m_data[index];
+			}
+
+		private:
+			const data_type *m_data;
+			grid_size<dims> m_dim;
+		};
+
+		export
+		// leaf node, providing the same value for every position. has no size of its own.
+		template <typename data_type>
+		class scalar
+		{
+		public:
+			using value_type = data_type;
+
+			constexpr explicit scalar(const data_type &value)
+				: m_value{ value }
+			{
+			}
+
+			[[nodiscard]] constexpr const data_type &operator[](size_t index) const
+			{
+				return m_value;
+			}
+
+		private:
+			data_type m_value;
+		};
+
+		template <typename type>
+		struct is_scalar : std::false_type {};
+
+		template <typename data_type>
+		struct is_scalar<scalar<data_type>> : std::true_type {};
+
+		// rank of an operand, scalars count as rank 0.
+		template <typename type>
+		constexpr size_t rank_of = type::dimensions;
+
+		template <typename data_type>
+		constexpr size_t rank_of<scalar<data_type>> = 0;
+
+		export
+		template <typename operation_type, typename operand_type>
+		class unary
+		{
+		public:
+			static constexpr bool is_grid_expression = true;
+			static constexpr size_t dimensions = operand_type::dimensions;
+			using layout_type = typename operand_type::layout_type;
+			using value_type = std::decay_t<std::invoke_result_t<const operation_type &, typename operand_type::value_type>>;
+
+			constexpr unary(const operation_type &operation, const operand_type &operand)
+				: m_operation{ operation }, m_operand{ operand }
+			{
+			}
+
+			[[nodiscard]] constexpr grid_size<dimensions> dim() const
+			{
+				return m_operand.dim();
+			}
+
+			[[nodiscard]] constexpr value_type operator[](size_t index) const
+			{
+				return m_operation(m_operand[index]);
+			}
+
+		private:
+			operation_type m_operation;
+			operand_type m_operand;
+		};
+
+		export
+		/*
+			combines two operands. one of them may be a scalar, otherwise both need the same layout and either the same dimensions,
+			or one of them has a lower rank and gets broadcast (row-major only): its axes have to match the trailing axes of the other
+			operand, and it repeats along the leading ones. a row vector + a matrix adds the row to every row of the matrix.
+		*/
+		template <typename operation_type, typename lhs_type, typename rhs_type>
+		class binary
+		{
+			static_assert(!is_scalar<lhs_type>::value || !is_scalar<rhs_type>::value, "grid_expr::binary: at least one operand has to be a grid.");
+			static constexpr bool rhs_shapes = is_scalar<lhs_type>::value || (!is_scalar<rhs_type>::value && rank_of<rhs_type> > rank_of<lhs_type>);
+			using shape_type = std::conditional_t<rhs_shapes, rhs_type, lhs_type>;
+
+		public:
+			static constexpr bool is_grid_expression = true;
+			static constexpr size_t dimensions = shape_type::dimensions;
+			using layout_type = typename shape_type::layout_type;
+			using value_type = std::decay_t<std::invoke_result_t<const operation_type &, typename lhs_type::value_type, typename rhs_type::value_type>>;
+
+			constexpr binary(const operation_type &operation, const lhs_type &lhs, const rhs_type &rhs)
+				: m_operation{ operation }, m_lhs{ lhs }, m_rhs{ rhs }
+			{
+				if constexpr (!is_scalar<lhs_type>::value && !is_scalar<rhs_type>::value)
+				{
+					static_assert(std::is_same_v<typename lhs_type::layout_type, typename rhs_type::layout_type>, "grid_expr::binary: operands differ in layout.");
+
+					if constexpr (lhs_type::dimensions == rhs_type::dimensions)
+					{
+						if (m_lhs.dim() != m_rhs.dim())
+						{
+							throw std::invalid_argument("grid_expr::binary: operand dimensions don't match.");
+						}
+					}
+					else
+					{
+						static_assert(layout_type::is_row_major, "grid_expr::binary: only row-major operands can be broadcast.");
+
+						const auto shape = dim();
+						const auto narrow = [this]()
+						{
+							if constexpr (rhs_shapes) return m_lhs.dim();
+							else return m_rhs.dim();
+						}();
+
+						constexpr size_t leading = dimensions - (rhs_shapes ? rank_of<lhs_type> : rank_of<rhs_type>);
+						for (size_t axis = 0; axis < dimensions - leading; ++axis)
+						{
+							if (narrow[axis] != shape[leading + axis])
+							{
+								throw std::invalid_argument("grid_expr::binary: the lower rank operand doesn't match the trailing axes.");
+							}
+						}
+						m_period = narrow.elements();
+					}
+				}
+			}
+
+			[[nodiscard]] constexpr grid_size<dimensions> dim() const
+			{
+				if constexpr (rhs_shapes)
+				{
+					return m_rhs.dim();
+				}
+				else
+				{
+					return m_lhs.dim();
+				}
+			}
+
+			[[nodiscard]] constexpr value_type operator[](size_t index) const
+			{
+				return m_operation(m_lhs[operand_index<lhs_type>(index)], m_rhs[operand_index<rhs_type>(index)]);
+			}
+
+		private:
+			// in row-major order, the trailing axes are the fastest ones. a broadcast operand simply starts over every m_period elements.
+			template <typename operand_type>
+			[[nodiscard]] constexpr size_t operand_index(size_t index) const
+			{
+				if constexpr (!is_scalar<operand_type>::value && rank_of<operand_type> < dimensions)
+				{
+					return index % m_period;
+				}
+				else
+				{
+					return index;
+				}
+			}
+
+			operation_type m_operation;
+			lhs_type m_lhs;
+			rhs_type m_rhs;
+			size_t m_period = 0;
+		};
+
+	#pragma endregion
+	#pragma region operations
+
+		// the math functions are looked up via "using std::func", so custom types can bring their own overloads.
+		export
+		struct abs_op
+		{
+			template <typename type>
+			[[nodiscard]] constexpr auto operator()(const type &value) const
+			{
+				if constexpr (std::is_unsigned_v<type>)
+				{
+					return value;
+				}
+				else
+				{
+					using std::abs;
+					return abs(value);
+				}
+			}
+		};
+
+		export
+		struct sqrt_op
+		{
+			template <typename type>
+			[[nodiscard]] auto operator()(const type &value) const
+			{
+				using std::sqrt;
+				return sqrt(value);
+			}
+		};
+
+		export
+		struct exp_op
+		{
+			template <typename type>
+			[[nodiscard]] auto operator()(const type &value) const
+			{
+				using std::exp;
+				return exp(value);
+			}
+		};
+
+		export
+		struct log_op
+		{
+			template <typename type>
+			[[nodiscard]] auto operator()(const type &value) const
+			{
+				using std::log;
+				return log(value);
+			}
+		};
+
+		export
+		struct sin_op
+		{
+			template <typename type>
+			[[nodiscard]] auto operator()(const type &value) const
+			{
+				using std::sin;
+				return sin(value);
+			}
+		};
+
+		export
+		struct cos_op
+		{
+			template <typename type>
+			[[nodiscard]] auto operator()(const type &value) const
+			{
+				using std::cos;
+				return cos(value);
+			}
+		};
+
+		export
+		struct pow_op
+		{
+			template <typename base_type, typename exponent_type>
+			[[nodiscard]] auto operator()(const base_type &base, const exponent_type &exponent) const
+			{
+				using std::pow;
+				return pow(base, exponent);
+			}
+		};
+
+		export
+		struct min_op
+		{
+			template <typename lhs_type, typename rhs_type>
+			[[nodiscard]] constexpr auto operator()(const lhs_type &lhs, const rhs_type &rhs) const
+			{
+				using common_type = std::common_type_t<lhs_type, rhs_type>;
+				return rhs < lhs ? common_type(rhs) : common_type(lhs);
+			}
+		};
+
+		export
+		struct max_op
+		{
+			template <typename lhs_type, typename rhs_type>
+			[[nodiscard]] constexpr auto operator()(const lhs_type &lhs, const rhs_type &rhs) const
+			{
+				using common_type = std::common_type_t<lhs_type, rhs_type>;
+				return lhs < rhs ? common_type(rhs) : common_type(lhs);
+			}
+		};
+
+	#pragma endregion
+	#pragma region operand conversion
+
+		template <typename type>
+		struct is_grid : std::false_type {};
+
+		template <typename data_type, size_t dimensions, typename layout_type, typename allocator_type>
+		struct is_grid<grid<data_type, dimensions, layout_type, allocator_type>> : std::true_type {};
+
+		// anything that has a shape: grids and expressions.
+		export
+		template <typename type>
+		concept grid_operand = is_grid<std::remove_cvref_t<type>>::value || grid_expression<std::remove_cvref_t<type>>;
+
+		export
+		template <typename type>
+		concept scalar_operand = std::is_arithmetic_v<std::remove_cvref_t<type>>;
+
+		template <typename lhs_type, typename rhs_type>
+		concept binary_operands = (grid_operand<lhs_type> && (grid_operand<rhs_type> || scalar_operand<rhs_type>))
+			|| (scalar_operand<lhs_type> && grid_operand<rhs_type>);
+
+		template <typename type>
+		[[nodiscard]] constexpr auto make_operand(const type &value)
+		{
+			if constexpr (is_grid<type>::value)
+			{
+				return terminal(value);
+			}
+			else if constexpr (grid_expression<type>)
+			{
+				return value;
+			}
+			else
+			{
+				return scalar<type>(value);
+			}
+		}
+
+		template <typename operation_type, typename operand_type>
+		[[nodiscard]] constexpr auto make_unary(const operation_type &operation, const operand_type &operand)
+		{
+			using node_type = decltype(make_operand(operand));
+			return unary<operation_type, node_type>(operation, make_operand(operand));
+		}
+
+		template <typename operation_type, typename lhs_type, typename rhs_type>
+		[[nodiscard]] constexpr auto make_binary(const operation_type &operation, const lhs_type &lhs, const rhs_type &rhs)
+		{
+			using lhs_node = decltype(make_operand(lhs));
+			using rhs_node = decltype(make_operand(rhs));
+			return binary<operation_type, lhs_node, rhs_node>(operation, make_operand(lhs), make_operand(rhs));
+		}
+	}
+
+#pragma endregion
+#pragma region operators
+
+	export
+	template <typename lhs_type, typename rhs_type>
+		requires(grid_expr::binary_operands<lhs_type, rhs_type>)
+	[[nodiscard]] constexpr auto operator+(const lhs_type &lhs, const rhs_type &rhs)
+	{
+		return grid_expr::make_binary(std::plus<>{}, lhs, rhs);
+	}
+
+	export
+	template <typename lhs_type, typename rhs_type>
+		requires(grid_expr::binary_operands<lhs_type, rhs_type>)
+	[[nodiscard]] constexpr auto operator-(const lhs_type &lhs, const rhs_type &rhs)
+	{
+		return grid_expr::make_binary(std::minus<>{}, lhs, rhs);
+	}
+
+	export
+	template <typename lhs_type, typename rhs_type>
+		requires(grid_expr::binary_operands<lhs_type, rhs_type>)
+	[[nodiscard]] constexpr auto operator*(const lhs_type &lhs, const rhs_type &rhs)
+	{
+		return grid_expr::make_binary(std::multiplies<>{}, lhs, rhs);
+	}
+
+	export
+	template <typename lhs_type, typename rhs_type>
+		requires(grid_expr::binary_operands<lhs_type, rhs_type>)
+	[[nodiscard]] constexpr auto operator/(const lhs_type &lhs, const rhs_type &rhs)
+	{
+		return grid_expr::make_binary(std::divides<>{}, lhs, rhs);
+	}
+
+	export
+	template <grid_expr::grid_operand operand_type>
+	[[nodiscard]] constexpr auto operator-(const operand_type &operand)
+	{
+		return grid_expr::make_unary(std::negate<>{}, operand);
+	}
+
+	// compound assignment: a += b is evaluated as a = a + b, in place.
+
+	export
+	template <typename data_type, size_t dimensions, typename layout_type, typename allocator_type, typename rhs_type>
+		requires(grid_expr::grid_operand<rhs_type> || grid_expr::scalar_operand<rhs_type>)
+	constexpr grid<data_type, dimensions, layout_type, allocator_type> &operator+=(grid<data_type, dimensions, layout_type, allocator_type> &target, const rhs_type &rhs)
+	{
+		return target = target + rhs;
+	}
+
+	export
+	template <typename data_type, size_t dimensions, typename layout_type, typename allocator_type, typename rhs_type>
+		requires(grid_expr::grid_operand<rhs_type> || grid_expr::scalar_operand<rhs_type>)
+	constexpr grid<data_type, dimensions, layout_type, allocator_type> &operator-=(grid<data_type, dimensions, layout_type, allocator_type> &target, const rhs_type &rhs)
+	{
+		return target = target - rhs;
+	}
+
+	export
+	template <typename data_type, size_t dimensions, typename layout_type, typename allocator_type, typename rhs_type>
+		requires(grid_expr::grid_operand<rhs_type> || grid_expr::scalar_operand<rhs_type>)
+	constexpr grid<data_type, dimensions, layout_type, allocator_type> &operator*=(grid<data_type, dimensions, layout_type, allocator_type> &target, const rhs_type &rhs)
+	{
+		return target = target * rhs;
+	}
+
+	export
+	template <typename data_type, size_t dimensions, typename layout_type, typename allocator_type, typename rhs_type>
+		requires(grid_expr::grid_operand<rhs_type> || grid_expr::scalar_operand<rhs_type>)
+	constexpr grid<data_type, dimensions, layout_type, allocator_type> &operator/=(grid<data_type, dimensions, layout_type, allocator_type> &target, const rhs_type &rhs)
+	{
+		return target = target / rhs;
+	}
+
+#pragma endregion
+#pragma region math functions
+
+	export
+	template <grid_expr::grid_operand operand_type>
+	[[nodiscard]] constexpr auto abs(const operand_type &operand)
+	{
+		return grid_expr::make_unary(grid_expr::abs_op{}, operand);
+	}
+
+	export
+	template <grid_expr::grid_operand operand_type>
+	[[nodiscard]] constexpr auto sqrt(const operand_type &operand)
+	{
+		return grid_expr::make_unary(grid_expr::sqrt_op{}, operand);
+	}
+
+	export
+	template <grid_expr::grid_operand operand_type>
+	[[nodiscard]] constexpr auto exp(const operand_type &operand)
+	{
+		return grid_expr::make_unary(grid_expr::exp_op{}, operand);
+	}
+
+	export
+	template <grid_expr::grid_operand operand_type>
+	[[nodiscard]] constexpr auto log(const operand_type &operand)
+	{
+		return grid_expr::make_unary(grid_expr::log_op{}, operand);
+	}
+
+	export
+	template <grid_expr::grid_operand operand_type>
+	[[nodiscard]] constexpr auto sin(const operand_type &operand)
+	{
+		return grid_expr::make_unary(grid_expr::sin_op{}, operand);
+	}
+
+	export
+	template <grid_expr::grid_operand operand_type>
+	[[nodiscard]] constexpr auto cos(const operand_type &operand)
+	{
+		return grid_expr::make_unary(grid_expr::cos_op{}, operand);
+	}
+
+	export
+	template <typename lhs_type, typename rhs_type>
+		requires(grid_expr::binary_operands<lhs_type, rhs_type>)
+	[[nodiscard]] constexpr auto pow(const lhs_type &base, const rhs_type &exponent)
+	{
+		return grid_expr::make_binary(grid_expr::pow_op{}, base, exponent);
+	}
+
+	export
+	template <typename lhs_type, typename rhs_type>
+		requires(grid_expr::binary_operands<lhs_type, rhs_type>)
+	[[nodiscard]] constexpr auto min(const lhs_type &lhs, const rhs_type &rhs)
+	{
+		return grid_expr::make_binary(grid_expr::min_op{}, lhs, rhs);
+	}
+
+	export
+	template <typename lhs_type, typename rhs_type>
+		requires(grid_expr::binary_operands<lhs_type, rhs_type>)
+	[[nodiscard]] constexpr auto max(const lhs_type &lhs, const rhs_type &rhs)
+	{
+		return grid_expr::make_binary(grid_expr::max_op{}, lhs, rhs);
+	}
+
+	export
+	// materializes an expression into a grid of its natural value type.
+	template <grid_expression expression_type>
+	[[nodiscard]] auto evaluate(const expression_type &expression)
+	{
+		return grid<typename expression_type::value_type, expression_type::dimensions, typename expression_type::layout_type>(expression);
+	}
+
+	// argument dependent lookup only searches grid_expr for the nodes. this way, the operators are found for nested expressions as well.
+	namespace grid_expr
+	{
+		export using p3::operator+;
+		export using p3::operator-;
+		export using p3::operator*;
+		export using p3::operator/;
+		export using p3::abs;
+		export using p3::sqrt;
+		export using p3::exp;
+		export using p3::log;
+		export using p3::sin;
+		export using p3::cos;
+		export using p3::pow;
+		export using p3::min;
+		export using p3::max;
+	}
+
+#pragma endregion
+}
@@ -0,0 +1,355 @@
+#include <initializer_list>
+#include <stdexcept>
+#include <algorithm>  // std::copy_n()
+#include <utility>    // std::index_sequence, std::as_const()
+#include <array>
+#include <span>
+export module p3.grid.fixed;
+/*
+	Fixed grid module, part of github/TeraFlint/pitrilib.
+	Daniel Wiegert (Pitri), 2021.
+*/
+
+export import p3.grid;
+// import <initializer_list>;
+// import <stdexcept>;
+// import <algorithm>;  // std::copy_n()
+// import <utility>;    // std::index_sequence, std::as_const()
+// import <array>;
+// import <span>;
+
+namespace p3
+{
+#pragma region fixed grid
+
+	export
+	/*
+		n dimensional grid with compile time extents. the elements live inside the object (std::array), so there is no heap allocation
+		and everything (construction, access, iteration, subgrids) works in constant expressions.
+		meant for small grids in hot paths: matrices, convolution kernels, lookup tables, etc.
+	*/
+	template <typename data_type, size_t ...extents>
+	class fixed_grid
+	{
+	#pragma region types
+
+	public:
+		static constexpr size_t dimensions = sizeof...(extents);
+		static constexpr size_t elements = (extents * ... * size_t{ 1 });
+
+		using this_type = fixed_grid<data_type, extents...>;
+		using container_type = std::array<data_type, elements>;
+		using iterator = typename container_type::iterator;
+		using const_iterator = typename container_type::const_iterator;
+		using reverse_iterator = typename container_type::reverse_iterator;
+		using const_reverse_iterator = typename container_type::const_reverse_iterator;
+
+	private:
+		static constexpr grid_size<dimensions> s_dim{ extents... };
+		static constexpr grid_stride<dimensions> s_stride = s_dim.strides();
+
+		// the fixed_grid type that's left after removing one axis.
+		template <size_t axis, size_t ...index>
+		static constexpr auto remove_extent(std::index_sequence<index...>) -> fixed_grid<data_type, s_dim[index < axis ? index : index + 1]...>;
+
+	public:
+		template <size_t axis>
+			requires(axis < dimensions)
+		using subgrid_type = decltype(remove_extent<axis>(std::make_index_sequence<dimensions - 1>{}));
+
+	#pragma endregion
+	#pragma region constructors
+
+	public:
+		// default constructor (value initialized elements)
+		constexpr fixed_grid() = default;
+
+		// list constructor. missing elements stay value initialized, surplus elements get ignored.
+		constexpr fixed_grid(std::initializer_list<data_type> init)
+		{
+			std::copy_n(init.begin(), std::min(init.size(), elements), m_data.begin());
+		}
+
+		// generator constructor
+		template <grid_generator<dimensions> generator_type>
+		constexpr explicit fixed_grid(generator_type &&generator)
+		{
+			grid_pos<dimensions> pos{ s_dim };
+			for (auto &item : m_data)
+			{
+				item = generator(std::as_const(pos));
+				++pos;
+			}
+		}
+
+		// view copy constructor. the view has to match the extents of the grid.
+		template <typename view_data_type>
+		constexpr explicit fixed_grid(const grid_view<view_data_type, dimensions> &view)
+			requires(std::is_same_v<std::remove_const_t<view_data_type>, data_type>)
+		{
+			if (view.dim() != s_dim)
+			{
+				throw std::invalid_argument("fixed_grid: view dimensions do not match the extents.");
+			}
+
+			auto iter = m_data.begin();
+			view.iterate([&](const auto &pos, const auto &val) { *iter++ = val; });
+		}
+
+	#pragma endregion
+	#pragma region meta data
+
+	public:
+		[[nodiscard]] constexpr auto operator<=>(const this_type &other) const = default;
+
+		[[nodiscard]] static constexpr size_t rank()
+		{
+			return dimensions;
+		}
+
+		[[nodiscard]] static constexpr grid_size<dimensions> dim()
+		{
+			return s_dim;
+		}
+
+		[[nodiscard]] static constexpr size_t dim_at(size_t axis)
+		{
+			return s_dim[axis];
+		}
+
+		[[nodiscard]] static constexpr grid_stride<dimensions> stride()
+		{
+			return s_stride;
+		}
+
+		[[nodiscard]] static constexpr size_t size()
+		{
+			return elements;
+		}
+
+		[[nodiscard]] constexpr const data_type *data() const
+		{
+			return m_data.data();
+		}
+
+		// the strides are known at compile time, so this unrolls into a plain multiply-add chain.
+		[[nodiscard]] static constexpr size_t index_of(const grid_size<dimensions> &pos)
+		{
+			return [&]<size_t ...axis>(std::index_sequence<axis...>)
+			{
+				return (size_t{ 0 } + ... + (pos[axis] * static_cast<size_t>(s_stride[axis])));
+			}(std::make_index_sequence<dimensions>{});
+		}
+
+		[[nodiscard]] static constexpr grid_size<dimensions> position_of(size_t index)
+		{
+			return grid_size<dimensions>::from_index(index, s_dim);
+		}
+
+		[[nodiscard]] static constexpr bool inside(const grid_size<dimensions> &pos)
+		{
+			return [&]<size_t ...axis>(std::index_sequence<axis...>)
+			{
+				return (true && ... && (pos[axis] < s_dim[axis]));
+			}(std::make_index_sequence<dimensions>{});
+		}
+
+	#pragma endregion
+	#pragma region accessors
+
+	public:
+		[[nodiscard]] constexpr data_type &operator[](size_t index)
+		{
+			return m_data[index];
+		}
+
+		[[nodiscard]] constexpr const data_type &operator[](size_t index) const
+		{
+			return m_data[index];
+		}
+
+		[[nodiscard]] constexpr data_type &at(const grid_size<dimensions> &pos)
+		{
+			return m_data[index_of(pos)];
+		}
+
+		[[nodiscard]] constexpr const data_type &at(const grid_size<dimensions> &pos) const
+		{
+			return m_data[index_of(pos)];
+		}
+
+	#pragma endregion
+	#pragma region iterators
+
+	public:
+		[[nodiscard]] constexpr iterator begin()
+		{
+			return m_data.begin();
+		}
+		[[nodiscard]] constexpr const_iterator begin() const
+		{
+			return m_data.begin();
+		}
+		[[nodiscard]] constexpr iterator end()
+		{
+			return m_data.end();
+		}
+		[[nodiscard]] constexpr const_iterator end() const
+		{
+			return m_data.end();
+		}
+
+		[[nodiscard]] constexpr reverse_iterator rbegin()
+		{
+			return m_data.rbegin();
+		}
+		[[nodiscard]] constexpr const_reverse_iterator rbegin() const
+		{
+			return m_data.rbegin();
+		}
+		[[nodiscard]] constexpr reverse_iterator rend()
+		{
+			return m_data.rend();
+		}
+		[[nodiscard]] constexpr const_reverse_iterator rend() const
+		{
+			return m_data.rend();
+		}
+
+		[[nodiscard]] constexpr const_iterator cbegin() const
+		{
+			return m_data.cbegin();
+		}
+		[[nodiscard]] constexpr const_iterator cend() const
+		{
+			return m_data.cend();
+		}
+
+		[[nodiscard]] constexpr const_reverse_iterator crbegin() const
+		{
+			return m_data.crbegin();
+		}
+		[[nodiscard]] constexpr const_reverse_iterator crend() const
+		{
+			return m_data.crend();
+		}
+
+	#pragma endregion
+	#pragma region manipulators
+
+	public:
+		// read-write iteration (with position information)
+		template <typename function_type>
+		constexpr void iterate(function_type &&function)
+		{
+			view().iterate(function);
+		}
+
+		// read-only iteration (with position information)
+		template <typename function_type>
+		constexpr void iterate(function_type &&function) const
+		{
+			view().iterate(function);
+		}
+
+		// read-write row iteration (see grid::iterate_rows())
+		template <typename function_type>
+		constexpr void iterate_rows(function_type &&function)
+			requires(dimensions > 0)
+		{
+			iterate_rows_of(m_data.data(), function);
+		}
+
+		// read-only row iteration (see grid::iterate_rows())
+		template <typename function_type>
+		constexpr void iterate_rows(function_type &&function) const
+			requires(dimensions > 0)
+		{
+			iterate_rows_of(m_data.data(), function);
+		}
+
+	private:
+		template <typename pointer_type, typename function_type>
+		static constexpr void iterate_rows_of(pointer_type data, function_type &function)
+		{
+			using element_type = std::remove_pointer_t<pointer_type>;
+			constexpr size_t row_length = s_dim[dimensions - 1];
+			if constexpr (row_length > 0)
+			{
+				grid_pos<dimensions> pos{ s_dim };
+				for (size_t offset = 0; offset < elements; offset += row_length)
+				{
+					function(std::as_const(pos), std::span<element_type, row_length>(data + offset, row_length));
+					pos.next(1);
+				}
+			}
+		}
+
+	#pragma endregion
+	#pragma region partitions (subgrid, slice)
+
+	public:
+		/*
+			cuts one slice/layer out of the grid. the axis has to be known at compile time, as it determines the extents of the result.
+			the axis is perpendicular to the cut (the slice contains all the values with dim_at(axis) == layer).
+		*/
+		template <size_t axis = 0>
+		[[nodiscard]] constexpr subgrid_type<axis> subgrid(size_t layer) const
+			requires(dimensions > 0)
+		{
+			return subgrid_type<axis>(subgrid_view(layer, axis));
+		}
+
+		/*
+			slices the whole grid into dim_at(axis) layers.
+		*/
+		template <size_t axis = 0>
+		[[nodiscard]] constexpr std::array<subgrid_type<axis>, s_dim[axis]> slice() const
+			requires(dimensions > 0)
+		{
+			std::array<subgrid_type<axis>, s_dim[axis]> result{};
+			for (size_t layer = 0; layer < result.size(); ++layer)
+			{
+				result[layer] = subgrid<axis>(layer);
+			}
+			return result;
+		}
+
+	#pragma endregion
+	#pragma region views
+
+	public:
+		[[nodiscard]] constexpr grid_view<data_type, dimensions> view()
+		{
+			return grid_view<data_type, dimensions>(m_data.data(), s_dim, s_stride);
+		}
+
+		[[nodiscard]] constexpr grid_view<const data_type, dimensions> view() const
+		{
+			return grid_view<const data_type, dimensions>(m_data.data(), s_dim, s_stride);
+		}
+
+		// runtime axis version of subgrid(), without copying.
+		[[nodiscard]] constexpr grid_view<data_type, dimensions - 1> subgrid_view(size_t layer, size_t axis = 0)
+			requires(dimensions > 0)
+		{
+			return view().subgrid(layer, axis);
+		}
+
+		[[nodiscard]] constexpr grid_view<const data_type, dimensions - 1> subgrid_view(size_t layer, size_t axis = 0) const
+			requires(dimensions > 0)
+		{
+			return view().subgrid(layer, axis);
+		}
+
+	#pragma endregion
+	#pragma region member variables
+
+	private:
+		container_type m_data{};
+
+	#pragma endregion
+	};
+
+#pragma endregion
+}
@@ -0,0 +1,585 @@
+#include <unordered_map>
+#include <type_traits> // std::is_trivially_copyable_v
+#include <filesystem>
+#include <stdexcept>
+#include <algorithm>   // std::max(), std::find_if()
+#include <cstring>     // std::memcpy()
+#include <fstream>
+#include <cstdint>
+#include <limits>      // std::numeric_limits
+#include <utility>     // std::as_const()
+#include <future>
+#include <vector>
+#include <array>
+#include <list>
+export module p3.grid.paged;
+/*
+	Paged grid module, part of github/TeraFlint/pitrilib.
+	Daniel Wiegert (Pitri), 2021.
+*/
+
+export import p3.grid;
+export import p3.persistence;
+// import <unordered_map>;
+// import <type_traits>; // std::is_trivially_copyable_v
+// import <filesystem>;
+// import <stdexcept>;
+// import <algorithm>;   // std::max(), std::find_if()
+// import <cstring>;     // std::memcpy()
+// import <fstream>;
+// import <cstdint>;
+// import <limits>;      // std::numeric_limits
+// import <utility>;     // std::as_const()
+// import <future>;
+// import <vector>;
+// import <array>;
+// import <list>;
+
+namespace p3
+{
+#pragma region paged grid
+
+	export
+	/*
+		n dimensional grid for data larger than the memory: the elements live in a backing file, split into chunks of a fixed size.
+		only a bounded amount of chunks is held in memory (least recently used ones get evicted). chunks get loaded on demand,
+		modified chunks are written back when they're evicted or flushed.
+
+		the backing file starts with a small header (element size, dimensions, chunk dimensions), padded to 64 bytes,
+		followed by the chunks in row-major order. each chunk holds its elements in row-major order as well, chunks at the
+		border are padded. a freshly created file reads as zero bytes.
+
+		create() starts a new backing file, load() (from file_access) opens an existing one.
+		save() flushes everything and copies the backing file, if the location differs.
+	*/
+	template <typename data_type, size_t dimensions>
+	class paged_grid : public file_access
+	{
+		static_assert(std::is_trivially_copyable_v<data_type>, "paged_grid: the elements must be trivially copyable.");
+
+	public:
+		using chunk_type = std::vector<data_type>;
+
+		struct statistics
+		{
+			size_t hits = 0;        // chunk was already resident.
+			size_t misses = 0;      // chunk had to be read from the file.
+			size_t evictions = 0;   // chunk was dropped to make room.
+			size_t write_backs = 0; // dirty chunk was written to the file.
+			size_t prefetches = 0;  // chunk was read in the background during iterate().
+		};
+
+	#pragma region constructors
+
+		// capacity = amount of chunks kept in memory at once.
+		explicit paged_grid(const grid_size<dimensions> &chunk_dim, size_t capacity)
+			: m_chunk{ chunk_dim }, m_capacity{ std::max<size_t>(capacity, 1) }
+		{
+			if (m_chunk.elements() == 0)
+			{
+				throw std::invalid_argument("paged_grid: chunks can't be empty.");
+			}
+		}
+
+		paged_grid(const paged_grid &) = delete;
+		paged_grid &operator=(const paged_grid &) = delete;
+
+		~paged_grid()
+		{
+			try
+			{
+				flush();
+			}
+			catch (...)
+			{
+				// destructors mustn't throw. call flush() beforehand to see errors.
+			}
+		}
+
+	#pragma endregion
+	#pragma region backing file
+
+		// creates (or overwrites) the backing file for a grid of the given size.
+		void create(const path_type &location, const grid_size<dimensions> &size)
+		{
+			close();
+			m_location = location;
+			set_dim(size);
+
+			{
+				std::ofstream file(location, std::ios::binary | std::ios::trunc);
+				if (!file)
+				{
+					throw no_directory("paged_grid: can't create the backing file.");
+				}
+				const auto header = make_header();
+				file.write(reinterpret_cast<const char *>(header.data()), header.size());
+			}
+			std::filesystem::resize_file(location, data_offset() + m_chunks.elements() * chunk_bytes());
+			open();
+		}
+
+		// writes all dirty chunks to the file. they stay resident.
+		void flush() const
+		{
+			for (auto &[index, entry] : m_cache)
+			{
+				write_back(index, entry);
+			}
+		}
+
+		[[nodiscard]] const path_type &location() const
+		{
+			return m_location;
+		}
+
+	#pragma endregion
+	#pragma region meta data
+
+		[[nodiscard]] constexpr size_t rank() const
+		{
+			return dimensions;
+		}
+
+		[[nodiscard]] grid_size<dimensions> dim() const
+		{
+			return m_dim;
+		}
+
+		[[nodiscard]] grid_size<dimensions> chunk_dim() const
+		{
+			return m_chunk;
+		}
+
+		// amount of chunks along each axis.
+		[[nodiscard]] grid_size<dimensions> chunk_grid() const
+		{
+			return m_chunks;
+		}
+
+		[[nodiscard]] size_t size() const
+		{
+			return m_dim.elements();
+		}
+
+		[[nodiscard]] size_t capacity() const
+		{
+			return m_capacity;
+		}
+
+		[[nodiscard]] size_t resident() const
+		{
+			return m_cache.size();
+		}
+
+		[[nodiscard]] bool inside(const grid_size<dimensions> &pos) const
+		{
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				if (pos[axis] >= m_dim[axis])
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		[[nodiscard]] const statistics &stats() const
+		{
+			return m_stats;
+		}
+
+		void reset_stats()
+		{
+			m_stats = {};
+		}
+
+	#pragma endregion
+	#pragma region accessors
+
+		[[nodiscard]] data_type at(const grid_size<dimensions> &pos) const
+		{
+			const auto [chunk, inner] = split(pos);
+			return fetch(chunk).data[inner];
+		}
+
+		void set(const grid_size<dimensions> &pos, const data_type &value)
+		{
+			const auto [chunk, inner] = split(pos);
+			auto &entry = fetch(chunk);
+			entry.data[inner] = value;
+			entry.dirty = true;
+		}
+
+		// loads a chunk ahead of time (no-op if it's resident already).
+		void prefetch(const grid_size<dimensions> &chunk_pos) const
+		{
+			fetch(m_chunks.index_of(chunk_pos));
+		}
+
+	#pragma endregion
+	#pragma region iterators
+
+		// read-write iteration, one chunk after another. the next chunk gets read in the background meanwhile.
+		template <typename function_type>
+		void iterate(function_type &&function)
+		{
+			iterate_chunks([&](const grid_pos<dimensions> &pos, cache_entry &entry, size_t inner)
+			{
+				function(pos, entry.data[inner]);
+			}, true);
+		}
+
+		// read-only iteration, one chunk after another. the next chunk gets read in the background meanwhile.
+		template <typename function_type>
+		void iterate(function_type &&function) const
+		{
+			iterate_chunks([&](const grid_pos<dimensions> &pos, const cache_entry &entry, size_t inner)
+			{
+				function(pos, std::as_const(entry.data[inner]));
+			}, false);
+		}
+
+	#pragma endregion
+
+	protected:
+		// the header is checked against the file size before anything changes, so failing leaves the grid as it was.
+		bool on_load(const path_type &location) override
+		{
+			std::ifstream file(location, std::ios::binary);
+			std::array<char, 8> magic{};
+			uint32_t element_size = 0, rank = 0;
+			file.read(magic.data(), magic.size());
+			file.read(reinterpret_cast<char *>(&element_size), sizeof(element_size));
+			file.read(reinterpret_cast<char *>(&rank), sizeof(rank));
+			if (!file || magic != s_magic || element_size != sizeof(data_type) || rank != dimensions)
+			{
+				return false;
+			}
+
+			std::array<uint64_t, 2 * dimensions> extents{};
+			file.read(reinterpret_cast<char *>(extents.data()), sizeof(extents));
+			if (!file)
+			{
+				return false;
+			}
+
+			grid_size<dimensions> size{}, chunk{};
+			uint64_t chunk_count = 1, chunk_size = sizeof(data_type);
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				size[axis] = static_cast<size_t>(extents[axis]);
+				chunk[axis] = static_cast<size_t>(extents[dimensions + axis]);
+				if (chunk[axis] == 0 || !multiply(chunk_size, chunk[axis]) || !multiply(chunk_count, chunks_along(size[axis], chunk[axis])))
+				{
+					return false;
+				}
+			}
+
+			std::error_code error;
+			const uint64_t file_size = std::filesystem::file_size(location, error);
+			if (error || !multiply(chunk_count, chunk_size) || file_size < data_offset() || file_size - data_offset() != chunk_count)
+			{
+				return false;
+			}
+
+			close();
+			m_chunk = chunk;
+			m_location = location;
+			set_dim(size);
+			open();
+			return true;
+		}
+
+		bool on_save(const path_type &location) const override
+		{
+			flush();
+			m_file.flush();
+			if (!std::filesystem::exists(location) || !std::filesystem::equivalent(location, m_location))
+			{
+				std::filesystem::copy_file(m_location, location, std::filesystem::copy_options::overwrite_existing);
+			}
+			return true;
+		}
+
+		// saving onto the backing file just flushes it, it can't be replaced while it's open.
+		bool save_in_place(const path_type &location) const override
+		{
+			return std::filesystem::exists(location) && std::filesystem::equivalent(location, m_location);
+		}
+
+	private:
+		struct cache_entry
+		{
+			chunk_type data;
+			typename std::list<size_t>::iterator lru;
+			bool dirty = false;
+			bool pinned = false; // in use by iterate(), can't be evicted.
+		};
+
+		static constexpr std::array<char, 8> s_magic{ 'p', '3', 'p', 'a', 'g', 'e', 'd', 1 };
+
+		// multiplies in place, unless the product doesn't fit into size_t.
+		[[nodiscard]] static bool multiply(uint64_t &value, uint64_t factor)
+		{
+			if (factor != 0 && value > std::numeric_limits<size_t>::max() / factor)
+			{
+				return false;
+			}
+			value *= factor;
+			return true;
+		}
+
+		[[nodiscard]] static size_t chunks_along(size_t extent, size_t chunk)
+		{
+			return extent / chunk + (extent % chunk != 0);
+		}
+
+		[[nodiscard]] size_t chunk_bytes() const
+		{
+			return m_chunk.elements() * sizeof(data_type);
+		}
+
+		[[nodiscard]] static constexpr size_t data_offset()
+		{
+			// magic, element size, rank, dimensions, chunk dimensions.
+			return (8 + 4 + 4 + 16 * dimensions + 63) / 64 * 64;
+		}
+
+		[[nodiscard]] std::vector<char> make_header() const
+		{
+			std::vector<char> result(data_offset());
+			const uint32_t element_size = sizeof(data_type), rank = dimensions;
+			std::array<uint64_t, 2 * dimensions> extents{};
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				extents[axis] = m_dim[axis];
+				extents[dimensions + axis] = m_chunk[axis];
+			}
+			std::memcpy(result.data(), s_magic.data(), s_magic.size());
+			std::memcpy(result.data() + 8, &element_size, 4);
+			std::memcpy(result.data() + 12, &rank, 4);
+			std::memcpy(result.data() + 16, extents.data(), sizeof(extents));
+			return result;
+		}
+
+		void set_dim(const grid_size<dimensions> &size)
+		{
+			m_dim = size;
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				m_chunks[axis] = chunks_along(size[axis], m_chunk[axis]);
+			}
+		}
+
+		void open()
+		{
+			m_file.open(m_location, std::ios::binary | std::ios::in | std::ios::out);
+			if (!m_file)
+			{
+				throw no_file("paged_grid: can't open the backing file.");
+			}
+		}
+
+		void close()
+		{
+			if (m_file.is_open())
+			{
+				flush();
+				m_file.close();
+			}
+			m_cache.clear();
+			m_lru.clear();
+		}
+
+		// chunk index + element index inside of the chunk.
+		[[nodiscard]] std::pair<size_t, size_t> split(const grid_size<dimensions> &pos) const
+		{
+			grid_size<dimensions> chunk{}, inner{};
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				chunk[axis] = pos[axis] / m_chunk[axis];
+				inner[axis] = pos[axis] % m_chunk[axis];
+			}
+			return { m_chunks.index_of(chunk), m_chunk.index_of(inner) };
+		}
+
+		void read_chunk(std::istream &stream, size_t index, chunk_type &chunk) const
+		{
+			chunk.resize(m_chunk.elements());
+			stream.seekg(data_offset() + index * chunk_bytes());
+			stream.read(reinterpret_cast<char *>(chunk.data()), chunk_bytes());
+			if (!stream)
+			{
+				throw custom_error("paged_grid: reading a chunk failed.");
+			}
+		}
+
+		void write_back(size_t index, cache_entry &entry) const
+		{
+			if (!entry.dirty)
+			{
+				return;
+			}
+			m_file.seekp(data_offset() + index * chunk_bytes());
+			m_file.write(reinterpret_cast<const char *>(entry.data.data()), chunk_bytes());
+			// background reads use their own file handle, they have to see this.
+			m_file.flush();
+			if (!m_file)
+			{
+				throw custom_error("paged_grid: writing a chunk failed.");
+			}
+			entry.dirty = false;
+			++m_stats.write_backs;
+			++m_writes;
+		}
+
+		/*
+			inserts a chunk as the most recently used one, evicting the least recently used chunks beyond the capacity.
+			pinned chunks get skipped, the cache may exceed its capacity by them for a while. a chunk that's resident
+			already only moves to the front, its cached data wins over the given one.
+		*/
+		cache_entry &insert(size_t index, chunk_type &&data) const
+		{
+			if (auto found = m_cache.find(index); found != m_cache.end())
+			{
+				m_lru.splice(m_lru.begin(), m_lru, found->second.lru);
+				return found->second;
+			}
+
+			while (m_cache.size() >= m_capacity)
+			{
+				auto victim = std::find_if(m_lru.rbegin(), m_lru.rend(), [this](size_t key) { return !m_cache.find(key)->second.pinned; });
+				if (victim == m_lru.rend())
+				{
+					break;
+				}
+				auto found = m_cache.find(*victim);
+				write_back(*victim, found->second);
+				m_cache.erase(found);
+				m_lru.erase(std::next(victim).base());
+				++m_stats.evictions;
+			}
+
+			m_lru.push_front(index);
+			auto &entry = m_cache[index];
+			entry.data = std::move(data);
+			entry.lru = m_lru.begin();
+			entry.dirty = false;
+			return entry;
+		}
+
+		cache_entry &fetch(size_t index) const
+		{
+			if (!m_file.is_open())
+			{
+				throw no_file("paged_grid: no backing file.");
+			}
+
+			auto found = m_cache.find(index);
+			if (found != m_cache.end())
+			{
+				++m_stats.hits;
+				m_lru.splice(m_lru.begin(), m_lru, found->second.lru);
+				return found->second;
+			}
+
+			++m_stats.misses;
+			chunk_type data;
+			read_chunk(m_file, index, data);
+			return insert(index, std::move(data));
+		}
+
+		template <typename function_type>
+		void iterate_chunks(function_type &&function, bool mark_dirty) const
+		{
+			const size_t chunk_count = m_chunks.elements();
+			if (chunk_count == 0 || m_dim.elements() == 0)
+			{
+				return;
+			}
+
+			/*
+				reads a non-resident chunk on another thread, with its own file handle. the callbacks may touch the chunk
+				in the meantime, so the result only counts if it isn't resident and nothing got written back since.
+			*/
+			size_t writes_at_prefetch = 0;
+			const auto start_prefetch = [&](size_t index)
+			{
+				if (index >= chunk_count || m_cache.contains(index))
+				{
+					return std::future<chunk_type>{};
+				}
+				writes_at_prefetch = m_writes;
+				return std::async(std::launch::async, [this, index]()
+				{
+					std::ifstream file(m_location, std::ios::binary);
+					chunk_type chunk;
+					read_chunk(file, index, chunk);
+					return chunk;
+				});
+			};
+
+			auto pending = start_prefetch(0);
+			grid_pos<dimensions> pos{ m_dim };
+
+			for (size_t index = 0; index < chunk_count; ++index)
+			{
+				cache_entry *entry = nullptr;
+				if (pending.valid() && !m_cache.contains(index) && m_writes == writes_at_prefetch)
+				{
+					++m_stats.prefetches;
+					entry = &insert(index, pending.get());
+				}
+				else
+				{
+					if (pending.valid())
+					{
+						pending.wait();
+					}
+					entry = &fetch(index);
+				}
+
+				// the callbacks may load other chunks, this one has to stay where it is.
+				entry->pinned = true;
+				pending = start_prefetch(index + 1);
+
+				const auto origin = grid_size<dimensions>::from_index(index, m_chunks);
+				try
+				{
+					for (grid_pos<dimensions> inner{ m_chunk }; inner.valid(); ++inner)
+					{
+						grid_size<dimensions> global{};
+						for (size_t axis = 0; axis < dimensions; ++axis)
+						{
+							global[axis] = origin[axis] * m_chunk[axis] + inner.pos_at(axis);
+						}
+						if (pos.jump(global))
+						{
+							function(std::as_const(pos), *entry, inner.index());
+						}
+					}
+				}
+				catch (...)
+				{
+					entry->pinned = false;
+					throw;
+				}
+				entry->pinned = false;
+				entry->dirty = entry->dirty || mark_dirty;
+			}
+		}
+
+		path_type m_location;
+		grid_size<dimensions> m_dim{}, m_chunk{}, m_chunks{};
+		size_t m_capacity;
+
+		mutable std::fstream m_file;
+		mutable std::unordered_map<size_t, cache_entry> m_cache;
+		mutable std::list<size_t> m_lru;
+		mutable statistics m_stats;
+		mutable size_t m_writes = 0; // write-backs so far, prefetches compare against it.
+	};
+
+#pragma endregion
+}
@@ -0,0 +1,555 @@
+#include <algorithm>  // std::sort(), std::count_if()
+#include <utility>    // std::as_const()
+#include <cstdint>
+#include <variant>
+#include <vector>
+export module p3.grid.sparse;
+/*
+	Sparse grid module, part of github/TeraFlint/pitrilib.
+	Daniel Wiegert (Pitri), 2021.
+*/
+
+export import p3.grid;
+// import <algorithm>;  // std::sort(), std::count_if()
+// import <utility>;    // std::as_const()
+// import <cstdint>;
+// import <variant>;
+// import <vector>;
+
+namespace p3
+{
+#pragma region sparse grid
+
+	export
+	/*
+		n dimensional grid which only stores the elements that differ from the default value (data_type{}).
+		the elements are kept in an open addressing hash table (linear probing), keyed by their row-major index.
+		meant for huge, mostly empty grids, like occupancy maps. every position that isn't stored reads as the default value.
+	*/
+	template <typename data_type, size_t dimensions>
+	class sparse_grid
+	{
+	#pragma region types
+
+	public:
+		using this_type = sparse_grid<data_type, dimensions>;
+
+	private:
+		// key 0 marks an empty slot, so the stored keys are index + 1.
+		struct slot
+		{
+			size_t key = 0;
+			data_type value{};
+		};
+
+		static constexpr size_t s_min_capacity = 16;
+
+	#pragma endregion
+	#pragma region constructors
+
+	public:
+		sparse_grid() = default;
+
+		// size constructor
+		explicit sparse_grid(const grid_size<dimensions> &size)
+			: m_dim{ size }
+		{
+		}
+
+		// dense grid constructor, only keeps the non-default elements
+		explicit sparse_grid(const grid<data_type, dimensions> &dense)
+			: m_dim{ dense.dim() }
+		{
+			for (size_t index = 0; index < dense.size(); ++index)
+			{
+				if (dense[index] != s_default)
+				{
+					insert(index) = dense[index];
+				}
+			}
+		}
+
+	#pragma endregion
+	#pragma region meta data
+
+	public:
+		[[nodiscard]] constexpr size_t rank() const
+		{
+			return dimensions;
+		}
+
+		[[nodiscard]] constexpr grid_size<dimensions> dim() const
+		{
+			return m_dim;
+		}
+
+		[[nodiscard]] constexpr size_t dim_at(size_t axis) const
+		{
+			return m_dim[axis];
+		}
+
+		// amount of positions in the grid, stored or not (same meaning as grid::size()).
+		[[nodiscard]] constexpr size_t size() const
+		{
+			return m_dim.elements();
+		}
+
+		// amount of actually stored elements.
+		[[nodiscard]] constexpr size_t stored() const
+		{
+			return m_count;
+		}
+
+		[[nodiscard]] constexpr size_t index_of(const grid_size<dimensions> &pos) const
+		{
+			return m_dim.index_of(pos);
+		}
+
+		[[nodiscard]] constexpr grid_size<dimensions> position_of(size_t index) const
+		{
+			return grid_size<dimensions>::from_index(index, m_dim);
+		}
+
+		[[nodiscard]] constexpr bool inside(const grid_size<dimensions> &pos) const
+		{
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				if (pos[axis] >= m_dim[axis])
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		[[nodiscard]] bool contains(const grid_size<dimensions> &pos) const
+		{
+			return find(index_of(pos)) != nullptr;
+		}
+
+		// bytes currently occupied by the element storage.
+		[[nodiscard]] size_t memory_footprint() const
+		{
+			return m_slots.capacity() * sizeof(slot);
+		}
+
+		// bytes the element storage would occupy for a given amount of stored elements.
+		[[nodiscard]] static constexpr size_t memory_footprint(size_t stored)
+		{
+			return capacity_for(stored) * sizeof(slot);
+		}
+
+	#pragma endregion
+	#pragma region accessors
+
+	public:
+		// read access. positions which aren't stored return the default value.
+		[[nodiscard]] const data_type &at(const grid_size<dimensions> &pos) const
+		{
+			const slot *found = find(index_of(pos));
+			return found ? found->value : s_default;
+		}
+
+		// write access. positions which aren't stored get inserted (default initialized), even if they're never written to.
+		// prefer set() to keep the grid sparse.
+		[[nodiscard]] data_type &at(const grid_size<dimensions> &pos)
+		{
+			return insert(index_of(pos));
+		}
+
+		// stores the value, or removes the position if the value equals the default value.
+		void set(const grid_size<dimensions> &pos, const data_type &value)
+		{
+			const size_t index = index_of(pos);
+			if (value == s_default)
+			{
+				erase(index);
+			}
+			else
+			{
+				insert(index) = value;
+			}
+		}
+
+		void erase(const grid_size<dimensions> &pos)
+		{
+			erase(index_of(pos));
+		}
+
+		void clear()
+		{
+			m_slots = {};
+			m_count = 0;
+		}
+
+	#pragma endregion
+	#pragma region manipulators
+
+	public:
+		// read-only iteration over every position in row-major order (with position information), stored or not.
+		template <typename function_type>
+		void iterate(function_type &&function) const
+		{
+			std::vector<const slot *> sorted = sorted_slots();
+			auto next = sorted.begin();
+
+			grid_pos<dimensions> pos{ m_dim };
+			for (size_t index = 0; index < size(); ++index, ++pos)
+			{
+				if (next != sorted.end() && (*next)->key == index + 1)
+				{
+					function(std::as_const(pos), (*next)->value);
+					++next;
+				}
+				else
+				{
+					function(std::as_const(pos), s_default);
+				}
+			}
+		}
+
+		// read-write iteration over the stored elements only, in no particular order.
+		template <typename function_type>
+		void iterate_stored(function_type &&function)
+		{
+			for (auto &entry : m_slots)
+			{
+				if (entry.key != 0)
+				{
+					const grid_pos<dimensions> pos{ m_dim, position_of(entry.key - 1) };
+					function(pos, entry.value);
+				}
+			}
+		}
+
+		// read-only iteration over the stored elements only, in no particular order.
+		template <typename function_type>
+		void iterate_stored(function_type &&function) const
+		{
+			for (const auto &entry : m_slots)
+			{
+				if (entry.key != 0)
+				{
+					const grid_pos<dimensions> pos{ m_dim, position_of(entry.key - 1) };
+					function(pos, entry.value);
+				}
+			}
+		}
+
+		[[nodiscard]] grid<data_type, dimensions> to_grid() const
+		{
+			grid<data_type, dimensions> result(m_dim);
+			for (const auto &entry : m_slots)
+			{
+				if (entry.key != 0)
+				{
+					result[entry.key - 1] = entry.value;
+				}
+			}
+			return result;
+		}
+
+	#pragma endregion
+	#pragma region hash table
+
+	private:
+		static constexpr size_t capacity_for(size_t stored)
+		{
+			// keeps the load factor below 1/2, which keeps the probe sequences short.
+			size_t capacity = s_min_capacity;
+			while (capacity < 2 * stored)
+			{
+				capacity *= 2;
+			}
+			return stored > 0 ? capacity : 0;
+		}
+
+		size_t home_of(size_t key) const
+		{
+			// fibonacci hashing, consecutive indices are spread over the whole table.
+			const std::uint64_t hash = static_cast<std::uint64_t>(key) * 0x9E3779B97F4A7C15ULL;
+			return static_cast<size_t>(hash ^ (hash >> 32)) & (m_slots.size() - 1);
+		}
+
+		const slot *find(size_t index) const
+		{
+			if (m_slots.empty())
+			{
+				return nullptr;
+			}
+
+			const size_t key = index + 1, mask = m_slots.size() - 1;
+			for (size_t i = home_of(key); m_slots[i].key != 0; i = (i + 1) & mask)
+			{
+				if (m_slots[i].key == key)
+				{
+					return &m_slots[i];
+				}
+			}
+			return nullptr;
+		}
+
+		data_type &insert(size_t index)
+		{
+			if (2 * (m_count + 1) > m_slots.size())
+			{
+				rehash(capacity_for(m_count + 1));
+			}
+
+			const size_t key = index + 1, mask = m_slots.size() - 1;
+			size_t i = home_of(key);
+			for (; m_slots[i].key != 0; i = (i + 1) & mask)
+			{
+				if (m_slots[i].key == key)
+				{
+					return m_slots[i].value;
+				}
+			}
+
+			m_slots[i].key = key;
+			++m_count;
+			return m_slots[i].value;
+		}
+
+		void erase(size_t index)
+		{
+			slot *found = const_cast<slot *>(find(index));
+			if (!found)
+			{
+				return;
+			}
+
+			// backward shift deletion: close the gap, so no tombstones are needed.
+			const size_t mask = m_slots.size() - 1;
+			size_t gap = static_cast<size_t>(found - m_slots.data());
+			for (size_t i = (gap + 1) & mask; m_slots[i].key != 0; i = (i + 1) & mask)
+			{
+				const size_t home = home_of(m_slots[i].key);
+				const bool movable = gap <= i ? (home <= gap || home > i) : (home <= gap && home > i);
+				if (movable)
+				{
+					m_slots[gap] = std::move(m_slots[i]);
+					gap = i;
+				}
+			}
+			m_slots[gap] = slot{};
+			--m_count;
+		}
+
+		void rehash(size_t capacity)
+		{
+			std::vector<slot> old(capacity);
+			old.swap(m_slots);
+
+			const size_t mask = m_slots.size() - 1;
+			for (auto &entry : old)
+			{
+				if (entry.key != 0)
+				{
+					size_t i = home_of(entry.key);
+					while (m_slots[i].key != 0)
+					{
+						i = (i + 1) & mask;
+					}
+					m_slots[i] = std::move(entry);
+				}
+			}
+		}
+
+		std::vector<const slot *> sorted_slots() const
+		{
+			std::vector<const slot *> result;
+			result.reserve(m_count);
+			for (const auto &entry : m_slots)
+			{
+				if (entry.key != 0)
+				{
+					result.push_back(&entry);
+				}
+			}
+			std::sort(result.begin(), result.end(), [](const slot *a, const slot *b) { return a->key < b->key; });
+			return result;
+		}
+
+	#pragma endregion
+	#pragma region member variables
+
+	private:
+		static inline const data_type s_default{};
+
+		grid_size<dimensions> m_dim{};
+		std::vector<slot> m_slots;
+		size_t m_count = 0;
+
+	#pragma endregion
+	};
+
+#pragma endregion
+#pragma region adaptive grid
+
+	export
+	/*
+		n dimensional grid which picks its storage by memory footprint: it starts out as a sparse_grid,
+		migrates into a dense grid once the hash table outgrows it and migrates back once enough elements got reset.
+		the migrations are tracked through set(), which is why there is no mutable at().
+	*/
+	template <typename data_type, size_t dimensions>
+	class adaptive_grid
+	{
+	#pragma region types
+
+	public:
+		using this_type = adaptive_grid<data_type, dimensions>;
+		using sparse_type = sparse_grid<data_type, dimensions>;
+		using dense_type = grid<data_type, dimensions>;
+
+	#pragma endregion
+	#pragma region constructors
+
+	public:
+		adaptive_grid() = default;
+
+		// size constructor (starts sparse)
+		explicit adaptive_grid(const grid_size<dimensions> &size)
+			: m_storage{ sparse_type(size) }
+		{
+		}
+
+		// dense grid constructor (picks the smaller storage right away)
+		explicit adaptive_grid(const dense_type &dense)
+			: m_storage{ dense }
+		{
+			m_count = static_cast<size_t>(std::count_if(dense.begin(), dense.end(), [](const auto &val) { return val != data_type{}; }));
+			migrate();
+		}
+
+	#pragma endregion
+	#pragma region meta data
+
+	public:
+		[[nodiscard]] constexpr size_t rank() const
+		{
+			return dimensions;
+		}
+
+		[[nodiscard]] grid_size<dimensions> dim() const
+		{
+			return std::visit([](const auto &storage) { return storage.dim(); }, m_storage);
+		}
+
+		[[nodiscard]] size_t dim_at(size_t axis) const
+		{
+			return dim()[axis];
+		}
+
+		[[nodiscard]] size_t size() const
+		{
+			return dim().elements();
+		}
+
+		// amount of non-default elements.
+		[[nodiscard]] size_t stored() const
+		{
+			return sparse() ? std::get<sparse_type>(m_storage).stored() : m_count;
+		}
+
+		[[nodiscard]] bool sparse() const
+		{
+			return std::holds_alternative<sparse_type>(m_storage);
+		}
+
+		[[nodiscard]] size_t memory_footprint() const
+		{
+			return sparse() ? std::get<sparse_type>(m_storage).memory_footprint() : dense_footprint();
+		}
+
+	#pragma endregion
+	#pragma region accessors
+
+	public:
+		[[nodiscard]] const data_type &at(const grid_size<dimensions> &pos) const
+		{
+			return std::visit([&](const auto &storage) -> const data_type & { return storage.at(pos); }, m_storage);
+		}
+
+		void set(const grid_size<dimensions> &pos, const data_type &value)
+		{
+			if (auto *storage = std::get_if<sparse_type>(&m_storage))
+			{
+				storage->set(pos, value);
+			}
+			else
+			{
+				auto &old = std::get<dense_type>(m_storage).at(pos);
+				const bool was_default = old == data_type{};
+				const bool is_default = value == data_type{};
+				if (was_default != is_default)
+				{
+					is_default ? --m_count : ++m_count;
+				}
+				old = value;
+			}
+			migrate();
+		}
+
+	#pragma endregion
+	#pragma region manipulators
+
+	public:
+		// read-only iteration over every position in row-major order (with position information).
+		template <typename function_type>
+		void iterate(function_type &&function) const
+		{
+			std::visit([&](const auto &storage) { storage.iterate(function); }, m_storage);
+		}
+
+		[[nodiscard]] dense_type to_grid() const
+		{
+			if (const auto *storage = std::get_if<sparse_type>(&m_storage))
+			{
+				return storage->to_grid();
+			}
+			return std::get<dense_type>(m_storage);
+		}
+
+	private:
+		size_t dense_footprint() const
+		{
+			return size() * sizeof(data_type);
+		}
+
+		/*
+			sparse -> dense once the hash table needs more memory than the dense grid.
+			dense -> sparse once a hash table for the stored elements would need less than half of it.
+			the gap between both thresholds keeps the grid from flipping back and forth.
+		*/
+		void migrate()
+		{
+			if (const auto *storage = std::get_if<sparse_type>(&m_storage))
+			{
+				if (storage->memory_footprint() > dense_footprint())
+				{
+					m_count = storage->stored();
+					m_storage = storage->to_grid();
+				}
+			}
+			else if (2 * sparse_type::memory_footprint(m_count) < dense_footprint())
+			{
+				m_storage = sparse_type(std::get<dense_type>(m_storage));
+			}
+		}
+
+	#pragma endregion
+	#pragma region member variables
+
+	private:
+		std::variant<sparse_type, dense_type> m_storage;
+
+		// non-default elements while the storage is dense (the sparse grid counts for itself).
+		size_t m_count = 0;
+
+	#pragma endregion
+	};
+
+#pragma endregion
+}
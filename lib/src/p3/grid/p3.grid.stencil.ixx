@@ -0,0 +1,404 @@
+#include <type_traits> // std::common_type_t
+#include <algorithm>   // std::min(), std::max()
+#include <stdexcept>
+#include <cstddef>     // std::ptrdiff_t
+#include <utility>     // std::swap()
+#include <vector>
+export module p3.grid.stencil;
+/*
+	Stencil module, part of github/TeraFlint/pitrilib.
+	Daniel Wiegert (Pitri), 2021.
+*/
+
+export import p3.grid;
+// import <type_traits>; // std::common_type_t
+// import <algorithm>;   // std::min(), std::max()
+// import <stdexcept>;
+// import <cstddef>;     // std::ptrdiff_t
+// import <utility>;     // std::swap()
+// import <vector>;
+
+namespace p3
+{
+#pragma region boundary
+
+	export
+	// decides what a stencil reads for neighbors outside of the grid.
+	template <typename data_type>
+	class stencil_boundary
+	{
+	public:
+		enum class mode
+		{
+			clamp,    // the closest cell at the border.
+			wrap,     // the opposite side of the grid (torus).
+			constant, // a fixed value.
+		};
+
+		[[nodiscard]] static constexpr stencil_boundary clamp()
+		{
+			return stencil_boundary(mode::clamp, {});
+		}
+
+		[[nodiscard]] static constexpr stencil_boundary wrap()
+		{
+			return stencil_boundary(mode::wrap, {});
+		}
+
+		[[nodiscard]] static constexpr stencil_boundary constant(const data_type &value = {})
+		{
+			return stencil_boundary(mode::constant, value);
+		}
+
+		[[nodiscard]] constexpr mode get_mode() const
+		{
+			return m_mode;
+		}
+
+		[[nodiscard]] constexpr const data_type &value() const
+		{
+			return m_value;
+		}
+
+	private:
+		constexpr stencil_boundary(mode boundary_mode, const data_type &value)
+			: m_mode{ boundary_mode }, m_value{ value }
+		{
+		}
+
+		mode m_mode;
+		data_type m_value;
+	};
+
+#pragma endregion
+#pragma region double buffer
+
+	export
+	/*
+		two grids of the same size: the front one gets read, the back one written. swapping exchanges the storage, no copies.
+		made for simulations, where every step computes a new state from the previous one.
+	*/
+	template <typename data_type, size_t dimensions>
+	class grid_double_buffer
+	{
+	public:
+		explicit grid_double_buffer(grid<data_type, dimensions> initial)
+			: m_front{ std::move(initial) }, m_back(m_front.dim())
+		{
+		}
+
+		[[nodiscard]] const grid<data_type, dimensions> &front() const
+		{
+			return m_front;
+		}
+
+		[[nodiscard]] grid<data_type, dimensions> &front()
+		{
+			return m_front;
+		}
+
+		[[nodiscard]] grid<data_type, dimensions> &back()
+		{
+			return m_back;
+		}
+
+		void swap()
+		{
+			std::swap(m_front, m_back);
+		}
+
+		// calls function(front, back) and swaps afterwards, so the result becomes the new front.
+		template <typename function_type>
+		void step(function_type &&function)
+		{
+			function(std::as_const(m_front), m_back);
+			swap();
+		}
+
+	private:
+		grid<data_type, dimensions> m_front, m_back;
+	};
+
+#pragma endregion
+#pragma region stencil
+
+	export
+	/*
+		applies a kernel to every cell of a grid: the result is the sum of all neighbors, multiplied by their kernel weights.
+		the kernel can be a grid or a fixed_grid. its anchor (the cell sitting on top of the target cell) defaults to the center.
+
+		the neighbor offsets are resolved into memory offsets once per call. cells whose neighborhood lies completely inside of
+		the grid simply add these offsets, only the cells near the border go through the boundary handling.
+		the rows are processed in column blocks, so the rows touched by the kernel stay in cache while a block is being worked on.
+	*/
+	template <typename weight_type, size_t dimensions>
+	class stencil
+	{
+		static_assert(dimensions > 0, "stencil: grids need at least one dimension.");
+
+	public:
+		// elements of a row processed at once.
+		static constexpr size_t block_size = 1024;
+
+		struct tap
+		{
+			grid_stride<dimensions> offset;
+			weight_type weight;
+		};
+
+	#pragma region constructors
+
+		template <typename kernel_type>
+		explicit stencil(const kernel_type &kernel)
+			: stencil(kernel, center_of(kernel.dim()))
+		{
+		}
+
+		// the anchor is the kernel position matching the target cell. weights of zero get skipped.
+		template <typename kernel_type>
+		explicit stencil(const kernel_type &kernel, const grid_size<dimensions> &anchor)
+		{
+			kernel.iterate([&](const auto &pos, const auto &weight)
+			{
+				if (weight == weight_type{})
+				{
+					return;
+				}
+
+				tap item{ {}, weight };
+				for (size_t axis = 0; axis < dimensions; ++axis)
+				{
+					item.offset[axis] = static_cast<std::ptrdiff_t>(pos.pos_at(axis)) - static_cast<std::ptrdiff_t>(anchor[axis]);
+					m_low[axis] = std::max<size_t>(m_low[axis], item.offset[axis] < 0 ? -item.offset[axis] : 0);
+					m_high[axis] = std::max<size_t>(m_high[axis], item.offset[axis] > 0 ? item.offset[axis] : 0);
+				}
+				m_taps.push_back(item);
+			});
+		}
+
+	#pragma endregion
+	#pragma region meta data
+
+		[[nodiscard]] const std::vector<tap> &taps() const
+		{
+			return m_taps;
+		}
+
+	#pragma endregion
+	#pragma region application
+
+		// target = weighted neighbor sum of source. target gets resized to match source.
+		template <typename data_type>
+		void apply(const grid<data_type, dimensions> &source, grid<data_type, dimensions> &target, const stencil_boundary<data_type> &boundary) const
+		{
+			transform(source, target, boundary, keep_sum{});
+		}
+
+		// multi-threaded version. the policy's chunk size counts elements.
+		template <typename data_type>
+		void apply(const grid<data_type, dimensions> &source, grid<data_type, dimensions> &target, const stencil_boundary<data_type> &boundary, const parallel_policy &policy) const
+		{
+			transform(source, target, boundary, keep_sum{}, policy);
+		}
+
+		/*
+			target = combine(center, sum), where sum is the weighted neighbor sum. made for non-linear rules like cellular automata:
+			a kernel of ones counts the neighbors and combine decides what becomes of the cell.
+		*/
+		template <typename data_type, typename combine_type>
+		void transform(const grid<data_type, dimensions> &source, grid<data_type, dimensions> &target, const stencil_boundary<data_type> &boundary, combine_type &&combine) const
+		{
+			prepare_target(source, target);
+			const auto offsets = linear_offsets(source.dim());
+			process_rows(source, target, boundary, combine, offsets, 0, row_count(source.dim()));
+		}
+
+		template <typename data_type, typename combine_type>
+		void transform(const grid<data_type, dimensions> &source, grid<data_type, dimensions> &target, const stencil_boundary<data_type> &boundary, combine_type &&combine, const parallel_policy &policy) const
+		{
+			prepare_target(source, target);
+			const auto offsets = linear_offsets(source.dim());
+
+			// the work gets split into whole rows.
+			parallel_policy row_policy = policy;
+			row_policy.chunk_size = std::max<size_t>(policy.chunk_size / std::max<size_t>(source.dim_at(dimensions - 1), 1), 1);
+			parallel_for(row_count(source.dim()), row_policy, [&](size_t begin, size_t end)
+			{
+				process_rows(source, target, boundary, combine, offsets, begin, end);
+			});
+		}
+
+	#pragma endregion
+
+	private:
+		struct keep_sum
+		{
+			template <typename data_type, typename sum_type>
+			constexpr const sum_type &operator()(const data_type &center, const sum_type &sum) const
+			{
+				return sum;
+			}
+		};
+
+		[[nodiscard]] static constexpr grid_size<dimensions> center_of(const grid_size<dimensions> &size)
+		{
+			grid_size<dimensions> result{};
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				result[axis] = size[axis] / 2;
+			}
+			return result;
+		}
+
+		[[nodiscard]] static constexpr size_t row_count(const grid_size<dimensions> &size)
+		{
+			const size_t width = size[dimensions - 1];
+			return width ? size.elements() / width : 0;
+		}
+
+		template <typename data_type>
+		static void prepare_target(const grid<data_type, dimensions> &source, grid<data_type, dimensions> &target)
+		{
+			if (&source == &target)
+			{
+				throw std::invalid_argument("stencil: source and target must be different grids.");
+			}
+			if (target.dim() != source.dim())
+			{
+				target.resize(source.dim());
+			}
+		}
+
+		[[nodiscard]] std::vector<std::ptrdiff_t> linear_offsets(const grid_size<dimensions> &size) const
+		{
+			const auto strides = size.strides();
+			std::vector<std::ptrdiff_t> result;
+			result.reserve(m_taps.size());
+			for (const auto &item : m_taps)
+			{
+				std::ptrdiff_t offset = 0;
+				for (size_t axis = 0; axis < dimensions; ++axis)
+				{
+					offset += item.offset[axis] * strides[axis];
+				}
+				result.push_back(offset);
+			}
+			return result;
+		}
+
+		// slow path for cells near the border: resolves every neighbor on its own.
+		template <typename sum_type, typename data_type>
+		[[nodiscard]] sum_type border_sum(const grid<data_type, dimensions> &source, const grid_size<dimensions> &pos, const stencil_boundary<data_type> &boundary) const
+		{
+			using mode = typename stencil_boundary<data_type>::mode;
+			const auto &dim = source.dim();
+
+			sum_type sum{};
+			for (const auto &item : m_taps)
+			{
+				grid_size<dimensions> neighbor{};
+				bool outside = false;
+				for (size_t axis = 0; axis < dimensions; ++axis)
+				{
+					const auto size = static_cast<std::ptrdiff_t>(dim[axis]);
+					auto coord = static_cast<std::ptrdiff_t>(pos[axis]) + item.offset[axis];
+					if (coord < 0 || coord >= size)
+					{
+						switch (boundary.get_mode())
+						{
+						case mode::clamp:    coord = std::clamp<std::ptrdiff_t>(coord, 0, size - 1); break;
+						case mode::wrap:     coord = (coord % size + size) % size; break;
+						case mode::constant: outside = true; break;
+						}
+					}
+					neighbor[axis] = static_cast<size_t>(coord);
+				}
+				sum += item.weight * (outside ? boundary.value() : source.at(neighbor));
+			}
+			return sum;
+		}
+
+		template <typename data_type, typename combine_type>
+		void process_rows(const grid<data_type, dimensions> &source, grid<data_type, dimensions> &target, const stencil_boundary<data_type> &boundary,
+			combine_type &combine, const std::vector<std::ptrdiff_t> &offsets, size_t row_begin, size_t row_end) const
+		{
+			using sum_type = std::common_type_t<weight_type, data_type>;
+
+			if (row_begin >= row_end)
+			{
+				return;
+			}
+
+			const auto &dim = source.dim();
+			const size_t width = dim[dimensions - 1];
+			const data_type *input = source.data();
+			data_type *output = &target[0];
+
+			// columns in which the whole neighborhood of a row lies inside of the grid.
+			const size_t inner_begin = std::min(m_low[dimensions - 1], width);
+			const size_t inner_end = std::max(inner_begin, width - std::min(m_high[dimensions - 1], width));
+
+			std::vector<sum_type> sums(std::min(block_size, width));
+
+			for (size_t block_begin = 0; block_begin < width; block_begin += block_size)
+			{
+				const size_t block_end = std::min(block_begin + block_size, width);
+
+				for (size_t row = row_begin; row < row_end; ++row)
+				{
+					const size_t base = row * width;
+					auto pos = source.position_of(base);
+
+					bool inner_row = true;
+					for (size_t axis = 0; axis + 1 < dimensions; ++axis)
+					{
+						inner_row = inner_row && pos[axis] >= m_low[axis] && pos[axis] + m_high[axis] < dim[axis];
+					}
+
+					const size_t fast_begin = inner_row ? std::clamp(inner_begin, block_begin, block_end) : block_end;
+					const size_t fast_end = inner_row ? std::clamp(inner_end, fast_begin, block_end) : block_end;
+
+					const auto border = [&](size_t column)
+					{
+						pos[dimensions - 1] = column;
+						const auto sum = border_sum<sum_type>(source, pos, boundary);
+						output[base + column] = static_cast<data_type>(combine(input[base + column], sum));
+					};
+
+					for (size_t column = block_begin; column < fast_begin; ++column)
+					{
+						border(column);
+					}
+
+					// fast path: one tap at a time over the whole segment, which keeps the inner loop simple enough for vectorization.
+					const size_t count = fast_end - fast_begin;
+					std::fill_n(sums.begin(), count, sum_type{});
+					for (size_t index = 0; index < m_taps.size(); ++index)
+					{
+						const data_type *neighbors = input + static_cast<std::ptrdiff_t>(base + fast_begin) + offsets[index];
+						const weight_type weight = m_taps[index].weight;
+						for (size_t column = 0; column < count; ++column)
+						{
+							sums[column] += weight * neighbors[column];
+						}
+					}
+					for (size_t column = 0; column < count; ++column)
+					{
+						const size_t index = base + fast_begin + column;
+						output[index] = static_cast<data_type>(combine(input[index], sums[column]));
+					}
+
+					for (size_t column = fast_end; column < block_end; ++column)
+					{
+						border(column);
+					}
+				}
+			}
+		}
+
+		std::vector<tap> m_taps;
+		grid_size<dimensions> m_low{}, m_high{};
+	};
+
+#pragma endregion
+}
@@ -0,0 +1,482 @@
+#include <stdexcept>
+#include <algorithm>  // std::min(), std::max(), std::fill()
+#include <cstdint>
+#include <cstddef>    // std::ptrdiff_t
+#include <utility>    // std::move(), std::as_const()
+#include <memory>     // std::allocator
+#include <vector>
+#include <bit>        // std::countr_zero(), std::bit_width()
+export module p3.grid.tracked;
+/*
+	Tracked grid module, part of github/TeraFlint/pitrilib.
+	Daniel Wiegert (Pitri), 2021.
+*/
+
+export import p3.grid;
+// import <stdexcept>;
+// import <algorithm>;  // std::min(), std::max(), std::fill()
+// import <cstdint>;
+// import <cstddef>;    // std::ptrdiff_t
+// import <utility>;    // std::move(), std::as_const()
+// import <memory>;     // std::allocator
+// import <vector>;
+// import <bit>;        // std::countr_zero(), std::bit_width()
+
+namespace p3
+{
+#pragma region dirty tracker
+
+	/*
+		one dirty bit per block of storage slots, the block size being a power of two (a shift instead of a division).
+		an empty bitmap means "everything is dirty", so marking everything doesn't have to touch the bits.
+
+		the tracker belongs to the object, not to its value: assignments keep the block size of the target and mark
+		everything as dirty. copies start with the state of their source.
+	*/
+	class dirty_tracker
+	{
+	public:
+		dirty_tracker() = default;
+		dirty_tracker(const dirty_tracker &) = default;
+		dirty_tracker(dirty_tracker &&) = default;
+
+		dirty_tracker &operator=(const dirty_tracker &)
+		{
+			mark_all();
+			return *this;
+		}
+
+		dirty_tracker &operator=(dirty_tracker &&) noexcept
+		{
+			mark_all();
+			return *this;
+		}
+
+		// false while everything is dirty anyway.
+		[[nodiscard]] bool recording() const
+		{
+			return !m_bits.empty();
+		}
+
+		[[nodiscard]] size_t block_size() const
+		{
+			return size_t{ 1 } << m_shift;
+		}
+
+		[[nodiscard]] size_t block_count(size_t slots) const
+		{
+			return (slots + block_size() - 1) >> m_shift;
+		}
+
+		// starts clean, the block size gets rounded up to the next power of two.
+		void reset(size_t block_size, size_t slots)
+		{
+			m_shift = static_cast<uint8_t>(std::bit_width(std::min(std::max<size_t>(block_size, 1), max_block_size) - 1));
+			clear(slots);
+		}
+
+		void clear(size_t slots)
+		{
+			// at least one word, so an empty bitmap keeps meaning "everything".
+			m_bits.assign(std::max<size_t>((block_count(slots) + 63) / 64, 1), 0);
+		}
+
+		void mark(size_t index)
+		{
+			if (!m_bits.empty())
+			{
+				// testing first skips the store for blocks that are dirty already, which most writes hit.
+				const size_t block = index >> m_shift;
+				uint64_t &word = m_bits[block / 64];
+				const uint64_t bit = uint64_t{ 1 } << (block % 64);
+				if (!(word & bit))
+				{
+					word |= bit;
+				}
+			}
+		}
+
+		// marks the slots [begin, end).
+		void mark(size_t begin, size_t end)
+		{
+			if (m_bits.empty() || begin >= end)
+			{
+				return;
+			}
+
+			const size_t first = begin >> m_shift, last = (end - 1) >> m_shift;
+			const auto mask_from = [](size_t bit) { return ~uint64_t{ 0 } << (bit % 64); };
+			const auto mask_to = [](size_t bit) { return ~uint64_t{ 0 } >> (63 - bit % 64); };
+			if (first / 64 == last / 64)
+			{
+				m_bits[first / 64] |= mask_from(first) & mask_to(last);
+				return;
+			}
+			m_bits[first / 64] |= mask_from(first);
+			std::fill(m_bits.begin() + first / 64 + 1, m_bits.begin() + last / 64, ~uint64_t{ 0 });
+			m_bits[last / 64] |= mask_to(last);
+		}
+
+		// keeps the capacity, so the next clear() doesn't allocate.
+		void mark_all()
+		{
+			m_bits.clear();
+		}
+
+		[[nodiscard]] bool dirty(size_t block) const
+		{
+			if (m_bits.empty())
+			{
+				return true;
+			}
+			return block / 64 < m_bits.size() && (m_bits[block / 64] >> (block % 64) & 1);
+		}
+
+		[[nodiscard]] std::vector<size_t> dirty_blocks(size_t slots) const
+		{
+			std::vector<size_t> result;
+			if (m_bits.empty())
+			{
+				const size_t count = block_count(slots);
+				for (size_t block = 0; block < count; ++block)
+				{
+					result.push_back(block);
+				}
+				return result;
+			}
+
+			for (size_t word = 0; word < m_bits.size(); ++word)
+			{
+				for (uint64_t bits = m_bits[word]; bits != 0; bits &= bits - 1)
+				{
+					result.push_back(word * 64 + static_cast<size_t>(std::countr_zero(bits)));
+				}
+			}
+			return result;
+		}
+
+	private:
+		static constexpr size_t max_block_size = size_t{ 1 } << 48;
+
+		std::vector<uint64_t> m_bits;
+		uint8_t m_shift = 10;
+	};
+
+#pragma endregion
+#pragma region tracked grid
+
+	export
+	/*
+		grid with change tracking for incremental saves (see grid_snapshot in p3.grid.delta). the storage slots get split
+		into blocks of block_size (rounded up to a power of two) with one dirty bit each. tracking starts clean.
+		plain grids don't pay for any of this, the tracking lives in this wrapper only.
+
+		reading goes through content(). the mutable at(), operator[] and iterate() overloads mark whatever they hand out,
+		even if it's only read (std::as_const() avoids that). everything else the grid offers is available through
+		modify(), which marks everything, or only the box it gets (the function must not write outside of it).
+		copy_region() and blit() into a tracked grid mark the covered box.
+	*/
+	template <typename data_type, size_t dimensions, typename layout_type = grid_layout::row_major, typename allocator_type = std::allocator<data_type>>
+	class tracked_grid
+	{
+	#pragma region types
+
+	public:
+		using grid_type = grid<data_type, dimensions, layout_type, allocator_type>;
+
+	#pragma endregion
+	#pragma region constructors
+
+	public:
+		tracked_grid()
+			: tracked_grid(grid_type{})
+		{
+		}
+
+		explicit tracked_grid(grid_type content, size_t block_size = 1024)
+			: m_content{ std::move(content) }
+		{
+			set_block_size(block_size);
+		}
+
+		// hands the grid over, the tracked grid is left empty (and completely dirty).
+		[[nodiscard]] grid_type take()
+		{
+			grid_type result = std::move(m_content);
+			m_content = grid_type{};
+			m_dirty.mark_all();
+			return result;
+		}
+
+	#pragma endregion
+	#pragma region meta data
+
+	public:
+		// trackers never take part in comparisons.
+		[[nodiscard]] friend bool operator==(const tracked_grid &lhs, const tracked_grid &rhs)
+		{
+			return lhs.m_content == rhs.m_content;
+		}
+
+		[[nodiscard]] const grid_type &content() const
+		{
+			return m_content;
+		}
+
+		[[nodiscard]] grid_size<dimensions> dim() const
+		{
+			return m_content.dim();
+		}
+
+		[[nodiscard]] size_t size() const
+		{
+			return m_content.size();
+		}
+
+		[[nodiscard]] const data_type *data() const
+		{
+			return m_content.data();
+		}
+
+	#pragma endregion
+	#pragma region accessors
+
+	public:
+		[[nodiscard]] data_type &operator[](size_t index)
+		{
+			m_dirty.mark(index);
+			return m_content[index];
+		}
+
+		[[nodiscard]] const data_type &operator[](size_t index) const
+		{
+			return m_content[index];
+		}
+
+		[[nodiscard]] data_type &at(const grid_size<dimensions> &pos)
+		{
+			data_type &result = m_content.at(pos);
+			m_dirty.mark(static_cast<size_t>(&result - m_content.data()));
+			return result;
+		}
+
+		[[nodiscard]] const data_type &at(const grid_size<dimensions> &pos) const
+		{
+			return m_content.at(pos);
+		}
+
+		template <typename function_type>
+		void iterate(function_type &&function)
+		{
+			m_dirty.mark_all();
+			m_content.iterate(function);
+		}
+
+		template <typename function_type>
+		void iterate(function_type &&function) const
+		{
+			m_content.iterate(function);
+		}
+
+		template <typename function_type>
+		void iterate(const grid_box<dimensions> &box, function_type &&function)
+			requires(dimensions > 0)
+		{
+			modify(box, [&](grid_type &content) { content.iterate(box, function); });
+		}
+
+		template <typename function_type>
+		void iterate(const grid_box<dimensions> &box, function_type &&function) const
+			requires(dimensions > 0)
+		{
+			m_content.iterate(box, function);
+		}
+
+		template <typename function_type>
+		void iterate_rows(const grid_box<dimensions> &box, function_type &&function)
+			requires(dimensions > 0 && layout_type::is_row_major)
+		{
+			modify(box, [&](grid_type &content) { content.iterate_rows(box, function); });
+		}
+
+		template <typename function_type>
+		void iterate_rows(const grid_box<dimensions> &box, function_type &&function) const
+			requires(dimensions > 0 && layout_type::is_row_major)
+		{
+			m_content.iterate_rows(box, function);
+		}
+
+		void fill(const grid_box<dimensions> &box, const data_type &value)
+			requires(dimensions > 0)
+		{
+			modify(box, [&](grid_type &content) { content.fill(box, value); });
+		}
+
+		// function(grid_type &) may change anything, resizing included.
+		template <typename function_type>
+		void modify(function_type &&function)
+		{
+			m_dirty.mark_all();
+			function(m_content);
+		}
+
+		// function(grid_type &) may only write inside of the box.
+		template <typename function_type>
+		void modify(const grid_box<dimensions> &box, function_type &&function)
+			requires(dimensions > 0)
+		{
+			mark_dirty(box);
+			function(m_content);
+		}
+
+	#pragma endregion
+	#pragma region dirty tracking
+
+	public:
+		// storage slots per block. the last block may be shorter.
+		[[nodiscard]] size_t block_size() const
+		{
+			return m_dirty.block_size();
+		}
+
+		// starts clean with the new block size.
+		void set_block_size(size_t block_size)
+		{
+			m_dirty.reset(block_size, m_content.storage_size());
+		}
+
+		[[nodiscard]] size_t block_count() const
+		{
+			return m_dirty.block_count(m_content.storage_size());
+		}
+
+		[[nodiscard]] bool is_dirty(size_t block) const
+		{
+			return m_dirty.dirty(block);
+		}
+
+		// indices of the dirty blocks, in ascending order.
+		[[nodiscard]] std::vector<size_t> dirty_blocks() const
+		{
+			return m_dirty.dirty_blocks(m_content.storage_size());
+		}
+
+		// O(blocks / 64), doesn't allocate after the first time.
+		void clear_dirty()
+		{
+			m_dirty.clear(m_content.storage_size());
+		}
+
+		void mark_dirty(size_t index)
+		{
+			m_dirty.mark(index);
+		}
+
+		void mark_dirty(const grid_box<dimensions> &box)
+			requires(dimensions > 0)
+		{
+			if (!grid_box<dimensions>::whole(m_content.dim()).contains(box))
+			{
+				throw std::out_of_range("tracked_grid: the box reaches outside of the grid.");
+			}
+			if (!m_dirty.recording())
+			{
+				return;
+			}
+
+			const auto &content = m_content;
+			const data_type *origin = content.data();
+
+			if constexpr (layout_type::is_row_major)
+			{
+				content.iterate_rows(box, [&](const auto &pos, const auto &row)
+				{
+					const size_t begin = static_cast<size_t>(row.data() - origin);
+					m_dirty.mark(begin, begin + row.size());
+				});
+			}
+			else
+			{
+				content.iterate(box, [&](const auto &pos, const data_type &val) { m_dirty.mark(static_cast<size_t>(&val - origin)); });
+			}
+		}
+
+		void mark_all_dirty()
+		{
+			m_dirty.mark_all();
+		}
+
+	#pragma endregion
+	#pragma region member variables
+
+	private:
+		grid_type m_content;
+		dirty_tracker m_dirty;
+
+	#pragma endregion
+	};
+
+#pragma endregion
+#pragma region region operations
+
+	/*
+		the part of the target a source of this size covers with its origin placed at offset.
+		returns false if nothing overlaps.
+	*/
+	template <size_t dimensions>
+	constexpr bool covered_box(const grid_size<dimensions> &source, const grid_size<dimensions> &target, const grid_stride<dimensions> &offset, grid_box<dimensions> &covered)
+	{
+		for (size_t axis = 0; axis < dimensions; ++axis)
+		{
+			const std::ptrdiff_t low = std::max<std::ptrdiff_t>(0, offset[axis]);
+			const std::ptrdiff_t high = std::min<std::ptrdiff_t>(static_cast<std::ptrdiff_t>(target[axis]), offset[axis] + static_cast<std::ptrdiff_t>(source[axis]));
+			if (high <= low)
+			{
+				return false;
+			}
+			covered.low[axis] = static_cast<size_t>(low);
+			covered.high[axis] = static_cast<size_t>(high);
+		}
+		return true;
+	}
+
+	export
+	// copy_region() into a tracked grid, marking the target box.
+	template <typename data_type, size_t dimensions, typename source_allocator, typename target_allocator>
+	void copy_region(const grid<data_type, dimensions, grid_layout::row_major, source_allocator> &source, const grid_box<dimensions> &source_box,
+		tracked_grid<data_type, dimensions, grid_layout::row_major, target_allocator> &target, const grid_size<dimensions> &target_pos)
+		requires(dimensions > 0)
+	{
+		target.modify(grid_box<dimensions>::from(target_pos, source_box.dim()), [&](auto &content) { copy_region(source, source_box, content, target_pos); });
+	}
+
+	export
+	// blit() into a tracked grid, marking the covered box.
+	template <typename data_type, size_t dimensions, typename source_allocator, typename target_allocator>
+	void blit(const grid<data_type, dimensions, grid_layout::row_major, source_allocator> &source,
+		tracked_grid<data_type, dimensions, grid_layout::row_major, target_allocator> &target, const grid_stride<dimensions> &offset)
+		requires(dimensions > 0)
+	{
+		grid_box<dimensions> covered{};
+		if (covered_box(source.dim(), target.dim(), offset, covered))
+		{
+			target.modify(covered, [&](auto &content) { blit(source, content, offset); });
+		}
+	}
+
+	export
+	// combining blit() into a tracked grid, marking the covered box.
+	template <typename data_type, size_t dimensions, typename source_allocator, typename target_allocator, typename combine_type>
+	void blit(const grid<data_type, dimensions, grid_layout::row_major, source_allocator> &source,
+		tracked_grid<data_type, dimensions, grid_layout::row_major, target_allocator> &target, const grid_stride<dimensions> &offset, combine_type &&combine)
+		requires(dimensions > 0)
+	{
+		grid_box<dimensions> covered{};
+		if (covered_box(source.dim(), target.dim(), offset, covered))
+		{
+			target.modify(covered, [&](auto &content) { blit(source, content, offset, combine); });
+		}
+	}
+
+#pragma endregion
+}
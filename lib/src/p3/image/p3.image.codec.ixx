@@ -0,0 +1,896 @@
+#include <filesystem>
+#include <algorithm>  // std::all_of(), std::any_of(), std::fill_n(), std::reverse(), std::swap_ranges()
+#include <cstring>    // std::memcpy(), std::memcmp()
+#include <cstdint>
+#include <cstddef>    // std::byte
+#include <string>
+#include <vector>
+#include <array>
+#include <span>
+
+export module p3.image.codec;
+/*
+	Image codec module, part of github/TeraFlint/pitrilib.
+	Daniel Wiegert (Pitri), 2021.
+*/
+
+export import p3.image.color;
+export import p3.grid;
+export import p3.persistence;
+// import <filesystem>;
+// import <algorithm>;  // std::all_of(), std::any_of(), std::fill_n(), std::reverse(), std::swap_ranges()
+// import <cstring>;    // std::memcpy(), std::memcmp()
+// import <cstdint>;
+// import <cstddef>;    // std::byte
+// import <string>;
+// import <vector>;
+// import <array>;
+// import <span>;
+
+namespace p3
+{
+#pragma region formats
+
+	/*
+		self-contained encoders and decoders, no platform library needed.
+		pixels live in a grid<color, 2> of { height, width }, decoders write straight into its buffer.
+
+		decoding:
+		- pgm/ppm: binary variants (P5, P6), 8 and 16 bit samples, any maximum value.
+		- bmp: uncompressed 8 bit (palette), 24 and 32 bit, bottom-up and top-down.
+		- tga: uncompressed and run-length encoded, 8 bit gray, 24 and 32 bit, any origin.
+		- qoi: the whole format.
+
+		encoding: pgm/ppm 8 bit, bmp and tga 24 bit (32 bit if anything is transparent), qoi.
+	*/
+
+	export
+	class image_error : public std::exception { using std::exception::exception; };
+
+	export
+	enum class image_format
+	{
+		unknown,
+		pgm,
+		ppm,
+		bmp,
+		tga,
+		qoi,
+	};
+
+	export
+	// by the file signature. tga only has one in its optional footer, older files stay unknown.
+	[[nodiscard]] image_format detect_format(std::span<const std::byte> bytes)
+	{
+		const auto starts_with = [&](const char *signature, size_t length)
+		{
+			return bytes.size() >= length && std::memcmp(bytes.data(), signature, length) == 0;
+		};
+
+		if (starts_with("P5", 2))
+		{
+			return image_format::pgm;
+		}
+		if (starts_with("P6", 2))
+		{
+			return image_format::ppm;
+		}
+		if (starts_with("BM", 2))
+		{
+			return image_format::bmp;
+		}
+		if (starts_with("qoif", 4))
+		{
+			return image_format::qoi;
+		}
+
+		constexpr char footer[] = "TRUEVISION-XFILE.";
+		if (bytes.size() >= 26 && std::memcmp(bytes.data() + bytes.size() - 18, footer, sizeof(footer)) == 0)
+		{
+			return image_format::tga;
+		}
+		return image_format::unknown;
+	}
+
+	export
+	[[nodiscard]] image_format format_from_extension(const std::filesystem::path &location)
+	{
+		std::string extension = location.extension().string();
+		for (auto &character : extension)
+		{
+			character = static_cast<char>(character >= 'A' && character <= 'Z' ? character - 'A' + 'a' : character);
+		}
+
+		if (extension == ".pgm")
+		{
+			return image_format::pgm;
+		}
+		if (extension == ".ppm" || extension == ".pnm")
+		{
+			return image_format::ppm;
+		}
+		if (extension == ".bmp" || extension == ".dib")
+		{
+			return image_format::bmp;
+		}
+		if (extension == ".tga")
+		{
+			return image_format::tga;
+		}
+		if (extension == ".qoi")
+		{
+			return image_format::qoi;
+		}
+		return image_format::unknown;
+	}
+
+#pragma endregion
+#pragma region helpers
+
+	namespace codec
+	{
+		using pixels = grid<color, 2>;
+
+		template <typename value_type>
+		[[nodiscard]] value_type read_le(const std::byte *data)
+		{
+			std::make_unsigned_t<value_type> result = 0;
+			for (size_t index = sizeof(value_type); index-- > 0;)
+			{
+				result = static_cast<decltype(result)>(result << 8 | static_cast<uint8_t>(data[index]));
+			}
+			return static_cast<value_type>(result);
+		}
+
+		template <typename value_type>
+		[[nodiscard]] value_type read_be(const std::byte *data)
+		{
+			std::make_unsigned_t<value_type> result = 0;
+			for (size_t index = 0; index < sizeof(value_type); ++index)
+			{
+				result = static_cast<decltype(result)>(result << 8 | static_cast<uint8_t>(data[index]));
+			}
+			return static_cast<value_type>(result);
+		}
+
+		template <typename value_type>
+		void write_le(std::byte *data, value_type value)
+		{
+			auto bits = static_cast<std::make_unsigned_t<value_type>>(value);
+			for (size_t index = 0; index < sizeof(value_type); ++index, bits = static_cast<decltype(bits)>(bits >> 8))
+			{
+				data[index] = static_cast<std::byte>(bits & 0xFF);
+			}
+		}
+
+		template <typename value_type>
+		void write_be(std::byte *data, value_type value)
+		{
+			auto bits = static_cast<std::make_unsigned_t<value_type>>(value);
+			for (size_t index = sizeof(value_type); index-- > 0; bits = static_cast<decltype(bits)>(bits >> 8))
+			{
+				data[index] = static_cast<std::byte>(bits & 0xFF);
+			}
+		}
+
+		[[nodiscard]] std::span<const uint8_t> as_samples(std::span<const std::byte> bytes)
+		{
+			return { reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size() };
+		}
+
+		[[nodiscard]] std::span<uint8_t> as_samples(std::span<std::byte> bytes)
+		{
+			return { reinterpret_cast<uint8_t *>(bytes.data()), bytes.size() };
+		}
+
+		[[nodiscard]] std::span<color> row_of(pixels &target, size_t row)
+		{
+			const size_t width = target.dim_at(1);
+			return { target.data() + row * width, width };
+		}
+
+		[[nodiscard]] std::span<const color> row_of(const pixels &source, size_t row)
+		{
+			const size_t width = source.dim_at(1);
+			return { source.data() + row * width, width };
+		}
+
+		// pixel counts beyond this are treated as corrupted headers.
+		constexpr size_t max_pixels = 400'000'000;
+
+		void check_size(size_t width, size_t height, const char *message)
+		{
+			if (width == 0 || height == 0 || width > max_pixels / height)
+			{
+				throw image_error(message);
+			}
+		}
+
+		[[nodiscard]] bool is_opaque(const pixels &source)
+		{
+			return std::all_of(source.data(), source.data() + source.size(), [](const color &item) { return item.a == 255; });
+		}
+
+		void flip_vertically(pixels &target)
+		{
+			for (size_t top = 0, bottom = target.dim_at(0); top + 1 < bottom; ++top)
+			{
+				--bottom;
+				const auto upper = row_of(target, top), lower = row_of(target, bottom);
+				std::swap_ranges(upper.begin(), upper.end(), lower.begin());
+			}
+		}
+
+		// four byte pixels (bgra) into a row.
+		void copy_bgra(std::span<const std::byte> source, std::span<color> target)
+		{
+			std::memcpy(target.data(), source.data(), target.size() * sizeof(color));
+			pixel::swap_red_blue(target);
+		}
+	}
+
+#pragma endregion
+#pragma region pgm + ppm
+
+	namespace codec
+	{
+		void decode_pnm(std::span<const std::byte> bytes, pixels &target)
+		{
+			const auto format = detect_format(bytes);
+			if (format != image_format::pgm && format != image_format::ppm)
+			{
+				throw image_error("pnm: only the binary variants P5 and P6 are supported.");
+			}
+
+			// width, height and maximum value, separated by whitespace and comments.
+			size_t position = 2;
+			std::array<size_t, 3> numbers{};
+			for (auto &number : numbers)
+			{
+				while (position < bytes.size())
+				{
+					const char character = static_cast<char>(bytes[position]);
+					if (character == '#')
+					{
+						while (position < bytes.size() && static_cast<char>(bytes[position]) != '\n')
+						{
+							++position;
+						}
+					}
+					else if (character == ' ' || character == '\t' || character == '\r' || character == '\n')
+					{
+						++position;
+					}
+					else
+					{
+						break;
+					}
+				}
+
+				const size_t start = position;
+				for (; position < bytes.size() && static_cast<char>(bytes[position]) >= '0' && static_cast<char>(bytes[position]) <= '9' && position - start < 10; ++position)
+				{
+					number = number * 10 + static_cast<size_t>(static_cast<char>(bytes[position]) - '0');
+				}
+				if (position == start)
+				{
+					throw image_error("pnm: corrupted header.");
+				}
+			}
+			// exactly one whitespace character before the samples.
+			++position;
+
+			const auto [width, height, maximum] = numbers;
+			check_size(width, height, "pnm: invalid image size.");
+			if (maximum == 0 || maximum > 65535)
+			{
+				throw image_error("pnm: invalid maximum value.");
+			}
+
+			const size_t channels = format == image_format::ppm ? 3 : 1, sample_size = maximum > 255 ? 2 : 1;
+			const size_t row_bytes = width * channels * sample_size;
+			if (position > bytes.size() || bytes.size() - position < row_bytes * height)
+			{
+				throw image_error("pnm: truncated data.");
+			}
+
+			target = pixels({ height, width });
+			const auto data = bytes.subspan(position);
+
+			// the common case converts the whole image at once.
+			if (channels == 3 && maximum == 255)
+			{
+				pixel::to_rgba(as_samples(data), std::span(target.data(), target.size()));
+				return;
+			}
+
+			std::vector<uint16_t> wide(sample_size == 2 ? width * channels : 0);
+			std::vector<uint8_t> samples(width * channels);
+			for (size_t row = 0; row < height; ++row)
+			{
+				const auto source = data.subspan(row * row_bytes, row_bytes);
+				if (sample_size == 2)
+				{
+					for (size_t index = 0; index < wide.size(); ++index)
+					{
+						wide[index] = read_be<uint16_t>(source.data() + 2 * index);
+					}
+					if (maximum == 65535)
+					{
+						pixel::narrow(wide, samples);
+					}
+					else
+					{
+						for (size_t index = 0; index < wide.size(); ++index)
+						{
+							samples[index] = static_cast<uint8_t>((std::min<size_t>(wide[index], maximum) * 255 + maximum / 2) / maximum);
+						}
+					}
+				}
+				else
+				{
+					const auto narrow_samples = as_samples(source);
+					for (size_t index = 0; index < samples.size(); ++index)
+					{
+						samples[index] = maximum == 255 ? narrow_samples[index] : static_cast<uint8_t>((std::min<size_t>(narrow_samples[index], maximum) * 255 + maximum / 2) / maximum);
+					}
+				}
+
+				const auto line = row_of(target, row);
+				if (channels == 3)
+				{
+					pixel::to_rgba(samples, line);
+				}
+				else
+				{
+					for (size_t column = 0; column < width; ++column)
+					{
+						line[column] = color::from_gray(samples[column]);
+					}
+				}
+			}
+		}
+
+		// ppm keeps the colors, pgm the gray values. alpha gets lost either way.
+		void encode_pnm(byte_writer &writer, const pixels &source, image_format format)
+		{
+			const bool gray = format == image_format::pgm;
+			const std::string header = std::string(gray ? "P5\n" : "P6\n") + std::to_string(source.dim_at(1)) + ' ' + std::to_string(source.dim_at(0)) + "\n255\n";
+			writer.write(std::as_bytes(std::span(header.data(), header.size())));
+
+			if (gray)
+			{
+				const auto target = as_samples(writer.append(source.size()));
+				for (size_t index = 0; index < source.size(); ++index)
+				{
+					target[index] = source.data()[index].gray();
+				}
+				return;
+			}
+			pixel::to_rgb(std::span(source.data(), source.size()), as_samples(writer.append(3 * source.size())));
+		}
+	}
+
+#pragma endregion
+#pragma region bmp
+
+	namespace codec
+	{
+		void decode_bmp(std::span<const std::byte> bytes, pixels &target)
+		{
+			if (bytes.size() < 54 || detect_format(bytes) != image_format::bmp)
+			{
+				throw image_error("bmp: not a bitmap.");
+			}
+
+			const uint32_t data_offset = read_le<uint32_t>(bytes.data() + 10), info_size = read_le<uint32_t>(bytes.data() + 14);
+			const int32_t width = read_le<int32_t>(bytes.data() + 18), height = read_le<int32_t>(bytes.data() + 22);
+			const uint16_t depth = read_le<uint16_t>(bytes.data() + 28);
+			const uint32_t compression = read_le<uint32_t>(bytes.data() + 30);
+			if (info_size < 40 || width <= 0 || height == 0 || height == INT32_MIN)
+			{
+				throw image_error("bmp: unsupported header.");
+			}
+
+			// bit fields are fine, as long as they describe the usual channel layout.
+			if (compression == 3 && depth == 32)
+			{
+				// the masks directly follow the file and info header fields, whether the info header contains them or not.
+				if (bytes.size() < 66)
+				{
+					throw image_error("bmp: truncated header.");
+				}
+				const std::byte *masks = bytes.data() + 54;
+				if (read_le<uint32_t>(masks) != 0x00FF0000U || read_le<uint32_t>(masks + 4) != 0x0000FF00U || read_le<uint32_t>(masks + 8) != 0x000000FFU)
+				{
+					throw image_error("bmp: unsupported bit fields.");
+				}
+			}
+			else if (compression != 0)
+			{
+				throw image_error("bmp: compressed bitmaps aren't supported.");
+			}
+			if (depth != 8 && depth != 24 && depth != 32)
+			{
+				throw image_error("bmp: unsupported bit depth.");
+			}
+
+			const size_t columns = static_cast<size_t>(width), rows = static_cast<size_t>(height < 0 ? -static_cast<int64_t>(height) : height);
+			check_size(columns, rows, "bmp: invalid image size.");
+			const size_t stride = (columns * depth / 8 + 3) / 4 * 4;
+			if (data_offset > bytes.size() || (bytes.size() - data_offset) / stride < rows)
+			{
+				throw image_error("bmp: truncated data.");
+			}
+
+			std::array<color, 256> palette{};
+			if (depth == 8)
+			{
+				const uint32_t used = read_le<uint32_t>(bytes.data() + 46);
+				const size_t entries = used == 0 || used > 256 ? 256 : used;
+				const size_t start = 14 + info_size;
+				if (start + 4 * entries > data_offset)
+				{
+					throw image_error("bmp: truncated palette.");
+				}
+				for (size_t entry = 0; entry < entries; ++entry)
+				{
+					const std::byte *item = bytes.data() + start + 4 * entry;
+					palette[entry] = { static_cast<uint8_t>(item[2]), static_cast<uint8_t>(item[1]), static_cast<uint8_t>(item[0]), 255 };
+				}
+			}
+
+			target = pixels({ rows, columns });
+			bool transparent = false;
+			for (size_t row = 0; row < rows; ++row)
+			{
+				const auto source = bytes.subspan(data_offset + row * stride, stride);
+				const auto line = row_of(target, height < 0 ? row : rows - 1 - row);
+				switch (depth)
+				{
+				case 8:
+					for (size_t column = 0; column < columns; ++column)
+					{
+						line[column] = palette[static_cast<uint8_t>(source[column])];
+					}
+					break;
+
+				case 24:
+					pixel::to_rgba(as_samples(source), line, channel_order::bgr);
+					break;
+
+				case 32:
+					copy_bgra(source, line);
+					transparent = transparent || std::any_of(line.begin(), line.end(), [](const color &item) { return item.a != 0; });
+					break;
+				}
+			}
+
+			// plain 32 bit bitmaps usually leave the fourth byte at zero. if nothing uses it, it isn't alpha.
+			if (depth == 32 && !transparent)
+			{
+				for (size_t index = 0; index < target.size(); ++index)
+				{
+					target.data()[index].a = 255;
+				}
+			}
+		}
+
+		void encode_bmp(byte_writer &writer, const pixels &source)
+		{
+			const bool opaque = is_opaque(source);
+			const size_t columns = source.dim_at(1), rows = source.dim_at(0), depth = opaque ? 24 : 32;
+			const size_t stride = (columns * depth / 8 + 3) / 4 * 4, image_size = stride * rows;
+
+			const auto header = writer.append(54 + image_size);
+			std::byte *data = header.data();
+			data[0] = std::byte{ 'B' };
+			data[1] = std::byte{ 'M' };
+			write_le<uint32_t>(data + 2, static_cast<uint32_t>(54 + image_size));
+			write_le<uint32_t>(data + 10, 54);
+			write_le<uint32_t>(data + 14, 40);
+			write_le<int32_t>(data + 18, static_cast<int32_t>(columns));
+			// negative height: top-down rows, which keeps the pixel order of the grid.
+			write_le<int32_t>(data + 22, -static_cast<int32_t>(rows));
+			write_le<uint16_t>(data + 26, 1);
+			write_le<uint16_t>(data + 28, static_cast<uint16_t>(depth));
+			write_le<uint32_t>(data + 34, static_cast<uint32_t>(image_size));
+			write_le<uint32_t>(data + 38, 2835);
+			write_le<uint32_t>(data + 42, 2835);
+
+			for (size_t row = 0; row < rows; ++row)
+			{
+				std::byte *line = data + 54 + row * stride;
+				if (opaque)
+				{
+					pixel::to_rgb(row_of(source, row), as_samples(std::span(line, stride)), channel_order::bgr);
+				}
+				else
+				{
+					const std::span<color> target(reinterpret_cast<color *>(line), columns);
+					std::memcpy(target.data(), row_of(source, row).data(), columns * sizeof(color));
+					pixel::swap_red_blue(target);
+				}
+			}
+		}
+	}
+
+#pragma endregion
+#pragma region tga
+
+	namespace codec
+	{
+		void decode_tga(std::span<const std::byte> bytes, pixels &target)
+		{
+			if (bytes.size() < 18)
+			{
+				throw image_error("tga: truncated header.");
+			}
+
+			const size_t id_length = static_cast<uint8_t>(bytes[0]);
+			const uint8_t map_type = static_cast<uint8_t>(bytes[1]), type = static_cast<uint8_t>(bytes[2]);
+			const size_t columns = read_le<uint16_t>(bytes.data() + 12), rows = read_le<uint16_t>(bytes.data() + 14);
+			const size_t depth = static_cast<uint8_t>(bytes[16]);
+			const uint8_t descriptor = static_cast<uint8_t>(bytes[17]);
+
+			const bool gray = type == 3 || type == 11, compressed = type == 10 || type == 11;
+			if (map_type != 0 || (type != 2 && type != 3 && type != 10 && type != 11))
+			{
+				throw image_error("tga: only true color and gray images without color map are supported.");
+			}
+			if (gray ? depth != 8 : depth != 24 && depth != 32)
+			{
+				throw image_error("tga: unsupported bit depth.");
+			}
+			check_size(columns, rows, "tga: invalid image size.");
+
+			const size_t pixel_size = depth / 8, count = columns * rows;
+			size_t position = 18 + id_length;
+			target = pixels({ rows, columns });
+			color *output = target.data();
+
+			// converts a run of pixels stored one after another.
+			const auto convert = [&](const std::byte *source, color *destination, size_t amount)
+			{
+				switch (pixel_size)
+				{
+				case 1:
+					for (size_t index = 0; index < amount; ++index)
+					{
+						destination[index] = color::from_gray(static_cast<uint8_t>(source[index]));
+					}
+					break;
+
+				case 3:
+					pixel::to_rgba(as_samples(std::span(source, 3 * amount)), std::span(destination, amount), channel_order::bgr);
+					break;
+
+				case 4:
+					copy_bgra(std::span(source, 4 * amount), std::span(destination, amount));
+					break;
+				}
+			};
+
+			if (!compressed)
+			{
+				if (position > bytes.size() || (bytes.size() - position) / pixel_size < count)
+				{
+					throw image_error("tga: truncated data.");
+				}
+				convert(bytes.data() + position, output, count);
+			}
+			else
+			{
+				// packets may cross row boundaries, so everything gets decoded in storage order.
+				for (size_t index = 0; index < count;)
+				{
+					if (position >= bytes.size())
+					{
+						throw image_error("tga: truncated data.");
+					}
+					const uint8_t packet = static_cast<uint8_t>(bytes[position++]);
+					const size_t length = std::min<size_t>((packet & 0x7F) + 1, count - index);
+					const size_t stored = packet & 0x80 ? pixel_size : length * pixel_size;
+					if (bytes.size() - position < stored)
+					{
+						throw image_error("tga: truncated data.");
+					}
+
+					if (packet & 0x80)
+					{
+						convert(bytes.data() + position, output + index, 1);
+						std::fill_n(output + index + 1, length - 1, output[index]);
+					}
+					else
+					{
+						convert(bytes.data() + position, output + index, length);
+					}
+					position += stored;
+					index += length;
+				}
+			}
+
+			// bit 5: top to bottom, bit 4: right to left.
+			if (!(descriptor & 0x20))
+			{
+				flip_vertically(target);
+			}
+			if (descriptor & 0x10)
+			{
+				for (size_t row = 0; row < rows; ++row)
+				{
+					const auto line = row_of(target, row);
+					std::reverse(line.begin(), line.end());
+				}
+			}
+		}
+
+		void encode_tga(byte_writer &writer, const pixels &source)
+		{
+			const bool opaque = is_opaque(source);
+			const size_t pixel_size = opaque ? 3 : 4;
+
+			const auto output = writer.append(18 + source.size() * pixel_size);
+			std::byte *data = output.data();
+			data[2] = std::byte{ 2 };
+			write_le<uint16_t>(data + 12, static_cast<uint16_t>(source.dim_at(1)));
+			write_le<uint16_t>(data + 14, static_cast<uint16_t>(source.dim_at(0)));
+			data[16] = static_cast<std::byte>(8 * pixel_size);
+			// top to bottom, plus the number of alpha bits.
+			data[17] = static_cast<std::byte>(0x20 | (opaque ? 0 : 8));
+
+			const std::span<color> whole(reinterpret_cast<color *>(data + 18), source.size());
+			if (opaque)
+			{
+				pixel::to_rgb(std::span(source.data(), source.size()), as_samples(output.subspan(18)), channel_order::bgr);
+			}
+			else
+			{
+				std::memcpy(whole.data(), source.data(), source.size() * sizeof(color));
+				pixel::swap_red_blue(whole);
+			}
+		}
+	}
+
+#pragma endregion
+#pragma region qoi
+
+	namespace codec
+	{
+		// see qoiformat.org for the specification.
+		namespace qoi
+		{
+			constexpr uint8_t op_index = 0x00, op_diff = 0x40, op_luma = 0x80, op_run = 0xC0, op_rgb = 0xFE, op_rgba = 0xFF, mask = 0xC0;
+			constexpr size_t header_size = 14;
+			constexpr std::array<uint8_t, 8> end_marker{ 0, 0, 0, 0, 0, 0, 0, 1 };
+
+			[[nodiscard]] constexpr size_t hash(const color &item)
+			{
+				return (item.r * 3 + item.g * 5 + item.b * 7 + item.a * 11) % 64;
+			}
+		}
+
+		void decode_qoi(std::span<const std::byte> bytes, pixels &target)
+		{
+			if (bytes.size() < qoi::header_size + qoi::end_marker.size() || detect_format(bytes) != image_format::qoi)
+			{
+				throw image_error("qoi: not a qoi image.");
+			}
+
+			const size_t columns = read_be<uint32_t>(bytes.data() + 4), rows = read_be<uint32_t>(bytes.data() + 8);
+			const uint8_t channels = static_cast<uint8_t>(bytes[12]);
+			check_size(columns, rows, "qoi: invalid image size.");
+			if (channels != 3 && channels != 4)
+			{
+				throw image_error("qoi: invalid channel count.");
+			}
+
+			target = pixels({ rows, columns });
+			color *output = target.data();
+			const size_t count = target.size();
+
+			const uint8_t *data = reinterpret_cast<const uint8_t *>(bytes.data());
+			// every operation takes at most 5 bytes, the 8 byte end marker keeps all reads inside of the input.
+			const size_t end = bytes.size() - qoi::end_marker.size();
+			size_t position = qoi::header_size;
+
+			std::array<color, 64> index{};
+			for (auto &item : index)
+			{
+				item.a = 0;
+			}
+			color current{ 0, 0, 0, 255 };
+
+			for (size_t pixel_index = 0; pixel_index < count;)
+			{
+				if (position >= end)
+				{
+					throw image_error("qoi: truncated data.");
+				}
+
+				const uint8_t first = data[position++];
+				if (first == qoi::op_rgb)
+				{
+					current.r = data[position];
+					current.g = data[position + 1];
+					current.b = data[position + 2];
+					position += 3;
+				}
+				else if (first == qoi::op_rgba)
+				{
+					current = { data[position], data[position + 1], data[position + 2], data[position + 3] };
+					position += 4;
+				}
+				else if ((first & qoi::mask) == qoi::op_index)
+				{
+					current = index[first];
+				}
+				else if ((first & qoi::mask) == qoi::op_diff)
+				{
+					current.r = static_cast<uint8_t>(current.r + ((first >> 4) & 3) - 2);
+					current.g = static_cast<uint8_t>(current.g + ((first >> 2) & 3) - 2);
+					current.b = static_cast<uint8_t>(current.b + (first & 3) - 2);
+				}
+				else if ((first & qoi::mask) == qoi::op_luma)
+				{
+					const uint8_t second = data[position++];
+					const int green = (first & 0x3F) - 32;
+					current.r = static_cast<uint8_t>(current.r + green - 8 + ((second >> 4) & 0x0F));
+					current.g = static_cast<uint8_t>(current.g + green);
+					current.b = static_cast<uint8_t>(current.b + green - 8 + (second & 0x0F));
+				}
+				else
+				{
+					// a run repeats the previous pixel. it's indexed as well: a leading run of the initial pixel isn't yet.
+					const size_t length = std::min<size_t>((first & 0x3F) + 1, count - pixel_index);
+					index[qoi::hash(current)] = current;
+					std::fill_n(output + pixel_index, length, current);
+					pixel_index += length;
+					continue;
+				}
+
+				index[qoi::hash(current)] = current;
+				output[pixel_index++] = current;
+			}
+		}
+
+		void encode_qoi(byte_writer &writer, const pixels &source)
+		{
+			const size_t count = source.size();
+			// worst case: every pixel as op_rgba.
+			const auto output = as_samples(writer.append(qoi::header_size + 5 * count + qoi::end_marker.size()));
+			uint8_t *data = output.data();
+
+			std::memcpy(data, "qoif", 4);
+			write_be<uint32_t>(reinterpret_cast<std::byte *>(data + 4), static_cast<uint32_t>(source.dim_at(1)));
+			write_be<uint32_t>(reinterpret_cast<std::byte *>(data + 8), static_cast<uint32_t>(source.dim_at(0)));
+			data[12] = is_opaque(source) ? 3 : 4;
+			data[13] = 0;
+			size_t position = qoi::header_size;
+
+			std::array<color, 64> index{};
+			for (auto &item : index)
+			{
+				item.a = 0;
+			}
+			color previous{ 0, 0, 0, 255 };
+			size_t run = 0;
+
+			const color *input = source.data();
+			for (size_t pixel_index = 0; pixel_index < count; ++pixel_index)
+			{
+				const color current = input[pixel_index];
+				if (current == previous)
+				{
+					++run;
+					if (run == 62 || pixel_index + 1 == count)
+					{
+						data[position++] = static_cast<uint8_t>(qoi::op_run | (run - 1));
+						run = 0;
+					}
+					continue;
+				}
+
+				if (run > 0)
+				{
+					data[position++] = static_cast<uint8_t>(qoi::op_run | (run - 1));
+					run = 0;
+				}
+
+				const size_t slot = qoi::hash(current);
+				if (index[slot] == current)
+				{
+					data[position++] = static_cast<uint8_t>(qoi::op_index | slot);
+				}
+				else
+				{
+					index[slot] = current;
+					if (current.a == previous.a)
+					{
+						const int8_t red = static_cast<int8_t>(current.r - previous.r), green = static_cast<int8_t>(current.g - previous.g), blue = static_cast<int8_t>(current.b - previous.b);
+						const int8_t red_green = static_cast<int8_t>(red - green), blue_green = static_cast<int8_t>(blue - green);
+
+						if (red >= -2 && red <= 1 && green >= -2 && green <= 1 && blue >= -2 && blue <= 1)
+						{
+							data[position++] = static_cast<uint8_t>(qoi::op_diff | (red + 2) << 4 | (green + 2) << 2 | (blue + 2));
+						}
+						else if (green >= -32 && green <= 31 && red_green >= -8 && red_green <= 7 && blue_green >= -8 && blue_green <= 7)
+						{
+							data[position++] = static_cast<uint8_t>(qoi::op_luma | (green + 32));
+							data[position++] = static_cast<uint8_t>((red_green + 8) << 4 | (blue_green + 8));
+						}
+						else
+						{
+							data[position++] = qoi::op_rgb;
+							data[position++] = current.r;
+							data[position++] = current.g;
+							data[position++] = current.b;
+						}
+					}
+					else
+					{
+						data[position++] = qoi::op_rgba;
+						data[position++] = current.r;
+						data[position++] = current.g;
+						data[position++] = current.b;
+						data[position++] = current.a;
+					}
+				}
+				previous = current;
+			}
+
+			std::memcpy(data + position, qoi::end_marker.data(), qoi::end_marker.size());
+			position += qoi::end_marker.size();
+			writer.shrink(output.size() - position);
+		}
+	}
+
+#pragma endregion
+#pragma region dispatch
+
+	export
+	/*
+		decodes an image into target (resizing it). the format comes from the signature,
+		the hint is only used for files without one (tga).
+	*/
+	void decode_image(std::span<const std::byte> bytes, grid<color, 2> &target, image_format hint = image_format::unknown)
+	{
+		const auto detected = detect_format(bytes);
+		switch (detected != image_format::unknown ? detected : hint)
+		{
+		case image_format::pgm:
+		case image_format::ppm: codec::decode_pnm(bytes, target); break;
+		case image_format::bmp: codec::decode_bmp(bytes, target); break;
+		case image_format::tga: codec::decode_tga(bytes, target); break;
+		case image_format::qoi: codec::decode_qoi(bytes, target); break;
+		default: throw image_error("decode_image: unknown image format.");
+		}
+	}
+
+	export
+	void encode_image(byte_writer &writer, const grid<color, 2> &source, image_format format)
+	{
+		if (source.size() == 0)
+		{
+			throw image_error("encode_image: empty image.");
+		}
+
+		switch (format)
+		{
+		case image_format::pgm:
+		case image_format::ppm: codec::encode_pnm(writer, source, format); break;
+		case image_format::bmp: codec::encode_bmp(writer, source); break;
+		case image_format::tga:
+			if (source.dim_at(0) > 0xFFFF || source.dim_at(1) > 0xFFFF)
+			{
+				throw image_error("encode_image: too big for tga.");
+			}
+			codec::encode_tga(writer, source);
+			break;
+		case image_format::qoi: codec::encode_qoi(writer, source); break;
+		default: throw image_error("encode_image: unknown image format.");
+		}
+	}
+
+#pragma endregion
+}
@@ -0,0 +1,262 @@
+#include <algorithm>  // std::min()
+#include <utility>    // std::swap()
+#include <cstdint>
+#include <cstddef>
+#include <span>
+
+// intrinsics are picked at compile time, everything has a portable fallback.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define P3_IMAGE_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(P3_IMAGE_SSE2) && (defined(__SSSE3__) || defined(__AVX__))
+#define P3_IMAGE_SSSE3
+#include <tmmintrin.h>
+#endif
+
+export module p3.image.color;
+/*
+	Image color module, part of github/TeraFlint/pitrilib.
+	Daniel Wiegert (Pitri), 2021.
+*/
+
+// import <algorithm>;  // std::min()
+// import <utility>;    // std::swap()
+// import <cstdint>;
+// import <cstddef>;
+// import <span>;
+
+namespace p3
+{
+#pragma region color
+
+	export
+	// 8 bit per channel, straight (not premultiplied) alpha unless stated otherwise.
+	struct color
+	{
+		uint8_t r = 0, g = 0, b = 0, a = 255;
+
+		[[nodiscard]] constexpr bool operator==(const color &other) const = default;
+
+		// rec. 601 luma, in fixed point.
+		[[nodiscard]] constexpr uint8_t gray() const
+		{
+			return static_cast<uint8_t>((r * 77 + g * 150 + b * 29 + 128) >> 8);
+		}
+
+		[[nodiscard]] static constexpr color from_gray(uint8_t value, uint8_t alpha = 255)
+		{
+			return { value, value, value, alpha };
+		}
+	};
+
+	static_assert(sizeof(color) == 4, "color: the channels must be packed, the pixel conversions rely on it.");
+
+#pragma endregion
+#pragma region pixel conversions
+
+	export
+	// byte order of three or four channel pixels outside of color.
+	enum class channel_order
+	{
+		rgb,
+		bgr,
+	};
+
+	namespace pixel
+	{
+		/*
+			bulk conversions between pixel formats. they process the smaller one of both spans' pixel counts,
+			with SSE2 (and SSSE3 for the channel shuffles) when the compiler targets it.
+		*/
+
+		export
+		// three bytes per pixel into colors with opaque alpha.
+		void to_rgba(std::span<const uint8_t> source, std::span<color> target, channel_order order = channel_order::rgb)
+		{
+			const size_t count = std::min(source.size() / 3, target.size());
+			const uint8_t *from = source.data();
+			color *to = target.data();
+			size_t index = 0;
+
+#if defined(P3_IMAGE_SSSE3)
+			const __m128i shuffle = order == channel_order::rgb ?
+				_mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1) :
+				_mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+			const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000U));
+			// each load reads 16 bytes, but only uses 12 of them.
+			for (; index + 6 <= count; index += 4)
+			{
+				const __m128i rgb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(from + 3 * index));
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(to + index), _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha));
+			}
+#endif
+			const size_t red = order == channel_order::rgb ? 0 : 2, blue = 2 - red;
+			for (; index < count; ++index)
+			{
+				const uint8_t *item = from + 3 * index;
+				to[index] = { item[red], item[1], item[blue], 255 };
+			}
+		}
+
+		export
+		// drops the alpha channel.
+		void to_rgb(std::span<const color> source, std::span<uint8_t> target, channel_order order = channel_order::rgb)
+		{
+			const size_t count = std::min(source.size(), target.size() / 3);
+			const color *from = source.data();
+			uint8_t *to = target.data();
+			size_t index = 0;
+
+#if defined(P3_IMAGE_SSSE3)
+			const __m128i shuffle = order == channel_order::rgb ?
+				_mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1) :
+				_mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+			// each store writes 16 bytes, the last 4 of them get overwritten by the next one.
+			for (; index + 6 <= count; index += 4)
+			{
+				const __m128i rgba = _mm_loadu_si128(reinterpret_cast<const __m128i *>(from + index));
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(to + 3 * index), _mm_shuffle_epi8(rgba, shuffle));
+			}
+#endif
+			for (; index < count; ++index)
+			{
+				uint8_t *item = to + 3 * index;
+				item[0] = order == channel_order::rgb ? from[index].r : from[index].b;
+				item[1] = from[index].g;
+				item[2] = order == channel_order::rgb ? from[index].b : from[index].r;
+			}
+		}
+
+		export
+		// exchanges red and blue, turning rgba into bgra and back.
+		void swap_red_blue(std::span<color> pixels)
+		{
+			color *data = pixels.data();
+			size_t index = 0;
+
+#if defined(P3_IMAGE_SSE2)
+			const __m128i keep = _mm_set1_epi32(static_cast<int>(0xFF00FF00U)), low = _mm_set1_epi32(0xFF);
+			for (; index + 4 <= pixels.size(); index += 4)
+			{
+				const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + index));
+				const __m128i red = _mm_and_si128(value, low), blue = _mm_and_si128(_mm_srli_epi32(value, 16), low);
+				const __m128i result = _mm_or_si128(_mm_and_si128(value, keep), _mm_or_si128(_mm_slli_epi32(red, 16), blue));
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(data + index), result);
+			}
+#endif
+			for (; index < pixels.size(); ++index)
+			{
+				std::swap(data[index].r, data[index].b);
+			}
+		}
+
+		export
+		// 8 to 16 bit samples, 255 becomes 65535.
+		void widen(std::span<const uint8_t> source, std::span<uint16_t> target)
+		{
+			const size_t count = std::min(source.size(), target.size());
+			size_t index = 0;
+
+#if defined(P3_IMAGE_SSE2)
+			for (; index + 16 <= count; index += 16)
+			{
+				const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source.data() + index));
+				// interleaving a byte with itself multiplies it by 257.
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(target.data() + index), _mm_unpacklo_epi8(value, value));
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(target.data() + index + 8), _mm_unpackhi_epi8(value, value));
+			}
+#endif
+			for (; index < count; ++index)
+			{
+				target[index] = static_cast<uint16_t>(source[index] * 257);
+			}
+		}
+
+		export
+		// 16 to 8 bit samples, rounded to the nearest value.
+		void narrow(std::span<const uint16_t> source, std::span<uint8_t> target)
+		{
+			const size_t count = std::min(source.size(), target.size());
+			size_t index = 0;
+
+#if defined(P3_IMAGE_SSE2)
+			// (value * 255 + 32895) >> 16 in 32 bit lanes, with the multiplication as (value << 8) - value.
+			const __m128i zero = _mm_setzero_si128(), bias = _mm_set1_epi32(32895);
+			const auto scale = [&](__m128i value)
+			{
+				return _mm_srli_epi32(_mm_add_epi32(_mm_sub_epi32(_mm_slli_epi32(value, 8), value), bias), 16);
+			};
+			for (; index + 16 <= count; index += 16)
+			{
+				const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source.data() + index));
+				const __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source.data() + index + 8));
+				const __m128i low = _mm_packs_epi32(scale(_mm_unpacklo_epi16(first, zero)), scale(_mm_unpackhi_epi16(first, zero)));
+				const __m128i high = _mm_packs_epi32(scale(_mm_unpacklo_epi16(second, zero)), scale(_mm_unpackhi_epi16(second, zero)));
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(target.data() + index), _mm_packus_epi16(low, high));
+			}
+#endif
+			for (; index < count; ++index)
+			{
+				target[index] = static_cast<uint8_t>((source[index] * 255U + 32895U) >> 16);
+			}
+		}
+
+		export
+		// multiplies the color channels by alpha (rounded exactly).
+		void premultiply(std::span<color> pixels)
+		{
+			color *data = pixels.data();
+			size_t index = 0;
+
+#if defined(P3_IMAGE_SSE2)
+			const __m128i zero = _mm_setzero_si128(), rounding = _mm_set1_epi16(128);
+			// the alpha lanes get multiplied by 255, which keeps them as they are.
+			const __m128i channels = _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0), opaque = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+			const auto multiply = [&](__m128i value)
+			{
+				__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(value, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+				alpha = _mm_or_si128(_mm_and_si128(alpha, channels), opaque);
+				// exact division by 255: (x + 128 + ((x + 128) >> 8)) >> 8.
+				const __m128i product = _mm_add_epi16(_mm_mullo_epi16(value, alpha), rounding);
+				return _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+			};
+			for (; index + 4 <= pixels.size(); index += 4)
+			{
+				const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + index));
+				const __m128i result = _mm_packus_epi16(multiply(_mm_unpacklo_epi8(value, zero)), multiply(_mm_unpackhi_epi8(value, zero)));
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(data + index), result);
+			}
+#endif
+			for (; index < pixels.size(); ++index)
+			{
+				color &item = data[index];
+				for (uint8_t *channel : { &item.r, &item.g, &item.b })
+				{
+					const unsigned product = *channel * item.a + 128U;
+					*channel = static_cast<uint8_t>((product + (product >> 8)) >> 8);
+				}
+			}
+		}
+
+		export
+		// divides the color channels by alpha again. fully transparent pixels become transparent black.
+		void unpremultiply(std::span<color> pixels)
+		{
+			for (auto &item : pixels)
+			{
+				if (item.a == 0)
+				{
+					item = { 0, 0, 0, 0 };
+					continue;
+				}
+				for (uint8_t *channel : { &item.r, &item.g, &item.b })
+				{
+					*channel = static_cast<uint8_t>(std::min(255U, (*channel * 255U + item.a / 2U) / item.a));
+				}
+			}
+		}
+	}
+
+#pragma endregion
+}
@@ -0,0 +1,141 @@
+#include <filesystem>
+#include <iterator>  // std::istreambuf_iterator
+#include <fstream>
+#include <cstdint>
+#include <cstddef>   // std::byte
+#include <vector>
+#include <span>
+
+export module p3.image;
+/*
+	Image module, part of github/TeraFlint/pitrilib.
+	Daniel Wiegert (Pitri), 2021.
+*/
+
+export import p3.image.color;
+export import p3.image.codec;
+// import <filesystem>;
+// import <iterator>;  // std::istreambuf_iterator
+// import <fstream>;
+// import <cstdint>;
+// import <cstddef>;   // std::byte
+// import <vector>;
+// import <span>;
+
+namespace p3
+{
+#pragma region image
+
+	export
+	/*
+		two dimensional grid of colors, indexed as { y, x } (rows first). everything from the grid works on it,
+		the image adds the codecs from p3.image.codec on top.
+
+		files are read and written in binary. load() detects the format by its signature (or the file extension for
+		tga), save() picks it by the file extension. streams and unknown extensions use format(), which defaults to qoi.
+	*/
+	class image : public grid<color, 2>, public file_access, public stream_access
+	{
+	public:
+		using grid_type = grid<color, 2>;
+		using grid_type::grid;
+
+		image() = default;
+
+		image(size_t width, size_t height, color fill = {})
+			: grid_type({ height, width }, [&](const auto &) { return fill; })
+		{
+		}
+
+		explicit image(grid_type content)
+			: grid_type(std::move(content))
+		{
+		}
+
+		[[nodiscard]] size_t width() const
+		{
+			return dim_at(1);
+		}
+
+		[[nodiscard]] size_t height() const
+		{
+			return dim_at(0);
+		}
+
+		[[nodiscard]] color &pixel(size_t x, size_t y)
+		{
+			return at({ y, x });
+		}
+
+		[[nodiscard]] const color &pixel(size_t x, size_t y) const
+		{
+			return at({ y, x });
+		}
+
+		[[nodiscard]] image_format format() const
+		{
+			return m_format;
+		}
+
+		void set_format(image_format format)
+		{
+			m_format = format;
+		}
+
+		[[nodiscard]] std::vector<std::byte> encode(image_format format) const
+		{
+			byte_writer writer;
+			encode_image(writer, *this, format);
+			return writer.take();
+		}
+
+		void decode(std::span<const std::byte> bytes, image_format hint = image_format::unknown)
+		{
+			decode_image(bytes, *this, hint);
+		}
+
+	protected:
+		bool on_load(const path_type &location) override
+		{
+			std::ifstream file(location, std::ios::binary);
+			const auto size = std::filesystem::file_size(location);
+			std::vector<std::byte> bytes(size);
+			file.read(reinterpret_cast<char *>(bytes.data()), static_cast<std::streamsize>(size));
+			if (!file)
+			{
+				return false;
+			}
+			decode(bytes, format_from_extension(location));
+			return true;
+		}
+
+		bool on_save(const path_type &location) const override
+		{
+			const auto by_extension = format_from_extension(location);
+			byte_writer writer;
+			encode_image(writer, *this, by_extension != image_format::unknown ? by_extension : m_format);
+
+			std::ofstream file(location, std::ios::binary);
+			writer.flush_to(file);
+			return static_cast<bool>(file);
+		}
+
+		// the image takes the rest of the input, none of the formats store their own length.
+		bool on_read(byte_reader &reader) override
+		{
+			decode(reader.view(reader.remaining()), m_format);
+			return true;
+		}
+
+		bool on_write(byte_writer &writer) const override
+		{
+			encode_image(writer, *this, m_format);
+			return true;
+		}
+
+	private:
+		image_format m_format = image_format::qoi;
+	};
+
+#pragma endregion
+}
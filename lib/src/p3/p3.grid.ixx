@@ -5,7 +5,13 @@
 #include <algorithm>  // std::transform()
 #include <iterator>   // std::back_inserter()
 #include <numeric>    // std::accumulate()
+#include <cstddef>    // std::ptrdiff_t
+#include <utility>    // std::as_const()
+#include <memory_resource>
+#include <memory>     // std::allocator, std::allocator_traits
+#include <new>        // placement new
 #include <vector>
+#include <span>
 #include <array>
 export module p3.grid;
 /*
@@ -13,12 +19,20 @@ export module p3.grid;
 	Daniel Wiegert (Pitri), 2021.
 */
 
+export import p3.parallel;
+
 // import <functional>; // std::bit_xor{}
 // import <stdexcept>;
 // import <algorithm>;  // std::transform()
 // import <iterator>;   // std::back_inserter()
 // import <numeric>;    // std::accumulate()
+// import <cstddef>;    // std::ptrdiff_t
+// import <utility>;    // std::as_const()
+// import <memory_resource>;
+// import <memory>;     // std::allocator, std::allocator_traits
+// import <new>;        // placement new
 // import <vector>;
+// import <span>;
 // import <array>;
 
 // also, big todo: replace this with actual constexpr once std::vector is actually constexpr compatible...
@@ -42,6 +56,32 @@ namespace p3
 		return true;
 	}
 
+	template <typename data_type, size_t size>
+	static constexpr std::array<data_type, size - 1> remove_element(const std::array<data_type, size> &source, size_t index)
+		requires(size > 0)
+	{
+		std::array<data_type, size - 1> result{};
+		for (size_t i = 0, j = 0; i < size; ++i)
+		{
+			if (i != index)
+			{
+				result[j++] = source[i];
+			}
+		}
+		return result;
+	}
+
+	template <typename data_type, size_t size>
+	static constexpr std::array<data_type, size + 1> insert_element(const std::array<data_type, size> &source, size_t index, const data_type &value)
+	{
+		std::array<data_type, size + 1> result{};
+		for (size_t i = 0, j = 0; i < size + 1; ++i)
+		{
+			result[i] = i == index ? value : source[j++];
+		}
+		return result;
+	}
+
 #pragma endregion
 #pragma region nested list
 
@@ -68,6 +108,11 @@ namespace p3
 #pragma endregion
 #pragma region grid size
 
+	// signed on purpose, views are allowed to walk backwards through memory.
+	export
+	template <size_t dimensions>
+	using grid_stride = std::array<std::ptrdiff_t, dimensions>;
+
 	export
 	template <size_t dimensions>
 	class grid_size : public std::array<size_t, dimensions>
@@ -101,6 +146,22 @@ namespace p3
 			return result;
 		}
 
+		/*
+			returns the distance in memory between two neighbors along each axis (row-major, the last axis is contiguous).
+		*/
+		[[nodiscard]] constexpr grid_stride<dimensions> strides() const
+		{
+			grid_stride<dimensions> result{};
+			std::ptrdiff_t layer_size = 1;
+			dual_iteration_n(dimensions, this->rbegin(), result.rbegin(), [&](size_t size, std::ptrdiff_t &stride)
+			{
+				stride = layer_size;
+				layer_size *= size;
+				return true;
+			});
+			return result;
+		}
+
 		[[nodiscard]] constexpr size_t index_in(const grid_size<dimensions> &boundary) const
 		{
 			return boundary.index_of(*this);
@@ -135,22 +196,7 @@ namespace p3
 		[[nodiscard]] constexpr grid_size<dimensions - 1> remove_axis(size_t axis) const
 			requires(dimensions > 0)
 		{
-			grid_size<dimensions - 1> result;
-			auto source = this->begin();
-			auto destination = result.begin();
-
-			const auto copy_n = [&](size_t n) 
-			{
-				for (size_t i = 0; i < n; ++i, ++destination, ++source)
-				{
-					*destination = *source;
-				}
-			};
-
-			copy_n(axis);
-			++source;
-			copy_n(dimensions - axis - 1);
-			return result;
+			return { remove_element<size_t, dimensions>(*this, axis) };
 		}
 	};
 
@@ -327,6 +373,101 @@ namespace p3
 	#pragma endregion
 	};
 
+#pragma endregion
+#pragma region grid box
+
+	export
+	/*
+		axis-aligned box [low, high) of grid positions, addressing a region of a grid (iteration, filling, copying).
+		axes with high <= low make an empty box.
+	*/
+	template <size_t dimensions>
+	struct grid_box
+	{
+		grid_size<dimensions> low{}, high{};
+
+		// the box covering a whole grid of this size.
+		[[nodiscard]] static constexpr grid_box whole(const grid_size<dimensions> &size)
+		{
+			return { {}, size };
+		}
+
+		// the box of this extent, starting at origin.
+		[[nodiscard]] static constexpr grid_box from(const grid_size<dimensions> &origin, const grid_size<dimensions> &extent)
+		{
+			grid_box result{ origin, origin };
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				result.high[axis] += extent[axis];
+			}
+			return result;
+		}
+
+		[[nodiscard]] constexpr auto operator<=>(const grid_box &other) const = default;
+
+		// extent along each axis.
+		[[nodiscard]] constexpr grid_size<dimensions> dim() const
+		{
+			grid_size<dimensions> result{};
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				result[axis] = high[axis] > low[axis] ? high[axis] - low[axis] : 0;
+			}
+			return result;
+		}
+
+		[[nodiscard]] constexpr size_t elements() const
+		{
+			return dim().elements();
+		}
+
+		[[nodiscard]] constexpr bool empty() const
+		{
+			return elements() == 0;
+		}
+
+		[[nodiscard]] constexpr bool contains(const grid_size<dimensions> &pos) const
+		{
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				if (pos[axis] < low[axis] || pos[axis] >= high[axis])
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// true if the other box lies completely inside of this one. empty boxes fit anywhere.
+		[[nodiscard]] constexpr bool contains(const grid_box &other) const
+		{
+			if (other.empty())
+			{
+				return true;
+			}
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				if (other.low[axis] < low[axis] || other.high[axis] > high[axis])
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// the overlapping part of both boxes (possibly empty).
+		[[nodiscard]] constexpr grid_box intersect(const grid_box &other) const
+		{
+			grid_box result{};
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				result.low[axis] = std::max(low[axis], other.low[axis]);
+				result.high[axis] = std::max(result.low[axis], std::min(high[axis], other.high[axis]));
+			}
+			return result;
+		}
+	};
+
 #pragma endregion
 #pragma region grid generators + concept
 
@@ -345,6 +486,18 @@ namespace p3
 		function(grid_pos<dim>{});
 	};
 
+	// Element-wise expressions (see p3.grid.expression) get evaluated when they're assigned to a grid.
+	// operator[] takes a storage index, which is why an expression only fits grids of the same layout.
+	export
+	template <typename expression_type>
+	concept grid_expression = requires(const expression_type &expression, size_t index)
+	{
+		expression_type::is_grid_expression;
+		typename expression_type::layout_type;
+		expression.dim();
+		expression[index];
+	};
+
 	namespace grid_gen
 	{
 		export
@@ -408,115 +561,372 @@ namespace p3
 	}
 
 #pragma endregion
-#pragma region grid
+#pragma region grid layouts
 
-	export
 	/*
-		n dimensional grid class. can represent a vector, matrix, 3d voxel structure, etc.
+		a layout decides where each position of a grid lives inside its storage.
+		every layout provides a mapping<dimensions> type, which gets built from the grid size and offers:
+		- storage_size(): amount of slots in the storage. may be larger than the amount of elements (padding).
+		- index_of(pos): storage slot of a position.
+		- position_of(index): position of a storage slot. padding slots map to positions outside of the grid.
+		is_row_major marks the layout whose rows are contiguous, which is what views, row iteration etc. build upon.
+		index_of() of the other layouts costs more than the row-major multiply-add, so they only pay off
+		when the accesses mostly run across the rows.
 	*/
-	template <typename data_type, size_t dimensions>
-	class grid
+	namespace grid_layout
 	{
-	#pragma region types
+		export
+		/*
+			the classic layout: the last axis is contiguous, followed by the second to last, etc. no padding.
+		*/
+		struct row_major
+		{
+			static constexpr bool is_row_major = true;
 
-public:
-	using this_type = grid<data_type, dimensions>;
-	using container_type = std::vector<data_type>;
-	using iterator = typename container_type::iterator;
-	using const_iterator = typename container_type::const_iterator;
-	using reverse_iterator = typename container_type::reverse_iterator;
-	using const_reverse_iterator = typename container_type::const_reverse_iterator;
+			template <size_t dimensions>
+			class mapping
+			{
+			public:
+				constexpr mapping() = default;
+				constexpr explicit mapping(const grid_size<dimensions> &size)
+					: m_dim{ size }, m_stride{ size.strides() }
+				{
+				}
 
-	#pragma endregion
-	#pragma region constructors
+				[[nodiscard]] constexpr auto operator<=>(const mapping &other) const = default;
 
-	public:
-		// default constructor
-		VEC_CXP grid() = default;
+				[[nodiscard]] constexpr size_t storage_size() const
+				{
+					return m_dim.elements();
+				}
 
-		// implicit nested list constructor. would be cool to have, but I'm not sure if this collides with other constructors.
-		// grid(const nested_list_t<data_type, dimensions> &list);
+				// one multiply-add per axis, the layer sizes are only computed once per grid size.
+				[[nodiscard]] constexpr size_t index_of(const grid_size<dimensions> &pos) const
+				{
+					std::ptrdiff_t result = 0;
+					for (size_t axis = 0; axis < dimensions; ++axis)
+					{
+						result += m_stride[axis] * static_cast<std::ptrdiff_t>(pos[axis]);
+					}
+					return static_cast<size_t>(result);
+				}
 
-		// size constructor
-		explicit VEC_CXP grid(const grid_size<dimensions> &size)
-			: m_dim{ size }, m_data(m_dim.elements())
-		{
-		}
+				[[nodiscard]] constexpr grid_size<dimensions> position_of(size_t index) const
+				{
+					return grid_size<dimensions>::from_index(index, m_dim);
+				}
 
-		// size + list constructor
-		explicit VEC_CXP grid(const grid_size<dimensions> &size, const std::initializer_list<data_type> &init)
-			: m_dim{ size.fit_to_data(init.size()) }
-		{
-			const auto fill = [&]() { std::copy(init.begin(), init.end(), std::back_inserter(m_data)); };
-			reserve_fill_resize(fill);
-		}
+				[[nodiscard]] constexpr const grid_stride<dimensions> &stride() const
+				{
+					return m_stride;
+				}
 
-		// size + iterator pair constructor
-		template <typename begin_type, typename end_type>
-		explicit VEC_CXP grid(const grid_size<dimensions> &size, const begin_type &begin, const end_type &end)
-			: m_dim{ size.fit_to_data(std::distance(begin, end)) }
-		{
-			const auto fill = [&]() { std::copy(begin, end, std::back_inserter(m_data)); };
-			reserve_fill_resize(fill);
-		}
+			private:
+				grid_size<dimensions> m_dim{};
+				grid_stride<dimensions> m_stride{};
+			};
+		};
 
-		// size + generator constructor
-		template <grid_generator<dimensions> generator_type>
-		explicit VEC_CXP grid(const grid_size<dimensions> &size, generator_type &&generator)
-			: m_dim{ size }
+		export
+		/*
+			splits the grid into hypercubic tiles with edge^dimensions elements each. the tiles are stored one after another (row-major),
+			the elements inside of each tile as well. neighbors along any axis are likely to share a tile (and cache lines).
+			tiles sticking out of the grid are padded.
+		*/
+		template <size_t edge = 8>
+		struct tiled
 		{
-			const auto fill = [&]()
+			static_assert(edge > 0, "grid_layout::tiled: the tile edge can't be 0.");
+			static constexpr bool is_row_major = false;
+
+			template <size_t dimensions>
+			class mapping
 			{
-				for (grid_pos<dimensions> pos{ m_dim }; pos.valid(); ++pos)
+				static constexpr size_t tile_elements = []()
 				{
-					m_data.push_back(generator(pos));
+					size_t result = 1;
+					for (size_t axis = 0; axis < dimensions; ++axis)
+					{
+						result *= edge;
+					}
+					return result;
+				}();
+
+			public:
+				constexpr mapping() = default;
+				constexpr explicit mapping(const grid_size<dimensions> &size)
+				{
+					for (size_t axis = 0; axis < dimensions; ++axis)
+					{
+						m_tiles[axis] = (size[axis] + edge - 1) / edge;
+						m_tile[axis] = edge;
+					}
+					m_tile_stride = m_tiles.strides();
+					for (auto &stride : m_tile_stride)
+					{
+						stride *= tile_elements;
+					}
+				}
+
+				[[nodiscard]] constexpr auto operator<=>(const mapping &other) const = default;
+
+				[[nodiscard]] constexpr size_t storage_size() const
+				{
+					return m_tiles.elements() * tile_elements;
+				}
+
+				// the distances between the tiles are computed once per grid size, the edge is known at compile time.
+				[[nodiscard]] constexpr size_t index_of(const grid_size<dimensions> &pos) const
+				{
+					size_t tile = 0, inner = 0;
+					for (size_t axis = 0; axis < dimensions; ++axis)
+					{
+						tile += pos[axis] / edge * static_cast<size_t>(m_tile_stride[axis]);
+						inner = inner * edge + pos[axis] % edge;
+					}
+					return tile + inner;
 				}
+
+				[[nodiscard]] constexpr grid_size<dimensions> position_of(size_t index) const
+				{
+					const size_t tile_elements = m_tile.elements();
+					const auto tile = grid_size<dimensions>::from_index(index / tile_elements, m_tiles);
+					const auto inner = grid_size<dimensions>::from_index(index % tile_elements, m_tile);
+
+					grid_size<dimensions> result{};
+					for (size_t axis = 0; axis < dimensions; ++axis)
+					{
+						result[axis] = tile[axis] * edge + inner[axis];
+					}
+					return result;
+				}
+
+			private:
+				grid_size<dimensions> m_tiles{}, m_tile{};
+				grid_stride<dimensions> m_tile_stride{};
 			};
-			reserve_fill_resize(fill);
-		}
+		};
 
-		// grid + converter constructor
-		template <typename compatible_type, typename converter_type>
-		explicit VEC_CXP grid(const grid<compatible_type, dimensions> &other, converter_type &&converter)
-			: m_dim{ other.dim() }
+		export
+		/*
+			morton order (z-order curve): the bits of all coordinates get interleaved, the last axis providing the lowest bit.
+			recursively keeps 2^dimensions blocks together, so neighborhoods are local at every scale.
+			every axis is padded to the next power of two. axes running out of bits simply stop contributing.
+		*/
+		struct morton
 		{
-			const auto fill = [&]()
+			static constexpr bool is_row_major = false;
+
+			template <size_t dimensions>
+			class mapping
 			{
-				grid_pos<dimensions> pos{ m_dim };
-				for (const auto &val : other)
+				/*
+					a run of bits of one coordinate, landing in the index with a fixed distance between them.
+					the runs change wherever an axis runs out of bits, so there are at most dimensions runs per axis.
+				*/
+				struct segment
+				{
+					size_t axis = 0, low = 0, count = 0; // bits [low, low + count) of the coordinate.
+					size_t shift = 0, stride = 1;        // their positions in the index: shift, shift + stride, ...
+
+					[[nodiscard]] constexpr auto operator<=>(const segment &other) const = default;
+				};
+
+				// the bits of each byte, moved apart by 1 to dimensions.
+				static constexpr auto spread_table = []()
+				{
+					std::array<std::array<size_t, 256>, dimensions> result{};
+					for (size_t stride = 1; stride <= dimensions; ++stride)
+					{
+						for (size_t byte = 0; byte < 256; ++byte)
+						{
+							for (size_t bit = 0; bit < 8 && bit * stride < 64; ++bit)
+							{
+								result[stride - 1][byte] |= ((byte >> bit) & 1) << (bit * stride);
+							}
+						}
+					}
+					return result;
+				}();
+
+			public:
+				constexpr mapping() = default;
+				constexpr explicit mapping(const grid_size<dimensions> &size)
+				{
+					for (size_t axis = 0; axis < dimensions; ++axis)
+					{
+						while ((size_t{ 1 } << m_bits[axis]) < size[axis])
+						{
+							++m_bits[axis];
+						}
+						m_max_bits = std::max(m_max_bits, m_bits[axis]);
+						m_total_bits += m_bits[axis];
+					}
+					m_empty = size.elements() == 0;
+
+					// between two axes running out of bits, the remaining ones take turns (the last axis first).
+					size_t target = 0;
+					for (size_t bit = 0; bit < m_max_bits;)
+					{
+						size_t end = m_max_bits, active = 0;
+						for (size_t axis = 0; axis < dimensions; ++axis)
+						{
+							if (bit < m_bits[axis])
+							{
+								end = std::min(end, m_bits[axis]);
+								++active;
+							}
+						}
+
+						size_t offset = 0;
+						for (size_t axis = dimensions; axis-- > 0;)
+						{
+							if (bit < m_bits[axis])
+							{
+								m_segments[m_segment_count++] = { axis, bit, end - bit, target + offset++, active };
+							}
+						}
+						target += (end - bit) * active;
+						bit = end;
+					}
+				}
+
+				[[nodiscard]] constexpr auto operator<=>(const mapping &other) const = default;
+
+				[[nodiscard]] constexpr size_t storage_size() const
+				{
+					return m_empty ? 0 : size_t{ 1 } << m_total_bits;
+				}
+
+				// spreads each run of bits with a table lookup per byte, instead of moving the bits one by one.
+				[[nodiscard]] constexpr size_t index_of(const grid_size<dimensions> &pos) const
+				{
+					size_t result = 0;
+					for (size_t index = 0; index < m_segment_count; ++index)
+					{
+						const segment &run = m_segments[index];
+						size_t bits = (pos[run.axis] >> run.low) & ((size_t{ 2 } << (run.count - 1)) - 1);
+						for (size_t shift = run.shift; bits != 0; bits >>= 8, shift += 8 * run.stride)
+						{
+							result |= spread_table[run.stride - 1][bits & 0xFF] << shift;
+						}
+					}
+					return result;
+				}
+
+				[[nodiscard]] constexpr grid_size<dimensions> position_of(size_t index) const
 				{
-					m_data.push_back(converter(pos, val));
-					++pos;
+					grid_size<dimensions> result{};
+					size_t source = 0;
+					for (size_t bit = 0; bit < m_max_bits; ++bit)
+					{
+						for (size_t axis = dimensions; axis-- > 0;)
+						{
+							if (bit < m_bits[axis])
+							{
+								result[axis] |= ((index >> source++) & 1) << bit;
+							}
+						}
+					}
+					return result;
 				}
+
+			private:
+				grid_size<dimensions> m_bits{};
+				size_t m_max_bits = 0, m_total_bits = 0;
+				std::array<segment, dimensions * dimensions> m_segments{};
+				size_t m_segment_count = 0;
+				bool m_empty = true;
 			};
-			reserve_fill_resize(fill);
+		};
+	}
+
+#pragma endregion
+#pragma region grid reductions
+
+	// how grid::sum() adds up floating point values. integral sums are exact anyway and always use plain.
+	export
+	enum class grid_summation
+	{
+		plain,    // fastest, the rounding error grows linearly with the element count.
+		pairwise, // sums blocks recursively in halves, the error only grows logarithmically.
+		kahan,    // compensated summation, the error mostly stays independent of the element count.
+	};
+
+	// binary operations for grid::reduce(), next to std::plus<> and std::multiplies<>.
+	namespace grid_reduce
+	{
+		export
+		struct minimum
+		{
+			template <typename data_type>
+			[[nodiscard]] constexpr data_type operator()(const data_type &lhs, const data_type &rhs) const
+			{
+				return rhs < lhs ? rhs : lhs;
+			}
+		};
+
+		export
+		struct maximum
+		{
+			template <typename data_type>
+			[[nodiscard]] constexpr data_type operator()(const data_type &lhs, const data_type &rhs) const
+			{
+				return lhs < rhs ? rhs : lhs;
+			}
+		};
+	}
+
+#pragma endregion
+#pragma region grid view
+
+	export
+	/*
+		non-owning window into n dimensional data, described by an origin pointer, a size and per-axis strides.
+		a const data_type makes it a read-only view. copying, slicing and cutting subgrids out of a view is O(1),
+		as no element is ever touched. the viewed memory has to outlive the view, just like std::span.
+	*/
+	template <typename data_type, size_t dimensions>
+	class grid_view
+	{
+	#pragma region types
+
+	public:
+		using this_type = grid_view<data_type, dimensions>;
+		using value_type = std::remove_const_t<data_type>;
+		using pointer = data_type *;
+		using reference = data_type &;
+
+	#pragma endregion
+	#pragma region constructors
+
+	public:
+		constexpr grid_view() = default;
+
+		// densely packed (row-major) data
+		constexpr explicit grid_view(pointer origin, const grid_size<dimensions> &size)
+			: grid_view(origin, size, size.strides())
+		{
 		}
 
-		// implicit conversion constructor
-		template <typename compatible_type>
-		VEC_CXP grid(const grid<compatible_type, dimensions> &other) 
-			requires(std::is_convertible_v<compatible_type, data_type>)
-			: grid(other, [](auto pos, auto val) { return val; })
+		// arbitrary strides
+		constexpr explicit grid_view(pointer origin, const grid_size<dimensions> &size, const grid_stride<dimensions> &stride)
+			: m_origin{ origin }, m_dim{ size }, m_stride{ stride }
 		{
 		}
 
-	private:
-		template <typename function_type>
-		VEC_CXP void reserve_fill_resize(function_type &&fill)
+		// implicit mutable -> read-only conversion
+		template <typename mutable_type>
+		constexpr grid_view(const grid_view<mutable_type, dimensions> &other)
+			requires(std::is_same_v<const mutable_type, data_type> && !std::is_const_v<mutable_type>)
+			: grid_view(other.origin(), other.dim(), other.stride())
 		{
-			// performs one single allocation and grows into the space (with default objects) in the end.
-			const auto elements = m_dim.elements();
-			m_data.reserve(elements);
-			fill();
-			m_data.resize(elements);
 		}
 
 	#pragma endregion
 	#pragma region meta data
 
 	public:
-		[[nodiscard]] VEC_CXP auto operator<=>(const this_type &other) const = default;
-
 		[[nodiscard]] constexpr size_t rank() const
 		{
 			return dimensions;
@@ -532,24 +942,41 @@ public:
 			return m_dim[axis];
 		}
 
+		[[nodiscard]] constexpr grid_stride<dimensions> stride() const
+		{
+			return m_stride;
+		}
+
+		[[nodiscard]] constexpr std::ptrdiff_t stride_at(size_t axis) const
+		{
+			return m_stride[axis];
+		}
+
 		[[nodiscard]] constexpr size_t size() const
 		{
-			return m_data.size();
+			return m_dim.elements();
 		}
 
-		[[nodiscard]] constexpr const data_type *data() const
+		[[nodiscard]] constexpr pointer origin() const
 		{
-			return m_data.data();
+			return m_origin;
 		}
 
-		[[nodiscard]] constexpr size_t index_of(const grid_size<dimensions> &pos) const
+		// true if the view covers one gapless block of memory in row-major order.
+		[[nodiscard]] constexpr bool contiguous() const
 		{
-			return m_dim.index_of(pos);
+			return m_stride == m_dim.strides();
 		}
 
-		[[nodiscard]] constexpr grid_size<dimensions> position_of(size_t index) const
+		[[nodiscard]] constexpr std::ptrdiff_t offset_of(const grid_size<dimensions> &pos) const
 		{
-			return grid_size<dimensions>::from_index(index, m_dim);
+			std::ptrdiff_t result = 0;
+			dual_iteration_n(dimensions, m_stride.begin(), pos.begin(), [&](std::ptrdiff_t stride, size_t pos)
+			{
+				result += stride * static_cast<std::ptrdiff_t>(pos);
+				return true;
+			});
+			return result;
 		}
 
 		[[nodiscard]] constexpr bool inside(const grid_size<dimensions> &pos) const
@@ -562,233 +989,1916 @@ public:
 	#pragma region accessors
 
 	public:
-		[[nodiscard]] VEC_CXP data_type &operator[](size_t index)
+		// views are shallow: constness of the view does not propagate to the data, only constness of data_type does.
+		[[nodiscard]] constexpr reference at(const grid_size<dimensions> &pos) const
 		{
-			return m_data[index];
+			return m_origin[offset_of(pos)];
 		}
 
-		[[nodiscard]] VEC_CXP const data_type &operator[](size_t index) const
-		{
-			return m_data[index];
-		}
+	#pragma endregion
+	#pragma region manipulators
 
-		[[nodiscard]] VEC_CXP data_type &at(const grid_size<dimensions> &pos)
-		{
-			return m_data[m_dim.index_of(pos)];
+	public:
+		// iteration in row-major order of the view (with position information)
+		template <typename function_type>
+		constexpr void iterate(function_type &&function) const
+		{
+			const size_t elements = size();
+			if (elements == 0)
+			{
+				return;
+			}
+
+			grid_pos<dimensions> pos{ m_dim };
+			if constexpr (dimensions == 0)
+			{
+				function(pos, *m_origin);
+			}
+			else
+			{
+				// the position is only resolved once per row, the innermost axis just follows its stride.
+				const size_t row_length = m_dim[dimensions - 1];
+				const std::ptrdiff_t step = m_stride[dimensions - 1];
+				for (size_t row = 0; row < elements / row_length; ++row)
+				{
+					pointer ptr = m_origin + offset_of(pos.pos());
+					for (size_t i = 0; i < row_length; ++i, ptr += step)
+					{
+						function(pos, *ptr);
+						++pos;
+					}
+				}
+			}
 		}
 
-		[[nodiscard]] VEC_CXP const data_type &at(const grid_size<dimensions> &pos) const
+	#pragma endregion
+	#pragma region partitions (subgrid, slice)
+
+	public:
+		/*
+			cuts one slice/layer out of the view without copying anything.
+			the axis is perpendicular to the cut (the slice contains all the values with dim_at(axis) == layer).
+		*/
+		[[nodiscard]] constexpr grid_view<data_type, dimensions - 1> subgrid(size_t layer, size_t axis = 0) const
+			requires(dimensions > 0)
+		{
+			const auto offset = m_stride[axis] * static_cast<std::ptrdiff_t>(layer);
+			return grid_view<data_type, dimensions - 1>(m_origin + offset, m_dim.remove_axis(axis), remove_element(m_stride, axis));
+		}
+
+		/*
+			the part of the view covered by the box, without copying anything.
+		*/
+		[[nodiscard]] constexpr this_type region(const grid_box<dimensions> &box) const
+		{
+			if (!grid_box<dimensions>::whole(m_dim).contains(box))
+			{
+				throw std::out_of_range("grid_view::region(): the box reaches outside of the view.");
+			}
+			return box.empty() ? this_type(m_origin, box.dim(), m_stride) : this_type(m_origin + offset_of(box.low), box.dim(), m_stride);
+		}
+
+		/*
+			slices the whole view into dim_at(axis) layers, each of them being a view itself.
+		*/
+		[[nodiscard]] VEC_CXP std::vector<grid_view<data_type, dimensions - 1>> slice(size_t axis = 0) const
+			requires(dimensions > 0)
 		{
-			return m_data[m_dim.index_of(pos)];
+			std::vector<grid_view<data_type, dimensions - 1>> result;
+			result.reserve(m_dim[axis]);
+			for (size_t layer = 0; layer < m_dim[axis]; ++layer)
+			{
+				result.push_back(subgrid(layer, axis));
+			}
+			return result;
 		}
 
 	#pragma endregion
-	#pragma region iterators
+	#pragma region reshaping
 
 	public:
-		[[nodiscard]] iterator begin()
+		// the same memory, seen with another size (and possibly rank) of the same element count. requires a contiguous view.
+		template <size_t new_dimensions>
+		[[nodiscard]] constexpr grid_view<data_type, new_dimensions> reshape(const grid_size<new_dimensions> &size) const
 		{
-			return m_data.begin();
+			if (size.elements() != this->size())
+			{
+				throw std::invalid_argument("grid_view::reshape(): the element count has to stay the same.");
+			}
+			if (!contiguous())
+			{
+				throw std::invalid_argument("grid_view::reshape(): only contiguous views can be reshaped.");
+			}
+			return grid_view<data_type, new_dimensions>(m_origin, size);
 		}
-		[[nodiscard]] const_iterator begin() const
+
+		// mirrors the view along one axis: the origin moves to the last layer, which then walks backwards.
+		[[nodiscard]] constexpr this_type flip(size_t axis) const
 		{
-			return m_data.begin();
+			if (m_dim[axis] == 0)
+			{
+				return *this;
+			}
+
+			auto stride = m_stride;
+			stride[axis] = -stride[axis];
+			return this_type(m_origin + m_stride[axis] * static_cast<std::ptrdiff_t>(m_dim[axis] - 1), m_dim, stride);
 		}
-		[[nodiscard]] iterator end()
+
+		/*
+			repeats the view along new leading axes (stride 0), so it can stand in for a grid of higher rank.
+			the view's own axes become the trailing axes of size and have to match them.
+		*/
+		template <size_t new_dimensions>
+		[[nodiscard]] constexpr grid_view<data_type, new_dimensions> broadcast(const grid_size<new_dimensions> &size) const
+			requires(new_dimensions >= dimensions)
 		{
-			return m_data.end();
+			constexpr size_t leading = new_dimensions - dimensions;
+
+			grid_stride<new_dimensions> stride{};
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				if (size[leading + axis] != m_dim[axis])
+				{
+					throw std::invalid_argument("grid_view::broadcast(): the trailing axes have to match the view.");
+				}
+				stride[leading + axis] = m_stride[axis];
+			}
+			return grid_view<data_type, new_dimensions>(m_origin, size, stride);
 		}
-		[[nodiscard]] const_iterator end() const
+
+	#pragma endregion
+	#pragma region member variables
+
+	private:
+		pointer m_origin = nullptr;
+		grid_size<dimensions> m_dim{};
+		grid_stride<dimensions> m_stride{};
+
+	#pragma endregion
+	};
+
+#pragma endregion
+#pragma region grid
+
+	export
+	/*
+		n dimensional grid class. can represent a vector, matrix, 3d voxel structure, etc.
+		the layout decides the order of the elements in memory (see grid_layout), row-major being the default.
+		the allocator is handed to the underlying container. see pmr::grid for grids living in a memory resource.
+	*/
+	template <typename data_type, size_t dimensions, typename layout_type = grid_layout::row_major, typename allocator_type = std::allocator<data_type>>
+	class grid
+	{
+	#pragma region types
+
+public:
+	using this_type = grid<data_type, dimensions, layout_type, allocator_type>;
+	using subgrid_type = grid<data_type, dimensions - 1, layout_type, allocator_type>;
+	using mapping_type = typename layout_type::template mapping<dimensions>;
+	using container_type = std::vector<data_type, allocator_type>;
+	using iterator = typename container_type::iterator;
+	using const_iterator = typename container_type::const_iterator;
+	using reverse_iterator = typename container_type::reverse_iterator;
+	using const_reverse_iterator = typename container_type::const_reverse_iterator;
+
+	private:
+		static constexpr bool row_major = layout_type::is_row_major;
+
+	#pragma endregion
+	#pragma region constructors
+
+	public:
+		// default constructor
+		VEC_CXP grid() = default;
+
+		// implicit nested list constructor. would be cool to have, but I'm not sure if this collides with other constructors.
+		// grid(const nested_list_t<data_type, dimensions> &list);
+
+		// allocator constructor (empty grid)
+		explicit VEC_CXP grid(const allocator_type &allocator)
+			: m_data(allocator)
 		{
-			return m_data.end();
 		}
 
-		[[nodiscard]] reverse_iterator rbegin()
+		// size constructor
+		explicit VEC_CXP grid(const grid_size<dimensions> &size, const allocator_type &allocator = {})
+			: m_dim{ size }, m_map{ size }, m_data(m_map.storage_size(), allocator)
 		{
-			return m_data.rbegin();
 		}
-		[[nodiscard]] const_reverse_iterator rbegin() const
+
+		// size + list constructor
+		explicit VEC_CXP grid(const grid_size<dimensions> &size, const std::initializer_list<data_type> &init, const allocator_type &allocator = {})
+			: m_dim{ size.fit_to_data(init.size()) }, m_map{ m_dim }, m_data(allocator)
 		{
-			return m_data.rbegin();
+			fill_row_major(init.begin(), init.end());
 		}
-		[[nodiscard]] reverse_iterator rend()
+
+		// size + iterator pair constructor
+		template <typename begin_type, typename end_type>
+		explicit VEC_CXP grid(const grid_size<dimensions> &size, const begin_type &begin, const end_type &end, const allocator_type &allocator = {})
+			requires(std::input_iterator<begin_type>)
+			: m_dim{ size.fit_to_data(std::distance(begin, end)) }, m_map{ m_dim }, m_data(allocator)
 		{
-			return m_data.rend();
+			fill_row_major(begin, end);
 		}
-		[[nodiscard]] const_reverse_iterator rend() const
+
+		// size + generator constructor
+		template <grid_generator<dimensions> generator_type>
+		explicit VEC_CXP grid(const grid_size<dimensions> &size, generator_type &&generator, const allocator_type &allocator = {})
+			: m_dim{ size }, m_map{ size }, m_data(allocator)
 		{
-			return m_data.rend();
+			if constexpr (row_major)
+			{
+				construct_row_major([&](const auto &pos, size_t index) { return generator(pos); });
+			}
+			else
+			{
+				m_data.resize(m_map.storage_size());
+				walk(0, m_data.size(), [&](const auto &pos, size_t index) { m_data[index] = generator(pos); });
+			}
 		}
 
-		[[nodiscard]] const_iterator cbegin() const
+		// size + generator constructor, spread over multiple threads.
+		// every chunk starts at its own position, so the generator gets called concurrently and has to be thread-safe.
+		// the result is identical to the sequential constructor, independent of the policy.
+		template <grid_generator<dimensions> generator_type>
+		explicit grid(const grid_size<dimensions> &size, generator_type &&generator, const parallel_policy &policy, const allocator_type &allocator = {})
+			: m_dim{ size }, m_map{ size }, m_data(m_map.storage_size(), allocator)
 		{
-			return m_data.cbegin();
+			parallel_for(m_data.size(), policy, [&](size_t begin, size_t end)
+			{
+				walk(begin, end, [&](const auto &pos, size_t index) { m_data[index] = generator(pos); });
+			});
 		}
-		[[nodiscard]] const_iterator cend() const
+
+		// grid + converter constructor
+		template <typename compatible_type, typename other_allocator_type, typename converter_type>
+		explicit VEC_CXP grid(const grid<compatible_type, dimensions, layout_type, other_allocator_type> &other, converter_type &&converter, const allocator_type &allocator = {})
+			: m_dim{ other.dim() }, m_map{ m_dim }, m_data(allocator)
 		{
-			return m_data.cend();
+			if constexpr (row_major)
+			{
+				const auto *source = other.data();
+				construct_row_major([&](const auto &pos, size_t index) { return converter(pos, source[index]); });
+			}
+			else
+			{
+				m_data.resize(m_map.storage_size());
+				other.iterate([&](const auto &pos, const auto &val) { m_data[m_map.index_of(pos.pos())] = converter(pos, val); });
+			}
 		}
 
-		[[nodiscard]] const_iterator crbegin() const
+		// view copy constructor (materializes the viewed elements in row-major order)
+		template <typename view_data_type>
+		explicit VEC_CXP grid(const grid_view<view_data_type, dimensions> &view, const allocator_type &allocator = {})
+			requires(std::is_same_v<std::remove_const_t<view_data_type>, data_type>)
+			: m_dim{ view.dim() }, m_map{ m_dim }, m_data(allocator)
 		{
-			return m_data.crbegin();
+			if constexpr (row_major)
+			{
+				const auto fill = [&]()
+				{
+					view.iterate([&](const auto &pos, const auto &val) { m_data.push_back(val); });
+				};
+				reserve_fill_resize(fill);
+			}
+			else
+			{
+				m_data.resize(m_map.storage_size());
+				view.iterate([&](const auto &pos, const auto &val) { at(pos.pos()) = val; });
+			}
 		}
-		[[nodiscard]] const_iterator crend() const
+
+		// implicit conversion constructor (also between allocators)
+		template <typename compatible_type, typename other_allocator_type>
+		VEC_CXP grid(const grid<compatible_type, dimensions, layout_type, other_allocator_type> &other) 
+			requires(std::is_convertible_v<compatible_type, data_type>)
+			: grid(other, [](auto pos, auto val) { return val; })
 		{
-			return m_data.crend();
 		}
 
-	#pragma endregion
-	#pragma region manipulators
-
-	public:
+		// expression constructor. evaluates the whole expression in one pass, without any temporary grids.
+		template <grid_expression expression_type>
+		VEC_CXP grid(const expression_type &expression, const allocator_type &allocator = {})
+			requires(expression_type::dimensions == dimensions && std::is_same_v<typename expression_type::layout_type, layout_type>)
+			: m_dim{ expression.dim() }, m_map{ m_dim }, m_data(m_map.storage_size(), allocator)
+		{
+			assign_expression(expression);
+		}
 
-		// read-write iteration (with position information)
-		template <typename function_type>
-		VEC_CXP void iterate(function_type &&function)
+		// expression assignment. the grid may be part of the expression itself (a = a * b), as every element only depends on its own position.
+		template <grid_expression expression_type>
+		VEC_CXP this_type &operator=(const expression_type &expression)
+			requires(expression_type::dimensions == dimensions && std::is_same_v<typename expression_type::layout_type, layout_type>)
 		{
-			grid_pos<dimensions> pos{ m_dim };
-			for (auto &item : m_data)
+			if (m_dim != expression.dim())
 			{
-				function(pos, item);
-				++pos;
+				m_dim = expression.dim();
+				m_map = mapping_type(m_dim);
+				m_data.resize(m_map.storage_size());
 			}
+			assign_expression(expression);
+			return *this;
 		}
 
-		// read-only iteration (with position information)
+	private:
 		template <typename function_type>
-		VEC_CXP void iterate(function_type &&function) const
+		VEC_CXP void reserve_fill_resize(function_type &&fill)
 		{
-			grid_pos<dimensions> pos{ m_dim };
-			for (const auto &item : m_data)
+			// performs one single allocation and grows into the space (with default objects) in the end.
+			const auto elements = m_dim.elements();
+			m_data.reserve(elements);
+			fill();
+			m_data.resize(elements);
+		}
+
+		/*
+			iterator yielding function(pos, index) when dereferenced. handing a pair of these to the container (after reserving)
+			constructs every element in place: one allocation, one pass and no default objects to overwrite.
+			the elements are prvalues, so it only qualifies as an input iterator for the standard library algorithms,
+			while the C++20 concepts see the random access operations.
+		*/
+		template <typename function_type>
+		class fill_iterator
+		{
+		public:
+			using iterator_concept = std::random_access_iterator_tag;
+			using iterator_category = std::input_iterator_tag;
+			using value_type = data_type;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = data_type;
+
+			constexpr fill_iterator() = default;
+			constexpr fill_iterator(function_type *function, const grid_size<dimensions> &size, size_t index)
+				: m_function{ function }, m_pos{ size }, m_index{ index }
 			{
-				function(pos, item);
-				++pos;
+				sync();
 			}
-		}
 
-		// preserves the positions of elements in the grid. cut-off elements due to axis shrinkage will be lost.
-		VEC_CXP void resize(const grid_size<dimensions> &size, bool keep_data = false)
-		{
-			if (keep_data)
+			[[nodiscard]] constexpr reference operator*() const
 			{
-				// todo: make it faster (and in-place)
-				// it's nice how my constructors and abstractions theoretically allows me to make a oneliner out of this.
-				// however, this is a very naive and potentially expensive approach, as a whole grid gets copied. :/
-				// this is going to be similarly complicated and brain wrecking as grid::subgrid(), I fear...
-				*this = this_type(size, [&](const auto &pos) { return this->inside(pos.pos()) ? this->at(pos.pos()) : data_type{}; });
+				return (*m_function)(m_pos, m_index);
 			}
-			else
+
+			[[nodiscard]] constexpr reference operator[](difference_type offset) const
 			{
-				m_dim = size;
-				m_data.resize(m_dim.elements());
-				std::transform(m_data.begin(), m_data.end(), m_data.begin(), [](const auto &old) { return data_type{}; });
+				return *(*this + offset);
 			}
-		}
 
-	#pragma endregion
-	#pragma region partitions (subgrid, slice)
+			constexpr fill_iterator &operator++()
+			{
+				++m_index;
+				++m_pos;
+				return *this;
+			}
 
-	private:
-		struct slice_info
-		{
-			slice_info() = delete;
+			constexpr fill_iterator operator++(int)
+			{
+				auto result = *this;
+				++*this;
+				return result;
+			}
 
-			explicit constexpr slice_info(const grid_size<dimensions> &original_size, size_t axis)
-				requires(dimensions > 0)
-				: size{ original_size.remove_axis(axis) }, period{ size.elements(axis) }, delta{ original_size.elements(axis) }
+			constexpr fill_iterator &operator--()
 			{
+				return *this -= 1;
 			}
 
-			constexpr size_t calc_offset(size_t layer)
+			constexpr fill_iterator operator--(int)
 			{
-				return layer * period;
+				auto result = *this;
+				--*this;
+				return result;
 			}
-			constexpr size_t calc_jump() const
+
+			constexpr fill_iterator &operator+=(difference_type offset)
 			{
-				return delta - period;
+				m_index += offset;
+				sync();
+				return *this;
 			}
 
-			const grid_size<dimensions - 1> size;
-			const size_t period, delta;
-		};
-		struct subgrid_info : slice_info
-		{
-			subgrid_info() = delete;
+			constexpr fill_iterator &operator-=(difference_type offset)
+			{
+				return *this += -offset;
+			}
+
+			[[nodiscard]] constexpr fill_iterator operator+(difference_type offset) const
+			{
+				auto result = *this;
+				return result += offset;
+			}
+
+			[[nodiscard]] friend constexpr fill_iterator operator+(difference_type offset, const fill_iterator &iter)
+			{
+				return iter + offset;
+			}
 
-			explicit constexpr subgrid_info(const grid_size<dimensions> &original_size, size_t layer, size_t axis)
-				requires(dimensions > 0)
-				: slice_info(original_size, axis), offset{ this->calc_offset(layer) }, jump{ this->calc_jump() }
+			[[nodiscard]] constexpr fill_iterator operator-(difference_type offset) const
 			{
+				auto result = *this;
+				return result -= offset;
 			}
 
-			explicit constexpr subgrid_info(const slice_info &info, size_t layer)
-				requires(dimensions > 0)
-				: slice_info{ info }, offset{ this->calc_offset(layer) }, jump{ this->calc_jump() }
+			[[nodiscard]] constexpr difference_type operator-(const fill_iterator &other) const
 			{
+				return static_cast<difference_type>(m_index) - static_cast<difference_type>(other.m_index);
 			}
 
-			const size_t offset, jump;
+			[[nodiscard]] constexpr bool operator==(const fill_iterator &other) const
+			{
+				return m_index == other.m_index;
+			}
+
+			[[nodiscard]] constexpr auto operator<=>(const fill_iterator &other) const
+			{
+				return m_index <=> other.m_index;
+			}
+
+		private:
+			// the end position (and anything beyond) has no valid grid position.
+			constexpr void sync()
+			{
+				if (m_index < m_pos.dim().elements())
+				{
+					m_pos.jump(grid_size<dimensions>::from_index(m_index, m_pos.dim()));
+				}
+			}
+
+			function_type *m_function = nullptr;
+			grid_pos<dimensions> m_pos{};
+			size_t m_index = 0;
 		};
 
-	public:
-		/*
-			cuts one slice/layer out of the grid.
-			the axis is perpendicular to the cut (the slice contains all the values with dim_at(axis) == layer).
-		*/
-		VEC_CXP grid<data_type, dimensions - 1> subgrid(size_t layer, size_t axis = 0) const
-			requires(dimensions > 0)
+		// row-major storage only: constructs each element directly from function(pos, index).
+		template <typename function_type>
+		VEC_CXP void construct_row_major(function_type &&function)
 		{
-			const subgrid_info info(m_dim, layer, axis);
-			return grid<data_type, dimensions - 1>(info.size, subgrid_generator(info));
+			using iterator_type = fill_iterator<std::remove_reference_t<function_type>>;
+			m_data.clear();
+			m_data.reserve(m_dim.elements());
+			m_data.assign(iterator_type(&function, m_dim, 0), iterator_type(&function, m_dim, m_dim.elements()));
 		}
 
-		/*
-			slices the whole grid into dim_at(axis) layers.
-			the axis is perpendicular to the cut (the slice contains all the values with dim_at(axis) == layer).
-		*/
-		VEC_CXP std::vector<grid<data_type, dimensions - 1>> slice(size_t axis = 0) const
-			requires(dimensions > 0)
+		// takes the elements in row-major order, no matter the layout.
+		template <typename iter_type>
+		VEC_CXP void fill_row_major(iter_type begin, const iter_type &end)
 		{
-			std::vector<grid<data_type, dimensions - 1U>> result;
-			result.reserve(m_dim[axis]);
-
-			const slice_info general_info(m_dim, axis);
-			for (size_t layer = 0; layer < m_dim[axis]; ++layer)
+			if constexpr (row_major && std::forward_iterator<iter_type>)
 			{
-				const subgrid_info layer_info(general_info, layer);
-				result.emplace_back(layer_info.size, subgrid_generator(layer_info));
+				// the container copies ranges of trivial types in bulk (memmove), everything else element by element.
+				const size_t elements = m_dim.elements();
+				const auto count = std::min<size_t>(static_cast<size_t>(std::distance(begin, end)), elements);
+				m_data.reserve(elements);
+				m_data.assign(begin, std::next(begin, count));
+				m_data.resize(elements);
+			}
+			else if constexpr (row_major)
+			{
+				const auto fill = [&]() { std::copy(begin, end, std::back_inserter(m_data)); };
+				reserve_fill_resize(fill);
+			}
+			else
+			{
+				m_data.resize(m_map.storage_size());
+				const size_t elements = m_dim.elements();
+				for (size_t index = 0; index < elements && begin != end; ++index, ++begin)
+				{
+					at(grid_size<dimensions>::from_index(index, m_dim)) = *begin;
+				}
 			}
-			return result;
 		}
 
-	private:
-		constexpr auto subgrid_generator(const subgrid_info &info) const
-			requires(dimensions > 0)
+		template <typename expression_type>
+		VEC_CXP void assign_expression(const expression_type &expression)
 		{
-			return [info, ptr = &m_data[info.offset], progress = 0U](const auto &pos) mutable
-				-> data_type
+			if constexpr (row_major)
 			{
-				const data_type result = *ptr;
-				++ptr;
-				if (++progress >= info.period)
+				// plain counted loop over raw memory: with the expression inlined, the compiler turns this into vector instructions.
+				data_type *target = m_data.data();
+				const size_t count = m_data.size();
+				for (size_t index = 0; index < count; ++index)
 				{
-					progress = 0;
-					ptr += info.jump;
+					target[index] = static_cast<data_type>(expression[index]);
 				}
-				return result;
-			};
+			}
+			else
+			{
+				// padding slots are skipped, they might not be valid operands (like a division by zero).
+				walk(0, m_data.size(), [&](const auto &pos, size_t index) { m_data[index] = static_cast<data_type>(expression[index]); });
+			}
 		}
 
-	#pragma endregion
-	#pragma region member variables
-
-	private:
-		grid_size<dimensions> m_dim{};
-		container_type m_data;
+		/*
+			calls function(pos, index) for all storage slots in [begin, end), in storage order. padding slots get skipped.
+			this is how every traversal follows the layout: positions are handed out in the order the elements lie in memory.
+		*/
+		template <typename function_type>
+		VEC_CXP void walk(size_t begin, size_t end, function_type &&function) const
+		{
+			if (begin >= end)
+			{
+				return;
+			}
+
+			if constexpr (row_major)
+			{
+				grid_pos<dimensions> pos{ m_dim, position_of(begin) };
+				for (size_t index = begin; index < end; ++index, ++pos)
+				{
+					function(std::as_const(pos), index);
+				}
+			}
+			else
+			{
+				grid_pos<dimensions> pos{ m_dim };
+				for (size_t index = begin; index < end; ++index)
+				{
+					if (pos.jump(m_map.position_of(index)))
+					{
+						function(std::as_const(pos), index);
+					}
+				}
+			}
+		}
+
+	#pragma endregion
+	#pragma region meta data
+
+	public:
+		[[nodiscard]] VEC_CXP auto operator<=>(const this_type &other) const = default;
+
+		[[nodiscard]] constexpr size_t rank() const
+		{
+			return dimensions;
+		}
+
+		[[nodiscard]] constexpr grid_size<dimensions> dim() const
+		{
+			return m_dim;
+		}
+
+		[[nodiscard]] constexpr size_t dim_at(size_t axis) const
+		{
+			return m_dim[axis];
+		}
+
+		[[nodiscard]] constexpr size_t size() const
+		{
+			return m_dim.elements();
+		}
+
+		// amount of slots in memory (including padding). operator[], data() and the iterators work on these slots.
+		[[nodiscard]] constexpr size_t storage_size() const
+		{
+			return m_data.size();
+		}
+
+		[[nodiscard]] constexpr data_type *data()
+		{
+			return m_data.data();
+		}
+
+		[[nodiscard]] constexpr const data_type *data() const
+		{
+			return m_data.data();
+		}
+
+		[[nodiscard]] constexpr const mapping_type &mapping() const
+		{
+			return m_map;
+		}
+
+		// distance in memory between two neighbors along each axis. cached by the mapping, not recomputed per access.
+		[[nodiscard]] constexpr const grid_stride<dimensions> &stride() const
+			requires(row_major)
+		{
+			return m_map.stride();
+		}
+
+		[[nodiscard]] constexpr std::ptrdiff_t stride_at(size_t axis) const
+			requires(row_major)
+		{
+			return m_map.stride()[axis];
+		}
+
+		[[nodiscard]] constexpr allocator_type get_allocator() const
+		{
+			return m_data.get_allocator();
+		}
+
+		[[nodiscard]] constexpr size_t index_of(const grid_size<dimensions> &pos) const
+		{
+			return m_map.index_of(pos);
+		}
+
+		// position of a storage slot. padding slots lie outside of the grid.
+		[[nodiscard]] constexpr grid_size<dimensions> position_of(size_t index) const
+		{
+			return m_map.position_of(index);
+		}
+
+		[[nodiscard]] constexpr bool inside(const grid_size<dimensions> &pos) const
+		{
+			const auto check = [](auto dim, auto pos) { return pos < dim; };
+			return dual_iteration_n(dimensions, m_dim.begin(), pos.begin(), check);
+		}
+
+	#pragma endregion
+	#pragma region accessors
+
+	public:
+		[[nodiscard]] VEC_CXP data_type &operator[](size_t index)
+		{
+			return m_data[index];
+		}
+
+		[[nodiscard]] VEC_CXP const data_type &operator[](size_t index) const
+		{
+			return m_data[index];
+		}
+
+		[[nodiscard]] VEC_CXP data_type &at(const grid_size<dimensions> &pos)
+		{
+			return m_data[m_map.index_of(pos)];
+		}
+
+		[[nodiscard]] VEC_CXP const data_type &at(const grid_size<dimensions> &pos) const
+		{
+			return m_data[m_map.index_of(pos)];
+		}
+
+	#pragma endregion
+	#pragma region iterators
+
+	public:
+		[[nodiscard]] iterator begin()
+		{
+			return m_data.begin();
+		}
+		[[nodiscard]] const_iterator begin() const
+		{
+			return m_data.begin();
+		}
+		[[nodiscard]] iterator end()
+		{
+			return m_data.end();
+		}
+		[[nodiscard]] const_iterator end() const
+		{
+			return m_data.end();
+		}
+
+		[[nodiscard]] reverse_iterator rbegin()
+		{
+			return m_data.rbegin();
+		}
+		[[nodiscard]] const_reverse_iterator rbegin() const
+		{
+			return m_data.rbegin();
+		}
+		[[nodiscard]] reverse_iterator rend()
+		{
+			return m_data.rend();
+		}
+		[[nodiscard]] const_reverse_iterator rend() const
+		{
+			return m_data.rend();
+		}
+
+		[[nodiscard]] const_iterator cbegin() const
+		{
+			return m_data.cbegin();
+		}
+		[[nodiscard]] const_iterator cend() const
+		{
+			return m_data.cend();
+		}
+
+		[[nodiscard]] const_iterator crbegin() const
+		{
+			return m_data.crbegin();
+		}
+		[[nodiscard]] const_iterator crend() const
+		{
+			return m_data.crend();
+		}
+
+	#pragma endregion
+	#pragma region manipulators
+
+	public:
+
+		// read-write iteration in memory order (with position information)
+		template <typename function_type>
+		VEC_CXP void iterate(function_type &&function)
+		{
+			walk(0, m_data.size(), [&](const auto &pos, size_t index) { function(pos, m_data[index]); });
+		}
+
+		// read-only iteration in memory order (with position information)
+		template <typename function_type>
+		VEC_CXP void iterate(function_type &&function) const
+		{
+			walk(0, m_data.size(), [&](const auto &pos, size_t index) { function(pos, m_data[index]); });
+		}
+
+		// read-write iteration, spread over multiple threads (the function gets called concurrently)
+		template <typename function_type>
+		void iterate(function_type &&function, const parallel_policy &policy)
+		{
+			iterate_parallel(m_data.data(), function, policy);
+		}
+
+		// read-only iteration, spread over multiple threads (the function gets called concurrently)
+		template <typename function_type>
+		void iterate(function_type &&function, const parallel_policy &policy) const
+		{
+			iterate_parallel(m_data.data(), function, policy);
+		}
+
+	private:
+		template <typename pointer_type, typename function_type>
+		void iterate_parallel(pointer_type data, function_type &function, const parallel_policy &policy) const
+		{
+			parallel_for(m_data.size(), policy, [&](size_t begin, size_t end)
+			{
+				walk(begin, end, [&](const auto &pos, size_t index) { function(pos, data[index]); });
+			});
+		}
+
+	public:
+		// read-write row iteration. the position points at the first element of each row (innermost axis at 0),
+		// the span covers the whole row, so the inner loop is a plain contiguous loop without any position carry logic.
+		template <typename function_type>
+		VEC_CXP void iterate_rows(function_type &&function)
+			requires(dimensions > 0 && row_major)
+		{
+			iterate_rows_of(m_data.data(), function);
+		}
+
+		// read-only row iteration (with position information of the row)
+		template <typename function_type>
+		VEC_CXP void iterate_rows(function_type &&function) const
+			requires(dimensions > 0 && row_major)
+		{
+			iterate_rows_of(m_data.data(), function);
+		}
+
+	private:
+		template <typename pointer_type, typename function_type>
+		VEC_CXP void iterate_rows_of(pointer_type data, function_type &function) const
+		{
+			using element_type = std::remove_pointer_t<pointer_type>;
+			const size_t row_length = m_dim[dimensions - 1];
+			if (row_length == 0)
+			{
+				return;
+			}
+
+			grid_pos<dimensions> pos{ m_dim };
+			for (size_t offset = 0; offset < m_data.size(); offset += row_length)
+			{
+				function(std::as_const(pos), std::span<element_type>(data + offset, row_length));
+				pos.next(1);
+			}
+		}
+
+	public:
+		// read-write iteration over the elements inside of the box. the position is the one within the whole grid.
+		template <typename function_type>
+		VEC_CXP void iterate(const grid_box<dimensions> &box, function_type &&function)
+			requires(dimensions > 0)
+		{
+			walk_region(box, [&](const auto &pos, size_t index) { function(pos, m_data[index]); });
+		}
+
+		// read-only iteration over the elements inside of the box.
+		template <typename function_type>
+		VEC_CXP void iterate(const grid_box<dimensions> &box, function_type &&function) const
+			requires(dimensions > 0)
+		{
+			walk_region(box, [&](const auto &pos, size_t index) { function(pos, m_data[index]); });
+		}
+
+		// read-write row iteration, limited to the box. each span covers the part of a row inside of the box.
+		template <typename function_type>
+		VEC_CXP void iterate_rows(const grid_box<dimensions> &box, function_type &&function)
+			requires(dimensions > 0 && row_major)
+		{
+			iterate_region_rows_of(m_data.data(), box, function);
+		}
+
+		// read-only row iteration, limited to the box.
+		template <typename function_type>
+		VEC_CXP void iterate_rows(const grid_box<dimensions> &box, function_type &&function) const
+			requires(dimensions > 0 && row_major)
+		{
+			iterate_region_rows_of(m_data.data(), box, function);
+		}
+
+		// sets every element inside of the box. row-major grids fill whole row segments at once.
+		VEC_CXP void fill(const grid_box<dimensions> &box, const data_type &value)
+			requires(dimensions > 0)
+		{
+			if constexpr (row_major)
+			{
+				iterate_rows(box, [&](const auto &pos, auto row) { std::fill(row.begin(), row.end(), value); });
+			}
+			else
+			{
+				iterate(box, [&](const auto &pos, auto &element) { element = value; });
+			}
+		}
+
+	private:
+		VEC_CXP void check_region(const grid_box<dimensions> &box) const
+		{
+			if (!grid_box<dimensions>::whole(m_dim).contains(box))
+			{
+				throw std::out_of_range("grid: the box reaches outside of the grid.");
+			}
+		}
+
+		// calls function(pos, storage_index) for every position inside of the box, row by row.
+		template <typename function_type>
+		VEC_CXP void walk_region(const grid_box<dimensions> &box, function_type &&function) const
+		{
+			check_region(box);
+			if (box.empty())
+			{
+				return;
+			}
+
+			auto rows = box.dim();
+			const size_t width = rows[dimensions - 1];
+			rows[dimensions - 1] = 1;
+
+			grid_pos<dimensions> pos{ m_dim };
+			for (grid_pos<dimensions> row{ rows }; row.valid(); ++row)
+			{
+				auto start = box.low;
+				for (size_t axis = 0; axis + 1 < dimensions; ++axis)
+				{
+					start[axis] += row.pos_at(axis);
+				}
+				pos.jump(start);
+
+				// row-major rows are contiguous, other layouts resolve every position.
+				const size_t index = m_map.index_of(start);
+				for (size_t column = 0; column < width; ++column, pos.next())
+				{
+					function(std::as_const(pos), row_major ? index + column : m_map.index_of(pos.pos()));
+				}
+			}
+		}
+
+		template <typename pointer_type, typename function_type>
+		VEC_CXP void iterate_region_rows_of(pointer_type data, const grid_box<dimensions> &box, function_type &function) const
+		{
+			using element_type = std::remove_pointer_t<pointer_type>;
+			check_region(box);
+			if (box.empty())
+			{
+				return;
+			}
+
+			auto rows = box.dim();
+			const size_t width = rows[dimensions - 1];
+			rows[dimensions - 1] = 1;
+
+			grid_pos<dimensions> pos{ m_dim };
+			for (grid_pos<dimensions> row{ rows }; row.valid(); ++row)
+			{
+				auto start = box.low;
+				for (size_t axis = 0; axis + 1 < dimensions; ++axis)
+				{
+					start[axis] += row.pos_at(axis);
+				}
+				pos.jump(start);
+				function(std::as_const(pos), std::span<element_type>(data + m_map.index_of(start), width));
+			}
+		}
+
+	public:
+
+		// preserves the positions of elements in the grid. cut-off elements due to axis shrinkage will be lost.
+		VEC_CXP void resize(const grid_size<dimensions> &size, bool keep_data = false)
+		{
+			if (keep_data)
+			{
+				if constexpr (row_major)
+				{
+					resize_keep_data(size);
+				}
+				else
+				{
+					*this = this_type(size, [this](const grid_pos<dimensions> &pos) { return inside(pos.pos()) ? at(pos.pos()) : data_type{}; });
+				}
+			}
+			else
+			{
+				// one single pass: existing slots get overwritten, new ones constructed as copies.
+				m_dim = size;
+				m_map = mapping_type(size);
+				m_data.assign(m_map.storage_size(), data_type{});
+			}
+		}
+
+	private:
+		/*
+			moves whole rows (the contiguous runs along the innermost axis) instead of single elements:
+			- no axis grows: rows only ever move towards the front, so it works in place, front to back.
+			- no axis shrinks: the container grows once, rows only ever move towards the back, so it goes back to front.
+			- mixed: rows would have to move in both directions, so they get moved into one fresh allocation.
+		*/
+		VEC_CXP void resize_keep_data(const grid_size<dimensions> &size)
+			requires(row_major)
+		{
+			bool shrinking = true, growing = true;
+			grid_size<dimensions> common{};
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				common[axis] = std::min(m_dim[axis], size[axis]);
+				shrinking &= size[axis] <= m_dim[axis];
+				growing &= size[axis] >= m_dim[axis];
+			}
+
+			if (shrinking && growing)
+			{
+				return;
+			}
+
+			if constexpr (dimensions > 0)
+			{
+				const auto old_dim = m_dim;
+				const size_t run = common[dimensions - 1];
+
+				// every row of the common area is identified by its position with the innermost axis collapsed.
+				auto rows = common;
+				rows[dimensions - 1] = 1;
+				const size_t row_count = run > 0 ? rows.elements() : 0;
+				const auto row_start = [&](size_t row) { return grid_size<dimensions>::from_index(row, rows); };
+
+				if (shrinking)
+				{
+					for (size_t row = 0; row < row_count; ++row)
+					{
+						const auto pos = row_start(row);
+						const auto source = m_data.begin() + old_dim.index_of(pos);
+						const auto destination = m_data.begin() + size.index_of(pos);
+						if (source != destination)
+						{
+							std::move(source, source + run, destination);
+						}
+					}
+					m_data.resize(size.elements());
+				}
+				else if (growing)
+				{
+					m_data.resize(size.elements());
+					for (size_t row = row_count; row-- > 0;)
+					{
+						const auto pos = row_start(row);
+						const auto source = m_data.begin() + old_dim.index_of(pos);
+						const auto destination = m_data.begin() + size.index_of(pos);
+						if (source != destination)
+						{
+							std::move_backward(source, source + run, destination + run);
+						}
+					}
+					reset_outside(old_dim, size);
+				}
+				else
+				{
+					// value-initialized explicitly: allocators like default_init_allocator leave construct(p) uninitialized.
+					container_type result(m_data.get_allocator());
+					result.assign(size.elements(), data_type{});
+					for (size_t row = 0; row < row_count; ++row)
+					{
+						const auto pos = row_start(row);
+						const auto source = m_data.begin() + old_dim.index_of(pos);
+						std::move(source, source + run, result.begin() + size.index_of(pos));
+					}
+					m_data.swap(result);
+				}
+			}
+			m_dim = size;
+			m_map = mapping_type(size);
+		}
+
+		// resets every element outside of the old boundary (either fresh or moved-from), one row at a time.
+		VEC_CXP void reset_outside(const grid_size<dimensions> &old_dim, const grid_size<dimensions> &size)
+			requires(dimensions > 0 && row_major)
+		{
+			const size_t run = size[dimensions - 1];
+			auto rows = size;
+			rows[dimensions - 1] = 1;
+			const size_t row_count = run > 0 ? rows.elements() : 0;
+
+			for (size_t row = 0; row < row_count; ++row)
+			{
+				const auto pos = grid_size<dimensions>::from_index(row, rows);
+				const bool row_existed = dual_iteration_n(dimensions - 1, old_dim.begin(), pos.begin(), [](auto dim, auto pos) { return pos < dim; });
+				const size_t kept = row_existed ? std::min(old_dim[dimensions - 1], run) : 0;
+
+				const auto begin = m_data.begin() + size.index_of(pos);
+				std::fill(begin + kept, begin + run, data_type{});
+			}
+		}
+
+	#pragma endregion
+	#pragma region partitions (subgrid, slice)
+
+	public:
+		/*
+			cuts one slice/layer out of the grid.
+			the axis is perpendicular to the cut (the slice contains all the values with dim_at(axis) == layer).
+			the allocator serves the new grid, like an arena shared by many short-lived subgrids.
+		*/
+		VEC_CXP subgrid_type subgrid(size_t layer, size_t axis = 0, const allocator_type &allocator = {}) const
+			requires(dimensions > 0)
+		{
+			if constexpr (row_major)
+			{
+				return subgrid_type(subgrid_view(layer, axis), allocator);
+			}
+			else
+			{
+				const auto generator = [&](const grid_pos<dimensions - 1> &pos) { return at({ insert_element<size_t, dimensions - 1>(pos.pos(), axis, layer) }); };
+				return subgrid_type(m_dim.remove_axis(axis), generator, allocator);
+			}
+		}
+
+		/*
+			slices the whole grid into dim_at(axis) layers.
+			the axis is perpendicular to the cut (the slice contains all the values with dim_at(axis) == layer).
+			the allocator serves the layers as well as the vector holding them.
+		*/
+		VEC_CXP auto slice(size_t axis = 0, const allocator_type &allocator = {}) const
+			requires(dimensions > 0)
+		{
+			using layer_allocator = typename std::allocator_traits<allocator_type>::template rebind_alloc<subgrid_type>;
+			std::vector<subgrid_type, layer_allocator> result{ layer_allocator(allocator) };
+			result.reserve(m_dim[axis]);
+
+			for (size_t layer = 0; layer < m_dim[axis]; ++layer)
+			{
+				result.push_back(subgrid(layer, axis, allocator));
+			}
+			return result;
+		}
+
+	#pragma endregion
+	#pragma region axis permutation
+
+	public:
+		/*
+			reorders the axes: axis i of the result is axis order[i] of this grid (order { 2, 1, 0 } turns z-y-x into x-y-z).
+			the copy recursively splits the result into boxes until they fit into the cache, so both sides get
+			accessed in compact blocks instead of striding through the whole source for every element.
+		*/
+		[[nodiscard]] VEC_CXP this_type permute_axes(const std::array<size_t, dimensions> &order) const
+			requires(row_major)
+		{
+			this_type result(permuted_size(order), m_data.get_allocator());
+			const auto plan = permutation_plan_for(result, order);
+			permute_box(plan, {}, result.m_dim);
+			return result;
+		}
+
+		// multi-threaded version, splitting the largest axis of the result. the policy's chunk size counts elements.
+		[[nodiscard]] this_type permute_axes(const std::array<size_t, dimensions> &order, const parallel_policy &policy) const
+			requires(row_major)
+		{
+			this_type result(permuted_size(order), m_data.get_allocator());
+			const auto plan = permutation_plan_for(result, order);
+
+			const auto &dim = result.m_dim;
+			const size_t axis = static_cast<size_t>(std::max_element(dim.begin(), dim.end()) - dim.begin());
+			const size_t layer = dim[axis] ? dim.elements() / dim[axis] : 0;
+
+			parallel_policy layer_policy = policy;
+			layer_policy.chunk_size = std::max<size_t>(policy.chunk_size / std::max<size_t>(layer, 1), 1);
+			parallel_for(layer ? dim[axis] : 0, layer_policy, [&](size_t begin, size_t end)
+			{
+				grid_size<dimensions> box_begin{}, box_end = dim;
+				box_begin[axis] = begin;
+				box_end[axis] = end;
+				permute_box(plan, box_begin, box_end);
+			});
+			return result;
+		}
+
+		// swaps rows and columns.
+		[[nodiscard]] VEC_CXP this_type transpose() const
+			requires(dimensions == 2 && row_major)
+		{
+			return permute_axes({ 1, 0 });
+		}
+
+		[[nodiscard]] this_type transpose(const parallel_policy &policy) const
+			requires(dimensions == 2 && row_major)
+		{
+			return permute_axes({ 1, 0 }, policy);
+		}
+
+		// transposes without a second buffer if the grid is square, otherwise it falls back to transpose().
+		VEC_CXP void transpose_in_place()
+			requires(dimensions == 2 && row_major)
+		{
+			if (m_dim[0] != m_dim[1])
+			{
+				*this = transpose();
+				return;
+			}
+			transpose_square(m_data.data(), m_dim[0], 0, m_dim[0]);
+		}
+
+		// multi-threaded version. every band of rows swaps its own elements right of the diagonal with their mirrors.
+		void transpose_in_place(const parallel_policy &policy)
+			requires(dimensions == 2 && row_major)
+		{
+			if (m_dim[0] != m_dim[1])
+			{
+				*this = transpose(policy);
+				return;
+			}
+
+			const size_t edge = m_dim[0];
+			parallel_policy row_policy = policy;
+			row_policy.chunk_size = std::max<size_t>(policy.chunk_size / std::max<size_t>(edge, 1), 1);
+			parallel_for(edge, row_policy, [&](size_t begin, size_t end)
+			{
+				transpose_square(m_data.data(), edge, begin, end);
+			});
+		}
+
+	private:
+		// boxes with fewer elements get copied directly.
+		static constexpr size_t permutation_leaf = 1024;
+
+		struct permutation_plan
+		{
+			const data_type *source;
+			data_type *target;
+			grid_stride<dimensions> source_stride; // source stride along each axis of the result.
+			grid_stride<dimensions> target_stride;
+		};
+
+		[[nodiscard]] VEC_CXP grid_size<dimensions> permuted_size(const std::array<size_t, dimensions> &order) const
+		{
+			std::array<bool, dimensions> used{};
+			grid_size<dimensions> result{};
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				if (order[axis] >= dimensions || used[order[axis]])
+				{
+					throw std::invalid_argument("grid::permute_axes(): order has to contain every axis exactly once.");
+				}
+				used[order[axis]] = true;
+				result[axis] = m_dim[order[axis]];
+			}
+			return result;
+		}
+
+		[[nodiscard]] VEC_CXP permutation_plan permutation_plan_for(this_type &result, const std::array<size_t, dimensions> &order) const
+		{
+			const auto strides = m_dim.strides();
+			permutation_plan plan{ m_data.data(), result.m_data.data(), {}, result.m_dim.strides() };
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				plan.source_stride[axis] = strides[order[axis]];
+			}
+			return plan;
+		}
+
+		// copies the box [begin, end) of the result, halving its longest side until it's small enough.
+		static VEC_CXP void permute_box(const permutation_plan &plan, grid_size<dimensions> begin, grid_size<dimensions> end)
+		{
+			size_t elements = 1, longest = 0;
+			for (size_t axis = 0; axis < dimensions; ++axis)
+			{
+				elements *= end[axis] - begin[axis];
+				if (end[axis] - begin[axis] > end[longest] - begin[longest])
+				{
+					longest = axis;
+				}
+			}
+
+			if (elements == 0)
+			{
+				return;
+			}
+
+			if (elements > permutation_leaf && end[longest] - begin[longest] > 1)
+			{
+				const size_t middle = begin[longest] + (end[longest] - begin[longest]) / 2;
+				auto first_end = end;
+				first_end[longest] = middle;
+				auto second_begin = begin;
+				second_begin[longest] = middle;
+
+				permute_box(plan, begin, first_end);
+				permute_box(plan, second_begin, end);
+				return;
+			}
+
+			// leaf: the result gets written row by row (contiguous), the source read with its stride.
+			if constexpr (dimensions == 0)
+			{
+				*plan.target = *plan.source;
+			}
+			else
+			{
+				const size_t run = end[dimensions - 1] - begin[dimensions - 1];
+				const std::ptrdiff_t step = plan.source_stride[dimensions - 1];
+
+				grid_size<dimensions> rows{};
+				for (size_t axis = 0; axis < dimensions; ++axis)
+				{
+					rows[axis] = end[axis] - begin[axis];
+				}
+				rows[dimensions - 1] = 1;
+
+				for (grid_pos<dimensions> row{ rows }; row.valid(); ++row)
+				{
+					std::ptrdiff_t source = 0, target = 0;
+					for (size_t axis = 0; axis < dimensions; ++axis)
+					{
+						const auto pos = static_cast<std::ptrdiff_t>(begin[axis] + row.pos_at(axis));
+						source += pos * plan.source_stride[axis];
+						target += pos * plan.target_stride[axis];
+					}
+
+					const data_type *from = plan.source + source;
+					data_type *to = plan.target + target;
+					for (size_t index = 0; index < run; ++index, from += step)
+					{
+						to[index] = *from;
+					}
+				}
+			}
+		}
+
+		/*
+			in-place transpose of the rows [row_begin, row_end) of a square matrix: swaps every element right of the diagonal
+			with its mirror. the rectangle gets split recursively, so both the rows and the mirrored columns stay in cache.
+		*/
+		static VEC_CXP void transpose_square(data_type *data, size_t edge, size_t row_begin, size_t row_end)
+		{
+			const auto swap_block = [data, edge](auto &self, size_t r0, size_t r1, size_t c0, size_t c1) -> void
+			{
+				// only the part right of the diagonal (column > row) gets swapped.
+				if (r0 >= r1 || c0 >= c1 || c1 <= r0 + 1)
+				{
+					return;
+				}
+
+				if ((r1 - r0) * (c1 - c0) <= permutation_leaf)
+				{
+					for (size_t row = r0; row < r1; ++row)
+					{
+						for (size_t column = std::max(c0, row + 1); column < c1; ++column)
+						{
+							std::swap(data[row * edge + column], data[column * edge + row]);
+						}
+					}
+					return;
+				}
+
+				if (r1 - r0 >= c1 - c0)
+				{
+					const size_t middle = r0 + (r1 - r0) / 2;
+					self(self, r0, middle, c0, c1);
+					self(self, middle, r1, c0, c1);
+				}
+				else
+				{
+					const size_t middle = c0 + (c1 - c0) / 2;
+					self(self, r0, r1, c0, middle);
+					self(self, r0, r1, middle, c1);
+				}
+			};
+			swap_block(swap_block, row_begin, row_end, row_begin, edge);
+		}
+
+	#pragma endregion
+	#pragma region reductions
+
+	public:
+		/*
+			folds all elements into one value. op has to be associative and commutative (like std::reduce), because
+			arithmetic types get folded in several interleaved lanes, so the compiler can vectorize the loop.
+			an empty grid has nothing to start with and throws std::invalid_argument.
+		*/
+		template <typename op_type>
+		[[nodiscard]] VEC_CXP data_type reduce(op_type &&op) const
+			requires(row_major)
+		{
+			return reduce_all(op, grid_summation::plain, nullptr);
+		}
+
+		// multi-threaded version. the partial results of the chunks get combined in order.
+		template <typename op_type>
+		[[nodiscard]] data_type reduce(op_type &&op, const parallel_policy &policy) const
+			requires(row_major)
+		{
+			return reduce_all(op, grid_summation::plain, &policy);
+		}
+
+		/*
+			folds the grid along one axis, turning it into a grid with one dimension less. the memory gets walked
+			in storage order: every layer along the axis gets combined into the result row by row, without copying layers.
+		*/
+		template <typename op_type>
+		[[nodiscard]] VEC_CXP subgrid_type reduce(size_t axis, op_type &&op) const
+			requires(dimensions > 0 && row_major)
+		{
+			return reduce_axis(axis, op, grid_summation::plain, nullptr);
+		}
+
+		// multi-threaded version, splitting the result between the threads.
+		template <typename op_type>
+		[[nodiscard]] subgrid_type reduce(size_t axis, op_type &&op, const parallel_policy &policy) const
+			requires(dimensions > 0 && row_major)
+		{
+			return reduce_axis(axis, op, grid_summation::plain, &policy);
+		}
+
+		// sum of all elements. unlike reduce(), an empty grid simply sums up to zero.
+		[[nodiscard]] VEC_CXP data_type sum(grid_summation mode = grid_summation::plain) const
+			requires(row_major)
+		{
+			return m_data.empty() ? data_type{} : reduce_all(std::plus<>{}, mode, nullptr);
+		}
+
+		[[nodiscard]] data_type sum(grid_summation mode, const parallel_policy &policy) const
+			requires(row_major)
+		{
+			return m_data.empty() ? data_type{} : reduce_all(std::plus<>{}, mode, &policy);
+		}
+
+		[[nodiscard]] VEC_CXP subgrid_type sum(size_t axis, grid_summation mode = grid_summation::plain) const
+			requires(dimensions > 0 && row_major)
+		{
+			return reduce_axis(axis, std::plus<>{}, mode, nullptr);
+		}
+
+		[[nodiscard]] subgrid_type sum(size_t axis, grid_summation mode, const parallel_policy &policy) const
+			requires(dimensions > 0 && row_major)
+		{
+			return reduce_axis(axis, std::plus<>{}, mode, &policy);
+		}
+
+		// arithmetic mean of all elements (integral types divide as integers).
+		[[nodiscard]] VEC_CXP data_type mean(grid_summation mode = grid_summation::plain) const
+			requires(row_major)
+		{
+			return reduce_all(std::plus<>{}, mode, nullptr) / static_cast<data_type>(m_data.size());
+		}
+
+		// arithmetic mean along one axis.
+		[[nodiscard]] VEC_CXP subgrid_type mean(size_t axis, grid_summation mode = grid_summation::plain) const
+			requires(dimensions > 0 && row_major)
+		{
+			auto result = sum(axis, mode);
+			const auto count = static_cast<data_type>(m_dim[axis]);
+			for (size_t index = 0; index < result.storage_size(); ++index)
+			{
+				result.data()[index] /= count;
+			}
+			return result;
+		}
+
+	private:
+		// arithmetic folds keep this many independent accumulators, one per vector lane.
+		static constexpr size_t reduction_lanes = std::is_arithmetic_v<data_type> ? 8 : 1;
+		// below this many elements (or layers), pairwise summation adds up directly.
+		static constexpr size_t pairwise_block = 128;
+
+		template <typename op_type>
+		[[nodiscard]] VEC_CXP data_type reduce_all(op_type &&op, grid_summation mode, const parallel_policy *policy) const
+		{
+			if (m_data.empty())
+			{
+				throw std::invalid_argument("grid::reduce(): an empty grid has no elements to reduce.");
+			}
+
+			if (!policy)
+			{
+				return reduce_span(m_data.data(), m_data.size(), op, mode);
+			}
+
+			const size_t chunk = std::max<size_t>(policy->chunk_size, 1);
+			std::vector<data_type> partial(policy->chunk_count(m_data.size()));
+			parallel_for(m_data.size(), *policy, [&](size_t begin, size_t end)
+			{
+				partial[begin / chunk] = reduce_span(m_data.data() + begin, end - begin, op, mode);
+			});
+			return reduce_span(partial.data(), partial.size(), op, mode);
+		}
+
+		// folds count > 0 consecutive elements.
+		template <typename op_type>
+		[[nodiscard]] static VEC_CXP data_type reduce_span(const data_type *first, size_t count, op_type &&op, grid_summation mode)
+		{
+			if constexpr (std::is_floating_point_v<data_type>)
+			{
+				if (mode == grid_summation::kahan)
+				{
+					// every step feeds the rounding error of the previous addition back into the next value.
+					data_type sum = first[0], compensation{};
+					for (size_t index = 1; index < count; ++index)
+					{
+						const data_type value = first[index] - compensation, next = sum + value;
+						compensation = (next - sum) - value;
+						sum = next;
+					}
+					return sum;
+				}
+			}
+
+			if (mode == grid_summation::pairwise && count > pairwise_block)
+			{
+				const size_t half = count / 2;
+				return op(reduce_span(first, half, op, mode), reduce_span(first + half, count - half, op, mode));
+			}
+
+			if (count < 2 * reduction_lanes)
+			{
+				data_type result = first[0];
+				for (size_t index = 1; index < count; ++index)
+				{
+					result = op(result, first[index]);
+				}
+				return result;
+			}
+
+			std::array<data_type, reduction_lanes> lanes;
+			std::copy_n(first, reduction_lanes, lanes.begin());
+
+			size_t index = reduction_lanes;
+			for (; index + reduction_lanes <= count; index += reduction_lanes)
+			{
+				for (size_t lane = 0; lane < reduction_lanes; ++lane)
+				{
+					lanes[lane] = op(lanes[lane], first[index + lane]);
+				}
+			}
+			for (size_t lane = 0; index < count; ++index, ++lane)
+			{
+				lanes[lane] = op(lanes[lane], first[index]);
+			}
+
+			data_type result = lanes[0];
+			for (size_t lane = 1; lane < reduction_lanes; ++lane)
+			{
+				result = op(result, lanes[lane]);
+			}
+			return result;
+		}
+
+		template <typename op_type>
+		[[nodiscard]] VEC_CXP subgrid_type reduce_axis(size_t axis, op_type &&op, grid_summation mode, const parallel_policy *policy) const
+		{
+			if (axis >= dimensions)
+			{
+				throw std::out_of_range("grid::reduce(): axis out of range.");
+			}
+
+			/*
+				viewed in storage order, the grid is outer blocks of layers * inner elements.
+				result element (outer, inner) folds the elements at ((outer * layers) + layer) * inner_size + inner.
+			*/
+			const size_t layers = m_dim[axis];
+			size_t inner_size = 1;
+			for (size_t index = axis + 1; index < dimensions; ++index)
+			{
+				inner_size *= m_dim[index];
+			}
+
+			subgrid_type result(m_dim.remove_axis(axis), m_data.get_allocator());
+			if (result.storage_size() == 0)
+			{
+				return result;
+			}
+			if (layers == 0)
+			{
+				throw std::invalid_argument("grid::reduce(): an empty axis has no elements to reduce.");
+			}
+
+			const auto reduce_range = [&](size_t begin, size_t end)
+			{
+				while (begin < end)
+				{
+					const size_t outer = begin / inner_size, inner = begin % inner_size;
+					const size_t count = std::min(end - begin, inner_size - inner);
+					reduce_layers(m_data.data() + outer * layers * inner_size + inner, layers, inner_size, result.data() + begin, count, op, mode);
+					begin += count;
+				}
+			};
+
+			if (policy)
+			{
+				// with the reduced axis being the last one, every result element is worth a whole run of layers.
+				parallel_policy result_policy = *policy;
+				result_policy.chunk_size = std::max<size_t>(policy->chunk_size / layers, 1);
+				parallel_for(result.storage_size(), result_policy, reduce_range);
+			}
+			else
+			{
+				reduce_range(0, result.storage_size());
+			}
+			return result;
+		}
+
+		/*
+			folds the layers of count neighboring columns into target. source points to the first layer,
+			consecutive layers are stride elements apart. contiguous columns get combined row by row.
+		*/
+		template <typename op_type>
+		static VEC_CXP void reduce_layers(const data_type *source, size_t layers, size_t stride, data_type *target, size_t count, op_type &&op, grid_summation mode)
+		{
+			if (stride == 1)
+			{
+				// the reduced axis is the last one, so each column is a contiguous run.
+				for (size_t column = 0; column < count; ++column)
+				{
+					target[column] = reduce_span(source + column * layers, layers, op, mode);
+				}
+				return;
+			}
+
+			if constexpr (std::is_floating_point_v<data_type>)
+			{
+				if (mode == grid_summation::kahan)
+				{
+					std::vector<data_type> compensation(count);
+					std::copy_n(source, count, target);
+					for (size_t layer = 1; layer < layers; ++layer)
+					{
+						const data_type *row = source + layer * stride;
+						for (size_t column = 0; column < count; ++column)
+						{
+							const data_type sum = target[column], value = row[column] - compensation[column], next = sum + value;
+							compensation[column] = (next - sum) - value;
+							target[column] = next;
+						}
+					}
+					return;
+				}
+			}
+
+			if (mode == grid_summation::pairwise && layers > pairwise_block)
+			{
+				const size_t half = layers / 2;
+				std::vector<data_type> second(count);
+				reduce_layers(source, half, stride, target, count, op, mode);
+				reduce_layers(source + half * stride, layers - half, stride, second.data(), count, op, mode);
+				for (size_t column = 0; column < count; ++column)
+				{
+					target[column] = op(target[column], second[column]);
+				}
+				return;
+			}
+
+			std::copy_n(source, count, target);
+			for (size_t layer = 1; layer < layers; ++layer)
+			{
+				const data_type *row = source + layer * stride;
+				for (size_t column = 0; column < count; ++column)
+				{
+					target[column] = op(target[column], row[column]);
+				}
+			}
+		}
+
+	#pragma endregion
+	#pragma region views
+
+	public:
+		[[nodiscard]] constexpr grid_view<data_type, dimensions> view()
+			requires(row_major)
+		{
+			return grid_view<data_type, dimensions>(m_data.data(), m_dim, m_map.stride());
+		}
+
+		[[nodiscard]] constexpr grid_view<const data_type, dimensions> view() const
+			requires(row_major)
+		{
+			return grid_view<const data_type, dimensions>(m_data.data(), m_dim, m_map.stride());
+		}
+
+		// same as subgrid(), but without copying. O(1) regardless of the grid size.
+		[[nodiscard]] constexpr grid_view<data_type, dimensions - 1> subgrid_view(size_t layer, size_t axis = 0)
+			requires(dimensions > 0 && row_major)
+		{
+			return view().subgrid(layer, axis);
+		}
+
+		[[nodiscard]] constexpr grid_view<const data_type, dimensions - 1> subgrid_view(size_t layer, size_t axis = 0) const
+			requires(dimensions > 0 && row_major)
+		{
+			return view().subgrid(layer, axis);
+		}
+
+		// same as slice(), but without copying. only the list of views itself is allocated.
+		[[nodiscard]] VEC_CXP std::vector<grid_view<data_type, dimensions - 1>> slice_view(size_t axis = 0)
+			requires(dimensions > 0 && row_major)
+		{
+			return view().slice(axis);
+		}
+
+		[[nodiscard]] VEC_CXP std::vector<grid_view<const data_type, dimensions - 1>> slice_view(size_t axis = 0) const
+			requires(dimensions > 0 && row_major)
+		{
+			return view().slice(axis);
+		}
+
+		/*
+			turns the grid into one of another size (and possibly rank) with the same element count.
+			the storage gets moved over, so not a single element is copied. for a grid that has to stay, use view().reshape().
+		*/
+		template <size_t new_dimensions>
+		[[nodiscard]] VEC_CXP grid<data_type, new_dimensions, layout_type, allocator_type> reshape(const grid_size<new_dimensions> &size) &&
+			requires(row_major)
+		{
+			if (size.elements() != m_dim.elements())
+			{
+				throw std::invalid_argument("grid::reshape(): the element count has to stay the same.");
+			}
+
+			grid<data_type, new_dimensions, layout_type, allocator_type> result(m_data.get_allocator());
+			result.m_dim = size;
+			result.m_map = typename grid<data_type, new_dimensions, layout_type, allocator_type>::mapping_type(size);
+			result.m_data = std::move(m_data);
+
+			// the moved-from grid stays valid, just empty.
+			m_dim = {};
+			m_map = mapping_type(m_dim);
+			m_data.clear();
+			return result;
+		}
+
+	#pragma endregion
+	#pragma region member variables
+
+	private:
+		// reshape() hands its storage over to grids of other ranks.
+		template <typename, size_t, typename, typename>
+		friend class grid;
+
+		grid_size<dimensions> m_dim{};
+		mapping_type m_map{};
+		container_type m_data;
 
 	#pragma endregion
 	};
 
+#pragma endregion
+#pragma region region operations
+
+	/*
+		calls function(source_row, source_step, target_row, target_step, count) for each pair of matching rows of two views
+		of the same size. views that are both gapless get passed as one single row.
+	*/
+	template <typename source_type, typename target_type, size_t dimensions, typename function_type>
+	constexpr void zip_rows(const grid_view<source_type, dimensions> &source, const grid_view<target_type, dimensions> &target, function_type &&function)
+	{
+		if (source.dim() != target.dim())
+		{
+			throw std::invalid_argument("grid region: source and target differ in size.");
+		}
+		if (source.size() == 0)
+		{
+			return;
+		}
+
+		if (source.contiguous() && target.contiguous())
+		{
+			function(source.origin(), std::ptrdiff_t{ 1 }, target.origin(), std::ptrdiff_t{ 1 }, source.size());
+			return;
+		}
+
+		auto rows = source.dim();
+		const size_t width = rows[dimensions - 1];
+		rows[dimensions - 1] = 1;
+
+		const std::ptrdiff_t source_step = source.stride_at(dimensions - 1), target_step = target.stride_at(dimensions - 1);
+		for (grid_pos<dimensions> row{ rows }; row.valid(); ++row)
+		{
+			function(source.origin() + source.offset_of(row.pos()), source_step, target.origin() + target.offset_of(row.pos()), target_step, width);
+		}
+	}
+
+	export
+	/*
+		copies the elements of one view into another one of the same size, which must not overlap with it.
+		rows with a contiguous innermost axis get copied as a whole (std::copy_n, a memmove for trivially copyable types).
+	*/
+	template <typename source_type, typename target_type, size_t dimensions>
+	constexpr void copy_region(const grid_view<source_type, dimensions> &source, const grid_view<target_type, dimensions> &target)
+		requires(dimensions > 0 && !std::is_const_v<target_type>)
+	{
+		zip_rows(source, target, [](auto from, std::ptrdiff_t from_step, auto to, std::ptrdiff_t to_step, size_t count)
+		{
+			if (from_step == 1 && to_step == 1)
+			{
+				std::copy_n(from, count, to);
+				return;
+			}
+			for (size_t index = 0; index < count; ++index, from += from_step, to += to_step)
+			{
+				*to = *from;
+			}
+		});
+	}
+
+	export
+	/*
+		copies the box of the source into the target, starting at target_pos. both boxes have to lie inside of their grids.
+		source and target may be the same grid, overlapping boxes get copied through a temporary.
+	*/
+	template <typename data_type, size_t dimensions, typename source_allocator, typename target_allocator>
+	void copy_region(const grid<data_type, dimensions, grid_layout::row_major, source_allocator> &source, const grid_box<dimensions> &source_box,
+		grid<data_type, dimensions, grid_layout::row_major, target_allocator> &target, const grid_size<dimensions> &target_pos)
+		requires(dimensions > 0)
+	{
+		const auto target_box = grid_box<dimensions>::from(target_pos, source_box.dim());
+		const auto from = source.view().region(source_box);
+		const auto to = target.view().region(target_box);
+
+		if (static_cast<const void *>(source.data()) == static_cast<const void *>(target.data()) && !source_box.intersect(target_box).empty())
+		{
+			const grid<data_type, dimensions> copy(from);
+			copy_region(copy.view(), to);
+			return;
+		}
+		copy_region(from, to);
+	}
+
+	/*
+		the part of a source of this size that lands inside of the target when its origin gets placed at offset.
+		returns false if nothing overlaps.
+	*/
+	template <size_t dimensions>
+	constexpr bool clip_blit(const grid_size<dimensions> &source, const grid_size<dimensions> &target, const grid_stride<dimensions> &offset,
+		grid_box<dimensions> &source_box, grid_size<dimensions> &target_pos)
+	{
+		for (size_t axis = 0; axis < dimensions; ++axis)
+		{
+			const std::ptrdiff_t low = std::max<std::ptrdiff_t>(0, -offset[axis]);
+			const std::ptrdiff_t high = std::min<std::ptrdiff_t>(static_cast<std::ptrdiff_t>(source[axis]), static_cast<std::ptrdiff_t>(target[axis]) - offset[axis]);
+			if (high <= low)
+			{
+				return false;
+			}
+			source_box.low[axis] = static_cast<size_t>(low);
+			source_box.high[axis] = static_cast<size_t>(high);
+			target_pos[axis] = static_cast<size_t>(low + offset[axis]);
+		}
+		return true;
+	}
+
+	export
+	/*
+		draws the whole source into the target, with the source origin placed at offset (negative offsets are fine).
+		whatever sticks out of the target gets clipped.
+	*/
+	template <typename data_type, size_t dimensions, typename source_allocator, typename target_allocator>
+	void blit(const grid<data_type, dimensions, grid_layout::row_major, source_allocator> &source,
+		grid<data_type, dimensions, grid_layout::row_major, target_allocator> &target, const grid_stride<dimensions> &offset)
+		requires(dimensions > 0)
+	{
+		grid_box<dimensions> source_box{};
+		grid_size<dimensions> target_pos{};
+		if (clip_blit(source.dim(), target.dim(), offset, source_box, target_pos))
+		{
+			copy_region(source, source_box, target, target_pos);
+		}
+	}
+
+	export
+	/*
+		same as blit(), but every covered target element becomes combine(target_element, source_element).
+		made for blending, masking, accumulating, ... the grids must be different ones.
+	*/
+	template <typename data_type, size_t dimensions, typename source_allocator, typename target_allocator, typename combine_type>
+	void blit(const grid<data_type, dimensions, grid_layout::row_major, source_allocator> &source,
+		grid<data_type, dimensions, grid_layout::row_major, target_allocator> &target, const grid_stride<dimensions> &offset, combine_type &&combine)
+		requires(dimensions > 0)
+	{
+		grid_box<dimensions> source_box{};
+		grid_size<dimensions> target_pos{};
+		if (!clip_blit(source.dim(), target.dim(), offset, source_box, target_pos))
+		{
+			return;
+		}
+
+		const auto covered = target.view().region(grid_box<dimensions>::from(target_pos, source_box.dim()));
+		zip_rows(source.view().region(source_box), covered, [&](auto from, std::ptrdiff_t from_step, auto to, std::ptrdiff_t to_step, size_t count)
+		{
+			for (size_t index = 0; index < count; ++index, from += from_step, to += to_step)
+			{
+				*to = combine(std::as_const(*to), *from);
+			}
+		});
+	}
+
+#pragma endregion
+#pragma region default init allocator
+
+	export
+	/*
+		allocator adaptor which default-initializes instead of value-initializing. a grid<T, N, layout, default_init_allocator<T>>
+		leaves trivial elements (int, float, ...) uninitialized when it gets constructed or resized with a size only.
+		saves the pass zeroing the memory, when every element gets overwritten right after anyway.
+	*/
+	template <typename data_type, typename base_allocator = std::allocator<data_type>>
+	class default_init_allocator : public base_allocator
+	{
+		using traits = std::allocator_traits<base_allocator>;
+
+	public:
+		template <typename other_type>
+		struct rebind
+		{
+			using other = default_init_allocator<other_type, typename traits::template rebind_alloc<other_type>>;
+		};
+
+		using base_allocator::base_allocator;
+
+		constexpr default_init_allocator() = default;
+
+		template <typename other_type, typename other_base>
+		constexpr default_init_allocator(const default_init_allocator<other_type, other_base> &other) noexcept
+			: base_allocator(other)
+		{
+		}
+
+		template <typename type>
+		void construct(type *ptr) noexcept(std::is_nothrow_default_constructible_v<type>)
+		{
+			::new (static_cast<void *>(ptr)) type;
+		}
+
+		template <typename type, typename... argument_types>
+		void construct(type *ptr, argument_types &&...arguments)
+		{
+			traits::construct(static_cast<base_allocator &>(*this), ptr, std::forward<argument_types>(arguments)...);
+		}
+	};
+
+#pragma endregion
+#pragma region pmr
+
+	namespace pmr
+	{
+		export
+		// grid drawing its memory from a std::pmr::memory_resource.
+		template <typename data_type, size_t dimensions, typename layout_type = grid_layout::row_major>
+		using grid = p3::grid<data_type, dimensions, layout_type, std::pmr::polymorphic_allocator<data_type>>;
+
+		export
+		/*
+			monotonic arena for short-lived grids (like the layers of a slice()): every allocation just bumps a pointer,
+			deallocations do nothing. release() frees everything at once, the memory gets reused afterwards.
+			the grids using the arena must not be touched after release() or the destruction of the arena.
+		*/
+		class grid_arena
+		{
+		public:
+			explicit grid_arena(size_t initial_size = 1U << 16, std::pmr::memory_resource *upstream = std::pmr::get_default_resource())
+				: m_resource(initial_size, upstream)
+			{
+			}
+
+			grid_arena(const grid_arena &) = delete;
+			grid_arena &operator=(const grid_arena &) = delete;
+
+			[[nodiscard]] std::pmr::memory_resource *resource()
+			{
+				return &m_resource;
+			}
+
+			template <typename data_type>
+			[[nodiscard]] std::pmr::polymorphic_allocator<data_type> allocator()
+			{
+				return std::pmr::polymorphic_allocator<data_type>(&m_resource);
+			}
+
+			void release()
+			{
+				m_resource.release();
+			}
+
+		private:
+			std::pmr::monotonic_buffer_resource m_resource;
+		};
+	}
+
 #pragma endregion
 }
\ No newline at end of file
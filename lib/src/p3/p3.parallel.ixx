@@ -0,0 +1,120 @@
+#include <exception>
+#include <algorithm>  // std::min()
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <mutex>
+export module p3.parallel;
+/*
+	Parallel module, part of github/TeraFlint/pitrilib.
+	Daniel Wiegert (Pitri), 2021.
+*/
+
+// import <exception>;
+// import <algorithm>;  // std::min()
+// import <atomic>;
+// import <thread>;
+// import <vector>;
+// import <mutex>;
+
+namespace p3
+{
+#pragma region parallel policy
+
+	export
+	/*
+		describes how a linear range of work gets split up between threads.
+		the results of the algorithms using it never depend on these values, only their speed does.
+	*/
+	struct parallel_policy
+	{
+		// 0 = one thread per hardware thread.
+		size_t threads = 0;
+
+		// amount of work items a thread grabs at once. smaller chunks balance better, bigger chunks synchronize less.
+		size_t chunk_size = 1U << 14;
+
+		[[nodiscard]] size_t chunk_count(size_t work) const
+		{
+			const size_t chunk = std::max<size_t>(chunk_size, 1);
+			return (work + chunk - 1) / chunk;
+		}
+
+		[[nodiscard]] size_t thread_count(size_t work) const
+		{
+			const size_t hardware = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+			return std::min(threads > 0 ? threads : hardware, chunk_count(work));
+		}
+	};
+
+#pragma endregion
+#pragma region parallel for
+
+	export
+	/*
+		calls function(begin, end) for consecutive chunks of [0, count), spread over multiple threads.
+		chunks are handed out dynamically, so a thread finishing early simply grabs the next one.
+		the calling thread takes part in the work. the first exception thrown stops the distribution of
+		further chunks and gets rethrown once all threads are joined.
+	*/
+	template <typename function_type>
+	void parallel_for(size_t count, const parallel_policy &policy, function_type &&function)
+	{
+		const size_t chunk = std::max<size_t>(policy.chunk_size, 1);
+		const size_t chunks = policy.chunk_count(count);
+		const size_t thread_count = policy.thread_count(count);
+
+		if (thread_count <= 1)
+		{
+			for (size_t begin = 0; begin < count; begin += chunk)
+			{
+				function(begin, std::min(begin + chunk, count));
+			}
+			return;
+		}
+
+		std::atomic<size_t> next_chunk{ 0 };
+		std::exception_ptr error;
+		std::mutex error_mutex;
+
+		const auto work = [&]()
+		{
+			for (size_t index = next_chunk++; index < chunks; index = next_chunk++)
+			{
+				try
+				{
+					const size_t begin = index * chunk;
+					function(begin, std::min(begin + chunk, count));
+				}
+				catch (...)
+				{
+					const std::lock_guard lock(error_mutex);
+					if (!error)
+					{
+						error = std::current_exception();
+					}
+					next_chunk = chunks;
+				}
+			}
+		};
+
+		std::vector<std::thread> helpers;
+		helpers.reserve(thread_count - 1);
+		for (size_t i = 1; i < thread_count; ++i)
+		{
+			helpers.emplace_back(work);
+		}
+		work();
+
+		for (auto &thread : helpers)
+		{
+			thread.join();
+		}
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+	}
+
+#pragma endregion
+}
@@ -1,12 +1,60 @@
+#include <condition_variable>
+#include <type_traits>
+#include <algorithm> // std::min()
+#include <typeinfo>
 #include <filesystem>
+#include <functional>
+#include <exception>
 #include <iostream>
+#include <iterator>  // std::istreambuf_iterator
 #include <fstream>
+#include <cstring>   // std::memcpy()
+#include <cstddef>   // std::byte
+#include <future>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <string>    // std::to_string()
+#include <atomic>
+#include <array>
+#include <span>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 export module p3.persistence;
 
+export import p3.persistence.codec;
+// import <condition_variable>;
+// import <type_traits>;
+// import <algorithm>; // std::min()
+// import <typeinfo>;
 // import <filesystem>;
+// import <functional>;
+// import <exception>;
 // import <iostream>;
+// import <iterator>;  // std::istreambuf_iterator
 // import <fstream>;
+// import <cstring>;   // std::memcpy()
+// import <cstddef>;   // std::byte
+// import <future>;
+// import <memory>;
+// import <thread>;
+// import <mutex>;
+// import <deque>;
+// import <vector>;
+// import <string>;    // std::to_string()
+// import <atomic>;
+// import <array>;
+// import <span>;
 
 namespace p3
 {
@@ -30,6 +78,371 @@ namespace p3
 		std::ios_base::fmtflags m_flags;
 	};
 
+	export
+	/*
+		waits until the file content has reached the disk, not only the cache of the operating system. on posix systems,
+		this works on directories as well (which makes renames inside of them durable), windows only flushes files.
+	*/
+	bool sync_to_disk(const std::filesystem::path &location)
+	{
+#if defined(_WIN32)
+		if (std::filesystem::is_directory(location))
+		{
+			return true;
+		}
+		const HANDLE file = CreateFileW(location.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		const bool result = FlushFileBuffers(file) != 0;
+		CloseHandle(file);
+		return result;
+#else
+		const int file = ::open(location.c_str(), O_RDONLY);
+		if (file < 0)
+		{
+			return false;
+		}
+		const bool result = ::fsync(file) == 0;
+		::close(file);
+		return result;
+#endif
+	}
+
+#pragma endregion
+#pragma region byte buffers
+
+	export
+	/*
+		sequential binary input from a span, without any copies of its own. read() copies into the caller's memory,
+		view() hands out a part of the input itself. reading past the end fails and leaves the reader in the failed state.
+	*/
+	class byte_reader
+	{
+	public:
+		explicit byte_reader(std::span<const std::byte> bytes)
+			: m_bytes{ bytes }
+		{
+		}
+
+		bool read(std::span<std::byte> target)
+		{
+			const auto source = view(target.size());
+			if (source.size() == target.size() && !source.empty())
+			{
+				std::memcpy(target.data(), source.data(), source.size());
+			}
+			return good();
+		}
+
+		template <typename value_type>
+		bool read_value(value_type &value)
+		{
+			static_assert(std::is_trivially_copyable_v<value_type>, "byte_reader: only trivially copyable values can be read.");
+			return read(std::as_writable_bytes(std::span(&value, 1)));
+		}
+
+		// scatter: fills the targets one after another.
+		bool read(std::span<const std::span<std::byte>> targets)
+		{
+			for (const auto &target : targets)
+			{
+				if (!read(target))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// the next count bytes of the input, without copying them. empty if there aren't enough left.
+		[[nodiscard]] std::span<const std::byte> view(size_t count)
+		{
+			if (!m_good || count > remaining())
+			{
+				m_good = false;
+				return {};
+			}
+			const auto result = m_bytes.subspan(m_position, count);
+			m_position += count;
+			return result;
+		}
+
+		void skip(size_t count)
+		{
+			(void)view(count);
+		}
+
+		// jumps to an absolute position, which also clears the failed state.
+		bool seek(size_t position)
+		{
+			m_good = position <= m_bytes.size();
+			m_position = m_good ? position : m_position;
+			return m_good;
+		}
+
+		[[nodiscard]] bool good() const
+		{
+			return m_good;
+		}
+
+		[[nodiscard]] size_t position() const
+		{
+			return m_position;
+		}
+
+		[[nodiscard]] size_t remaining() const
+		{
+			return m_bytes.size() - m_position;
+		}
+
+	private:
+		std::span<const std::byte> m_bytes;
+		size_t m_position = 0;
+		bool m_good = true;
+	};
+
+	export
+	/*
+		binary output into a growable buffer. besides copying bytes into the buffer (write()), memory that outlives
+		the writer can be appended by reference (write_external()), e.g. the elements of a grid. segments() is the
+		resulting gather list, which gets written out without ever copying the referenced memory.
+	*/
+	class byte_writer
+	{
+	public:
+		byte_writer() = default;
+
+		explicit byte_writer(size_t capacity)
+		{
+			m_buffer.reserve(capacity);
+		}
+
+		void write(std::span<const std::byte> bytes)
+		{
+			if (!bytes.empty())
+			{
+				std::memcpy(append(bytes.size()).data(), bytes.data(), bytes.size());
+			}
+		}
+
+		// room for count more bytes at the end of the own buffer, to be filled in place. valid until the next write.
+		[[nodiscard]] std::span<std::byte> append(size_t count)
+		{
+			if (count == 0)
+			{
+				return {};
+			}
+			if (m_pieces.empty() || m_pieces.back().external)
+			{
+				m_pieces.push_back({ nullptr, m_buffer.size(), 0 });
+			}
+			const size_t offset = m_buffer.size();
+			m_buffer.resize(offset + count);
+			m_pieces.back().size += count;
+			m_size += count;
+			return { m_buffer.data() + offset, count };
+		}
+
+		// gives back the unused end of the last append(), when it was reserved generously. external memory stays.
+		void shrink(size_t count)
+		{
+			if (m_pieces.empty() || m_pieces.back().external)
+			{
+				return;
+			}
+			count = std::min(count, m_pieces.back().size);
+			m_buffer.resize(m_buffer.size() - count);
+			m_pieces.back().size -= count;
+			m_size -= count;
+		}
+
+		template <typename value_type>
+		void write_value(const value_type &value)
+		{
+			static_assert(std::is_trivially_copyable_v<value_type>, "byte_writer: only trivially copyable values can be written.");
+			write(std::as_bytes(std::span(&value, 1)));
+		}
+
+		// appends the bytes by reference. they have to stay alive and unchanged until the output has been used.
+		void write_external(std::span<const std::byte> bytes)
+		{
+			if (!bytes.empty())
+			{
+				m_pieces.push_back({ bytes.data(), 0, bytes.size() });
+				m_size += bytes.size();
+			}
+		}
+
+		// total number of bytes written so far.
+		[[nodiscard]] size_t size() const
+		{
+			return m_size;
+		}
+
+		// the output in order, as a gather list of the own buffer and the external memory.
+		[[nodiscard]] std::vector<std::span<const std::byte>> segments() const
+		{
+			std::vector<std::span<const std::byte>> result;
+			result.reserve(m_pieces.size());
+			for (const auto &item : m_pieces)
+			{
+				result.emplace_back(item.external ? item.external : m_buffer.data() + item.offset, item.size);
+			}
+			return result;
+		}
+
+		// the whole output in one piece. only external memory gets copied, without any the buffer gets moved out.
+		[[nodiscard]] std::vector<std::byte> take()
+		{
+			std::vector<std::byte> result;
+			if (m_pieces.size() <= 1 && (m_pieces.empty() || !m_pieces.front().external))
+			{
+				result = std::move(m_buffer);
+			}
+			else
+			{
+				result.reserve(m_size);
+				for (const auto &segment : segments())
+				{
+					result.insert(result.end(), segment.begin(), segment.end());
+				}
+			}
+			clear();
+			return result;
+		}
+
+		void clear()
+		{
+			m_buffer.clear();
+			m_pieces.clear();
+			m_size = 0;
+		}
+
+		// writes every segment into the stream.
+		void flush_to(std::ostream &stream) const
+		{
+			for (const auto &segment : segments())
+			{
+				stream.write(reinterpret_cast<const char *>(segment.data()), static_cast<std::streamsize>(segment.size()));
+			}
+		}
+
+	private:
+		struct piece
+		{
+			const std::byte *external; // nullptr for a part of the own buffer.
+			size_t offset, size;
+		};
+
+		std::vector<std::byte> m_buffer;
+		std::vector<piece> m_pieces;
+		size_t m_size = 0;
+	};
+
+	// read-only stream buffer over a span, hands binary input to iostream based code.
+	class span_streambuf : public std::streambuf
+	{
+	public:
+		explicit span_streambuf(std::span<const std::byte> bytes)
+		{
+			// the get area is never written to.
+			char *begin = const_cast<char *>(reinterpret_cast<const char *>(bytes.data()));
+			setg(begin, begin, begin + bytes.size());
+		}
+
+		[[nodiscard]] size_t consumed() const
+		{
+			return static_cast<size_t>(gptr() - eback());
+		}
+
+	protected:
+		pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override
+		{
+			const off_type base = direction == std::ios_base::beg ? 0 : direction == std::ios_base::cur ? gptr() - eback() : egptr() - eback();
+			const off_type target = base + offset;
+			if (!(which & std::ios_base::in) || target < 0 || target > egptr() - eback())
+			{
+				return pos_type(off_type(-1));
+			}
+			setg(eback(), eback() + target, egptr());
+			return pos_type(target);
+		}
+
+		pos_type seekpos(pos_type position, std::ios_base::openmode which) override
+		{
+			return seekoff(off_type(position), std::ios_base::beg, which);
+		}
+	};
+
+	// append-only stream buffer into a byte_writer, hands iostream output to binary code. tellp() works, seeking doesn't.
+	class writer_streambuf : public std::streambuf
+	{
+	public:
+		explicit writer_streambuf(byte_writer &writer)
+			: m_writer{ writer }
+		{
+			setp(m_pending.data(), m_pending.data() + m_pending.size());
+		}
+
+		~writer_streambuf() override
+		{
+			flush();
+		}
+
+	protected:
+		int_type overflow(int_type character) override
+		{
+			flush();
+			if (!traits_type::eq_int_type(character, traits_type::eof()))
+			{
+				*pptr() = traits_type::to_char_type(character);
+				pbump(1);
+			}
+			return traits_type::not_eof(character);
+		}
+
+		std::streamsize xsputn(const char *data, std::streamsize count) override
+		{
+			if (count > epptr() - pptr())
+			{
+				flush();
+				m_writer.write(std::as_bytes(std::span(data, static_cast<size_t>(count))));
+				return count;
+			}
+			std::memcpy(pptr(), data, static_cast<size_t>(count));
+			pbump(static_cast<int>(count));
+			return count;
+		}
+
+		int sync() override
+		{
+			flush();
+			return 0;
+		}
+
+		pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override
+		{
+			if (offset != 0 || direction != std::ios_base::cur || !(which & std::ios_base::out))
+			{
+				return pos_type(off_type(-1));
+			}
+			flush();
+			return pos_type(static_cast<off_type>(m_writer.size()));
+		}
+
+	private:
+		void flush()
+		{
+			m_writer.write(std::as_bytes(std::span(pbase(), static_cast<size_t>(pptr() - pbase()))));
+			setp(m_pending.data(), m_pending.data() + m_pending.size());
+		}
+
+		byte_writer &m_writer;
+		std::array<char, 512> m_pending{};
+	};
+
 #pragma endregion
 #pragma region file_access
 
@@ -56,6 +469,11 @@ namespace p3
 			}
 		}
 
+		/*
+			saves are crash-safe: on_save writes a temporary file next to the destination, which gets synced to the disk
+			and then replaces the destination in a single rename. an interrupted save (even by a power loss) leaves
+			either the previous or the new file, never a partial one.
+		*/
 		void save(const path_type &location, bool create = false) const
 		{
 			if (!directory_exists(location))
@@ -66,12 +484,56 @@ namespace p3
 				}
 			}
 
-			if (!on_save(location))
+			if (save_in_place(location))
+			{
+				if (!on_save(location))
+				{
+					throw custom_error("saving: on_safe returned false.");
+				}
+				return;
+			}
+
+			const path_type temporary = temporary_path(location);
+			try
+			{
+				if (!on_save(temporary))
+				{
+					throw custom_error("saving: on_safe returned false.");
+				}
+				if (!sync_to_disk(temporary))
+				{
+					throw custom_error("saving: the file couldn't be synced to the disk.");
+				}
+				std::filesystem::rename(temporary, location);
+				// makes the rename itself durable. the file is complete either way, so a failure isn't an error.
+				sync_to_disk(std::filesystem::absolute(location).parent_path());
+			}
+			catch (...)
 			{
-				throw custom_error("saving: on_safe returned false.");
+				std::error_code error;
+				std::filesystem::remove(temporary, error);
+				throw;
 			}
 		}
 
+		/*
+			load() on a separate thread. the object must not be touched until the future is ready,
+			get() rethrows whatever load() threw.
+		*/
+		[[nodiscard]] std::future<void> load_async(const path_type &location)
+		{
+			return std::async(std::launch::async, [this, location]() { load(location); });
+		}
+
+		/*
+			save() on a separate thread. the object must not be modified until the future is ready.
+			to keep working on the object in the meantime, save a snapshot through a background_writer.
+		*/
+		[[nodiscard]] std::future<void> save_async(const path_type &location, bool create = false) const
+		{
+			return std::async(std::launch::async, [this, location, create]() { save(location, create); });
+		}
+
 		static bool directory_exists(const path_type &location)
 		{
 			namespace fs = std::filesystem;
@@ -91,15 +553,38 @@ namespace p3
 				fs::create_directories(location.parent_path());
 		}
 
+		/*
+			a new name on every call ("name.p3tmp<n>.ext"), so concurrent saves to the same location don't share their
+			temporary file. the extension stays last, for on_save implementations that look at it.
+		*/
+		static path_type temporary_path(const path_type &location)
+		{
+			static std::atomic<size_t> counter = 0;
+			path_type result = location;
+			result.replace_extension(".p3tmp" + std::to_string(counter++) + location.extension().string());
+			return result;
+		}
+
 	protected:
 		virtual bool on_load(const path_type &location) = 0;
 		virtual bool on_save(const path_type &location) const = 0;
+
+		// true skips the temporary file, for classes that manage the destination file themselves.
+		virtual bool save_in_place(const path_type &/*location*/) const
+		{
+			return false;
+		}
 	};
 
 #pragma endregion
 #pragma region stream_access
 
 	export
+	/*
+		serialization through either iostreams or binary buffers (byte_reader, byte_writer). a class overrides one pair of
+		on_read/on_write functions, the other pair adapts to it. binary implementations skip the stream flags and
+		the virtual stream buffer calls, which makes them the better choice for binary formats and in-memory messages.
+	*/
 	class stream_access
 	{
 	public:
@@ -129,31 +614,430 @@ namespace p3
 			}
 		}
 
+		// returns the number of bytes consumed.
+		size_t read(std::span<const std::byte> bytes)
+		{
+			byte_reader reader(bytes);
+			if (!on_read(reader))
+			{
+				throw custom_error("reading: on_read returned false.");
+			}
+			return reader.position();
+		}
+
+		void write(byte_writer &writer) const
+		{
+			if (!on_write(writer))
+			{
+				throw custom_error("writing: on_write returned false.");
+			}
+		}
+
 	protected:
-		virtual bool on_read (std::istream &stream) = 0;
-		virtual bool on_write(std::ostream &stream) const = 0;
+		/*
+			reads the rest of the stream into memory. seekable streams get placed right behind the consumed bytes.
+			the stream has to be a binary one: text mode streams (newline conversion, ^Z on windows) deliver fewer bytes
+			than their positions suggest, which fails instead of handing a corrupted input to on_read(byte_reader).
+		*/
+		virtual bool on_read(std::istream &stream)
+		{
+			const adapter_guard guard(this);
+			if (guard.recursive())
+			{
+				return false;
+			}
+
+			const auto start = stream.tellg();
+			const bool seekable = start != std::istream::pos_type(-1) && stream.seekg(0, std::ios::end);
+			std::vector<std::byte> bytes;
+			if (seekable)
+			{
+				bytes.resize(static_cast<size_t>(stream.tellg() - start));
+				stream.seekg(start);
+				stream.read(reinterpret_cast<char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+				if (static_cast<size_t>(stream.gcount()) != bytes.size())
+				{
+					stream.clear();
+					stream.seekg(start);
+					return false;
+				}
+			}
+			else
+			{
+				stream.clear();
+				for (auto iter = std::istreambuf_iterator<char>(stream); iter != std::istreambuf_iterator<char>(); ++iter)
+				{
+					bytes.push_back(static_cast<std::byte>(*iter));
+				}
+			}
+
+			byte_reader reader(bytes);
+			const bool result = on_read(reader);
+			if (seekable)
+			{
+				// every byte got delivered, so the byte count matches the stream offset.
+				stream.clear();
+				stream.seekg(start + static_cast<std::streamoff>(reader.position()));
+			}
+			return result;
+		}
+
+		virtual bool on_write(std::ostream &stream) const
+		{
+			const adapter_guard guard(this);
+			if (guard.recursive())
+			{
+				return false;
+			}
+
+			byte_writer writer;
+			const bool result = on_write(writer);
+			writer.flush_to(stream);
+			return result && stream;
+		}
+
+		virtual bool on_read(byte_reader &reader)
+		{
+			const adapter_guard guard(this);
+			if (guard.recursive())
+			{
+				return false;
+			}
+
+			const size_t start = reader.position();
+			span_streambuf buffer(reader.view(reader.remaining()));
+			std::istream stream(&buffer);
+			const bool result = on_read(stream);
+
+			// gives back whatever the stream didn't consume.
+			reader.seek(start + buffer.consumed());
+			return result;
+		}
+
+		virtual bool on_write(byte_writer &writer) const
+		{
+			const adapter_guard guard(this);
+			if (guard.recursive())
+			{
+				return false;
+			}
+
+			writer_streambuf buffer(writer);
+			std::ostream stream(&buffer);
+			return on_write(stream) && stream.flush();
+		}
+
+	private:
+		// catches classes that override neither pair, which would bounce between the adapters forever.
+		class adapter_guard
+		{
+		public:
+			explicit adapter_guard(const stream_access *object)
+				: m_previous{ current() }, m_recursive{ current() == object }
+			{
+				current() = object;
+			}
+
+			~adapter_guard()
+			{
+				current() = m_previous;
+			}
+
+			[[nodiscard]] bool recursive() const
+			{
+				return m_recursive;
+			}
+
+		private:
+			static const stream_access *&current()
+			{
+				static thread_local const stream_access *instance = nullptr;
+				return instance;
+			}
+
+			const stream_access *m_previous;
+			bool m_recursive;
+		};
 	};
 
 #pragma endregion
 #pragma region filestream_access
 
 	export
+	/*
+		file_access through the stream_access functions. with a codec set, saving serializes into memory, compresses it
+		(see p3.persistence.codec) and writes it in one go. loading recognizes compressed files by their header,
+		so files saved with and without a codec can be loaded either way.
+
+		uncompressed files are opened in text mode, for the stream pair of on_read/on_write. classes with binary content
+		(the byte_reader/byte_writer pair) derive from file_access and stream_access directly instead, see p3::image.
+	*/
 	class filestream_access
 		: public file_access, public stream_access
 	{
+	public:
+		void set_codec(const codec_options &options)
+		{
+			m_codec = options;
+		}
+
+		[[nodiscard]] const codec_options &codec() const
+		{
+			return m_codec;
+		}
+
 	protected:
 		bool on_load(const path_type &location) override
 		{
+			if (auto bytes = read_compressed(location); !bytes.empty())
+			{
+				const auto content = decompress(bytes, m_codec.policy);
+				bytes = {};
+				read(content);
+				return true;
+			}
+
 			std::ifstream file(location);
 			read(file);
 			return true;
 		}
 		bool on_save(const path_type &location) const override
 		{
-			std::ofstream file(location);
-			write(file);
-			return true;
+			if (m_codec.id == codec_id::none)
+			{
+				std::ofstream file(location);
+				write(file);
+				return true;
+			}
+
+			byte_writer writer;
+			write(writer);
+			const auto bytes = compress(writer.take(), m_codec);
+			std::ofstream file(location, std::ios::binary);
+			file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+			return static_cast<bool>(file);
 		}
+
+	private:
+		codec_options m_codec;
+
+		// the whole file if it's compressed, nothing otherwise. once the magic matches, anything incomplete is an error.
+		[[nodiscard]] static std::vector<std::byte> read_compressed(const path_type &location)
+		{
+			std::ifstream file(location, std::ios::binary);
+			std::vector<std::byte> bytes(compressed_header_size);
+			file.read(reinterpret_cast<char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+			bytes.resize(static_cast<size_t>(file.gcount()));
+			if (!has_compressed_magic(bytes))
+			{
+				return {};
+			}
+			if (!is_compressed(bytes))
+			{
+				throw codec_error("loading: truncated or unsupported compression header.");
+			}
+
+			bytes.resize(static_cast<size_t>(std::filesystem::file_size(location)));
+			file.read(reinterpret_cast<char *>(bytes.data() + compressed_header_size), static_cast<std::streamsize>(bytes.size() - compressed_header_size));
+			if (static_cast<size_t>(file.gcount()) != bytes.size() - compressed_header_size)
+			{
+				throw codec_error("loading: truncated compressed file.");
+			}
+			return bytes;
+		}
+	};
+
+#pragma endregion
+#pragma region background_writer
+
+	export
+	/*
+		saves snapshots of file_access objects on its own thread. save() copies the object (the copy is the snapshot),
+		queues it and returns right away, so the caller can keep modifying the original while the snapshot is written.
+		the foreground cost is one copy of the object. the last written snapshot gets reused as a second buffer,
+		so copy-assignable objects don't need to allocate their memory anew on every save.
+
+		a queued snapshot that hasn't been started yet gets replaced by a newer one for the same location. its future
+		becomes ready as soon as the newer snapshot has been saved. the destructor saves everything still queued.
+	*/
+	class background_writer
+	{
+	public:
+		using path_type = file_access::path_type;
+
+		struct statistics
+		{
+			size_t saves = 0;      // snapshots written.
+			size_t superseded = 0; // snapshots replaced by newer ones before they were written.
+			size_t failures = 0;   // saves that threw.
+		};
+
+		background_writer()
+			: m_thread{ [this]() { run(); } }
+		{
+		}
+
+		background_writer(const background_writer &) = delete;
+		background_writer &operator=(const background_writer &) = delete;
+
+		~background_writer()
+		{
+			{
+				std::lock_guard lock(m_mutex);
+				m_stop = true;
+			}
+			m_wake.notify_all();
+			m_thread.join();
+		}
+
+		template <typename object_type>
+		std::future<void> save(const object_type &object, const path_type &location, bool create = false)
+		{
+			static_assert(std::is_base_of_v<file_access, object_type>, "background_writer: only file_access objects can be saved.");
+
+			std::shared_ptr<object_type> snapshot;
+			if constexpr (std::is_copy_assignable_v<object_type>)
+			{
+				{
+					std::lock_guard lock(m_mutex);
+					// the same type can have several type_info objects (one per shared library), so they're compared by value.
+					if (m_spare_type && *m_spare_type == typeid(object_type))
+					{
+						snapshot = std::static_pointer_cast<object_type>(std::move(m_spare));
+						m_spare_type = nullptr;
+					}
+				}
+				if (snapshot)
+				{
+					*snapshot = object;
+				}
+			}
+			if (!snapshot)
+			{
+				snapshot = std::make_shared<object_type>(object);
+			}
+
+			std::promise<void> done;
+			std::future<void> result = done.get_future();
+
+			const object_type *source = snapshot.get();
+			std::function<void()> task = [source, location, create]() { source->save(location, create); };
+			{
+				std::lock_guard lock(m_mutex);
+				for (auto &job : m_queue)
+				{
+					if (job.location == location)
+					{
+						job.task = std::move(task);
+						job.snapshot = std::move(snapshot);
+						job.type = &typeid(object_type);
+						job.done.push_back(std::move(done));
+						++m_stats.superseded;
+						return result;
+					}
+				}
+				m_queue.push_back({ location, std::move(task), std::move(snapshot), &typeid(object_type), {} });
+				m_queue.back().done.push_back(std::move(done));
+			}
+			m_wake.notify_all();
+			return result;
+		}
+
+		// blocks until every queued snapshot has been written.
+		void wait()
+		{
+			std::unique_lock lock(m_mutex);
+			m_idle.wait(lock, [this]() { return m_queue.empty() && !m_busy; });
+		}
+
+		[[nodiscard]] size_t pending() const
+		{
+			std::lock_guard lock(m_mutex);
+			return m_queue.size() + m_busy;
+		}
+
+		[[nodiscard]] statistics stats() const
+		{
+			std::lock_guard lock(m_mutex);
+			return m_stats;
+		}
+
+	private:
+		struct job
+		{
+			path_type location;
+			std::function<void()> task;
+			std::shared_ptr<void> snapshot;
+			const std::type_info *type = nullptr;
+			std::vector<std::promise<void>> done;
+		};
+
+		void run()
+		{
+			std::unique_lock lock(m_mutex);
+			while (true)
+			{
+				m_wake.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+				if (m_queue.empty())
+				{
+					return;
+				}
+
+				job current = std::move(m_queue.front());
+				m_queue.pop_front();
+				m_busy = true;
+				lock.unlock();
+
+				std::exception_ptr error;
+				try
+				{
+					current.task();
+				}
+				catch (...)
+				{
+					error = std::current_exception();
+				}
+				// the snapshot is put aside and the statistics are done before anyone gets notified.
+				current.task = nullptr;
+				lock.lock();
+				m_spare = std::move(current.snapshot);
+				m_spare_type = current.type;
+				if (error)
+				{
+					++m_stats.failures;
+				}
+				else
+				{
+					++m_stats.saves;
+				}
+				lock.unlock();
+
+				for (auto &done : current.done)
+				{
+					if (error)
+					{
+						done.set_exception(error);
+					}
+					else
+					{
+						done.set_value();
+					}
+				}
+
+				lock.lock();
+				m_busy = false;
+				m_idle.notify_all();
+			}
+		}
+
+		mutable std::mutex m_mutex;
+		std::condition_variable m_wake, m_idle;
+		std::deque<job> m_queue;
+		std::shared_ptr<void> m_spare;
+		const std::type_info *m_spare_type = nullptr;
+		statistics m_stats;
+		bool m_busy = false, m_stop = false;
+		std::thread m_thread;
 	};
 
 #pragma endregion
@@ -0,0 +1,782 @@
+#include <algorithm>  // std::min(), std::max()
+#include <exception>
+#include <cstring>    // std::memcpy(), std::memcmp(), std::memset()
+#include <cstdint>
+#include <bit>        // std::countr_zero(), std::countl_zero(), std::endian
+#include <cstddef>    // std::byte
+#include <type_traits> // std::integral_constant
+#include <limits>     // std::numeric_limits
+#include <utility>    // std::move()
+#include <memory>
+#include <vector>
+#include <array>
+#include <mutex>
+#include <span>
+
+export module p3.persistence.codec;
+/*
+	Persistence codec module, part of github/TeraFlint/pitrilib.
+	Daniel Wiegert (Pitri), 2021.
+*/
+
+export import p3.parallel;
+// import <algorithm>;  // std::min(), std::max()
+// import <exception>;
+// import <cstring>;    // std::memcpy(), std::memcmp(), std::memset()
+// import <cstdint>;
+// import <bit>;        // std::countr_zero(), std::countl_zero(), std::endian
+// import <cstddef>;    // std::byte
+// import <type_traits>; // std::integral_constant
+// import <limits>;     // std::numeric_limits
+// import <utility>;    // std::move()
+// import <memory>;
+// import <vector>;
+// import <array>;
+// import <mutex>;
+// import <span>;
+
+namespace p3
+{
+#pragma region block codec
+
+	export
+	class codec_error : public std::exception { using std::exception::exception; };
+
+	export
+	// stored in the file header. ids from 128 up are free for own codecs (register_codec()).
+	enum class codec_id : uint8_t
+	{
+		none = 0,      // blocks stored as they are.
+		lz = 1,        // lz77 with byte aligned tokens, for anything.
+		delta_rle = 2, // byte planes, deltas and run lengths, for numeric data (element_size = sizeof the numbers).
+	};
+
+	export
+	/*
+		compresses independent blocks. the element size is the one from codec_options, codecs may ignore it.
+		decompress() gets the exact size of the original block and returns false on corrupted input.
+		max_original_size() is what a compressed block can expand to at most, unlimited by default. headers asking for
+		more get rejected before anything is allocated.
+	*/
+	class block_codec
+	{
+	public:
+		virtual ~block_codec() = default;
+
+		virtual void compress(std::span<const std::byte> input, size_t element_size, std::vector<std::byte> &output) const = 0;
+		[[nodiscard]] virtual bool decompress(std::span<const std::byte> input, size_t element_size, std::span<std::byte> output) const = 0;
+
+		[[nodiscard]] virtual uint64_t max_original_size(size_t) const
+		{
+			return std::numeric_limits<uint64_t>::max();
+		}
+	};
+
+	export
+	struct codec_options
+	{
+		codec_id id = codec_id::none;
+
+		// size of the values in the payload, for the filters that look at them. has to be below 256.
+		size_t element_size = 1;
+
+		// bigger blocks compress a little better, smaller ones spread over more threads. rounded to whole elements.
+		size_t block_size = 1U << 20;
+
+		// one block per work item.
+		parallel_policy policy{ .threads = 0, .chunk_size = 1 };
+	};
+
+#pragma endregion
+#pragma region lz
+
+	namespace block_codecs
+	{
+		/*
+			lz4 style block format: a token (4 bit literal count, 4 bit match length - 4), more length bytes for 15
+			and above (adding up until one is below 255), the literals, then a 16 bit little endian match offset.
+			the last sequence is literals only. matches end at least 5 bytes before the end of the block.
+		*/
+		class lz_codec : public block_codec
+		{
+		public:
+			void compress(std::span<const std::byte> input, size_t, std::vector<std::byte> &output) const override
+			{
+				const uint8_t *data = reinterpret_cast<const uint8_t *>(input.data());
+				const size_t size = input.size();
+				output.resize(size + size / 255 + 16);
+				uint8_t *out = reinterpret_cast<uint8_t *>(output.data());
+
+				std::vector<uint32_t> table(size_t{ 1 } << hash_bits, 0);
+				const size_t limit = size > match_guard ? size - match_guard : 0;
+				size_t anchor = 0, position = 0;
+
+				while (position < limit)
+				{
+					const uint32_t sequence = load32(data + position);
+					const uint32_t hash = (sequence * 2654435761U) >> (32 - hash_bits);
+					const size_t candidate = table[hash];
+					table[hash] = static_cast<uint32_t>(position);
+
+					if (candidate >= position || position - candidate > max_offset || load32(data + candidate) != sequence)
+					{
+						// incompressible data gets skipped faster the longer it goes on.
+						position += 1 + ((position - anchor) >> 6);
+						continue;
+					}
+
+					const size_t length = match_length(data + candidate, data + position, data + size - last_literals);
+
+					out = write_sequence(out, data + anchor, position - anchor, position - candidate, length);
+					position += length;
+					anchor = position;
+
+					// one more table entry near the end of the match finds follow-up matches more often.
+					if (position < limit)
+					{
+						const size_t inside = position - 2;
+						table[(load32(data + inside) * 2654435761U) >> (32 - hash_bits)] = static_cast<uint32_t>(inside);
+					}
+				}
+
+				out = write_literals(out, data + anchor, size - anchor);
+				output.resize(static_cast<size_t>(out - reinterpret_cast<uint8_t *>(output.data())));
+			}
+
+			[[nodiscard]] bool decompress(std::span<const std::byte> input, size_t, std::span<std::byte> output) const override
+			{
+				const uint8_t *in = reinterpret_cast<const uint8_t *>(input.data()), *in_end = in + input.size();
+				uint8_t *out = reinterpret_cast<uint8_t *>(output.data()), *const out_begin = out, *const out_end = out + output.size();
+
+				while (in < in_end)
+				{
+					const uint8_t token = *in++;
+
+					size_t literals = token >> 4;
+					if (literals < 15 && in_end - in >= 16 && out_end - out >= 16)
+					{
+						// short literals: one fixed size copy, the extra bytes get overwritten later.
+						std::memcpy(out, in, 16);
+					}
+					else
+					{
+						if (literals == 15 && !read_length(in, in_end, literals))
+						{
+							return false;
+						}
+						if (static_cast<size_t>(in_end - in) < literals || static_cast<size_t>(out_end - out) < literals)
+						{
+							return false;
+						}
+						std::memcpy(out, in, literals);
+					}
+					in += literals;
+					out += literals;
+
+					// the last sequence has no match.
+					if (in == in_end)
+					{
+						break;
+					}
+
+					if (in_end - in < 2)
+					{
+						return false;
+					}
+					const size_t offset = static_cast<size_t>(in[0]) | static_cast<size_t>(in[1]) << 8;
+					in += 2;
+
+					size_t length = token & 0x0F;
+					if (length == 15 && !read_length(in, in_end, length))
+					{
+						return false;
+					}
+					length += min_match;
+					if (offset == 0 || offset > static_cast<size_t>(out - out_begin) || static_cast<size_t>(out_end - out) < length)
+					{
+						return false;
+					}
+
+					const uint8_t *match = out - offset;
+					if (offset >= 8 && static_cast<size_t>(out_end - out) >= length + 8)
+					{
+						// copies in steps of 8 bytes, which only ever read bytes written before.
+						for (size_t copied = 0; copied < length; copied += 8)
+						{
+							std::memcpy(out + copied, match + copied, 8);
+						}
+						out += length;
+					}
+					else if (offset >= length)
+					{
+						std::memcpy(out, match, length);
+						out += length;
+					}
+					else
+					{
+						// overlapping copies repeat the last offset bytes, byte by byte.
+						for (const uint8_t *const end = out + length; out < end;)
+						{
+							*out++ = *match++;
+						}
+					}
+				}
+				return out == out_end;
+			}
+
+			// every sequence spends at least one byte per literal, the matches get at most 255 bytes longer per length byte.
+			[[nodiscard]] uint64_t max_original_size(size_t stored) const override
+			{
+				return uint64_t{ 255 } * stored;
+			}
+
+		private:
+			static constexpr size_t hash_bits = 16, min_match = 4, last_literals = 5, match_guard = 12, max_offset = 65535;
+
+			[[nodiscard]] static uint32_t load32(const uint8_t *data)
+			{
+				uint32_t result;
+				std::memcpy(&result, data, sizeof(result));
+				return result;
+			}
+
+			[[nodiscard]] static uint64_t load64(const uint8_t *data)
+			{
+				uint64_t result;
+				std::memcpy(&result, data, sizeof(result));
+				return result;
+			}
+
+			// how many bytes match (at least min_match), comparing 8 at a time.
+			[[nodiscard]] static size_t match_length(const uint8_t *match, const uint8_t *current, const uint8_t *end)
+			{
+				const uint8_t *const start = current;
+				match += min_match;
+				current += min_match;
+				for (; current + 8 <= end; current += 8, match += 8)
+				{
+					if (const uint64_t difference = load64(current) ^ load64(match); difference != 0)
+					{
+						const int bits = std::endian::native == std::endian::little ? std::countr_zero(difference) : std::countl_zero(difference);
+						return static_cast<size_t>(current - start) + static_cast<size_t>(bits / 8);
+					}
+				}
+				while (current < end && *current == *match)
+				{
+					++current;
+					++match;
+				}
+				return static_cast<size_t>(current - start);
+			}
+
+			[[nodiscard]] static uint8_t *write_length(uint8_t *out, size_t length)
+			{
+				for (; length >= 255; length -= 255)
+				{
+					*out++ = 255;
+				}
+				*out++ = static_cast<uint8_t>(length);
+				return out;
+			}
+
+			[[nodiscard]] static bool read_length(const uint8_t *&in, const uint8_t *in_end, size_t &length)
+			{
+				for (uint8_t next = 255; next == 255; length += next)
+				{
+					if (in == in_end)
+					{
+						return false;
+					}
+					next = *in++;
+				}
+				return true;
+			}
+
+			[[nodiscard]] static uint8_t *write_literals(uint8_t *out, const uint8_t *literals, size_t count)
+			{
+				*out++ = static_cast<uint8_t>(std::min<size_t>(count, 15) << 4);
+				if (count >= 15)
+				{
+					out = write_length(out, count - 15);
+				}
+				std::memcpy(out, literals, count);
+				return out + count;
+			}
+
+			[[nodiscard]] static uint8_t *write_sequence(uint8_t *out, const uint8_t *literals, size_t count, size_t offset, size_t length)
+			{
+				uint8_t *token = out;
+				out = write_literals(out, literals, count);
+				*out++ = static_cast<uint8_t>(offset & 0xFF);
+				*out++ = static_cast<uint8_t>(offset >> 8);
+
+				const size_t extra = length - min_match;
+				*token = static_cast<uint8_t>(*token | std::min<size_t>(extra, 15));
+				return extra >= 15 ? write_length(out, extra - 15) : out;
+			}
+		};
+	}
+
+#pragma endregion
+#pragma region delta + rle
+
+	namespace block_codecs
+	{
+		/*
+			splits the elements into byte planes (all first bytes, then all second bytes, ...) and replaces each byte
+			by the difference to the one before it in its plane. slowly changing numbers turn into long runs of equal
+			bytes, the high planes mostly into zeros. the run length coding afterwards stores a control byte c:
+			below 128, c + 1 literal bytes follow. from 128 up, the next byte repeats c - 125 times (3 to 130).
+			bytes beyond the last whole element are kept as they are, behind the planes.
+		*/
+		class delta_rle_codec : public block_codec
+		{
+		public:
+			void compress(std::span<const std::byte> input, size_t element_size, std::vector<std::byte> &output) const override
+			{
+				const uint8_t *data = reinterpret_cast<const uint8_t *>(input.data());
+				const size_t size = input.size(), whole = size / element_size * element_size;
+
+				std::vector<uint8_t> filtered(size);
+				transpose(data, filtered.data(), element_size, size / element_size, true);
+				differences(filtered.data(), element_size, size / element_size);
+				std::memcpy(filtered.data() + whole, data + whole, size - whole);
+				encode_runs(filtered, output);
+			}
+
+			[[nodiscard]] bool decompress(std::span<const std::byte> input, size_t element_size, std::span<std::byte> output) const override
+			{
+				std::vector<uint8_t> filtered(output.size() + slack);
+				if (!decode_runs(input, std::span(filtered).first(output.size())))
+				{
+					return false;
+				}
+
+				uint8_t *data = reinterpret_cast<uint8_t *>(output.data());
+				const size_t size = output.size(), whole = size / element_size * element_size;
+				sums(filtered.data(), element_size, size / element_size);
+				transpose(filtered.data(), data, element_size, size / element_size, false);
+				std::memcpy(data + whole, filtered.data() + whole, size - whole);
+				return true;
+			}
+
+			// the longest run for two bytes.
+			[[nodiscard]] uint64_t max_original_size(size_t stored) const override
+			{
+				return stored / 2 * max_run;
+			}
+
+		private:
+			static constexpr size_t min_run = 3, max_run = 130, max_literals = 128;
+
+			// decode_runs() may write this many bytes past the end of its output, in fixed size copies.
+			static constexpr size_t slack = 16;
+
+			// each byte minus the one before it, plane by plane.
+			static void differences(uint8_t *planes, size_t element_size, size_t count)
+			{
+				for (size_t plane = 0; plane < element_size; ++plane)
+				{
+					uint8_t *values = planes + plane * count, previous = 0;
+					for (size_t index = 0; index < count; ++index)
+					{
+						const uint8_t value = values[index];
+						values[index] = static_cast<uint8_t>(value - previous);
+						previous = value;
+					}
+				}
+			}
+
+			// undoes differences().
+			static void sums(uint8_t *planes, size_t element_size, size_t count)
+			{
+				for (size_t plane = 0; plane < element_size; ++plane)
+				{
+					uint8_t *values = planes + plane * count, sum = 0;
+					for (size_t index = 0; index < count; ++index)
+					{
+						sum = static_cast<uint8_t>(sum + values[index]);
+						values[index] = sum;
+					}
+				}
+			}
+
+			// elements into byte planes (split) or back.
+			static void transpose(const uint8_t *source, uint8_t *target, size_t element_size, size_t count, bool split)
+			{
+				// everything the loops need as local values, byte stores could alias anything captured by reference.
+				const auto run = [source, target, element_size, count, split]<size_t size>(std::integral_constant<size_t, size>)
+				{
+					const size_t planes = size > 0 ? size : element_size;
+					if (split)
+					{
+						for (size_t index = 0; index < count; ++index)
+						{
+							for (size_t plane = 0; plane < planes; ++plane)
+							{
+								target[plane * count + index] = source[index * planes + plane];
+							}
+						}
+						return;
+					}
+					for (size_t index = 0; index < count; ++index)
+					{
+						for (size_t plane = 0; plane < planes; ++plane)
+						{
+							target[index * planes + plane] = source[plane * count + index];
+						}
+					}
+				};
+
+				switch (element_size)
+				{
+				case 1: std::memcpy(target, source, count); break;
+				case 2: run(std::integral_constant<size_t, 2>{}); break;
+				case 4: run(std::integral_constant<size_t, 4>{}); break;
+				case 8: run(std::integral_constant<size_t, 8>{}); break;
+				default: run(std::integral_constant<size_t, 0>{}); break;
+				}
+			}
+
+			// where the next three equal bytes start, or the size if there aren't any. looks at 8 positions at once.
+			[[nodiscard]] static size_t next_run(const uint8_t *data, size_t position, size_t size)
+			{
+				if constexpr (std::endian::native == std::endian::little)
+				{
+					constexpr uint64_t ones = 0x0101010101010101U, highs = 0x8080808080808080U;
+					for (; position + 10 <= size; position += 8)
+					{
+						uint64_t first, second, third;
+						std::memcpy(&first, data + position, 8);
+						std::memcpy(&second, data + position + 1, 8);
+						std::memcpy(&third, data + position + 2, 8);
+
+						// a zero byte marks a position equal to both of its followers. the lowest one is exact.
+						const uint64_t different = (first ^ second) | (first ^ third);
+						if (const uint64_t zeros = (different - ones) & ~different & highs; zeros != 0)
+						{
+							return position + static_cast<size_t>(std::countr_zero(zeros) / 8);
+						}
+					}
+				}
+				for (; position + 2 < size; ++position)
+				{
+					if (data[position] == data[position + 1] && data[position] == data[position + 2])
+					{
+						return position;
+					}
+				}
+				return size;
+			}
+
+			static void encode_runs(std::span<const uint8_t> input, std::vector<std::byte> &output)
+			{
+				// worst case: one control byte for every 128 literals.
+				output.resize(input.size() + input.size() / max_literals + 1);
+				uint8_t *out = reinterpret_cast<uint8_t *>(output.data());
+				const uint8_t *data = input.data();
+				const size_t size = input.size();
+
+				for (size_t position = 0; position < size;)
+				{
+					const size_t start = position;
+					position = next_run(data, position, size);
+					for (size_t literal = start; literal < position;)
+					{
+						const size_t amount = std::min(position - literal, max_literals);
+						*out++ = static_cast<uint8_t>(amount - 1);
+						std::memcpy(out, data + literal, amount);
+						out += amount;
+						literal += amount;
+					}
+					if (position == size)
+					{
+						break;
+					}
+
+					size_t run = min_run;
+					while (position + run < size && run < max_run && data[position + run] == data[position])
+					{
+						++run;
+					}
+					*out++ = static_cast<uint8_t>(run - min_run + max_literals);
+					*out++ = data[position];
+					position += run;
+				}
+				output.resize(static_cast<size_t>(out - reinterpret_cast<uint8_t *>(output.data())));
+			}
+
+			// the output needs room for slack more bytes behind it.
+			[[nodiscard]] static bool decode_runs(std::span<const std::byte> input, std::span<uint8_t> output)
+			{
+				const uint8_t *in = reinterpret_cast<const uint8_t *>(input.data()), *const in_end = in + input.size();
+				uint8_t *out = output.data(), *const out_end = out + output.size();
+
+				while (in < in_end)
+				{
+					const uint8_t control = *in++;
+					if (control < max_literals)
+					{
+						const size_t amount = control + 1U;
+						if (static_cast<size_t>(in_end - in) < amount || static_cast<size_t>(out_end - out) < amount)
+						{
+							return false;
+						}
+						if (amount <= slack && in_end - in >= static_cast<ptrdiff_t>(slack))
+						{
+							std::memcpy(out, in, slack);
+						}
+						else
+						{
+							std::memcpy(out, in, amount);
+						}
+						in += amount;
+						out += amount;
+					}
+					else
+					{
+						const size_t amount = control - max_literals + min_run;
+						if (in == in_end || static_cast<size_t>(out_end - out) < amount)
+						{
+							return false;
+						}
+						// 8 bytes at a time, at most 7 of them beyond the run.
+						const uint64_t pattern = *in++ * 0x0101010101010101U;
+						for (size_t filled = 0; filled < amount; filled += 8)
+						{
+							std::memcpy(out + filled, &pattern, 8);
+						}
+						out += amount;
+					}
+				}
+				return out == out_end;
+			}
+		};
+
+		struct codec_registry
+		{
+			std::mutex mutex;
+			std::array<std::shared_ptr<const block_codec>, 256> codecs;
+
+			codec_registry()
+			{
+				codecs[static_cast<size_t>(codec_id::lz)] = std::make_shared<lz_codec>();
+				codecs[static_cast<size_t>(codec_id::delta_rle)] = std::make_shared<delta_rle_codec>();
+			}
+		};
+
+		[[nodiscard]] codec_registry &registry()
+		{
+			static codec_registry instance;
+			return instance;
+		}
+	}
+
+	export
+	// adds or replaces a codec. none can't be replaced.
+	void register_codec(codec_id id, std::shared_ptr<const block_codec> codec)
+	{
+		if (id == codec_id::none)
+		{
+			throw codec_error("register_codec(): none is reserved for stored blocks.");
+		}
+		auto &registry = block_codecs::registry();
+		const std::lock_guard lock(registry.mutex);
+		registry.codecs[static_cast<size_t>(id)] = std::move(codec);
+	}
+
+	export
+	// nullptr for none and unknown codecs.
+	[[nodiscard]] std::shared_ptr<const block_codec> find_codec(codec_id id)
+	{
+		auto &registry = block_codecs::registry();
+		const std::lock_guard lock(registry.mutex);
+		return registry.codecs[static_cast<size_t>(id)];
+	}
+
+#pragma endregion
+#pragma region compressed container
+
+	/*
+		layout, integers in little endian:
+		- magic "p3cz", version (1 byte), codec id (1 byte), element size (1 byte), reserved (1 byte)
+		- original size (8 bytes), block size (4 bytes), block count (4 bytes)
+		- stored size of every block (4 bytes each). a block as big as its original is stored uncompressed.
+		- the blocks, one after another.
+	*/
+	namespace block_codecs
+	{
+		constexpr std::array<char, 4> magic{ 'p', '3', 'c', 'z' };
+		constexpr uint8_t version = 1;
+
+		void write_le(std::byte *target, uint64_t value, size_t size)
+		{
+			for (size_t index = 0; index < size; ++index, value >>= 8)
+			{
+				target[index] = static_cast<std::byte>(value & 0xFF);
+			}
+		}
+
+		[[nodiscard]] uint64_t read_le(const std::byte *source, size_t size)
+		{
+			uint64_t result = 0;
+			for (size_t index = size; index-- > 0;)
+			{
+				result = result << 8 | static_cast<uint8_t>(source[index]);
+			}
+			return result;
+		}
+	}
+
+	export
+	// everything up to the table of block sizes.
+	constexpr size_t compressed_header_size = 24;
+
+	export
+	// true if the bytes start like the header of compress(), even if the rest of it is missing or from another version.
+	[[nodiscard]] bool has_compressed_magic(std::span<const std::byte> bytes)
+	{
+		return bytes.size() >= block_codecs::magic.size() && std::memcmp(bytes.data(), block_codecs::magic.data(), block_codecs::magic.size()) == 0;
+	}
+
+	export
+	// true if the bytes start with the header of compress().
+	[[nodiscard]] bool is_compressed(std::span<const std::byte> bytes)
+	{
+		return bytes.size() >= compressed_header_size && has_compressed_magic(bytes) && static_cast<uint8_t>(bytes[4]) == block_codecs::version;
+	}
+
+	export
+	// the header of compress() is the only thing the other side needs to know.
+	[[nodiscard]] std::vector<std::byte> compress(std::span<const std::byte> input, const codec_options &options)
+	{
+		if (options.element_size == 0 || options.element_size > 255)
+		{
+			throw codec_error("compress(): the element size has to be between 1 and 255.");
+		}
+		const auto codec = find_codec(options.id);
+		if (!codec && options.id != codec_id::none)
+		{
+			throw codec_error("compress(): unknown codec.");
+		}
+
+		const size_t block_size = std::max(std::min<size_t>(options.block_size, UINT32_MAX) / options.element_size, size_t{ 1 }) * options.element_size;
+		const size_t block_count = (input.size() + block_size - 1) / block_size;
+		if (block_count > UINT32_MAX)
+		{
+			throw codec_error("compress(): too many blocks, the block size is too small.");
+		}
+
+		std::vector<std::vector<std::byte>> blocks(block_count);
+		parallel_for(block_count, options.policy, [&](size_t begin, size_t end)
+		{
+			for (size_t block = begin; block < end; ++block)
+			{
+				const auto original = input.subspan(block * block_size, std::min(block_size, input.size() - block * block_size));
+				if (codec)
+				{
+					codec->compress(original, options.element_size, blocks[block]);
+				}
+				// no gain (or no codec): the block gets stored as it is.
+				if (!codec || blocks[block].size() >= original.size())
+				{
+					blocks[block].assign(original.begin(), original.end());
+				}
+			}
+		});
+
+		size_t total = compressed_header_size + 4 * block_count;
+		for (const auto &block : blocks)
+		{
+			total += block.size();
+		}
+
+		std::vector<std::byte> result(total);
+		std::memcpy(result.data(), block_codecs::magic.data(), block_codecs::magic.size());
+		result[4] = static_cast<std::byte>(block_codecs::version);
+		result[5] = static_cast<std::byte>(options.id);
+		result[6] = static_cast<std::byte>(options.element_size);
+		block_codecs::write_le(result.data() + 8, input.size(), 8);
+		block_codecs::write_le(result.data() + 16, block_size, 4);
+		block_codecs::write_le(result.data() + 20, block_count, 4);
+
+		std::byte *table = result.data() + compressed_header_size, *target = table + 4 * block_count;
+		for (size_t block = 0; block < block_count; ++block)
+		{
+			block_codecs::write_le(table + 4 * block, blocks[block].size(), 4);
+			std::memcpy(target, blocks[block].data(), blocks[block].size());
+			target += blocks[block].size();
+		}
+		return result;
+	}
+
+	export
+	[[nodiscard]] std::vector<std::byte> decompress(std::span<const std::byte> input, const parallel_policy &policy = { .threads = 0, .chunk_size = 1 })
+	{
+		if (!is_compressed(input))
+		{
+			throw codec_error("decompress(): no compressed data.");
+		}
+
+		const auto id = static_cast<codec_id>(input[5]);
+		const size_t element_size = static_cast<uint8_t>(input[6]);
+		const uint64_t size = block_codecs::read_le(input.data() + 8, 8);
+		const size_t block_size = block_codecs::read_le(input.data() + 16, 4), block_count = block_codecs::read_le(input.data() + 20, 4);
+
+		const auto codec = find_codec(id);
+		if (!codec && id != codec_id::none)
+		{
+			throw codec_error("decompress(): unknown codec.");
+		}
+		if (element_size == 0 || block_size == 0 || block_count != size / block_size + (size % block_size != 0) || (input.size() - compressed_header_size) / 4 < block_count)
+		{
+			throw codec_error("decompress(): corrupted header.");
+		}
+
+		/*
+			where every block starts, checked against the input size. the original size in the header isn't trusted
+			either: every block has to be able to expand to its part of it, before the result gets allocated.
+		*/
+		std::vector<size_t> offsets(block_count + 1, compressed_header_size + 4 * block_count);
+		for (size_t block = 0; block < block_count; ++block)
+		{
+			const size_t stored = block_codecs::read_le(input.data() + compressed_header_size + 4 * block, 4);
+			offsets[block + 1] = offsets[block] + stored;
+			if (offsets[block + 1] > input.size())
+			{
+				throw codec_error("decompress(): truncated data.");
+			}
+
+			// compress() stores blocks without any gain as they are.
+			const uint64_t original = std::min<uint64_t>(block_size, size - block * block_size);
+			if (stored != original)
+			{
+				if (!codec || stored > original || original > codec->max_original_size(stored))
+				{
+					throw codec_error("decompress(): corrupted block size.");
+				}
+			}
+		}
+
+		std::vector<std::byte> result(static_cast<size_t>(size));
+		parallel_for(block_count, policy, [&](size_t begin, size_t end)
+		{
+			for (size_t block = begin; block < end; ++block)
+			{
+				const auto stored = input.subspan(offsets[block], offsets[block + 1] - offsets[block]);
+				const auto original = std::span(result).subspan(block * block_size, std::min<size_t>(block_size, result.size() - block * block_size));
+				if (stored.size() == original.size())
+				{
+					std::memcpy(original.data(), stored.data(), stored.size());
+				}
+				else if (!codec || !codec->decompress(stored, element_size, original))
+				{
+					throw codec_error("decompress(): corrupted block.");
+				}
+			}
+		});
+		return result;
+	}
+
+#pragma endregion
+}
@@ -1,4 +1,17 @@
 #pragma once
 #include "grid_test.hpp"
+#include "grid_automaton_test.hpp"
+#include "grid_binary_test.hpp"
+#include "grid_chunked_test.hpp"
+#include "grid_compressed_test.hpp"
+#include "grid_delta_test.hpp"
+#include "grid_fixed_test.hpp"
+#include "grid_paged_test.hpp"
+#include "grid_expression_test.hpp"
+#include "grid_sparse_test.hpp"
+#include "grid_stencil_test.hpp"
+#include "grid_tracked_test.hpp"
+#include "image_test.hpp"
+#include "parallel_test.hpp"
 #include "persistence_test.hpp"
 #include "meta_list_test.hpp"
@@ -0,0 +1,141 @@
+#pragma once
+#include "../unit_test.hpp"
+#include <cstdint>
+#include <cstddef>
+
+import p3.grid.automaton;
+
+#pragma region helper functions
+
+namespace grid_automaton_test
+{
+	// straightforward reference: one generation, every neighbor resolved on its own.
+	template <typename data_type, size_t dimensions, typename rule_type>
+	p3::grid<data_type, dimensions> naive_step(const p3::grid<data_type, dimensions> &source, p3::neighborhood shape, size_t radius,
+		const p3::stencil_boundary<data_type> &boundary, rule_type &&rule)
+	{
+		using mode = typename p3::stencil_boundary<data_type>::mode;
+
+		p3::grid_size<dimensions> span{};
+		for (size_t axis = 0; axis < dimensions; ++axis)
+		{
+			span[axis] = 2 * radius + 1;
+		}
+
+		return p3::grid<data_type, dimensions>(source.dim(), [&](const auto &pos)
+		{
+			int sum = 0;
+			for (p3::grid_pos<dimensions> offset{ span }; offset.valid(); ++offset)
+			{
+				p3::grid_size<dimensions> neighbor{};
+				size_t distance = 0;
+				bool outside = false;
+				for (size_t axis = 0; axis < dimensions; ++axis)
+				{
+					const auto delta = static_cast<std::ptrdiff_t>(offset.pos_at(axis)) - static_cast<std::ptrdiff_t>(radius);
+					distance += delta < 0 ? -delta : delta;
+
+					const auto size = static_cast<std::ptrdiff_t>(source.dim_at(axis));
+					auto coord = static_cast<std::ptrdiff_t>(pos.pos_at(axis)) + delta;
+					if (coord < 0 || coord >= size)
+					{
+						outside = outside || boundary.get_mode() == mode::constant;
+						coord = boundary.get_mode() == mode::wrap ? (coord % size + size) % size : std::clamp<std::ptrdiff_t>(coord, 0, size - 1);
+					}
+					neighbor[axis] = coord;
+				}
+
+				if (distance > 0 && (shape == p3::neighborhood::moore || distance <= radius))
+				{
+					sum += outside ? boundary.value() : source.at(neighbor);
+				}
+			}
+			return static_cast<data_type>(rule(source.at(pos.pos()), sum));
+		});
+	}
+
+	template <size_t dimensions>
+	p3::grid<std::uint8_t, dimensions> noise(const p3::grid_size<dimensions> &size, size_t density)
+	{
+		return p3::grid<std::uint8_t, dimensions>(size, [=](const auto &pos) { return static_cast<std::uint8_t>((pos.index() * 2654435761U >> 7) % 100 < density); });
+	}
+}
+
+#pragma endregion
+#pragma region automaton
+
+P3_UNIT_TEST(automaton_matches_reference)
+{
+	using boundary = p3::stencil_boundary<std::uint8_t>;
+	const auto life = p3::automaton_rule::game_of_life();
+
+	// sizes chosen so the last tiles are narrower than the rest.
+	p3::grid<std::uint8_t, 2> expected = grid_automaton_test::noise<2>({ 71, 45 }, 35);
+	p3::automaton<std::uint8_t, 2> serial(expected, p3::neighborhood::moore, 1, boundary::wrap());
+	p3::automaton<std::uint8_t, 2> parallel(expected, p3::neighborhood::moore, 1, boundary::wrap());
+
+	for (size_t generation = 1; generation <= 12; ++generation)
+	{
+		expected = grid_automaton_test::naive_step(expected, p3::neighborhood::moore, 1, boundary::wrap(), life);
+		serial.step(life);
+		parallel.step(life, { .threads = 3, .chunk_size = 32 * 45 });
+
+		grid_test::assert_equal_grids(expected, serial.state(), std::format("automaton: game of life, generation {}", generation));
+		grid_test::assert_equal_grids(expected, parallel.state(), std::format("automaton: parallel game of life, generation {}", generation));
+	}
+	unit_test::assert_equals<size_t>(12, serial.generation(), "automaton::generation()");
+
+	// a bigger, three dimensional neighborhood with a radius crossing the narrow tiles.
+	const auto majority = [](std::uint8_t cell, int sum) { return static_cast<std::uint8_t>(sum > 12 || (cell && sum > 9)); };
+	for (const auto &edges : { boundary::wrap(), boundary::clamp(), boundary::constant(1) })
+	{
+		const auto name = std::format("automaton: 3d von neumann, boundary mode {}", static_cast<int>(edges.get_mode()));
+		p3::grid<std::uint8_t, 3> volume = grid_automaton_test::noise<3>({ 34, 9, 35 }, 50);
+		p3::automaton<std::uint8_t, 3> engine(volume, p3::neighborhood::von_neumann, 3, edges);
+		unit_test::assert_equals<size_t>(62, engine.neighbors(), name + ": neighbor count");
+
+		for (size_t generation = 0; generation < 4; ++generation)
+		{
+			volume = grid_automaton_test::naive_step(volume, p3::neighborhood::von_neumann, 3, edges, majority);
+			engine.step(majority, { .threads = 2, .chunk_size = 1 });
+			grid_test::assert_equal_grids(volume, engine.state(), name);
+		}
+	}
+}
+
+P3_UNIT_TEST(automaton_tile_skipping)
+{
+	// a glider in the corner of an otherwise empty plane.
+	p3::grid<std::uint8_t, 2> plane({ 256, 256 });
+	for (const auto &cell : { p3::grid_size<2>{ 1, 2 }, p3::grid_size<2>{ 2, 3 }, p3::grid_size<2>{ 3, 1 }, p3::grid_size<2>{ 3, 2 }, p3::grid_size<2>{ 3, 3 } })
+	{
+		plane.at(cell) = 1;
+	}
+
+	const auto life = p3::automaton_rule::game_of_life();
+	p3::automaton<std::uint8_t, 2> engine(plane, p3::neighborhood::moore, 1, p3::stencil_boundary<std::uint8_t>::wrap());
+	unit_test::assert_equals<size_t>(64, engine.tile_count(), "automaton::tile_count()");
+
+	engine.step(life);
+	unit_test::assert_equals<size_t>(64, engine.tiles_computed(), "automaton: the first step computes everything");
+
+	// from now on, only the glider's tile and its (wrapped) neighbors are worth looking at.
+	for (size_t generation = 1; generation < 8; ++generation)
+	{
+		engine.step(life);
+		plane = grid_automaton_test::naive_step(plane, p3::neighborhood::moore, 1, p3::stencil_boundary<std::uint8_t>::wrap(), life);
+		unit_test::assert_equals(true, engine.tiles_computed() <= 9, std::format("automaton: computed tiles in generation {}", generation + 1));
+	}
+	plane = grid_automaton_test::naive_step(plane, p3::neighborhood::moore, 1, p3::stencil_boundary<std::uint8_t>::wrap(), life);
+	grid_test::assert_equal_grids(plane, engine.state(), "automaton: glider after skipping tiles");
+
+	// a still life stops all the work.
+	p3::grid<std::uint8_t, 2> block({ 100, 100 });
+	block.at({ 50, 50 }) = block.at({ 50, 51 }) = block.at({ 51, 50 }) = block.at({ 51, 51 }) = 1;
+	engine.reset(block);
+	engine.run(2, life);
+	unit_test::assert_equals<size_t>(0, engine.tiles_computed(), "automaton: still life");
+	grid_test::assert_equal_grids(block, engine.state(), "automaton: still life state");
+}
+
+#pragma endregion
\ No newline at end of file
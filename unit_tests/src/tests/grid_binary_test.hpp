@@ -0,0 +1,232 @@
+#pragma once
+#include "../unit_test.hpp"
+#include <filesystem>
+#include <algorithm>
+#include <sstream>
+#include <fstream>
+#include <utility>
+#include <cstring>
+#include <cstdint>
+
+import p3.grid.binary;
+
+#pragma region helper functions
+
+namespace grid_binary_test
+{
+	template <typename exception_type, typename function_type>
+	bool throws(function_type &&function)
+	{
+		try
+		{
+			function();
+		}
+		catch (const exception_type &)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	template <typename data_type, size_t dimensions>
+	bool read_fails(const std::string &bytes)
+	{
+		std::stringstream stream(bytes);
+		return throws<p3::binary_grid_error>([&]() { const auto grid = p3::read_binary<data_type, dimensions>(stream); });
+	}
+
+	// hands out the bytes of a string, like a pipe that can't seek.
+	struct forward_only_buffer : std::streambuf
+	{
+		std::string bytes;
+
+		explicit forward_only_buffer(std::string content)
+			: bytes{ std::move(content) }
+		{
+			setg(bytes.data(), bytes.data(), bytes.data() + bytes.size());
+		}
+	};
+
+	// removes the file at the end of the test, even if it fails.
+	struct temporary_file
+	{
+		std::filesystem::path location;
+
+		explicit temporary_file(const std::string &name)
+			: location{ std::filesystem::temp_directory_path() / name }
+		{
+		}
+
+		~temporary_file()
+		{
+			std::error_code error;
+			std::filesystem::remove(location, error);
+		}
+	};
+}
+
+#pragma endregion
+#pragma region binary grid
+
+P3_UNIT_TEST(grid_binary_roundtrip)
+{
+	const p3::grid<float, 3> source({ 3, 4, 5 }, [](const auto &pos) { return pos.index() * 0.5f; });
+	std::stringstream stream;
+	p3::write_binary(stream, source);
+
+	unit_test::assert_equals<size_t>(64 + source.size() * sizeof(float), stream.str().size(), "write_binary(): file size");
+	grid_test::assert_equal_grids(source, p3::read_binary<float, 3>(stream), "read_binary()");
+
+	grid_binary_test::forward_only_buffer pipe_buffer(stream.str());
+	std::istream pipe(&pipe_buffer);
+	grid_test::assert_equal_grids(source, p3::read_binary<float, 3>(pipe), "read_binary(): stream without seeking");
+
+	// other layouts get stored in row-major order as well.
+	const p3::grid<int16_t, 2, p3::grid_layout::morton> morton({ 5, 3 }, &p3::grid_gen::ascending<2>);
+	std::stringstream morton_stream;
+	p3::write_binary(morton_stream, morton);
+	const auto loaded = p3::read_binary<int16_t, 2>(morton_stream);
+	loaded.iterate([](const auto &pos, const auto &val)
+	{
+		unit_test::assert_equals<int>(static_cast<int>(pos.index()), val, "read_binary(): morton grid");
+	});
+}
+
+P3_UNIT_TEST(grid_binary_byte_buffers)
+{
+	const p3::grid<double, 2> source({ 7, 9 }, [](const auto &pos) { return pos.index() * 0.25; });
+	p3::byte_writer writer;
+	p3::write_binary(writer, source);
+
+	// header in the own buffer, the elements stay where they are.
+	const auto segments = writer.segments();
+	unit_test::assert_equals<size_t>(2, segments.size(), "write_binary(byte_writer): segments");
+	unit_test::assert_equals(true, static_cast<const void *>(segments[1].data()) == source.data(), "write_binary(byte_writer): elements copied");
+	unit_test::assert_equals<size_t>(64 + source.size() * sizeof(double), writer.size(), "write_binary(byte_writer): size");
+
+	// the same bytes as the stream version.
+	std::stringstream stream;
+	p3::write_binary(stream, source);
+	const std::string expected = stream.str();
+	const auto bytes = writer.take();
+	unit_test::assert_equals(true, bytes.size() == expected.size() && std::memcmp(bytes.data(), expected.data(), bytes.size()) == 0, "write_binary(byte_writer): content");
+
+	p3::byte_reader reader(bytes);
+	grid_test::assert_equal_grids(source, p3::read_binary<double, 2>(reader), "read_binary(byte_reader)");
+	unit_test::assert_equals<size_t>(0, reader.remaining(), "read_binary(byte_reader): remaining");
+
+	p3::byte_reader truncated{ std::span(bytes).first(bytes.size() - 1) };
+	unit_test::assert_equals(true, grid_binary_test::throws<p3::binary_grid_error>([&]() { (void)p3::read_binary<double, 2>(truncated); }), "read_binary(byte_reader): truncated");
+}
+
+P3_UNIT_TEST(grid_binary_mismatch)
+{
+	std::stringstream stream;
+	p3::write_binary(stream, p3::grid<int32_t, 2>({ 2, 2 }));
+	const std::string bytes = stream.str();
+
+	unit_test::assert_equals(false, grid_binary_test::read_fails<int32_t, 2>(bytes), "read_binary(): matching type");
+	unit_test::assert_equals(true, grid_binary_test::read_fails<int32_t, 3>(bytes), "read_binary(): rank mismatch");
+	unit_test::assert_equals(true, grid_binary_test::read_fails<uint32_t, 2>(bytes), "read_binary(): signedness mismatch");
+	unit_test::assert_equals(true, grid_binary_test::read_fails<float, 2>(bytes), "read_binary(): kind mismatch");
+	unit_test::assert_equals(true, grid_binary_test::read_fails<int32_t, 2>(bytes.substr(0, bytes.size() - 1)), "read_binary(): truncated data");
+	unit_test::assert_equals(true, grid_binary_test::read_fails<int32_t, 2>("definitely not a grid file, but long enough for the header"), "read_binary(): no grid file");
+
+	// corrupted headers must not turn into huge allocations.
+	const auto patched = [&](size_t offset, auto value)
+	{
+		std::string result = bytes;
+		std::memcpy(result.data() + offset, &value, sizeof(value));
+		return result;
+	};
+	unit_test::assert_equals(true, grid_binary_test::read_fails<int32_t, 2>(patched(16, uint64_t{ 1 } << 60)), "read_binary(): data offset");
+	unit_test::assert_equals(true, grid_binary_test::read_fails<int32_t, 2>(patched(12, 0xFFFFFFF0U)), "read_binary(): rank");
+	unit_test::assert_equals(true, grid_binary_test::read_fails<int32_t, 2>(patched(24, uint64_t{ 1 } << 62)), "read_binary(): element count overflow");
+	const std::string oversized = patched(24, uint64_t{ 1 } << 40);
+	p3::byte_reader reader(std::as_bytes(std::span(oversized)));
+	unit_test::assert_equals(true, grid_binary_test::throws<p3::binary_grid_error>([&]() { (void)p3::read_binary<int32_t, 2>(reader); }), "read_binary(byte_reader): more elements than bytes");
+
+	// a bare header claiming 16 GiB of elements, through every stream kind.
+	std::stringstream empty;
+	p3::write_binary(empty, p3::grid<int32_t, 2>({ 0, 0 }));
+	std::string huge = empty.str();
+	const uint64_t extent = uint64_t{ 1 } << 16;
+	std::memcpy(huge.data() + 24, &extent, sizeof(extent));
+	std::memcpy(huge.data() + 32, &extent, sizeof(extent));
+	unit_test::assert_equals(true, grid_binary_test::read_fails<int32_t, 2>(huge), "read_binary(istream): more elements than bytes");
+
+	grid_binary_test::forward_only_buffer pipe_buffer(huge);
+	std::istream pipe(&pipe_buffer);
+	unit_test::assert_equals(true, grid_binary_test::throws<p3::binary_grid_error>([&]() { (void)p3::read_binary<int32_t, 2>(pipe); }), "read_binary(istream): more elements than bytes, not seekable");
+
+	const grid_binary_test::temporary_file file("p3_grid_binary_huge_test.p3grid");
+	std::ofstream(file.location, std::ios::binary).write(huge.data(), huge.size());
+	unit_test::assert_equals(true, grid_binary_test::throws<p3::binary_grid_error>([&]() { (void)p3::load_binary<int32_t, 2>(file.location); }), "load_binary(): more elements than bytes");
+}
+
+P3_UNIT_TEST(grid_binary_byte_order)
+{
+	const p3::grid<uint32_t, 2> source({ 2, 3 }, { 0x01020304, 0xAABBCCDD, 7, 8, 9, 10 });
+	std::stringstream stream;
+	p3::write_binary(stream, source);
+	std::string bytes = stream.str();
+
+	// pretend the file came from a machine of the other byte order: swap every number.
+	const auto swap = [&](size_t offset, size_t size) { std::reverse(bytes.begin() + offset, bytes.begin() + offset + size); };
+	swap(8, 2);
+	swap(12, 4);
+	swap(16, 8);
+	swap(24, 8);
+	swap(32, 8);
+	for (size_t index = 0; index < source.size(); ++index)
+	{
+		swap(64 + index * 4, 4);
+	}
+
+	std::stringstream foreign(bytes);
+	grid_test::assert_equal_grids(source, p3::read_binary<uint32_t, 2>(foreign), "read_binary(): foreign byte order");
+}
+
+P3_UNIT_TEST(mapped_grid_access)
+{
+	const grid_binary_test::temporary_file file("p3_mapped_grid_test.p3grid");
+	const p3::grid<double, 3> source({ 4, 5, 6 }, [](const auto &pos) { return pos.index() * 0.25; });
+	p3::save_binary(file.location, source);
+
+	{
+		const p3::mapped_grid<double, 3> mapped(file.location);
+		unit_test::assert_equals(true, mapped.dim() == source.dim(), "mapped_grid::dim()");
+		unit_test::assert_equals<double>(source.at({ 3, 2, 1 }), mapped.at({ 3, 2, 1 }), "mapped_grid::at()");
+		grid_test::assert_equal_grids(source, mapped.to_grid(), "mapped_grid::to_grid()");
+
+		p3::mapped_grid<double, 3> read_only(file.location);
+		unit_test::assert_equals(true, grid_binary_test::throws<p3::binary_grid_error>([&]() { read_only.at({ 0, 0, 0 }) = 1; }), "mapped_grid: writing a read-only mapping");
+	}
+
+	{
+		// copy-on-write: the changes stay in memory.
+		p3::mapped_grid<double, 3> mapped(file.location, p3::map_mode::copy_on_write);
+		mapped.at({ 1, 1, 1 }) = -1.0;
+		mapped.view().subgrid(0).iterate([](const auto &pos, auto &val) { val = 42.0; });
+		unit_test::assert_equals<double>(-1.0, mapped.at({ 1, 1, 1 }), "mapped_grid: copy-on-write");
+		unit_test::assert_equals<double>(42.0, mapped.at({ 0, 4, 5 }), "mapped_grid: copy-on-write view");
+	}
+	grid_test::assert_equal_grids(source, p3::load_binary<double, 3>(file.location), "mapped_grid: copy-on-write changed the file");
+
+	unit_test::assert_equals(true, grid_binary_test::throws<p3::binary_grid_error>([&]() { p3::mapped_grid<float, 3> wrong(file.location); }), "mapped_grid: type mismatch");
+	unit_test::assert_equals(true, grid_binary_test::throws<p3::binary_grid_error>([&]() { p3::mapped_grid<double, 3> missing(file.location.string() + ".missing"); }), "mapped_grid: missing file");
+
+	// a valid file for read_binary(), but its elements would start in the middle of a double.
+	std::stringstream stream;
+	p3::write_binary(stream, source);
+	std::string shifted = stream.str();
+	const uint64_t offset = 68;
+	std::memcpy(shifted.data() + 16, &offset, sizeof(offset));
+	shifted.insert(64, 4, '\0');
+	std::stringstream shifted_stream(shifted);
+	grid_test::assert_equal_grids(source, p3::read_binary<double, 3>(shifted_stream), "read_binary(): unaligned data offset");
+	std::ofstream(file.location, std::ios::binary | std::ios::trunc).write(shifted.data(), shifted.size());
+	unit_test::assert_equals(true, grid_binary_test::throws<p3::binary_grid_error>([&]() { p3::mapped_grid<double, 3> misaligned(file.location); }), "mapped_grid: unaligned data offset");
+}
+
+#pragma endregion
\ No newline at end of file
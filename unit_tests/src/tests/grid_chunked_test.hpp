@@ -0,0 +1,165 @@
+#pragma once
+#include "../unit_test.hpp"
+#include <filesystem>
+#include <sstream>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <span>
+
+import p3.grid.chunked;
+
+#pragma region helper functions
+
+namespace grid_chunked_test
+{
+	// mostly noise, with an empty band that ends up in uniform chunks.
+	inline p3::grid<int32_t, 3> volume()
+	{
+		return p3::grid<int32_t, 3>({ 11, 17, 23 }, [](const auto &pos)
+		{
+			return pos.pos_at(1) >= 8 && pos.pos_at(1) < 12 ? 0 : static_cast<int32_t>(pos.index() * 2654435761U >> 7);
+		});
+	}
+
+	template <size_t dimensions>
+	p3::grid<int32_t, dimensions> cut(const p3::grid<int32_t, dimensions> &source, const p3::grid_box<dimensions> &box)
+	{
+		return p3::grid<int32_t, dimensions>(source.view().region(box));
+	}
+}
+
+#pragma endregion
+#pragma region chunked grid
+
+P3_UNIT_TEST(grid_chunked_crc32)
+{
+	const std::string text = "123456789";
+	const auto bytes = std::as_bytes(std::span(text.data(), text.size()));
+	unit_test::assert_equals<uint32_t>(0xCBF43926U, p3::crc32(bytes), "crc32(): check value");
+	unit_test::assert_equals<uint32_t>(0xCBF43926U, p3::crc32(bytes.subspan(5), p3::crc32(bytes.first(5))), "crc32(): continued");
+	unit_test::assert_equals<uint32_t>(0, p3::crc32({}), "crc32(): nothing");
+}
+
+P3_UNIT_TEST(grid_chunked_roundtrip)
+{
+	const auto source = grid_chunked_test::volume();
+	p3::chunked_grid_file<int32_t, 3> container(source, { 4, 4, 8 });
+
+	std::stringstream stream;
+	container.write(stream);
+
+	p3::chunked_grid_file<int32_t, 3> loaded({ 1, 1, 1 });
+	loaded.read(stream);
+	grid_test::assert_equal_grids(source, loaded.content(), "chunked_grid_file: stream roundtrip");
+	unit_test::assert_equals(true, loaded.chunk_dim() == p3::grid_size<3>{ 4, 4, 8 }, "chunked_grid_file::chunk_dim()");
+	unit_test::assert_equals<size_t>(3 * 5 * 3, loaded.stats().chunks_read, "chunked_grid_file::stats(): chunks");
+
+	// uniform chunks only store a single element.
+	const size_t raw_bytes = source.size() * sizeof(int32_t);
+	unit_test::assert_equals(true, loaded.stats().bytes_read < raw_bytes, "chunked_grid_file: uniform chunks");
+
+	const grid_binary_test::temporary_file file("p3_chunked_test.p3chunk");
+	container.save(file.location);
+	loaded.load(file.location);
+	grid_test::assert_equal_grids(source, loaded.content(), "chunked_grid_file: file roundtrip");
+}
+
+P3_UNIT_TEST(grid_chunked_region)
+{
+	const auto source = grid_chunked_test::volume();
+	const grid_binary_test::temporary_file file("p3_chunked_region_test.p3chunk");
+	p3::chunked_grid_file<int32_t, 3>(source, { 4, 4, 8 }).save(file.location);
+
+	p3::chunked_grid_file<int32_t, 3> slab({ 1, 1, 1 });
+	for (const auto &box : { p3::grid_box<3>{ { 5, 0, 0 }, { 6, 17, 23 } }, p3::grid_box<3>{ { 3, 7, 7 }, { 9, 13, 17 } }, p3::grid_box<3>{ { 0, 0, 0 }, { 11, 17, 23 } } })
+	{
+		slab.reset_stats();
+		slab.load_region(file.location, box.low, box.high);
+		grid_test::assert_equal_grids(grid_chunked_test::cut(source, box), slab.content(), "chunked_grid_file::load_region()");
+		unit_test::assert_equals(true, slab.region() == box, "chunked_grid_file::region()");
+		unit_test::assert_equals(true, slab.file_dim() == source.dim(), "chunked_grid_file::file_dim()");
+	}
+
+	// a single layer only touches one layer of chunks.
+	slab.reset_stats();
+	slab.load_region(file.location, { 5, 0, 0 }, { 6, 17, 23 });
+	unit_test::assert_equals<size_t>(5 * 3, slab.stats().chunks_read, "chunked_grid_file::load_region(): chunks read");
+
+	slab.load_region(file.location, { 2, 2, 2 }, { 2, 2, 2 });
+	unit_test::assert_equals<size_t>(0, slab.content().size(), "chunked_grid_file::load_region(): empty region");
+
+	const bool outside = grid_binary_test::throws<p3::binary_grid_error>([&]() { slab.load_region(file.location, { 0, 0, 0 }, { 12, 1, 1 }); });
+	unit_test::assert_equals(true, outside, "chunked_grid_file::load_region(): region outside of the grid");
+}
+
+P3_UNIT_TEST(grid_chunked_corruption)
+{
+	const p3::grid<int32_t, 2> source({ 16, 16 }, &p3::grid_gen::ascending<2>);
+	std::stringstream stream;
+	p3::chunked_grid_file<int32_t, 2>(source, { 8, 8 }).write(stream);
+
+	// flips a bit inside of the last chunk (rows 8 to 15, columns 8 to 15).
+	std::string bytes = stream.str();
+	const size_t header = 64, chunk = 8 * 8 * sizeof(int32_t);
+	bytes[header + 3 * chunk + 17] ^= 0x10;
+
+	p3::chunked_grid_file<int32_t, 2> loaded({ 1, 1 });
+	std::stringstream corrupted(bytes);
+	loaded.read_region(corrupted, { { 0, 0 }, { 8, 16 } });
+	grid_test::assert_equal_grids(grid_chunked_test::cut(source, { { 0, 0 }, { 8, 16 } }), loaded.content(), "chunked_grid_file: intact chunks");
+
+	corrupted.seekg(0);
+	const bool detected = grid_binary_test::throws<p3::binary_grid_error>([&]() { loaded.read_region(corrupted, { { 8, 8 }, { 9, 9 } }); });
+	unit_test::assert_equals(true, detected, "chunked_grid_file: corrupted chunk");
+
+	std::stringstream wrong_type(stream.str());
+	p3::chunked_grid_file<float, 2> floats({ 1, 1 });
+	const bool mismatch = grid_binary_test::throws<p3::binary_grid_error>([&]() { floats.read_region(wrong_type, { { 0, 0 }, { 1, 1 } }); });
+	unit_test::assert_equals(true, mismatch, "chunked_grid_file: element type mismatch");
+}
+
+P3_UNIT_TEST(grid_chunked_corrupted_sizes)
+{
+	const p3::grid<int32_t, 2> source({ 16, 16 }, &p3::grid_gen::ascending<2>);
+	std::stringstream stream;
+	p3::chunked_grid_file<int32_t, 2>(source, { 8, 8 }).write(stream);
+	const std::string bytes = stream.str();
+
+	// header (64 bytes), four chunks of 256 bytes, then the index: 24 bytes per entry and the checksum.
+	const size_t index = 64 + 4 * 256, checksum = index + 4 * 24;
+	const auto fails = [](const std::string &file)
+	{
+		std::stringstream input(file);
+		p3::chunked_grid_file<int32_t, 2> loaded({ 1, 1 });
+		return grid_binary_test::throws<p3::binary_grid_error>([&]() { loaded.read(input); });
+	};
+	const auto patched = [&](size_t offset, uint64_t value)
+	{
+		std::string result = bytes;
+		std::memcpy(result.data() + offset, &value, sizeof(value));
+		if (offset >= index)
+		{
+			const uint32_t crc = p3::crc32(std::as_bytes(std::span(result).subspan(index, checksum - index)));
+			std::memcpy(result.data() + checksum, &crc, sizeof(crc));
+		}
+		return result;
+	};
+	unit_test::assert_equals(false, fails(bytes), "chunked_grid_file: intact file");
+
+	// 2^40 chunks of a single element, the index would take 24 TiB.
+	std::string huge = patched(24, uint64_t{ 1 } << 20);
+	std::memcpy(huge.data() + 32, huge.data() + 24, 8);
+	const uint64_t one = 1;
+	std::memcpy(huge.data() + 40, &one, 8);
+	std::memcpy(huge.data() + 48, &one, 8);
+	unit_test::assert_equals(true, fails(huge), "chunked_grid_file: more index entries than bytes");
+	unit_test::assert_equals(true, fails(patched(24, uint64_t{ 1 } << 62)), "chunked_grid_file: element count overflow");
+	unit_test::assert_equals(true, fails(patched(16, bytes.size())), "chunked_grid_file: index behind the end");
+
+	// sizes that wrap around, or don't match the chunk.
+	unit_test::assert_equals(true, fails(patched(index + 8, ~uint64_t{ 0 } - 63)), "chunked_grid_file: wrapping chunk size");
+	unit_test::assert_equals(true, fails(patched(index + 8, 4)), "chunked_grid_file: chunk size mismatch");
+}
+
+#pragma endregion
\ No newline at end of file
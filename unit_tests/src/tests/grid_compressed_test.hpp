@@ -0,0 +1,109 @@
+#pragma once
+#include "../unit_test.hpp"
+#include <cstdint>
+
+import p3.grid.compressed;
+
+#pragma region helper functions
+
+namespace grid_compressed_test
+{
+	/*
+		label map with a bit of everything in 8^3 blocks: empty space (uniform), a few materials (palette),
+		horizontal layers (run length) and noise (raw). the size isn't a multiple of the block edge.
+	*/
+	inline p3::grid<std::uint16_t, 3> label_map()
+	{
+		return p3::grid<std::uint16_t, 3>({ 21, 19, 34 }, [](const auto &pos)
+		{
+			const size_t z = pos.pos_at(0), y = pos.pos_at(1), x = pos.pos_at(2);
+			if (z < 8)
+			{
+				return std::uint16_t{ 0 };
+			}
+			if (z < 16 && x < 16)
+			{
+				return static_cast<std::uint16_t>(x < 8 ? 100 + (x * 7 + y * 3) % 5 : y);
+			}
+			if (z < 16)
+			{
+				return static_cast<std::uint16_t>(pos.index() * 2654435761U >> 13);
+			}
+			return static_cast<std::uint16_t>(z);
+		});
+	}
+}
+
+#pragma endregion
+#pragma region compressed_grid
+
+P3_UNIT_TEST(compressed_grid_roundtrip)
+{
+	const auto dense = grid_compressed_test::label_map();
+	const p3::compressed_grid<std::uint16_t, 3, 8> compressed(dense);
+	const p3::compressed_grid<std::uint16_t, 3, 8> parallel(dense, { .threads = 3, .chunk_size = 2 });
+
+	unit_test::assert_equals(true, compressed.dim() == dense.dim(), "compressed_grid::dim()");
+	unit_test::assert_equals<size_t>(3 * 3 * 5, compressed.block_count(), "compressed_grid::block_count()");
+
+	grid_test::assert_equal_grids(dense, compressed.to_grid(), "compressed_grid::to_grid()");
+	grid_test::assert_equal_grids(dense, parallel.to_grid(), "compressed_grid: parallel compression");
+	dense.iterate([&](const auto &pos, const auto &val)
+	{
+		unit_test::assert_equals<std::uint16_t>(val, compressed.at(pos.pos()), "compressed_grid::at()");
+	});
+
+	unit_test::assert_equals(true, compressed.encoding_of({ 3, 18, 33 }) == p3::block_encoding::uniform, "compressed_grid: empty space");
+	unit_test::assert_equals(true, compressed.encoding_of({ 9, 0, 0 }) == p3::block_encoding::palette, "compressed_grid: few materials");
+	unit_test::assert_equals(true, compressed.encoding_of({ 9, 0, 20 }) == p3::block_encoding::raw, "compressed_grid: noise");
+	unit_test::assert_equals(true, compressed.encoding_of({ 17, 9, 9 }) == p3::block_encoding::run_length, "compressed_grid: layers");
+	unit_test::assert_equals(true, compressed.encoding_of({ 9, 0, 9 }) == p3::block_encoding::run_length, "compressed_grid: rows");
+
+	const auto stats = compressed.stats();
+	unit_test::assert_equals(compressed.block_count(), stats.uniform + stats.palette + stats.run_length + stats.raw, "compressed_grid::stats(): block count");
+	unit_test::assert_equals(true, stats.compression_ratio > 1, "compressed_grid::stats(): compression ratio");
+}
+
+P3_UNIT_TEST(compressed_grid_set)
+{
+	auto dense = grid_compressed_test::label_map();
+	p3::compressed_grid<std::uint16_t, 3, 8> compressed(dense);
+
+	// reading first puts the block into the cache, the write has to replace it.
+	unit_test::assert_equals<std::uint16_t>(16, compressed.at({ 16, 4, 4 }), "compressed_grid::at(): before writing");
+	for (const auto &pos : { p3::grid_size<3>{ 16, 4, 4 }, p3::grid_size<3>{ 2, 2, 2 }, p3::grid_size<3>{ 20, 18, 33 }, p3::grid_size<3>{ 10, 3, 3 } })
+	{
+		dense.at(pos) = 999;
+		compressed.set(pos, 999);
+		unit_test::assert_equals<std::uint16_t>(999, compressed.at(pos), "compressed_grid::set()");
+	}
+	unit_test::assert_equals(true, compressed.encoding_of({ 2, 2, 2 }) != p3::block_encoding::uniform, "compressed_grid::set(): uniform block");
+	grid_test::assert_equal_grids(dense, compressed.to_grid(), "compressed_grid::set(): whole grid");
+
+	// a fresh grid is entirely uniform.
+	p3::compressed_grid<float, 2> plane({ 100, 50 }, 0.5f);
+	unit_test::assert_equals(plane.block_count(), plane.stats().uniform, "compressed_grid: uniform construction");
+	unit_test::assert_equals(true, plane.stats().compression_ratio > 10, "compressed_grid: uniform compression ratio");
+	unit_test::assert_equals(0.5f, plane.at({ 99, 49 }), "compressed_grid: uniform value");
+}
+
+P3_UNIT_TEST(compressed_grid_cache)
+{
+	using compressed_type = p3::compressed_grid<std::uint16_t, 3, 8>;
+	const compressed_type compressed(grid_compressed_test::label_map());
+
+	compressed_type::reset_decode_stats();
+	for (size_t x = 0; x < 8; ++x)
+	{
+		(void)compressed.at({ 9, 1, x });
+	}
+	(void)compressed.at({ 0, 0, 0 });
+
+	// one decode, seven reads from the cache, the uniform block doesn't need either.
+	const auto stats = compressed_type::decode_stats();
+	unit_test::assert_equals<size_t>(1, stats.misses, "compressed_grid::decode_stats(): misses");
+	unit_test::assert_equals<size_t>(7, stats.hits, "compressed_grid::decode_stats(): hits");
+	unit_test::assert_equals<size_t>(compressed_type::block_elements * sizeof(std::uint16_t), stats.decoded_bytes, "compressed_grid::decode_stats(): bytes");
+}
+
+#pragma endregion
\ No newline at end of file
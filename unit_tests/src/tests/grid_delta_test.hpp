@@ -0,0 +1,103 @@
+#pragma once
+#include "../unit_test.hpp"
+#include <filesystem>
+#include <fstream>
+#include <cstdint>
+#include <vector>
+
+import p3.grid.delta;
+
+#pragma region helper functions
+
+namespace grid_delta_test
+{
+	inline p3::tracked_grid<uint32_t, 2> terrain()
+	{
+		return p3::tracked_grid<uint32_t, 2>(p3::grid<uint32_t, 2>({ 64, 100 }, [](const auto &pos) { return static_cast<uint32_t>(pos.index() * 2654435761U); }), 256);
+	}
+
+	struct temporary_snapshot
+	{
+		p3::grid_snapshot<uint32_t, 2> snapshot{ std::filesystem::temp_directory_path() / "p3_grid_delta_test.p3grid" };
+
+		~temporary_snapshot()
+		{
+			std::error_code error;
+			std::filesystem::remove(snapshot.location(), error);
+			std::filesystem::remove(snapshot.log_location(), error);
+		}
+	};
+}
+
+#pragma endregion
+#pragma region grid snapshot
+
+P3_UNIT_TEST(grid_delta_snapshot)
+{
+	grid_delta_test::temporary_snapshot files;
+	auto &snapshot = files.snapshot;
+	auto grid = grid_delta_test::terrain();
+
+	unit_test::assert_equals(false, snapshot.save_increment(grid), "save_increment(): nothing to refer to");
+	const auto full_size = std::filesystem::file_size(snapshot.location());
+
+	// two increments, the second one overwriting a block of the first.
+	grid.at({ 3, 7 }) = 1;
+	grid.fill({ { 40, 0 }, { 42, 100 } }, 2);
+	unit_test::assert_equals(true, snapshot.save_increment(grid), "save_increment()");
+	unit_test::assert_equals<size_t>(0, grid.dirty_blocks().size(), "save_increment(): clears the dirty blocks");
+	grid.at({ 3, 8 }) = 3;
+	unit_test::assert_equals(true, snapshot.save_increment(grid), "save_increment(): second batch");
+	unit_test::assert_equals(true, std::filesystem::file_size(snapshot.log_location()) < full_size / 4, "save_increment(): only dirty blocks");
+
+	p3::grid_snapshot<uint32_t, 2> reader(snapshot.location());
+	auto loaded = reader.load();
+	unit_test::assert_equals(true, loaded == grid, "load(): replayed");
+	unit_test::assert_equals<size_t>(256, loaded.block_size(), "load(): tracking");
+	unit_test::assert_equals(snapshot.log_size(), reader.log_size(), "load(): log size");
+
+	// a torn batch gets ignored, and cut off by the next increment.
+	const auto intact = std::filesystem::file_size(snapshot.log_location());
+	{
+		std::ofstream log(snapshot.log_location(), std::ios::binary | std::ios::app);
+		const uint64_t count = 2, index = 1;
+		log.write(reinterpret_cast<const char *>(&count), 8);
+		log.write(reinterpret_cast<const char *>(&index), 8);
+		log.write("torn", 4);
+	}
+	unit_test::assert_equals(true, reader.load() == grid, "load(): torn batch");
+	loaded[0] = 4;
+	grid[0] = 4;
+	unit_test::assert_equals(true, reader.save_increment(loaded), "save_increment() after load()");
+	unit_test::assert_equals(intact + 8 + 8 + 256 * 4 + 4, std::filesystem::file_size(snapshot.log_location()), "save_increment(): torn batch cut off");
+	unit_test::assert_equals(true, snapshot.load() == grid, "load(): after the torn batch");
+
+	// a new snapshot makes the old log stale.
+	grid.iterate([](const auto &pos, auto &val) { val ^= 5; });
+	unit_test::assert_equals(false, snapshot.save_increment(grid), "save_increment(): everything dirty");
+	unit_test::assert_equals(true, reader.load() == grid, "load(): new snapshot");
+	unit_test::assert_equals(true, std::filesystem::file_size(snapshot.log_location()) < 100, "save(): empty log");
+
+	grid.modify([](auto &content) { content.resize({ 10, 10 }); });
+	unit_test::assert_equals(false, snapshot.save_increment(grid), "save_increment(): resized");
+	unit_test::assert_equals(true, reader.load() == grid, "load(): resized");
+}
+
+P3_UNIT_TEST(grid_delta_snapshot_blit)
+{
+	grid_delta_test::temporary_snapshot files;
+	auto &snapshot = files.snapshot;
+	auto grid = grid_delta_test::terrain();
+	snapshot.save(grid);
+
+	// blit() and copy_region() write through views, the tracked overloads have to mark what they cover.
+	const p3::grid<uint32_t, 2> stamp({ 4, 4 }, [](const auto &pos) { return 77U; });
+	p3::blit(stamp, grid, { 30, 97 });
+	p3::blit(stamp, grid, { 50, 50 }, [](uint32_t target, uint32_t source) { return target ^ source; });
+	p3::copy_region(stamp, { { 1, 1 }, { 3, 3 } }, grid, { 0, 0 });
+	unit_test::assert_equals(true, snapshot.save_increment(grid), "save_increment(): after blit()");
+
+	unit_test::assert_equals(true, snapshot.load() == grid, "load(): blit() replayed");
+}
+
+#pragma endregion
\ No newline at end of file
@@ -0,0 +1,142 @@
+#pragma once
+#include "../unit_test.hpp"
+#include <stdexcept>
+#include <cstdint>
+#include <cmath>
+
+import p3.grid.expression;
+
+#pragma region grid expressions
+
+P3_UNIT_TEST(grid_expression_arithmetic)
+{
+	const p3::grid<int, 2> a({ 3, 4 }, &p3::grid_gen::ascending<2>);
+	const p3::grid<int, 2> b({ 3, 4 }, p3::grid_gen::axis_add<int>());
+	const p3::grid<int, 2> c({ 3, 4 }, p3::grid_gen::axis_mul<int>());
+
+	// nothing gets computed before the assignment, the expression is just a description.
+	const auto expression = a + b * c - 2 * a / (b + 1);
+	static_assert(!std::is_same_v<std::remove_cvref_t<decltype(expression)>, p3::grid<int, 2>>, "grid expression: evaluated too early");
+
+	const p3::grid<int, 2> result = expression;
+	a.iterate([&](const auto &pos, const auto &val)
+	{
+		const auto &p = pos.pos();
+		const int expected = val + b.at(p) * c.at(p) - 2 * val / (b.at(p) + 1);
+		unit_test::assert_equals<int>(expected, result.at(p), std::format("grid expression: value mismatch at index {}", pos.index()));
+	});
+
+	p3::grid<int, 2> negated;
+	negated = -a;
+	unit_test::assert_equals(true, negated.dim() == a.dim(), "grid expression: assignment didn't adapt the dimensions");
+	unit_test::assert_equals<int>(-11, negated.at({ 2, 3 }), "grid expression: unary minus");
+}
+
+P3_UNIT_TEST(grid_expression_compound_assignment)
+{
+	p3::grid<float, 3> grid({ 4, 5, 6 }, &p3::grid_gen::ascending<3>);
+	const p3::grid<float, 3> ones({ 4, 5, 6 }, [](const auto &pos) { return 1.f; });
+
+	// the target is part of the expression, every element only reads its own position.
+	grid += ones;
+	grid *= 2;
+	grid = grid - ones * 2;
+	grid /= 2.f;
+	grid.iterate([](const auto &pos, const auto &val)
+	{
+		unit_test::assert_equals<float>(static_cast<float>(pos.index()), val, "grid expression: compound assignment");
+	});
+}
+
+P3_UNIT_TEST(grid_expression_math)
+{
+	const p3::grid<double, 1> values({ 5 }, { -4.0, -1.0, 0.0, 2.25, 9.0 });
+
+	const p3::grid<double, 1> root = p3::sqrt(p3::abs(values));
+	const p3::grid<double, 1> clamped = p3::min(p3::max(values, -1.0), 2.0);
+	const p3::grid<double, 1> squared = p3::pow(values, 2);
+	const p3::grid<double, 1> identity = p3::log(p3::exp(values)) + p3::sin(values) * p3::sin(values) + p3::cos(values) * p3::cos(values) - 1;
+
+	const double expected_root[]{ 2.0, 1.0, 0.0, 1.5, 3.0 };
+	const double expected_clamped[]{ -1.0, -1.0, 0.0, 2.0, 2.0 };
+	for (size_t index = 0; index < values.size(); ++index)
+	{
+		unit_test::assert_equals<double>(expected_root[index], root[index], "p3::sqrt(p3::abs())");
+		unit_test::assert_equals<double>(expected_clamped[index], clamped[index], "p3::min(p3::max())");
+		unit_test::assert_equals<double>(values[index] * values[index], squared[index], "p3::pow()");
+		unit_test::assert_equals(true, std::abs(identity[index] - values[index]) < 1e-9, "p3::log(p3::exp()), sin^2 + cos^2");
+	}
+}
+
+P3_UNIT_TEST(grid_expression_types)
+{
+	// small integers get promoted during the computation and converted back on assignment.
+	const p3::grid<uint8_t, 1> bytes({ 3 }, { 100, 200, 250 });
+	const p3::grid<uint8_t, 1> halved = (bytes + bytes) / 4;
+	unit_test::assert_equals<int>(125, halved[2], "grid expression: integer promotion");
+
+	// mixed types evaluate to their common type.
+	const p3::grid<float, 1> floats({ 3 }, { 0.5f, 1.5f, 2.5f });
+	const auto mixed = p3::evaluate(bytes + floats);
+	static_assert(std::is_same_v<std::remove_cvref_t<decltype(mixed)>, p3::grid<float, 1>>, "p3::evaluate(): value type");
+	unit_test::assert_equals<float>(252.5f, mixed[2], "grid expression: mixed types");
+
+	// other layouts work the same way, as long as every operand shares it.
+	const p3::grid<int, 2, p3::grid_layout::morton> morton({ 3, 5 }, &p3::grid_gen::ascending<2>);
+	const p3::grid<int, 2, p3::grid_layout::morton> doubled = morton + morton / (morton + 1) * 0 + morton;
+	doubled.iterate([](const auto &pos, const auto &val)
+	{
+		unit_test::assert_equals<int>(static_cast<int>(pos.index() * 2), val, "grid expression: morton layout");
+	});
+}
+
+P3_UNIT_TEST(grid_expression_dimension_mismatch)
+{
+	const p3::grid<int, 2> a({ 3, 4 });
+	const p3::grid<int, 2> b({ 4, 3 });
+
+	bool thrown = false;
+	try
+	{
+		const p3::grid<int, 2> sum = a + b;
+	}
+	catch (const std::invalid_argument &)
+	{
+		thrown = true;
+	}
+	unit_test::assert_equals(true, thrown, "grid expression: dimension mismatch did not throw");
+}
+
+P3_UNIT_TEST(grid_expression_broadcast)
+{
+	const p3::grid<int, 3> volume({ 4, 3, 5 }, &p3::grid_gen::ascending<3>);
+	const p3::grid<int, 1> row({ 5 }, { 100, 200, 300, 400, 500 });
+	const p3::grid<int, 2> plane({ 3, 5 }, [](const auto &pos) { return static_cast<int>(pos.index()) * 1000; });
+
+	// the lower rank operand repeats along the leading axes, no matter which side it's on.
+	const p3::grid<int, 3> result = row + volume * 2 - plane;
+	const p3::grid<int, 3> mirrored = volume * 2 + row - plane;
+	result.iterate([&](const auto &pos, const auto &val)
+	{
+		const auto expected = row.at({ pos.pos_at(2) }) + volume.at(pos.pos()) * 2 - plane.at({ pos.pos_at(1), pos.pos_at(2) });
+		unit_test::assert_equals(expected, val, std::format("grid expression: broadcast at index {}", pos.index()));
+	});
+	grid_test::assert_equal_grids(result, mirrored, "grid expression: broadcast operand order");
+
+	p3::grid<int, 2> accumulated = plane;
+	accumulated += row;
+	unit_test::assert_equals(plane[7] + row[2], accumulated[7], "grid expression: broadcast compound assignment");
+
+	bool thrown = false;
+	try
+	{
+		const p3::grid<int, 3> sum = volume + p3::grid<int, 1>({ 4 });
+	}
+	catch (const std::invalid_argument &)
+	{
+		thrown = true;
+	}
+	unit_test::assert_equals(true, thrown, "grid expression: mismatching trailing axis did not throw");
+}
+
+#pragma endregion
\ No newline at end of file
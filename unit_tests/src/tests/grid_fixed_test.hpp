@@ -0,0 +1,79 @@
+#pragma once
+#include "../unit_test.hpp"
+
+import p3.grid.fixed;
+
+#pragma region fixed_grid
+
+P3_UNIT_TEST(fixed_grid_compile_time)
+{
+	// all of this happens during compilation, a failure wouldn't even compile.
+	constexpr p3::fixed_grid<int, 3, 3> kernel{ 1, 2, 1,  2, 4, 2,  1, 2, 1 };
+	static_assert(kernel.rank() == 2, "fixed_grid::rank()");
+	static_assert(kernel.size() == 9, "fixed_grid::size()");
+	static_assert(kernel.at({ 1, 1 }) == 4, "fixed_grid::at({ 1, 1 })");
+	static_assert(kernel.at({ 2, 1 }) == 2, "fixed_grid::at({ 2, 1 })");
+	static_assert(kernel.index_of({ 2, 1 }) == 7, "fixed_grid::index_of({ 2, 1 })");
+	static_assert(kernel.inside({ 2, 2 }) && !kernel.inside({ 3, 0 }), "fixed_grid::inside()");
+
+	// no hidden heap allocation, just the elements.
+	static_assert(sizeof(p3::fixed_grid<float, 4, 4>) == 16 * sizeof(float), "fixed_grid: unexpected object size");
+
+	constexpr p3::fixed_grid<int, 2, 3, 4> ascending(&p3::grid_gen::ascending<3>);
+	static_assert(ascending.at({ 1, 2, 3 }) == 23, "fixed_grid: generator constructor");
+
+	constexpr auto sum = []()
+	{
+		p3::fixed_grid<int, 4, 4> grid(p3::grid_gen::axis_add<int>());
+		int result = 0;
+		grid.iterate([&](const auto &pos, auto &val) { val *= 2; });
+		grid.iterate([&](const auto &pos, const auto &val) { result += val; });
+		return result;
+	}();
+	static_assert(sum == 96, "fixed_grid::iterate()");
+}
+
+P3_UNIT_TEST(fixed_grid_subgrid)
+{
+	constexpr p3::fixed_grid<int, 2, 3, 4> grid(&p3::grid_gen::ascending<3>);
+	static_assert(std::is_same_v<decltype(grid.subgrid<0>(0)), p3::fixed_grid<int, 3, 4>>, "fixed_grid::subgrid<0>(): type");
+	static_assert(std::is_same_v<decltype(grid.subgrid<1>(0)), p3::fixed_grid<int, 2, 4>>, "fixed_grid::subgrid<1>(): type");
+	static_assert(std::is_same_v<decltype(grid.subgrid<2>(0)), p3::fixed_grid<int, 2, 3>>, "fixed_grid::subgrid<2>(): type");
+	static_assert(grid.subgrid<1>(2) == p3::fixed_grid<int, 2, 4>{ 8, 9, 10, 11,  20, 21, 22, 23 }, "fixed_grid::subgrid<1>(2)");
+
+	// has to agree with the dynamic grid.
+	const p3::grid<int, 3> dynamic(grid.dim(), &p3::grid_gen::ascending<3>);
+	const auto compare = [&]<size_t axis>()
+	{
+		const auto slices = grid.slice<axis>();
+		for (size_t layer = 0; layer < slices.size(); ++layer)
+		{
+			const auto expected = dynamic.subgrid(layer, axis);
+			const p3::grid<int, 2> actual(slices[layer].view());
+			if (expected != actual)
+			{
+				unit_test::assert_equals(0, 1, std::format("fixed_grid::slice<{0}>()[{1}] does not match grid::subgrid({1}, {0})", axis, layer));
+			}
+		}
+	};
+	compare.template operator()<0>();
+	compare.template operator()<1>();
+	compare.template operator()<2>();
+}
+
+P3_UNIT_TEST(fixed_grid_iterate_rows)
+{
+	p3::fixed_grid<int, 3, 4> grid(&p3::grid_gen::ascending<2>);
+
+	size_t rows = 0;
+	grid.iterate_rows([&](const auto &pos, std::span<int, 4> row)
+	{
+		unit_test::assert_equals<int>(pos.index(), row[0], "fixed_grid::iterate_rows(): row start");
+		row[3] = -1;
+		++rows;
+	});
+	unit_test::assert_equals<size_t>(3, rows, "fixed_grid::iterate_rows(): row count");
+	unit_test::assert_equals<int>(-1, grid.at({ 2, 3 }), "fixed_grid::iterate_rows(): writing did not work");
+}
+
+#pragma endregion
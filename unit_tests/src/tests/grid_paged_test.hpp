@@ -0,0 +1,175 @@
+#pragma once
+#include "../unit_test.hpp"
+#include <filesystem>
+#include <fstream>
+#include <cstdint>
+#include <array>
+
+import p3.grid.paged;
+
+#pragma region helper functions
+
+namespace grid_paged_test
+{
+	// removes the files at the end of the test, even if it fails.
+	struct temporary_files
+	{
+		std::filesystem::path first, second;
+
+		temporary_files()
+			: first{ std::filesystem::temp_directory_path() / "p3_paged_grid_test_a.p3paged" },
+			  second{ std::filesystem::temp_directory_path() / "p3_paged_grid_test_b.p3paged" }
+		{
+		}
+
+		~temporary_files()
+		{
+			std::error_code error;
+			std::filesystem::remove(first, error);
+			std::filesystem::remove(second, error);
+		}
+	};
+}
+
+#pragma endregion
+#pragma region paged_grid
+
+P3_UNIT_TEST(paged_grid_access)
+{
+	const grid_paged_test::temporary_files files;
+	const p3::grid<int, 3> expected({ 10, 9, 7 }, &p3::grid_gen::ascending<3>);
+
+	{
+		// 3 * 3 * 2 = 18 chunks, only 4 of them in memory.
+		p3::paged_grid<int, 3> paged({ 4, 4, 4 }, 4);
+		paged.create(files.first, expected.dim());
+		unit_test::assert_equals(true, paged.chunk_grid() == p3::grid_size<3>{ 3, 3, 2 }, "paged_grid::chunk_grid()");
+		unit_test::assert_equals<int>(0, paged.at({ 9, 8, 6 }), "paged_grid: fresh file");
+
+		expected.iterate([&](const auto &pos, const auto &val) { paged.set(pos.pos(), val); });
+		unit_test::assert_equals<size_t>(4, paged.resident(), "paged_grid::resident()");
+		unit_test::assert_equals(true, paged.stats().evictions > 0 && paged.stats().write_backs > 0, "paged_grid: no evictions despite the small cache");
+
+		expected.iterate([&](const auto &pos, const auto &val)
+		{
+			unit_test::assert_equals<int>(val, paged.at(pos.pos()), "paged_grid::at()");
+		});
+
+		// same chunk twice in a row: the second access is a hit.
+		paged.reset_stats();
+		const int first = paged.at({ 5, 5, 5 });
+		const int second = paged.at({ 5, 6, 5 });
+		unit_test::assert_equals<size_t>(1, paged.stats().hits, "paged_grid::stats(): hits");
+		unit_test::assert_equals<int>(first + 7, second, "paged_grid::at(): same chunk");
+	}
+
+	// the destructor flushed everything.
+	p3::paged_grid<int, 3> reopened({ 1, 1, 1 }, 2);
+	reopened.load(files.first);
+	unit_test::assert_equals(true, reopened.dim() == expected.dim(), "paged_grid::load(): dimensions");
+	unit_test::assert_equals(true, reopened.chunk_dim() == p3::grid_size<3>{ 4, 4, 4 }, "paged_grid::load(): chunk dimensions");
+
+	size_t count = 0;
+	reopened.iterate([&](const auto &pos, const auto &val)
+	{
+		unit_test::assert_equals<int>(expected.at(pos.pos()), val, "paged_grid::iterate()");
+		++count;
+	});
+	unit_test::assert_equals<size_t>(expected.size(), count, "paged_grid::iterate(): element count");
+	unit_test::assert_equals(true, reopened.stats().prefetches > 0, "paged_grid::iterate(): no prefetching");
+}
+
+P3_UNIT_TEST(paged_grid_save)
+{
+	const grid_paged_test::temporary_files files;
+
+	p3::paged_grid<float, 2> paged({ 8, 8 }, 2);
+	paged.create(files.first, { 30, 20 });
+	paged.iterate([](const auto &pos, auto &val) { val = pos.index() * 0.5f; });
+
+	// a copy of the backing file, with everything written back.
+	paged.save(files.second);
+	p3::paged_grid<float, 2> copy({ 8, 8 }, 1);
+	copy.load(files.second);
+
+	copy.iterate([&](const auto &pos, const auto &val)
+	{
+		unit_test::assert_equals<float>(pos.index() * 0.5f, val, "paged_grid::save()");
+	});
+
+	p3::paged_grid<double, 2> wrong_type({ 8, 8 }, 1);
+	bool thrown = false;
+	try
+	{
+		wrong_type.load(files.second);
+	}
+	catch (const p3::file_access::custom_error &)
+	{
+		thrown = true;
+	}
+	unit_test::assert_equals(true, thrown, "paged_grid::load(): element type mismatch");
+
+	// broken files get rejected, and the grid keeps its previous state.
+	const auto rejected = [&](const char *message)
+	{
+		thrown = false;
+		try
+		{
+			copy.load(files.second);
+		}
+		catch (const p3::file_access::custom_error &)
+		{
+			thrown = true;
+		}
+		unit_test::assert_equals(true, thrown, message);
+		unit_test::assert_equals(true, copy.dim() == p3::grid_size<2>{ 30, 20 } && copy.chunk_dim() == p3::grid_size<2>{ 8, 8 }, message);
+		unit_test::assert_equals<float>(12 * 0.5f, copy.at({ 0, 12 }), message);
+	};
+
+	const auto size = std::filesystem::file_size(files.second);
+	std::filesystem::resize_file(files.second, size - 1);
+	rejected("paged_grid::load(): truncated file");
+	std::filesystem::resize_file(files.second, size + 4);
+	rejected("paged_grid::load(): oversized file");
+
+	// chunks of 2^40 x 2^40 elements: the product wraps around.
+	std::filesystem::resize_file(files.second, size);
+	{
+		const std::array<uint64_t, 2> chunk{ uint64_t{ 1 } << 40, uint64_t{ 1 } << 40 };
+		std::fstream file(files.second, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(32);
+		file.write(reinterpret_cast<const char *>(chunk.data()), sizeof(chunk));
+	}
+	rejected("paged_grid::load(): chunk size overflow");
+}
+
+P3_UNIT_TEST(paged_grid_iterate_reentrant)
+{
+	const grid_paged_test::temporary_files files;
+
+	// callbacks that write into the next chunk (and beyond), while it's being prefetched or has been evicted.
+	for (const size_t capacity : { 1, 2 })
+	{
+		p3::paged_grid<int, 2> paged({ 4, 4 }, capacity);
+		paged.create(files.first, { 4, 16 });
+		paged.iterate([&](const auto &pos, auto &val)
+		{
+			val += 1;
+			if (pos.pos_at(1) % 4 == 0 && pos.pos_at(1) + 4 < 16)
+			{
+				paged.set({ pos.pos_at(0), pos.pos_at(1) + 4 }, 10);
+			}
+		});
+		paged.flush();
+
+		for (size_t x = 0; x < 16; ++x)
+		{
+			// the first column of every chunk but the first one got 10 from the previous chunk, then + 1 by itself.
+			const int expected = x % 4 == 0 && x >= 4 ? 11 : 1;
+			unit_test::assert_equals<int>(expected, paged.at({ 2, x }), "paged_grid::iterate(): writes into other chunks");
+		}
+		unit_test::assert_equals(true, paged.resident() <= capacity, "paged_grid::iterate(): capacity");
+	}
+}
+
+#pragma endregion
\ No newline at end of file
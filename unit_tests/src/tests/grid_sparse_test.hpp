@@ -0,0 +1,130 @@
+#pragma once
+#include "../unit_test.hpp"
+#include <algorithm>
+#include <utility>
+#include <random>
+
+import p3.grid.sparse;
+
+#pragma region sparse_grid
+
+P3_UNIT_TEST(sparse_grid_access)
+{
+	p3::sparse_grid<int, 3> grid({ 100, 100, 100 });
+	unit_test::assert_equals<size_t>(1000000, grid.size(), "sparse_grid::size()");
+	unit_test::assert_equals<size_t>(0, grid.stored(), "sparse_grid::stored()");
+	unit_test::assert_equals<int>(0, grid.at({ 12, 34, 56 }), "sparse_grid::at(): unstored position");
+
+	grid.set({ 12, 34, 56 }, 7);
+	grid.set({ 99, 99, 99 }, 8);
+	grid.set({ 0, 0, 0 }, 0);
+	unit_test::assert_equals<size_t>(2, grid.stored(), "sparse_grid::stored() after set()");
+	unit_test::assert_equals<int>(7, std::as_const(grid).at({ 12, 34, 56 }), "sparse_grid::at() after set()");
+	unit_test::assert_equals<int>(8, std::as_const(grid).at({ 99, 99, 99 }), "sparse_grid::at() after set()");
+
+	// writing the default value removes the element again.
+	grid.set({ 12, 34, 56 }, 0);
+	unit_test::assert_equals<size_t>(1, grid.stored(), "sparse_grid::stored() after resetting");
+	unit_test::assert_equals<bool>(false, grid.contains({ 12, 34, 56 }), "sparse_grid::contains() after resetting");
+
+	grid.at({ 1, 2, 3 }) += 5;
+	unit_test::assert_equals<int>(5, std::as_const(grid).at({ 1, 2, 3 }), "sparse_grid::at() mutable");
+}
+
+P3_UNIT_TEST(sparse_grid_random_operations)
+{
+	// compares a long chain of random writes and erases with a dense grid. this exercises rehashing and backward shift deletion.
+	constexpr p3::grid_size<2> size{ 64, 64 };
+	p3::grid<int, 2> dense(size);
+	p3::sparse_grid<int, 2> sparse(size);
+
+	std::mt19937 random(1234);
+	std::uniform_int_distribution<size_t> coordinate(0, 63);
+	std::uniform_int_distribution<int> value(0, 3);
+
+	for (size_t i = 0; i < 20000; ++i)
+	{
+		const p3::grid_size<2> pos{ coordinate(random), coordinate(random) };
+		const int val = value(random);
+		dense.at(pos) = val;
+		sparse.set(pos, val);
+	}
+
+	const auto expected_stored = std::count_if(dense.begin(), dense.end(), [](int val) { return val != 0; });
+	unit_test::assert_equals<size_t>(expected_stored, sparse.stored(), "sparse_grid::stored()");
+
+	size_t iterations = 0;
+	sparse.iterate([&](const auto &pos, const auto &val)
+	{
+		unit_test::assert_equals<int>(dense.at(pos.pos()), val, std::format("sparse_grid::iterate(): mismatch at index {0}", pos.index()));
+		++iterations;
+	});
+	unit_test::assert_equals<size_t>(dense.size(), iterations, "sparse_grid::iterate(): iteration count");
+
+	if (sparse.to_grid() != dense)
+	{
+		unit_test::assert_equals(0, 1, "sparse_grid::to_grid() did not match the dense grid");
+	}
+	if (p3::sparse_grid<int, 2>(dense).to_grid() != dense)
+	{
+		unit_test::assert_equals(0, 1, "sparse_grid(grid) did not round trip");
+	}
+}
+
+P3_UNIT_TEST(sparse_grid_iterate_stored)
+{
+	p3::sparse_grid<int, 2> grid({ 10, 10 });
+	grid.set({ 1, 2 }, 12);
+	grid.set({ 7, 3 }, 73);
+
+	size_t iterations = 0;
+	grid.iterate_stored([&](const auto &pos, auto &val)
+	{
+		unit_test::assert_equals<int>(static_cast<int>(pos.pos_at(0) * 10 + pos.pos_at(1)), val, "sparse_grid::iterate_stored(): position mismatch");
+		val = -val;
+		++iterations;
+	});
+	unit_test::assert_equals<size_t>(2, iterations, "sparse_grid::iterate_stored(): iteration count");
+	unit_test::assert_equals<int>(-73, std::as_const(grid).at({ 7, 3 }), "sparse_grid::iterate_stored(): writing did not work");
+}
+
+#pragma endregion
+#pragma region adaptive_grid
+
+P3_UNIT_TEST(adaptive_grid_migration)
+{
+	p3::adaptive_grid<long long, 2> grid({ 32, 32 });
+	unit_test::assert_equals<bool>(true, grid.sparse(), "adaptive_grid: should start sparse");
+
+	// filling up the grid has to make it dense at some point...
+	for (size_t y = 0; y < 32; ++y)
+	{
+		for (size_t x = 0; x < 32; ++x)
+		{
+			grid.set({ y, x }, static_cast<long long>(y * 32 + x + 1));
+			if (grid.sparse() && grid.memory_footprint() > 32 * 32 * sizeof(long long))
+			{
+				unit_test::assert_equals(0, 1, "adaptive_grid: sparse storage outgrew the dense one");
+			}
+		}
+	}
+	unit_test::assert_equals<bool>(false, grid.sparse(), "adaptive_grid: should have become dense");
+	unit_test::assert_equals<size_t>(1024, grid.stored(), "adaptive_grid::stored() (dense)");
+
+	// ... and clearing it has to make it sparse again, without losing the remaining elements.
+	for (size_t y = 0; y < 32; ++y)
+	{
+		for (size_t x = 0; x < 32; ++x)
+		{
+			if (y != 5 || x != 9)
+			{
+				grid.set({ y, x }, 0);
+			}
+		}
+	}
+	unit_test::assert_equals<bool>(true, grid.sparse(), "adaptive_grid: should have become sparse again");
+	unit_test::assert_equals<size_t>(1, grid.stored(), "adaptive_grid::stored() (sparse)");
+	unit_test::assert_equals<long long>(5 * 32 + 9 + 1, grid.at({ 5, 9 }), "adaptive_grid: element lost during migration");
+}
+
+#pragma endregion
@@ -0,0 +1,142 @@
+#pragma once
+#include "../unit_test.hpp"
+#include <stdexcept>
+#include <cstddef>
+
+import p3.grid.stencil;
+import p3.grid.fixed;
+
+#pragma region helper functions
+
+namespace grid_stencil_test
+{
+	// straightforward reference: resolves every neighbor with the boundary rules.
+	template <typename data_type, size_t dimensions>
+	p3::grid<data_type, dimensions> naive_stencil(const p3::grid<data_type, dimensions> &source, const p3::grid<data_type, dimensions> &kernel,
+		const p3::grid_size<dimensions> &anchor, const p3::stencil_boundary<data_type> &boundary)
+	{
+		using mode = typename p3::stencil_boundary<data_type>::mode;
+		return p3::grid<data_type, dimensions>(source.dim(), [&](const auto &pos)
+		{
+			data_type sum{};
+			kernel.iterate([&](const auto &kernel_pos, const auto &weight)
+			{
+				p3::grid_size<dimensions> neighbor{};
+				bool outside = false;
+				for (size_t axis = 0; axis < dimensions; ++axis)
+				{
+					const auto size = static_cast<std::ptrdiff_t>(source.dim_at(axis));
+					auto coord = static_cast<std::ptrdiff_t>(pos.pos_at(axis) + kernel_pos.pos_at(axis)) - static_cast<std::ptrdiff_t>(anchor[axis]);
+					if (coord < 0 || coord >= size)
+					{
+						outside = outside || boundary.get_mode() == mode::constant;
+						coord = boundary.get_mode() == mode::wrap ? (coord % size + size) % size : std::clamp<std::ptrdiff_t>(coord, 0, size - 1);
+					}
+					neighbor[axis] = coord;
+				}
+				sum += weight * (outside ? boundary.value() : source.at(neighbor));
+			});
+			return sum;
+		});
+	}
+}
+
+#pragma endregion
+#pragma region stencil
+
+P3_UNIT_TEST(stencil_boundaries)
+{
+	// wide enough to span multiple column blocks.
+	const p3::grid<int, 2> source({ 5, p3::stencil<int, 2>::block_size + 7 }, [](const auto &pos) { return static_cast<int>(pos.index() * 7919 % 23) - 11; });
+	const p3::grid<int, 2> kernel({ 3, 4 }, { 0, 1, 0, 2,  1, -6, 1, 3,  0, 1, 0, -1 });
+
+	const p3::stencil_boundary<int> boundaries[]{ p3::stencil_boundary<int>::clamp(), p3::stencil_boundary<int>::wrap(), p3::stencil_boundary<int>::constant(5) };
+	const p3::grid_size<2> anchors[]{ { 1, 2 }, { 0, 0 }, { 2, 3 } };
+
+	for (const auto &boundary : boundaries)
+	{
+		for (const auto &anchor : anchors)
+		{
+			const auto expected = grid_stencil_test::naive_stencil(source, kernel, anchor, boundary);
+			const p3::stencil<int, 2> stencil(kernel, anchor);
+
+			p3::grid<int, 2> serial, parallel;
+			stencil.apply(source, serial, boundary);
+			stencil.apply(source, parallel, boundary, p3::parallel_policy{ .threads = 3, .chunk_size = 1000 });
+
+			const auto name = std::format("stencil (mode {}, anchor {}, {})", static_cast<int>(boundary.get_mode()), anchor[0], anchor[1]);
+			grid_test::assert_equal_grids(expected, serial, name);
+			grid_test::assert_equal_grids(expected, parallel, name + " (parallel)");
+		}
+	}
+}
+
+P3_UNIT_TEST(stencil_fixed_kernel)
+{
+	// 3d laplacian (6 neighbors) from a compile-time kernel. zero weights get dropped.
+	constexpr p3::fixed_grid<float, 3, 3, 3> laplacian([](const auto &pos)
+	{
+		size_t distance = 0;
+		for (size_t axis = 0; axis < 3; ++axis)
+		{
+			distance += pos.pos_at(axis) == 1 ? 0 : 1;
+		}
+		return distance == 0 ? -6.f : (distance == 1 ? 1.f : 0.f);
+	});
+	const p3::stencil<float, 3> stencil(laplacian);
+	unit_test::assert_equals<size_t>(7, stencil.taps().size(), "stencil::taps(): zero weights");
+
+	// the laplacian of x^2 + y^2 + z^2 is 6 everywhere (away from the border).
+	const p3::grid<float, 3> source({ 6, 7, 8 }, p3::grid_gen::axis_binary_operation<float>(0.f, [](float sum, size_t x) { return sum + x * x; }));
+	p3::grid<float, 3> result;
+	stencil.apply(source, result, p3::stencil_boundary<float>::clamp());
+
+	result.iterate([&](const auto &pos, const auto &val)
+	{
+		if (pos.pos() != p3::grid_size<3>{ 3, 3, 3 })
+		{
+			return;
+		}
+		unit_test::assert_equals<float>(6.f, val, "stencil: 3d laplacian");
+	});
+
+	bool thrown = false;
+	try
+	{
+		result = source;
+		stencil.apply(result, result, p3::stencil_boundary<float>::clamp());
+	}
+	catch (const std::invalid_argument &)
+	{
+		thrown = true;
+	}
+	unit_test::assert_equals(true, thrown, "stencil: in-place application did not throw");
+}
+
+P3_UNIT_TEST(stencil_game_of_life)
+{
+	// a glider on a torus comes back to its shape (moved by one cell diagonally) every four steps.
+	p3::grid<int, 2> glider({ 8, 8 });
+	for (const auto &pos : { p3::grid_size<2>{ 0, 1 }, { 1, 2 }, { 2, 0 }, { 2, 1 }, { 2, 2 } })
+	{
+		glider.at(pos) = 1;
+	}
+	const p3::fixed_grid<int, 3, 3> neighbors{ 1, 1, 1,  1, 0, 1,  1, 1, 1 };
+	const p3::stencil<int, 2> stencil(neighbors);
+
+	const auto rule = [](int alive, int count) { return count == 3 || (alive && count == 2) ? 1 : 0; };
+
+	p3::grid_double_buffer<int, 2> buffer(glider);
+	for (size_t step = 0; step < 32; ++step)
+	{
+		buffer.step([&](const auto &current, auto &next)
+		{
+			stencil.transform(current, next, p3::stencil_boundary<int>::wrap(), rule, p3::parallel_policy{ .threads = 2, .chunk_size = 8 });
+		});
+	}
+
+	// 32 steps = 8 diagonal moves = once around the 8x8 torus.
+	grid_test::assert_equal_grids(glider, buffer.front(), "stencil: game of life");
+}
+
+#pragma endregion
\ No newline at end of file
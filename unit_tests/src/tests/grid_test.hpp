@@ -1,5 +1,8 @@
 #pragma once
 #include "../unit_test.hpp"
+#include <utility>
+#include <atomic>
+#include <memory_resource>
 
 import p3.grid;
 
@@ -623,6 +626,81 @@ P3_UNIT_TEST(grid_iterate)
 	grid_mutable.iterate(assert_zeroes);
 }
 
+P3_UNIT_TEST(grid_iterate_rows)
+{
+	const p3::grid<int, 3> grid_const({ 3, 4, 5 }, &p3::grid_gen::ascending<3>);
+
+	size_t rows = 0, elements = 0;
+	grid_const.iterate_rows([&](const auto &pos, std::span<const int> row)
+	{
+		unit_test::assert_equals<size_t>(0, pos.pos_at(2), "grid::iterate_rows(): row does not start at the innermost axis");
+		unit_test::assert_equals<size_t>(5, row.size(), "grid::iterate_rows(): row length");
+		for (size_t x = 0; x < row.size(); ++x)
+		{
+			unit_test::assert_equals<int>(pos.index() + x, row[x], "grid::iterate_rows(): value mismatch");
+		}
+		elements += row.size();
+		++rows;
+	});
+	unit_test::assert_equals<size_t>(12, rows, "grid::iterate_rows(): row count");
+	unit_test::assert_equals<size_t>(grid_const.size(), elements, "grid::iterate_rows(): element count");
+
+	p3::grid<int, 3> grid_mutable = grid_const;
+	grid_mutable.iterate_rows([](const auto &pos, std::span<int> row)
+	{
+		for (auto &val : row)
+		{
+			val *= 2;
+		}
+	});
+	grid_mutable.iterate([](const auto &pos, const auto &val)
+	{
+		unit_test::assert_equals<int>(2 * pos.index(), val, "grid::iterate_rows(): writing did not work");
+	});
+}
+
+P3_UNIT_TEST(grid_iterate_rows_empty)
+{
+	const p3::grid<int, 2> grid({ 3, 0 });
+	grid.iterate_rows([](const auto &pos, const auto &row) { unit_test::assert_equals(0, 1, "grid::iterate_rows(): empty grid should never iterate"); });
+}
+
+P3_UNIT_TEST(grid_constructor_generator_parallel)
+{
+	constexpr p3::grid_size<3> size{ 7, 11, 13 };
+	const auto generator = [](const auto &pos) { return static_cast<int>(pos.pos_at(0) * 10000 + pos.pos_at(1) * 100 + pos.pos_at(2)); };
+	const p3::grid<int, 3> expected(size, generator);
+
+	for (const size_t threads : { 1, 2, 5 })
+	{
+		for (const size_t chunk_size : { 1, 13, 100, 5000 })
+		{
+			const p3::grid<int, 3> actual(size, generator, { threads, chunk_size });
+			grid_test::assert_equal_grids(expected, actual, std::format("grid(size, generator, {{{0}, {1}}})", threads, chunk_size));
+		}
+	}
+}
+
+P3_UNIT_TEST(grid_iterate_parallel)
+{
+	const p3::parallel_policy policy{ 4, 17 };
+	p3::grid<int, 3> grid({ 5, 6, 7 }, &p3::grid_gen::ascending<3>);
+
+	std::atomic<size_t> iterations = 0;
+	std::as_const(grid).iterate([&](const auto &pos, const auto &val)
+	{
+		unit_test::assert_equals<int>(pos.index(), val, "grid::iterate(parallel): position mismatch");
+		++iterations;
+	}, policy);
+	unit_test::assert_equals<size_t>(grid.size(), iterations, "grid::iterate(parallel): iteration count mismatch");
+
+	grid.iterate([](const auto &pos, auto &val) { val = -val; }, policy);
+	grid.iterate([](const auto &pos, const auto &val)
+	{
+		unit_test::assert_equals<int>(-static_cast<int>(pos.index()), val, "grid::iterate(parallel): writing did not work");
+	});
+}
+
 P3_UNIT_TEST(grid_resize_predefined)
 {
 	using data_type = unsigned short;
@@ -699,6 +777,46 @@ P3_UNIT_TEST(grid_resize_predefined)
 	compare(plus_plus,   "plus_plus");
 }
 
+P3_UNIT_TEST(grid_resize_3d_all_directions)
+{
+	using grid_type = p3::grid<int, 3>;
+	const grid_type original({ 3, 4, 5 }, [](const auto &pos) { return static_cast<int>(pos.index()) + 1; });
+
+	// every axis can shrink, stay or grow (including the degenerate case of an empty axis).
+	const std::array<size_t, 4> factors{ 0, 2, 4, 6 };
+	for (const auto z : factors)
+	{
+		for (const auto y : factors)
+		{
+			for (const auto x : factors)
+			{
+				const p3::grid_size<3> size{ z, y, x };
+				const grid_type expected(size, [&](const auto &pos) { return original.inside(pos.pos()) ? original.at(pos.pos()) : 0; });
+
+				auto actual = original;
+				actual.resize(size, true);
+				grid_test::assert_equal_grids(expected, actual, std::format("grid::resize({{{0}, {1}, {2}}}, true)", z, y, x));
+			}
+		}
+	}
+}
+
+P3_UNIT_TEST(grid_resize_chained)
+{
+	// growing after shrinking must not leak any of the moved-from or cut-off values back into the grid.
+	p3::grid<int, 2> grid({ 4, 4 }, [](const auto &pos) { return static_cast<int>(pos.index()) + 1; });
+	grid.resize({ 2, 2 }, true);
+	grid.resize({ 3, 5 }, true);
+
+	const p3::grid<int, 2> expected({ 3, 5 },
+	{
+		1, 2, 0, 0, 0,
+		5, 6, 0, 0, 0,
+		0, 0, 0, 0, 0
+	});
+	grid_test::assert_equal_grids(expected, grid, "grid::resize() chained");
+}
+
 P3_UNIT_TEST(grid_subgrid_3d_small)
 {
 	const p3::grid<int, 3> grid({ 2, 3, 4 }, &p3::grid_gen::ascending<3>);  //  0  1  2 ...  9 10 11
@@ -827,4 +945,609 @@ P3_UNIT_TEST(grid_slice)
 	}
 }
 
+P3_UNIT_TEST(grid_constructor_bulk)
+{
+	// iterator and list constructors copy in bulk. the first axis adapts to the data, missing elements default.
+	const std::vector<int> values{ 1, 2, 3, 4, 5, 6, 7 };
+	const p3::grid<int, 2> exact({ 2, 3 }, values.begin(), values.begin() + 6);
+	const p3::grid<int, 2> surplus({ 2, 3 }, values.begin(), values.end());
+	const p3::grid<int, 2> missing({ 2, 3 }, values.begin(), values.begin() + 4);
+
+	grid_test::assert_equal_grids(p3::grid<int, 2>({ 2, 3 }, { 1, 2, 3, 4, 5, 6 }), exact, "grid(size, begin, end): exact");
+	grid_test::assert_equal_grids(p3::grid<int, 2>({ 3, 3 }, { 1, 2, 3, 4, 5, 6, 7, 0, 0 }), surplus, "grid(size, begin, end): surplus");
+	grid_test::assert_equal_grids(p3::grid<int, 2>({ 2, 3 }, { 1, 2, 3, 4, 0, 0 }), missing, "grid(size, begin, end): missing");
+
+	// the generator still sees every position exactly once, in order.
+	size_t calls = 0;
+	const p3::grid<size_t, 3> generated({ 3, 4, 5 }, [&](const auto &pos) { return pos.index() == calls++ ? pos.index() : 0; });
+	unit_test::assert_equals<size_t>(generated.size(), calls, "grid(size, generator): generator calls");
+	grid_test::assert_equal_grids(p3::grid<size_t, 3>({ 3, 4, 5 }, &p3::grid_gen::ascending<3>), generated, "grid(size, generator): order");
+
+	const p3::grid<int, 2> empty({ 0, 5 }, &p3::grid_gen::ascending<2>);
+	unit_test::assert_equals<size_t>(0, empty.size(), "grid(size, generator): empty");
+}
+
+P3_UNIT_TEST(grid_default_init_allocator)
+{
+	using grid_type = p3::grid<int, 2, p3::grid_layout::row_major, p3::default_init_allocator<int>>;
+
+	// only the size constructor skips the initialization, everything else behaves like a regular grid.
+	grid_type grid({ 4, 3 });
+	grid.iterate([](const auto &pos, auto &val) { val = static_cast<int>(pos.index()); });
+	grid_test::assert_equal_grids(p3::grid<int, 2>({ 4, 3 }, &p3::grid_gen::ascending<2>), p3::grid<int, 2>(grid), "default_init_allocator: iterate");
+
+	// one axis shrinks, the other one grows: the rows move into a new allocation.
+	auto mixed = grid;
+	mixed.resize({ 3, 5 }, true);
+	mixed.iterate([](const auto &pos, const auto &val)
+	{
+		const size_t y = pos.pos_at(0), x = pos.pos_at(1);
+		unit_test::assert_equals<int>(x < 3 ? static_cast<int>(y * 3 + x) : 0, val, "default_init_allocator: resize (mixed)");
+	});
+
+	grid.resize({ 5, 3 }, true);
+	unit_test::assert_equals<int>(11, grid.at({ 3, 2 }), "default_init_allocator: resize (keep data)");
+	unit_test::assert_equals<int>(0, grid.at({ 4, 2 }), "default_init_allocator: resize (new elements)");
+
+	grid.resize({ 2, 2 }, false);
+	grid_test::assert_equal_grids(p3::grid<int, 2>({ 2, 2 }), p3::grid<int, 2>(grid), "default_init_allocator: resize (discard data)");
+
+	const auto layers = grid_type({ 3, 2 }, { 1, 2, 3, 4, 5, 6 }).slice(1);
+	unit_test::assert_equals<int>(5, layers[0].at({ 2 }), "default_init_allocator: slice");
+}
+
+#pragma endregion
+#pragma region grid_view
+
+P3_UNIT_TEST(grid_size_strides)
+{
+	constexpr p3::grid_size<4> size{ 2, 3, 5, 7 };
+	constexpr p3::grid_stride<4> expected{ 105, 35, 7, 1 };
+	static_assert(expected == size.strides(), "grid_size::strides()");
+
+	for (size_t i = 0; i < size.elements(); ++i)
+	{
+		const auto position = p3::grid_size<4>::from_index(i, size);
+		std::ptrdiff_t offset = 0;
+		for (size_t axis = 0; axis < size.size(); ++axis)
+		{
+			offset += size.strides()[axis] * position[axis];
+		}
+		unit_test::assert_equals<std::ptrdiff_t>(i, offset, "grid_size::strides() offset");
+	}
+}
+
+P3_UNIT_TEST(grid_view_matches_grid)
+{
+	const p3::grid<int, 3> grid({ 3, 4, 5 }, &p3::grid_gen::ascending<3>);
+	const auto view = grid.view();
+
+	unit_test::assert_equals<size_t>(grid.size(), view.size(), "grid_view::size()");
+	unit_test::assert_equals<bool>(true, view.contiguous(), "grid_view::contiguous()");
+	if (view.dim() != grid.dim())
+	{
+		unit_test::assert_equals(0, 1, "grid_view::dim() does not match the grid");
+	}
+
+	size_t iterations = 0;
+	view.iterate([&](const auto &pos, const auto &val)
+	{
+		unit_test::assert_equals<int>(grid.at(pos.pos()), val, "grid_view::iterate(): value mismatch");
+		unit_test::assert_equals<int>(grid.at(pos.pos()), view.at(pos.pos()), "grid_view::at(): value mismatch");
+		++iterations;
+	});
+	unit_test::assert_equals<size_t>(grid.size(), iterations, "grid_view::iterate(): iteration count mismatch");
+}
+
+P3_UNIT_TEST(grid_view_subgrid)
+{
+	const p3::grid<int, 4> grid({ 2, 3, 4, 5 }, &p3::grid_gen::ascending<4>);
+
+	for (size_t axis = 0; axis < grid.rank(); ++axis)
+	{
+		const auto views = grid.slice_view(axis);
+		unit_test::assert_equals<size_t>(grid.dim_at(axis), views.size(), "grid::slice_view(): layer count");
+
+		for (size_t layer = 0; layer < views.size(); ++layer)
+		{
+			const p3::grid<int, 3> materialized(views[layer]);
+			grid_test::assert_equal_grids(grid.subgrid(layer, axis), materialized, std::format("grid::slice_view({1})[{0}]", layer, axis));
+			unit_test::assert_equals<bool>(axis == 0, views[layer].contiguous(), std::format("grid::slice_view({1})[{0}].contiguous()", layer, axis));
+		}
+	}
+}
+
+P3_UNIT_TEST(grid_view_nested_subgrid)
+{
+	const p3::grid<int, 3> grid({ 3, 4, 5 }, &p3::grid_gen::ascending<3>);
+
+	// cutting twice has to end up in the same row, no matter the order of the axes.
+	const auto row_a = grid.subgrid_view(2, 0).subgrid(1, 1);
+	const auto row_b = grid.subgrid_view(1, 2).subgrid(2, 0);
+	const p3::grid<int, 1> expected({ 4 }, { 41, 46, 51, 56 });
+
+	grid_test::assert_equal_grids(expected, p3::grid<int, 1>(row_a), "grid_view::subgrid() (axis 0, then axis 1)");
+	grid_test::assert_equal_grids(expected, p3::grid<int, 1>(row_b), "grid_view::subgrid() (axis 2, then axis 0)");
+}
+
+P3_UNIT_TEST(grid_view_write_through)
+{
+	p3::grid<int, 3> grid({ 4, 3, 2 });
+
+	auto layer = grid.subgrid_view(1, 1);
+	layer.iterate([](const auto &pos, auto &val) { val = 7; });
+	layer.at({ 3, 1 }) = 9;
+
+	grid.iterate([](const auto &pos, const auto &val)
+	{
+		const int expected = pos.pos_at(1) != 1 ? 0 : (pos.pos() == p3::grid_size<3>{ 3, 1, 1 } ? 9 : 7);
+		unit_test::assert_equals<int>(expected, val, "grid_view: writing did not reach the grid");
+	});
+
+	// mutable views decay into read-only views, but not the other way around.
+	const p3::grid_view<const int, 2> read_only = layer;
+	unit_test::assert_equals<int>(9, read_only.at({ 3, 1 }), "grid_view<const>: value mismatch");
+	static_assert(!std::is_convertible_v<p3::grid_view<const int, 2>, p3::grid_view<int, 2>>, "grid_view: const view converted into a mutable one");
+}
+
+P3_UNIT_TEST(grid_view_reshape_flip_broadcast)
+{
+	p3::grid<int, 3> grid({ 2, 3, 4 }, &p3::grid_gen::ascending<3>);
+	unit_test::assert_equals(true, grid.stride() == grid.dim().strides(), "grid::stride()");
+	unit_test::assert_equals<std::ptrdiff_t>(4, grid.stride_at(1), "grid::stride_at()");
+
+	const auto flat = grid.view().reshape(p3::grid_size<2>{ 6, 4 });
+	unit_test::assert_equals(true, grid.data() == flat.origin(), "grid_view::reshape(): same memory");
+	unit_test::assert_equals(grid.at({ 1, 2, 3 }), flat.at({ 5, 3 }), "grid_view::reshape(): element");
+
+	const auto flipped = grid.view().flip(1).flip(2);
+	flipped.iterate([&](const auto &pos, const auto &val)
+	{
+		unit_test::assert_equals(grid.at({ pos.pos_at(0), 2 - pos.pos_at(1), 3 - pos.pos_at(2) }), val, std::format("grid_view::flip() at index {}", pos.index()));
+	});
+
+	const auto repeated = grid.subgrid_view(1).broadcast(p3::grid_size<4>{ 5, 2, 3, 4 });
+	repeated.iterate([&](const auto &pos, const auto &val)
+	{
+		unit_test::assert_equals(grid.at({ 1, pos.pos_at(2), pos.pos_at(3) }), val, std::format("grid_view::broadcast() at index {}", pos.index()));
+	});
+
+	// a flipped view isn't contiguous anymore.
+	bool threw = false;
+	try
+	{
+		(void)flipped.reshape(p3::grid_size<1>{ 24 });
+	}
+	catch (const std::invalid_argument &)
+	{
+		threw = true;
+	}
+	unit_test::assert_equals(true, threw, "grid_view::reshape(): non-contiguous view");
+
+	// moving the storage over keeps the address.
+	const auto *storage = grid.data();
+	const auto matrix = std::move(grid).reshape(p3::grid_size<2>{ 4, 6 });
+	unit_test::assert_equals(true, storage == matrix.data(), "grid::reshape(): storage moved");
+	unit_test::assert_equals(true, matrix.dim() == p3::grid_size<2>{ 4, 6 } && matrix.stride() == matrix.dim().strides(), "grid::reshape(): size and strides");
+	unit_test::assert_equals(17, matrix.at({ 2, 5 }), "grid::reshape(): element");
+	unit_test::assert_equals<size_t>(0, grid.size(), "grid::reshape(): moved-from grid");
+}
+
+#pragma endregion
+#pragma region grid layouts
+
+namespace grid_test
+{
+	template <typename layout_type, typename data_type, size_t dimensions>
+	void assert_same_content(const p3::grid<data_type, dimensions> &expected, const p3::grid<data_type, dimensions, layout_type> &actual, const std::string &name)
+	{
+		unit_test::assert_equals(true, expected.dim() == actual.dim(), name + ": dimensions did not match");
+
+		size_t iterations = 0;
+		actual.iterate([&](const auto &pos, const auto &val)
+		{
+			unit_test::assert_equals<data_type>(expected.at(pos.pos()), val, name + std::format(": value mismatch at index {}", actual.index_of(pos.pos())));
+			unit_test::assert_equals<size_t>(actual.index_of(pos.pos()), actual.index_of(actual.position_of(actual.index_of(pos.pos()))), name + ": index/position roundtrip");
+			++iterations;
+		});
+		unit_test::assert_equals<size_t>(expected.size(), iterations, name + ": iteration count mismatch");
+	}
+}
+
+P3_UNIT_TEST(grid_layout_construction)
+{
+	const p3::grid<int, 3> expected({ 5, 3, 6 }, &p3::grid_gen::ascending<3>);
+	std::vector<int> values(expected.begin(), expected.end());
+
+	grid_test::assert_same_content(expected, p3::grid<int, 3, p3::grid_layout::tiled<4>>(expected.dim(), &p3::grid_gen::ascending<3>), "tiled: generator");
+	grid_test::assert_same_content(expected, p3::grid<int, 3, p3::grid_layout::tiled<4>>(expected.dim(), values.begin(), values.end()), "tiled: iterators");
+	grid_test::assert_same_content(expected, p3::grid<int, 3, p3::grid_layout::morton>(expected.dim(), &p3::grid_gen::ascending<3>), "morton: generator");
+	grid_test::assert_same_content(expected, p3::grid<int, 3, p3::grid_layout::morton>(expected.dim(), values.begin(), values.end()), "morton: iterators");
+	grid_test::assert_same_content(expected, p3::grid<int, 3, p3::grid_layout::morton>(expected.view()), "morton: view");
+
+	const p3::grid<int, 3, p3::grid_layout::morton> parallel(expected.dim(), &p3::grid_gen::ascending<3>, p3::parallel_policy{ .threads = 3, .chunk_size = 7 });
+	grid_test::assert_same_content(expected, parallel, "morton: parallel generator");
+
+	// padding: 5x3x6 gets padded to 8x4x8 (morton) or 8x4x8 (tiles of 4).
+	unit_test::assert_equals<size_t>(256, parallel.storage_size(), "morton: storage size");
+	unit_test::assert_equals<size_t>(90, parallel.size(), "morton: size");
+}
+
+P3_UNIT_TEST(grid_layout_morton_order)
+{
+	const p3::grid<int, 2, p3::grid_layout::morton> grid({ 4, 4 });
+
+	unit_test::assert_equals<size_t>(0, grid.index_of({ 0, 0 }), "morton: index of {0, 0}");
+	unit_test::assert_equals<size_t>(1, grid.index_of({ 0, 1 }), "morton: index of {0, 1}");
+	unit_test::assert_equals<size_t>(2, grid.index_of({ 1, 0 }), "morton: index of {1, 0}");
+	unit_test::assert_equals<size_t>(3, grid.index_of({ 1, 1 }), "morton: index of {1, 1}");
+	unit_test::assert_equals<size_t>(4, grid.index_of({ 0, 2 }), "morton: index of {0, 2}");
+	unit_test::assert_equals<size_t>(15, grid.index_of({ 3, 3 }), "morton: index of {3, 3}");
+
+	// iteration follows the memory, not the row-major order.
+	std::vector<p3::grid_size<2>> order;
+	grid.iterate([&](const auto &pos, const auto &val) { order.push_back(pos.pos()); });
+	unit_test::assert_equals<size_t>(16, order.size(), "morton: iteration count");
+	unit_test::assert_equals(true, order[2] == p3::grid_size<2>{ 1, 0 }, "morton: third position");
+	unit_test::assert_equals(true, order[4] == p3::grid_size<2>{ 0, 2 }, "morton: fifth position");
+
+	// 2, 9 and 5 bits: the axes run out of bits at different points, the longest one spans two bytes.
+	const p3::grid<int, 3, p3::grid_layout::morton> uneven({ 3, 300, 20 });
+	unit_test::assert_equals<size_t>(4, uneven.index_of({ 1, 0, 0 }), "morton: index of {1, 0, 0}");
+	unit_test::assert_equals<size_t>(128, uneven.index_of({ 0, 4, 0 }), "morton: index of {0, 4, 0}");
+	unit_test::assert_equals<size_t>(32768, uneven.index_of({ 0, 256, 0 }), "morton: index of {0, 256, 0}");
+	bool consistent = true;
+	for (p3::grid_pos<3> pos{ uneven.dim() }; pos.valid(); ++pos)
+	{
+		consistent = consistent && uneven.position_of(uneven.index_of(pos.pos())) == pos.pos();
+	}
+	unit_test::assert_equals(true, consistent, "morton: index_of() and position_of() on uneven axes");
+}
+
+P3_UNIT_TEST(grid_layout_partitions)
+{
+	const p3::grid<int, 3> expected({ 3, 5, 4 }, &p3::grid_gen::ascending<3>);
+	const p3::grid<int, 3, p3::grid_layout::tiled<2>> tiled(expected.dim(), &p3::grid_gen::ascending<3>);
+
+	for (size_t axis = 0; axis < expected.rank(); ++axis)
+	{
+		const auto layers = tiled.slice(axis);
+		unit_test::assert_equals<size_t>(expected.dim_at(axis), layers.size(), "tiled: slice layer count");
+		for (size_t layer = 0; layer < layers.size(); ++layer)
+		{
+			grid_test::assert_same_content(expected.subgrid(layer, axis), layers[layer], std::format("tiled: slice({1})[{0}]", layer, axis));
+		}
+	}
+}
+
+P3_UNIT_TEST(grid_layout_resize)
+{
+	p3::grid<int, 2, p3::grid_layout::morton> morton({ 3, 5 }, &p3::grid_gen::ascending<2>);
+	p3::grid<int, 2> expected({ 3, 5 }, &p3::grid_gen::ascending<2>);
+
+	morton.resize({ 6, 2 }, true);
+	expected.resize({ 6, 2 }, true);
+	grid_test::assert_same_content(expected, morton, "morton: resize (keep data)");
+
+	morton.resize({ 2, 2 }, false);
+	expected.resize({ 2, 2 }, false);
+	grid_test::assert_same_content(expected, morton, "morton: resize (discard data)");
+}
+
+#pragma endregion
+
+#pragma region grid allocators
+
+namespace grid_test
+{
+	// forwards to the default resource, counting the allocations on the way.
+	class counting_resource : public std::pmr::memory_resource
+	{
+	public:
+		size_t allocations = 0, deallocations = 0;
+
+	private:
+		void *do_allocate(size_t bytes, size_t alignment) override
+		{
+			++allocations;
+			return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+		}
+
+		void do_deallocate(void *ptr, size_t bytes, size_t alignment) override
+		{
+			++deallocations;
+			std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+		{
+			return this == &other;
+		}
+	};
+}
+
+P3_UNIT_TEST(grid_pmr_allocator)
+{
+	grid_test::counting_resource counter;
+
+	p3::pmr::grid<int, 3> grid({ 4, 5, 6 }, &p3::grid_gen::ascending<3>, &counter);
+	unit_test::assert_equals<size_t>(1, counter.allocations, "pmr::grid: generator constructor allocations");
+	unit_test::assert_equals(true, grid.get_allocator().resource() == &counter, "pmr::grid::get_allocator()");
+
+	grid.resize({ 4, 5, 7 }, true);
+	unit_test::assert_equals<size_t>(2, counter.allocations, "pmr::grid: resize allocations");
+
+	// the elements stay the same, no matter where they live.
+	const p3::grid<int, 3> regular = grid;
+	grid_test::assert_equal_grids(regular, p3::grid<int, 3>(p3::pmr::grid<int, 3>(regular, [](const auto &pos, const auto &val) { return val; }, &counter)), "pmr::grid: conversion");
+}
+
+P3_UNIT_TEST(grid_arena_slice)
+{
+	grid_test::counting_resource counter;
+	const p3::grid<int, 3> source({ 32, 8, 8 }, &p3::grid_gen::ascending<3>);
+	const p3::pmr::grid<int, 3> grid(source);
+
+	{
+		// one upstream block serves all layers and the vector holding them.
+		p3::pmr::grid_arena arena(1U << 16, &counter);
+		{
+			const auto layers = grid.slice(0, arena.allocator<int>());
+			unit_test::assert_equals<size_t>(32, layers.size(), "grid::slice(allocator): layer count");
+			unit_test::assert_equals<size_t>(1, counter.allocations, "grid_arena: upstream allocations for slice()");
+
+			const auto layer = grid.subgrid(3, 1, arena.allocator<int>());
+			unit_test::assert_equals<size_t>(1, counter.allocations, "grid_arena: upstream allocations for subgrid()");
+
+			for (size_t index = 0; index < layers.size(); ++index)
+			{
+				grid_test::assert_equal_grids(source.subgrid(index), p3::grid<int, 2>(layers[index]), std::format("grid::slice(allocator)[{}]", index));
+			}
+			grid_test::assert_equal_grids(source.subgrid(3, 1), p3::grid<int, 2>(layer), "grid::subgrid(allocator)");
+		}
+
+		// the grids are gone, so the arena can start over. release() returned the block upstream, the next slice takes a new one.
+		arena.release();
+		const auto again = grid.slice(2, arena.allocator<int>());
+		unit_test::assert_equals<size_t>(2, counter.allocations, "grid_arena: upstream allocations after release()");
+	}
+	unit_test::assert_equals<size_t>(counter.allocations, counter.deallocations, "grid_arena: leaked upstream blocks");
+}
+
+#pragma endregion
+
+#pragma region axis permutation
+
+P3_UNIT_TEST(grid_permute_axes)
+{
+	// big enough to get split into several boxes, odd enough to leave uneven halves.
+	const p3::grid<int, 3> grid({ 37, 23, 41 }, &p3::grid_gen::ascending<3>);
+	const std::array<std::array<size_t, 3>, 6> orders{ { { 0, 1, 2 }, { 0, 2, 1 }, { 1, 0, 2 }, { 1, 2, 0 }, { 2, 0, 1 }, { 2, 1, 0 } } };
+
+	for (const auto &order : orders)
+	{
+		const auto name = std::format("grid::permute_axes({{ {}, {}, {} }})", order[0], order[1], order[2]);
+		const auto permuted = grid.permute_axes(order);
+
+		const p3::grid<int, 3> expected({ grid.dim()[order[0]], grid.dim()[order[1]], grid.dim()[order[2]] }, [&](const auto &pos)
+		{
+			p3::grid_size<3> source{};
+			for (size_t axis = 0; axis < 3; ++axis)
+			{
+				source[order[axis]] = pos.pos_at(axis);
+			}
+			return grid.at(source);
+		});
+		grid_test::assert_equal_grids(expected, permuted, name);
+		grid_test::assert_equal_grids(expected, grid.permute_axes(order, { .threads = 3, .chunk_size = 2000 }), name + " (parallel)");
+	}
+
+	bool threw = false;
+	try
+	{
+		(void)grid.permute_axes({ 0, 2, 2 });
+	}
+	catch (const std::invalid_argument &)
+	{
+		threw = true;
+	}
+	unit_test::assert_equals(true, threw, "grid::permute_axes(): duplicate axis");
+}
+
+P3_UNIT_TEST(grid_transpose)
+{
+	for (const auto &size : { p3::grid_size<2>{ 37, 37 }, p3::grid_size<2>{ 19, 70 }, p3::grid_size<2>{ 1, 5 }, p3::grid_size<2>{ 0, 3 } })
+	{
+		const auto name = std::format("grid::transpose() {}x{}", size[0], size[1]);
+		const p3::grid<int, 2> grid(size, &p3::grid_gen::ascending<2>);
+		const p3::grid<int, 2> expected({ size[1], size[0] }, [&](const auto &pos) { return grid.at({ pos.pos_at(1), pos.pos_at(0) }); });
+
+		grid_test::assert_equal_grids(expected, grid.transpose(), name);
+		grid_test::assert_equal_grids(expected, grid.transpose({ .threads = 4, .chunk_size = 100 }), name + " (parallel)");
+
+		auto in_place = grid;
+		in_place.transpose_in_place();
+		grid_test::assert_equal_grids(expected, in_place, name + " in place");
+
+		in_place = grid;
+		in_place.transpose_in_place({ .threads = 4, .chunk_size = 100 });
+		grid_test::assert_equal_grids(expected, in_place, name + " in place (parallel)");
+	}
+}
+
+#pragma endregion
+
+#pragma region reductions
+
+P3_UNIT_TEST(grid_reduce)
+{
+	const p3::grid<int, 3> grid({ 7, 13, 300 }, [](const auto &pos) { return static_cast<int>((pos.index() * 7919) % 1009) - 500; });
+	const p3::parallel_policy policy{ .threads = 4, .chunk_size = 1000 };
+
+	int sum = 0, min = grid[0], max = grid[0];
+	for (size_t index = 0; index < grid.size(); ++index)
+	{
+		sum += grid[index];
+		min = std::min(min, grid[index]);
+		max = std::max(max, grid[index]);
+	}
+
+	unit_test::assert_equals(sum, grid.reduce(std::plus<>{}), "grid::reduce(plus)");
+	unit_test::assert_equals(sum, grid.reduce(std::plus<>{}, policy), "grid::reduce(plus, policy)");
+	unit_test::assert_equals(sum, grid.sum(p3::grid_summation::pairwise), "grid::sum(pairwise)");
+	unit_test::assert_equals(min, grid.reduce(p3::grid_reduce::minimum{}), "grid::reduce(minimum)");
+	unit_test::assert_equals(max, grid.reduce(p3::grid_reduce::maximum{}, policy), "grid::reduce(maximum, policy)");
+	unit_test::assert_equals(sum / static_cast<int>(grid.size()), grid.mean(), "grid::mean()");
+
+	for (size_t axis = 0; axis < 3; ++axis)
+	{
+		const auto name = std::format("grid::reduce({}, ...)", axis);
+		const auto layers = grid.slice(axis);
+
+		p3::grid<int, 2> expected_sum = layers[0], expected_max = layers[0];
+		for (size_t layer = 1; layer < layers.size(); ++layer)
+		{
+			for (size_t index = 0; index < expected_sum.size(); ++index)
+			{
+				expected_sum[index] += layers[layer][index];
+				expected_max[index] = std::max(expected_max[index], layers[layer][index]);
+			}
+		}
+
+		grid_test::assert_equal_grids(expected_sum, grid.reduce(axis, std::plus<>{}), name + " sum");
+		grid_test::assert_equal_grids(expected_sum, grid.sum(axis, p3::grid_summation::pairwise, policy), name + " pairwise sum (parallel)");
+		grid_test::assert_equal_grids(expected_max, grid.reduce(axis, p3::grid_reduce::maximum{}, policy), name + " maximum (parallel)");
+	}
+
+	bool threw = false;
+	try
+	{
+		(void)p3::grid<int, 2>({ 0, 4 }).reduce(std::plus<>{});
+	}
+	catch (const std::invalid_argument &)
+	{
+		threw = true;
+	}
+	unit_test::assert_equals(true, threw, "grid::reduce(): empty grid");
+	unit_test::assert_equals(0, p3::grid<int, 2>({ 0, 4 }).sum(), "grid::sum(): empty grid");
+}
+
+P3_UNIT_TEST(grid_sum_precision)
+{
+	// 0.1f can't be represented exactly, so a plain float sum drifts away noticeably over a million elements.
+	const size_t count = 1U << 20;
+	const p3::grid<float, 2> grid({ 1024, 1024 }, [](const auto &) { return 0.1f; });
+	const double expected = 0.1f * static_cast<double>(count);
+
+	const auto error = [&](float value) { return std::abs(value - expected) / expected; };
+	unit_test::assert_equals(true, error(grid.sum(p3::grid_summation::kahan)) < 1e-6, "grid::sum(kahan)");
+	unit_test::assert_equals(true, error(grid.sum(p3::grid_summation::pairwise)) < 1e-6, "grid::sum(pairwise)");
+	unit_test::assert_equals(true, error(grid.sum(p3::grid_summation::kahan, { .threads = 4 })) < 1e-6, "grid::sum(kahan, policy)");
+
+	// same along the first axis, adding 1024 layers per column.
+	const auto columns = grid.sum(0, p3::grid_summation::kahan);
+	const auto mean = grid.mean(0, p3::grid_summation::pairwise);
+	for (size_t index = 0; index < columns.size(); ++index)
+	{
+		unit_test::assert_equals(true, std::abs(columns[index] - 102.4f) < 1e-4f, std::format("grid::sum(0, kahan)[{}]", index));
+		unit_test::assert_equals(true, std::abs(mean[index] - 0.1f) < 1e-6f, std::format("grid::mean(0, pairwise)[{}]", index));
+	}
+}
+
+#pragma endregion
+
+#pragma region regions
+
+P3_UNIT_TEST(grid_box_region)
+{
+	const p3::grid_box<3> box{ { 1, 2, 3 }, { 3, 5, 7 } };
+	unit_test::assert_equals(true, box.dim() == p3::grid_size<3>{ 2, 3, 4 }, "grid_box::dim()");
+	unit_test::assert_equals(true, box.contains(p3::grid_size<3>{ 2, 4, 6 }) && !box.contains(p3::grid_size<3>{ 2, 5, 6 }), "grid_box::contains()");
+	unit_test::assert_equals(true, box.intersect({ { 2, 0, 0 }, { 9, 3, 4 } }) == p3::grid_box<3>{ { 2, 2, 3 }, { 3, 3, 4 } }, "grid_box::intersect()");
+	unit_test::assert_equals(true, box.intersect({ { 3, 0, 0 }, { 9, 9, 9 } }).empty(), "grid_box::intersect(): touching boxes");
+
+	p3::grid<int, 3> grid({ 4, 6, 8 }, &p3::grid_gen::ascending<3>);
+	const p3::grid<int, 3, p3::grid_layout::morton> morton(grid.dim(), &p3::grid_gen::ascending<3>);
+
+	// the region iteration visits exactly the positions a full iteration with a bounds check would.
+	std::vector<int> expected, actual, actual_morton;
+	grid.iterate([&](const auto &pos, const auto &val)
+	{
+		if (box.contains(pos.pos()))
+		{
+			expected.push_back(val);
+		}
+	});
+	grid.iterate(box, [&](const auto &pos, const auto &val)
+	{
+		unit_test::assert_equals(grid.at(pos.pos()), val, "grid::iterate(box): position");
+		actual.push_back(val);
+	});
+	morton.iterate(box, [&](const auto &pos, const auto &val) { actual_morton.push_back(val); });
+	unit_test::assert_equals(true, expected == actual, "grid::iterate(box)");
+	unit_test::assert_equals(true, expected == actual_morton, "grid::iterate(box): morton layout");
+
+	const auto view = grid.view().region(box);
+	unit_test::assert_equals(grid.at(box.low), view.at({ 0, 0, 0 }), "grid_view::region()");
+
+	grid.fill(box, -1);
+	grid.iterate([&](const auto &pos, const auto &val)
+	{
+		unit_test::assert_equals(box.contains(pos.pos()) ? -1 : static_cast<int>(pos.index()), val, std::format("grid::fill(box) at index {}", pos.index()));
+	});
+
+	bool threw = false;
+	try
+	{
+		grid.fill({ { 0, 0, 0 }, { 5, 1, 1 } }, 0);
+	}
+	catch (const std::out_of_range &)
+	{
+		threw = true;
+	}
+	unit_test::assert_equals(true, threw, "grid::fill(): box outside of the grid");
+}
+
+P3_UNIT_TEST(grid_copy_region_blit)
+{
+	const p3::grid<int, 2> source({ 5, 7 }, &p3::grid_gen::ascending<2>);
+	p3::grid<int, 2> target({ 8, 8 });
+
+	p3::copy_region(source, { { 1, 2 }, { 4, 6 } }, target, { 4, 0 });
+	target.iterate([&](const auto &pos, const auto &val)
+	{
+		const bool inside = pos.pos_at(0) >= 4 && pos.pos_at(0) < 7 && pos.pos_at(1) < 4;
+		const int expected = inside ? source.at({ pos.pos_at(0) - 3, pos.pos_at(1) + 2 }) : 0;
+		unit_test::assert_equals(expected, val, std::format("copy_region() at index {}", pos.index()));
+	});
+
+	// overlapping boxes within the same grid behave like memmove.
+	p3::grid<int, 2> shifted = source;
+	p3::copy_region(shifted, { { 0, 0 }, { 4, 6 } }, shifted, { 1, 1 });
+	shifted.iterate([&](const auto &pos, const auto &val)
+	{
+		const bool moved = pos.pos_at(0) >= 1 && pos.pos_at(1) >= 1;
+		const int expected = moved ? source.at({ pos.pos_at(0) - 1, pos.pos_at(1) - 1 }) : source.at(pos.pos());
+		unit_test::assert_equals(expected, val, std::format("copy_region(): overlap at index {}", pos.index()));
+	});
+
+	// clipped on the top left and on the right.
+	p3::grid<int, 2> canvas({ 4, 4 }, [](const auto &) { return 100; });
+	p3::blit(source, canvas, { -2, 1 });
+	p3::grid<int, 2> blended({ 4, 4 }, [](const auto &) { return 100; });
+	p3::blit(source, blended, { -2, 1 }, [](int below, int above) { return below + above; });
+	canvas.iterate([&](const auto &pos, const auto &val)
+	{
+		const bool covered = pos.pos_at(0) + 2 < 5 && pos.pos_at(1) >= 1;
+		const int value = covered ? source.at({ pos.pos_at(0) + 2, pos.pos_at(1) - 1 }) : 0;
+		unit_test::assert_equals(covered ? value : 100, val, std::format("blit() at index {}", pos.index()));
+		unit_test::assert_equals(100 + value, blended.at(pos.pos()), std::format("blit(combine) at index {}", pos.index()));
+	});
+
+	// nothing overlaps, nothing happens.
+	p3::blit(source, canvas, { 0, 4 });
+	p3::blit(source, canvas, { -5, 0 });
+	unit_test::assert_equals(100, canvas.at({ 3, 0 }), "blit(): outside of the target");
+}
+
 #pragma endregion
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+#include "../unit_test.hpp"
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+import p3.grid.tracked;
+
+#pragma region tracked grid
+
+P3_UNIT_TEST(tracked_grid_access)
+{
+	// 300 slots in blocks of 16 (rounded up), the last one being shorter.
+	p3::tracked_grid<int, 2> grid(p3::grid<int, 2>({ 10, 30 }), 10);
+	unit_test::assert_equals<size_t>(16, grid.block_size(), "tracked_grid::block_size()");
+	unit_test::assert_equals<size_t>(19, grid.block_count(), "tracked_grid::block_count()");
+	unit_test::assert_equals<size_t>(0, grid.dirty_blocks().size(), "tracked_grid: starts clean");
+
+	grid.at({ 2, 5 }) = 1;
+	grid[299] = 2;
+	const auto &constant = std::as_const(grid);
+	unit_test::assert_equals(0, constant.at({ 9, 0 }) + constant[100] + grid.content()[200], "tracked_grid: const access");
+	unit_test::assert_equals(true, grid.dirty_blocks() == std::vector<size_t>{ 4, 18 }, "tracked_grid::at(), operator[]");
+
+	// rows 3 and 4, columns 10 to 19: slots 100..109 and 130..139.
+	grid.clear_dirty();
+	grid.fill({ { 3, 10 }, { 5, 20 } }, 7);
+	unit_test::assert_equals(true, grid.dirty_blocks() == std::vector<size_t>{ 6, 8 }, "tracked_grid::fill(box)");
+	grid.clear_dirty();
+	grid.iterate({ { 0, 0 }, { 1, 30 } }, [](const auto &pos, auto &val) {});
+	unit_test::assert_equals(true, grid.dirty_blocks() == std::vector<size_t>{ 0, 1 }, "tracked_grid::iterate(box)");
+	grid.clear_dirty();
+	grid.mark_dirty({ { 9, 28 }, { 10, 30 } });
+	grid.mark_dirty(40);
+	unit_test::assert_equals(true, grid.dirty_blocks() == std::vector<size_t>{ 2, 18 }, "tracked_grid::mark_dirty()");
+	unit_test::assert_equals(true, grid.is_dirty(18) && !grid.is_dirty(17), "tracked_grid::is_dirty()");
+
+	bool thrown = false;
+	try
+	{
+		grid.mark_dirty({ { 9, 28 }, { 11, 30 } });
+	}
+	catch (const std::out_of_range &)
+	{
+		thrown = true;
+	}
+	unit_test::assert_equals(true, thrown, "tracked_grid::mark_dirty(): outside of the grid");
+
+	// whole-grid changes mark everything.
+	grid.clear_dirty();
+	grid.iterate([](const auto &pos, auto &val) { ++val; });
+	unit_test::assert_equals<size_t>(19, grid.dirty_blocks().size(), "tracked_grid::iterate()");
+	grid.clear_dirty();
+	grid.modify([](auto &content) { content.resize({ 20, 30 }, true); });
+	unit_test::assert_equals<size_t>(38, grid.dirty_blocks().size(), "tracked_grid::modify()");
+	unit_test::assert_equals(8, grid.at({ 3, 10 }), "tracked_grid::modify(): keeps the data");
+
+	// assignments keep the block size of the target, and never affect comparisons.
+	grid.clear_dirty();
+	const p3::tracked_grid<int, 2> other(grid.content(), 64);
+	grid = other;
+	unit_test::assert_equals(true, grid.block_size() == 16 && grid.is_dirty(37), "tracked_grid: assignment");
+	unit_test::assert_equals(true, grid == other, "tracked_grid: comparison");
+
+	const auto taken = grid.take();
+	unit_test::assert_equals(true, taken == other.content() && grid.size() == 0, "tracked_grid::take()");
+}
+
+P3_UNIT_TEST(tracked_grid_copy_region_blit)
+{
+	p3::tracked_grid<int, 2> canvas(p3::grid<int, 2>({ 8, 16 }), 16);
+	const p3::grid<int, 2> brush({ 3, 3 }, [](const auto &pos) { return 1; });
+
+	// rows 1 to 3, columns 2 to 4: blocks 1, 2 and 3.
+	p3::copy_region(brush, p3::grid_box<2>::whole(brush.dim()), canvas, { 1, 2 });
+	unit_test::assert_equals(true, canvas.dirty_blocks() == std::vector<size_t>{ 1, 2, 3 }, "copy_region(): tracked target");
+	unit_test::assert_equals(1, canvas.at({ 3, 4 }), "copy_region(): copied");
+
+	// clipped at the top left corner: only row 0, columns 0 and 1.
+	canvas.clear_dirty();
+	p3::blit(brush, canvas, { -2, -1 });
+	unit_test::assert_equals(true, canvas.dirty_blocks() == std::vector<size_t>{ 0 }, "blit(): tracked target");
+	unit_test::assert_equals(true, canvas.at({ 0, 1 }) == 1 && canvas.at({ 0, 2 }) == 0, "blit(): clipped");
+
+	canvas.clear_dirty();
+	p3::blit(brush, canvas, { 6, 15 }, [](int target, int source) { return target + source * 5; });
+	unit_test::assert_equals(true, canvas.dirty_blocks() == std::vector<size_t>{ 6, 7 }, "blit(): combining, tracked target");
+	unit_test::assert_equals(5, canvas.at({ 7, 15 }), "blit(): combined");
+
+	canvas.clear_dirty();
+	p3::blit(brush, canvas, { 8, 0 });
+	unit_test::assert_equals<size_t>(0, canvas.dirty_blocks().size(), "blit(): outside of the target");
+}
+
+#pragma endregion
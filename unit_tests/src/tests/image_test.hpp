@@ -0,0 +1,295 @@
+#pragma once
+#include "../unit_test.hpp"
+#include <filesystem>
+#include <initializer_list>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <array>
+#include <span>
+
+import p3.image;
+
+#pragma region helper functions
+
+namespace image_test
+{
+	// odd size on purpose, the vectorized conversions need their scalar tails.
+	inline p3::image test_image(bool transparent)
+	{
+		p3::image result(37, 23);
+		result.iterate([&](const auto &pos, auto &val)
+		{
+			const size_t y = pos.pos_at(0), x = pos.pos_at(1);
+			// flat areas for runs, gradients for the small differences and noise for everything else.
+			if (y < 4)
+			{
+				val = { 10, 200, 30, 255 };
+			}
+			else if (y < 12)
+			{
+				val = { static_cast<std::uint8_t>(x * 5), static_cast<std::uint8_t>(y * 9), static_cast<std::uint8_t>(x + y), 255 };
+			}
+			else
+			{
+				const auto noise = static_cast<std::uint32_t>(pos.index() * 2654435761U);
+				val = { static_cast<std::uint8_t>(noise >> 8), static_cast<std::uint8_t>(noise >> 16), static_cast<std::uint8_t>(noise >> 24), 255 };
+			}
+			if (transparent)
+			{
+				val.a = static_cast<std::uint8_t>(x * 7);
+			}
+		});
+		return result;
+	}
+
+	inline std::vector<std::byte> to_bytes(std::initializer_list<int> values)
+	{
+		std::vector<std::byte> result;
+		for (const int value : values)
+		{
+			result.push_back(static_cast<std::byte>(value));
+		}
+		return result;
+	}
+
+	inline void assert_equal_images(const p3::image &expected, const p3::image &actual, const std::string &message)
+	{
+		unit_test::assert_equals(expected.width(), actual.width(), message + ": width");
+		unit_test::assert_equals(expected.height(), actual.height(), message + ": height");
+		for (size_t index = 0; index < expected.size(); ++index)
+		{
+			unit_test::assert_equals(true, expected.data()[index] == actual.data()[index], message + ": pixel " + std::to_string(index));
+		}
+	}
+
+	inline bool fails_decoding(const std::vector<std::byte> &bytes)
+	{
+		p3::image result;
+		try
+		{
+			result.decode(bytes);
+		}
+		catch (const p3::image_error &)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	inline bool fails_decoding(std::initializer_list<int> values)
+	{
+		return fails_decoding(to_bytes(values));
+	}
+
+	struct temporary_files
+	{
+		std::vector<std::filesystem::path> locations;
+
+		~temporary_files()
+		{
+			std::error_code error;
+			for (const auto &location : locations)
+			{
+				std::filesystem::remove(location, error);
+			}
+		}
+	};
+}
+
+#pragma endregion
+#pragma region pixel conversions
+
+P3_UNIT_TEST(image_pixel_conversions)
+{
+	std::vector<std::uint16_t> wide(65536);
+	std::vector<std::uint8_t> narrow(wide.size());
+	for (size_t value = 0; value < wide.size(); ++value)
+	{
+		wide[value] = static_cast<std::uint16_t>(value);
+	}
+	p3::pixel::narrow(wide, narrow);
+	for (size_t value = 0; value < wide.size(); ++value)
+	{
+		unit_test::assert_equals<size_t>((value * 255 + 32767) / 65535, narrow[value], "pixel::narrow(): rounding");
+	}
+
+	std::vector<std::uint8_t> bytes(256);
+	for (size_t value = 0; value < bytes.size(); ++value)
+	{
+		bytes[value] = static_cast<std::uint8_t>(value);
+	}
+	p3::pixel::widen(bytes, wide);
+	for (size_t value = 0; value < bytes.size(); ++value)
+	{
+		unit_test::assert_equals<size_t>(value * 257, wide[value], "pixel::widen()");
+	}
+
+	// 23 pixels: a few vector iterations and a tail.
+	std::vector<std::uint8_t> rgb(23 * 3), back(rgb.size());
+	for (size_t index = 0; index < rgb.size(); ++index)
+	{
+		rgb[index] = static_cast<std::uint8_t>(index * 11);
+	}
+	std::vector<p3::color> colors(23);
+	for (const auto order : { p3::channel_order::rgb, p3::channel_order::bgr })
+	{
+		const bool swapped = order == p3::channel_order::bgr;
+		p3::pixel::to_rgba(rgb, colors, order);
+		for (size_t index = 0; index < colors.size(); ++index)
+		{
+			const p3::color expected{ rgb[3 * index + (swapped ? 2 : 0)], rgb[3 * index + 1], rgb[3 * index + (swapped ? 0 : 2)], 255 };
+			unit_test::assert_equals(true, colors[index] == expected, "pixel::to_rgba()");
+		}
+		p3::pixel::to_rgb(colors, back, order);
+		unit_test::assert_equals(true, rgb == back, "pixel::to_rgb()");
+	}
+
+	auto swapped = colors;
+	p3::pixel::swap_red_blue(swapped);
+	for (size_t index = 0; index < colors.size(); ++index)
+	{
+		unit_test::assert_equals(true, swapped[index].r == colors[index].b && swapped[index].b == colors[index].r, "pixel::swap_red_blue()");
+	}
+
+	// every channel value against a few alphas, compared to the rounded quotient.
+	std::vector<p3::color> premultiplied;
+	for (const int alpha : { 0, 1, 77, 128, 254, 255 })
+	{
+		for (int value = 0; value < 256; ++value)
+		{
+			premultiplied.push_back({ static_cast<std::uint8_t>(value), static_cast<std::uint8_t>(255 - value), static_cast<std::uint8_t>(value / 3), static_cast<std::uint8_t>(alpha) });
+		}
+	}
+	premultiplied.push_back({ 200, 100, 50, 99 });
+	const auto straight = premultiplied;
+	p3::pixel::premultiply(premultiplied);
+	for (size_t index = 0; index < straight.size(); ++index)
+	{
+		const auto expect = [&](std::uint8_t channel) { return (channel * straight[index].a + 127) / 255; };
+		const auto &item = premultiplied[index];
+		unit_test::assert_equals(true, item.r == expect(straight[index].r) && item.g == expect(straight[index].g) && item.b == expect(straight[index].b) && item.a == straight[index].a, "pixel::premultiply()");
+	}
+
+	auto restored = premultiplied;
+	p3::pixel::unpremultiply(restored);
+	// 8 bit precision gets lost on the way: 200 * 99 / 255 = 77.6, 78 * 255 / 99 = 200.9.
+	unit_test::assert_equals(true, restored.back() == p3::color{ 201, 100, 49, 99 }, "pixel::unpremultiply()");
+	unit_test::assert_equals(true, restored.front() == p3::color{ 0, 0, 0, 0 }, "pixel::unpremultiply(): transparent");
+}
+
+#pragma endregion
+#pragma region codecs
+
+P3_UNIT_TEST(image_codec_roundtrip)
+{
+	const auto opaque = image_test::test_image(false), transparent = image_test::test_image(true);
+
+	for (const auto format : { p3::image_format::bmp, p3::image_format::tga, p3::image_format::qoi, p3::image_format::ppm })
+	{
+		for (const auto *source : { &opaque, &transparent })
+		{
+			const auto bytes = source->encode(format);
+			if (format != p3::image_format::tga)
+			{
+				unit_test::assert_equals(true, p3::detect_format(bytes) == format, "detect_format()");
+			}
+
+			p3::image decoded;
+			decoded.decode(bytes, format);
+			if (format == p3::image_format::ppm)
+			{
+				// no alpha channel.
+				unit_test::assert_equals(true, decoded.at({ 20, 30 }) == p3::color{ source->at({ 20, 30 }).r, source->at({ 20, 30 }).g, source->at({ 20, 30 }).b, 255 }, "ppm roundtrip");
+				continue;
+			}
+			image_test::assert_equal_images(*source, decoded, "codec roundtrip");
+		}
+	}
+
+	p3::image gray;
+	gray.decode(opaque.encode(p3::image_format::pgm));
+	unit_test::assert_equals(true, gray.pixel(30, 20) == p3::color::from_gray(opaque.pixel(30, 20).gray()), "pgm roundtrip");
+
+	// flat areas compress well, the transparent image needs four channels.
+	unit_test::assert_equals(true, opaque.encode(p3::image_format::qoi).size() < opaque.size() * 3, "qoi: compression");
+	unit_test::assert_equals<int>(4, static_cast<int>(transparent.encode(p3::image_format::qoi)[12]), "qoi: channels");
+	unit_test::assert_equals<int>(24, static_cast<int>(opaque.encode(p3::image_format::bmp)[28]), "bmp: opaque bit depth");
+
+	unit_test::assert_equals(true, image_test::fails_decoding({ 'q', 'o', 'i', 'f', 0, 0 }), "decode(): truncated");
+	unit_test::assert_equals(true, image_test::fails_decoding({ 1, 2, 3 }), "decode(): unknown format");
+}
+
+P3_UNIT_TEST(image_decode_variants)
+{
+	p3::image result;
+
+	// 16 bit samples are big endian.
+	result.decode(image_test::to_bytes({ 'P', '5', '\n', '#', ' ', 'x', '\n', '2', ' ', '1', '\n', '6', '5', '5', '3', '5', '\n', 0xFF, 0xFF, 0x80, 0x00 }));
+	unit_test::assert_equals(true, result.pixel(0, 0) == p3::color::from_gray(255) && result.pixel(1, 0) == p3::color::from_gray(128), "pgm: 16 bit");
+
+	// bottom-up 24 bit bitmap, 2x2 with padded rows.
+	auto bmp = image_test::to_bytes({ 'B', 'M', 70, 0, 0, 0, 0, 0, 0, 0, 54, 0, 0, 0, 40, 0, 0, 0, 2, 0, 0, 0, 2, 0, 0, 0, 1, 0, 24, 0 });
+	bmp.resize(54);
+	for (const int value : { 0, 0, 255, 0, 255, 0, 0, 0, 255, 0, 0, 255, 255, 255, 0, 0 })
+	{
+		bmp.push_back(static_cast<std::byte>(value));
+	}
+	result.decode(bmp);
+	unit_test::assert_equals(true, result.pixel(0, 1) == p3::color{ 255, 0, 0, 255 }, "bmp: bottom row");
+	unit_test::assert_equals(true, result.pixel(1, 1) == p3::color{ 0, 255, 0, 255 }, "bmp: bgr order");
+	unit_test::assert_equals(true, result.pixel(0, 0) == p3::color{ 0, 0, 255, 255 } && result.pixel(1, 0) == p3::color{ 255, 255, 255, 255 }, "bmp: top row");
+
+	// 32 bit bit fields behind an odd sized info header, the file ends before the masks.
+	auto bit_fields = image_test::to_bytes({ 'B', 'M', 60, 0, 0, 0, 0, 0, 0, 0, 58, 0, 0, 0, 44, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 32, 0, 3, 0 });
+	bit_fields.resize(60);
+	unit_test::assert_equals(true, image_test::fails_decoding(bit_fields), "bmp: truncated bit fields");
+
+	// a leading run of the initial pixel puts it into the index as well, op_index 53 refers to it.
+	result.decode(image_test::to_bytes({ 'q', 'o', 'i', 'f', 0, 0, 0, 2, 0, 0, 0, 1, 4, 0, 0xC0, 0x35, 0, 0, 0, 0, 0, 0, 0, 1 }));
+	unit_test::assert_equals(true, result.pixel(1, 0) == p3::color{ 0, 0, 0, 255 }, "qoi: indexed run");
+
+	// run length encoded gray tga, bottom-left origin: a run of three and two raw pixels.
+	const auto tga = image_test::to_bytes({ 0, 0, 11, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5, 0, 1, 0, 8, 0, 0x82, 50, 0x01, 60, 70 });
+	result.decode(tga, p3::image_format::tga);
+	unit_test::assert_equals<size_t>(5, result.width(), "tga: width");
+	unit_test::assert_equals(true, result.pixel(2, 0) == p3::color::from_gray(50) && result.pixel(4, 0) == p3::color::from_gray(70), "tga: run length");
+}
+
+#pragma endregion
+#pragma region files
+
+P3_UNIT_TEST(image_files)
+{
+	const auto source = image_test::test_image(true);
+	image_test::temporary_files files;
+	const auto directory = std::filesystem::temp_directory_path();
+
+	for (const char *name : { "p3_image_test.bmp", "p3_image_test.tga", "p3_image_test.qoi", "p3_image_test.unknown" })
+	{
+		files.locations.push_back(directory / name);
+		source.save(files.locations.back());
+
+		p3::image loaded;
+		loaded.load(files.locations.back());
+		image_test::assert_equal_images(source, loaded, std::string("image::load(): ") + name);
+	}
+
+	// the extension decides, the format only fills in.
+	p3::image loaded;
+	loaded.load(files.locations[0]);
+	unit_test::assert_equals(true, loaded.format() == p3::image_format::qoi, "image::format(): default");
+
+	p3::byte_writer writer;
+	auto copy = source;
+	copy.set_format(p3::image_format::bmp);
+	copy.write(writer);
+	const auto bytes = writer.take();
+	unit_test::assert_equals(true, p3::detect_format(bytes) == p3::image_format::bmp, "image::write(): set_format()");
+
+	unit_test::assert_equals(bytes.size(), loaded.read(bytes), "image::read(): consumed bytes");
+	image_test::assert_equal_images(source, loaded, "image::read()");
+}
+
+#pragma endregion
\ No newline at end of file
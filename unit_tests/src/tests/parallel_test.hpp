@@ -0,0 +1,54 @@
+#pragma once
+#include "../unit_test.hpp"
+#include <stdexcept>
+#include <vector>
+
+import p3.parallel;
+
+#pragma region parallel_for
+
+P3_UNIT_TEST(parallel_for_coverage)
+{
+	// every index has to be visited exactly once, no matter how the work is split up.
+	for (const size_t threads : { 1, 2, 3, 8 })
+	{
+		for (const size_t chunk_size : { 1, 7, 64, 1000 })
+		{
+			std::vector<int> visits(1000);
+			p3::parallel_for(visits.size(), { threads, chunk_size }, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					++visits[i];
+				}
+			});
+
+			for (size_t i = 0; i < visits.size(); ++i)
+			{
+				unit_test::assert_equals<int>(1, visits[i], std::format("parallel_for(threads = {0}, chunk_size = {1}): visits of index {2}", threads, chunk_size, i));
+			}
+		}
+	}
+}
+
+P3_UNIT_TEST(parallel_for_exception)
+{
+	bool caught = false;
+	try
+	{
+		p3::parallel_for(100, { 4, 10 }, [](size_t begin, size_t end)
+		{
+			if (begin <= 50 && 50 < end)
+			{
+				throw std::runtime_error("chunk failed");
+			}
+		});
+	}
+	catch (const std::runtime_error &)
+	{
+		caught = true;
+	}
+	unit_test::assert_equals<bool>(true, caught, "parallel_for: exception did not reach the calling thread");
+}
+
+#pragma endregion
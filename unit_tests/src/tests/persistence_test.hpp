@@ -1,5 +1,183 @@
 #pragma once
+#include "../unit_test.hpp"
 // #include "persistence_assert.hpp"
+#include <filesystem>
+#include <algorithm>
+#include <sstream>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <array>
+
+import p3.persistence;
+
+#pragma region helper functions
+
+namespace persistence_test
+{
+	struct numbers : public p3::filestream_access
+	{
+		std::vector<int> values;
+		bool fail_saving = false;
+
+	protected:
+		bool on_read(std::istream &stream) override
+		{
+			size_t count = 0;
+			stream >> count;
+			values.resize(count);
+			for (auto &value : values)
+			{
+				stream >> value;
+			}
+			return !stream.fail();
+		}
+
+		bool on_write(std::ostream &stream) const override
+		{
+			stream << values.size();
+			for (const auto &value : values)
+			{
+				stream << ' ' << value;
+			}
+			return !fail_saving;
+		}
+	};
+
+	// binary serialization only, the stream functions are adapters.
+	struct vector3 : public p3::stream_access
+	{
+		float x = 0, y = 0, z = 0;
+
+	protected:
+		bool on_read(p3::byte_reader &reader) override
+		{
+			return reader.read_value(x) && reader.read_value(y) && reader.read_value(z);
+		}
+
+		bool on_write(p3::byte_writer &writer) const override
+		{
+			writer.write_value(x);
+			writer.write_value(y);
+			writer.write_value(z);
+			return true;
+		}
+	};
+
+	// positions like a text mode file stream on windows: offsets count "\r\n", the delivered characters don't.
+	struct text_mode_buffer : public std::stringbuf
+	{
+		using std::stringbuf::stringbuf;
+
+	protected:
+		pos_type seekoff(off_type offset, std::ios::seekdir dir, std::ios::openmode mode) override
+		{
+			if (dir != std::ios::cur)
+			{
+				m_at_end = dir == std::ios::end;
+			}
+			const auto result = std::stringbuf::seekoff(offset, dir, mode);
+			return m_at_end && result != pos_type(-1) ? result + off_type(2) : result;
+		}
+
+		pos_type seekpos(pos_type pos, std::ios::openmode mode) override
+		{
+			m_at_end = false;
+			return std::stringbuf::seekpos(pos, mode);
+		}
+
+	private:
+		bool m_at_end = false;
+	};
+
+	// overrides nothing at all.
+	struct nothing : public p3::stream_access
+	{
+	};
+
+	// temporary files of file_access::save() next to the location ("name.p3tmp<n>.ext").
+	inline std::vector<std::filesystem::path> temporaries_of(const std::filesystem::path &location)
+	{
+		std::vector<std::filesystem::path> result;
+		const std::string prefix = location.stem().string() + ".p3tmp";
+		for (const auto &entry : std::filesystem::directory_iterator(location.parent_path()))
+		{
+			if (entry.path().filename().string().starts_with(prefix))
+			{
+				result.push_back(entry.path());
+			}
+		}
+		return result;
+	}
+
+	// removes the file at the end of the test, even if it fails.
+	struct temporary_file
+	{
+		std::filesystem::path location{ std::filesystem::temp_directory_path() / "p3_persistence_test.txt" };
+
+		~temporary_file()
+		{
+			std::error_code error;
+			std::filesystem::remove(location, error);
+			for (const auto &temporary : temporaries_of(location))
+			{
+				std::filesystem::remove(temporary, error);
+			}
+		}
+	};
+
+	// pluggable codec for the tests: drops the zeros at the end of the block.
+	struct zero_trimming_codec : public p3::block_codec
+	{
+		void compress(std::span<const std::byte> input, size_t, std::vector<std::byte> &output) const override
+		{
+			size_t size = input.size();
+			while (size > 0 && input[size - 1] == std::byte{ 0 })
+			{
+				--size;
+			}
+			output.assign(input.begin(), input.begin() + size);
+		}
+
+		bool decompress(std::span<const std::byte> input, size_t, std::span<std::byte> output) const override
+		{
+			if (input.size() > output.size())
+			{
+				return false;
+			}
+			std::copy(input.begin(), input.end(), output.begin());
+			std::fill(output.begin() + input.size(), output.end(), std::byte{ 0 });
+			return true;
+		}
+	};
+
+	// a bit of everything: runs, repeated text, slowly rising numbers and noise.
+	inline std::vector<std::byte> codec_payload()
+	{
+		std::vector<std::byte> result(5000, std::byte{ 7 });
+		for (int repeat = 0; repeat < 200; ++repeat)
+		{
+			for (const char character : std::string("the quick brown fox jumps over the lazy dog. "))
+			{
+				result.push_back(static_cast<std::byte>(character));
+			}
+		}
+		for (uint32_t value = 0; value < 3000; ++value)
+		{
+			const uint32_t number = 100000 + value * 3;
+			const auto bytes = std::as_bytes(std::span(&number, 1));
+			result.insert(result.end(), bytes.begin(), bytes.end());
+		}
+		for (uint32_t value = 0; value < 2001; ++value)
+		{
+			result.push_back(static_cast<std::byte>(value * 2654435761U >> 24));
+		}
+		return result;
+	}
+}
+
+#pragma endregion
 
 #pragma region file_access
 
@@ -23,4 +201,314 @@
 // 	persistence_test::test_exceptions(false, false, "  no_success");
 // }
 
+#pragma endregion
+#pragma region byte buffers
+
+P3_UNIT_TEST(byte_buffers)
+{
+	const std::array<std::byte, 4> external{ std::byte{ 1 }, std::byte{ 2 }, std::byte{ 3 }, std::byte{ 4 } };
+	p3::byte_writer writer;
+	writer.write_value<uint16_t>(0xABCD);
+	writer.write_external(external);
+	writer.write_value<uint8_t>(7);
+	writer.write_value<uint8_t>(8);
+
+	// gather list: own buffer, external memory, own buffer again.
+	const auto segments = writer.segments();
+	unit_test::assert_equals<size_t>(3, segments.size(), "byte_writer::segments()");
+	unit_test::assert_equals(true, segments[1].data() == external.data(), "byte_writer::write_external(): copied");
+	unit_test::assert_equals<size_t>(2, segments[2].size(), "byte_writer::segments(): merged writes");
+
+	const auto bytes = writer.take();
+	unit_test::assert_equals<size_t>(8, bytes.size(), "byte_writer::take()");
+	unit_test::assert_equals<size_t>(0, writer.size(), "byte_writer::take(): cleared");
+
+	// scatter into separate targets, the rest without copying.
+	p3::byte_reader reader(bytes);
+	uint16_t first = 0;
+	std::array<std::byte, 2> middle{};
+	const std::array<std::span<std::byte>, 2> targets{ std::as_writable_bytes(std::span(&first, 1)), std::span(middle) };
+	unit_test::assert_equals(true, reader.read(targets), "byte_reader::read(): scatter");
+	unit_test::assert_equals<uint16_t>(0xABCD, first, "byte_reader::read(): first target");
+	unit_test::assert_equals(true, middle[1] == std::byte{ 2 }, "byte_reader::read(): second target");
+
+	const auto rest = reader.view(4);
+	unit_test::assert_equals(true, rest.data() == bytes.data() + 4, "byte_reader::view()");
+	unit_test::assert_equals(true, rest[3] == std::byte{ 8 }, "byte_reader::view(): content");
+
+	uint32_t beyond = 0;
+	unit_test::assert_equals(false, reader.read_value(beyond), "byte_reader::read_value(): past the end");
+	unit_test::assert_equals(false, reader.good(), "byte_reader::good()");
+}
+
+P3_UNIT_TEST(stream_access_adapters)
+{
+	// binary implementation, used through streams.
+	persistence_test::vector3 original, loaded;
+	original.x = 1.5f;
+	original.y = -2.f;
+	original.z = 1e9f;
+
+	std::stringstream stream;
+	original.write(stream);
+	stream << "tail";
+	loaded.read(stream);
+	unit_test::assert_equals(true, loaded.x == original.x && loaded.y == original.y && loaded.z == original.z, "stream_access: stream to binary adapter");
+	unit_test::assert_equals<size_t>(3 * sizeof(float), static_cast<size_t>(stream.tellg()), "stream_access: stream position after reading");
+
+	// fewer bytes than the stream positions promise.
+	persistence_test::text_mode_buffer buffer(stream.str());
+	std::istream text_mode(&buffer);
+	bool short_read = false;
+	try
+	{
+		loaded.read(text_mode);
+	}
+	catch (const p3::stream_access::custom_error &)
+	{
+		short_read = true;
+	}
+	unit_test::assert_equals(true, short_read, "stream_access: short read");
+
+	// stream implementation, used through binary buffers.
+	persistence_test::numbers text, parsed;
+	text.values = { 3, 1, 4, 1, 5 };
+	p3::byte_writer writer;
+	text.write(writer);
+	const auto bytes = writer.take();
+	unit_test::assert_equals<size_t>(bytes.size(), parsed.read(bytes), "stream_access::read(): consumed bytes");
+	unit_test::assert_equals(true, parsed.values == text.values, "stream_access: binary to stream adapter");
+
+	// neither implementation.
+	persistence_test::nothing empty;
+	bool thrown = false;
+	try
+	{
+		empty.write(writer);
+	}
+	catch (const p3::stream_access::custom_error &)
+	{
+		thrown = true;
+	}
+	unit_test::assert_equals(true, thrown, "stream_access: no implementation");
+}
+
+#pragma endregion
+#pragma region asynchronous access
+
+P3_UNIT_TEST(file_access_async)
+{
+	const persistence_test::temporary_file file;
+	persistence_test::numbers original, loaded;
+	original.values = { 4, 8, 15, 16, 23, 42 };
+
+	original.save_async(file.location).get();
+	loaded.load_async(file.location).get();
+	unit_test::assert_equals(true, loaded.values == original.values, "file_access::load_async()");
+	unit_test::assert_equals(true, persistence_test::temporaries_of(file.location).empty(), "file_access::save(): temporary file left");
+
+	// a failing save keeps the previous file.
+	original.values = { 1, 2, 3 };
+	original.fail_saving = true;
+	bool thrown = false;
+	try
+	{
+		original.save(file.location);
+	}
+	catch (const p3::stream_access::custom_error &)
+	{
+		thrown = true;
+	}
+	unit_test::assert_equals(true, thrown, "file_access::save(): failure");
+	unit_test::assert_equals(true, persistence_test::temporaries_of(file.location).empty(), "file_access::save(): temporary file after failure");
+
+	loaded.load(file.location);
+	unit_test::assert_equals<size_t>(6, loaded.values.size(), "file_access::save(): previous file after failure");
+
+	// concurrent saves to the same location write their own temporary files, one of them ends up complete.
+	unit_test::assert_equals(true, p3::file_access::temporary_path(file.location) != p3::file_access::temporary_path(file.location), "file_access::temporary_path(): unique");
+	persistence_test::numbers first, second;
+	first.values.assign(5000, 1);
+	second.values.assign(5000, 2);
+	for (int round = 0; round < 10; ++round)
+	{
+		auto pending = first.save_async(file.location);
+		second.save(file.location);
+		pending.get();
+		loaded.load(file.location);
+		unit_test::assert_equals(true, loaded.values == first.values || loaded.values == second.values, "file_access::save(): concurrent saves");
+	}
+	unit_test::assert_equals(true, persistence_test::temporaries_of(file.location).empty(), "file_access::save(): temporary files after concurrent saves");
+}
+
+P3_UNIT_TEST(background_writer_snapshots)
+{
+	const persistence_test::temporary_file file;
+	persistence_test::numbers original, loaded;
+	p3::background_writer writer;
+
+	// the original changes right after every save, each snapshot keeps its own state.
+	std::vector<std::future<void>> saves;
+	for (int version = 0; version < 10; ++version)
+	{
+		original.values.assign(1000, version);
+		saves.push_back(writer.save(original, file.location));
+		original.values.assign(5, -1);
+	}
+	for (auto &done : saves)
+	{
+		done.get();
+	}
+	writer.wait();
+	unit_test::assert_equals<size_t>(0, writer.pending(), "background_writer::pending()");
+
+	const auto stats = writer.stats();
+	unit_test::assert_equals<size_t>(10, stats.saves + stats.superseded, "background_writer::stats()");
+	unit_test::assert_equals<size_t>(0, stats.failures, "background_writer::stats(): failures");
+
+	loaded.load(file.location);
+	unit_test::assert_equals(true, loaded.values == std::vector<int>(1000, 9), "background_writer: latest snapshot");
+
+	// errors end up in the future.
+	bool thrown = false;
+	try
+	{
+		writer.save(original, file.location.parent_path() / "p3_missing_directory" / "file.txt").get();
+	}
+	catch (const p3::file_access::no_directory &)
+	{
+		thrown = true;
+	}
+	unit_test::assert_equals(true, thrown, "background_writer: missing directory");
+	unit_test::assert_equals<size_t>(1, writer.stats().failures, "background_writer::stats(): failure");
+}
+
+#pragma endregion
+#pragma region codecs
+
+P3_UNIT_TEST(codec_roundtrip)
+{
+	const auto payload = persistence_test::codec_payload();
+	const auto trimming = static_cast<p3::codec_id>(200);
+	p3::register_codec(trimming, std::make_shared<persistence_test::zero_trimming_codec>());
+
+	for (const auto id : { p3::codec_id::none, p3::codec_id::lz, p3::codec_id::delta_rle, trimming })
+	{
+		// whole elements per block, the last one is shorter. three threads have to produce the same bytes as one.
+		for (const size_t element_size : { 1, 3, 4 })
+		{
+			const p3::codec_options options{ .id = id, .element_size = element_size, .block_size = 4099 };
+			auto parallel = options;
+			parallel.policy.threads = 3;
+
+			const auto compressed = p3::compress(payload, options);
+			unit_test::assert_equals(true, p3::is_compressed(compressed), "compress(): header");
+			unit_test::assert_equals(true, compressed == p3::compress(payload, parallel), "compress(): multiple threads");
+			unit_test::assert_equals(true, payload == p3::decompress(compressed), "decompress()");
+			unit_test::assert_equals(true, payload == p3::decompress(compressed, parallel.policy), "decompress(): multiple threads");
+		}
+	}
+
+	const auto lz = p3::compress(payload, { .id = p3::codec_id::lz });
+	const auto delta = p3::compress(payload, { .id = p3::codec_id::delta_rle, .element_size = 4 });
+	// lz can't do much with the rising numbers, delta_rle nothing with the text.
+	unit_test::assert_equals(true, lz.size() < payload.size() * 3 / 4, "compress(): lz ratio");
+	unit_test::assert_equals(true, delta.size() < payload.size() / 2, "compress(): delta_rle ratio");
+	unit_test::assert_equals(true, p3::compress({}, { .id = p3::codec_id::lz }).size() == p3::compressed_header_size, "compress(): nothing");
+
+	std::vector<std::byte> padded(1000);
+	padded[99] = std::byte{ 1 };
+	const auto trimmed = p3::compress(padded, { .id = trimming });
+	unit_test::assert_equals(p3::compressed_header_size + 4 + 100, trimmed.size(), "register_codec(): own codec");
+	unit_test::assert_equals(true, padded == p3::decompress(trimmed), "register_codec(): own codec roundtrip");
+
+	// broken input throws, it never reads or writes out of bounds.
+	for (const size_t cut : { size_t{ 3 }, p3::compressed_header_size + 2, lz.size() - 1 })
+	{
+		bool thrown = false;
+		try
+		{
+			(void)p3::decompress(std::span(lz).first(cut));
+		}
+		catch (const p3::codec_error &)
+		{
+			thrown = true;
+		}
+		unit_test::assert_equals(true, thrown, "decompress(): truncated");
+	}
+
+	// a forged header asks for 255 blocks of 4 GiB, which three stored bytes each can't expand to.
+	for (const auto id : { p3::codec_id::none, p3::codec_id::lz, p3::codec_id::delta_rle })
+	{
+		auto forged = p3::compress({}, { .id = id });
+		forged.resize(p3::compressed_header_size + 255 * (4 + 3), std::byte{ 0xFF });
+		const auto write_le = [&](size_t offset, uint64_t value, size_t size)
+		{
+			for (size_t index = 0; index < size; ++index, value >>= 8)
+			{
+				forged[offset + index] = static_cast<std::byte>(value & 0xFF);
+			}
+		};
+		write_le(8, 255 * uint64_t{ 0xFFFFFFFF }, 8);
+		write_le(16, 0xFFFFFFFF, 4);
+		write_le(20, 255, 4);
+		for (size_t block = 0; block < 255; ++block)
+		{
+			write_le(p3::compressed_header_size + 4 * block, 3, 4);
+		}
+		bool thrown = false;
+		try
+		{
+			(void)p3::decompress(forged);
+		}
+		catch (const p3::codec_error &)
+		{
+			thrown = true;
+		}
+		unit_test::assert_equals(true, thrown, "decompress(): original size beyond the blocks");
+	}
+}
+
+P3_UNIT_TEST(filestream_access_codec)
+{
+	const persistence_test::temporary_file file;
+	persistence_test::numbers original, loaded;
+	original.values.assign(10000, 12345);
+
+	original.set_codec({ .id = p3::codec_id::lz });
+	original.save(file.location);
+	unit_test::assert_equals(true, std::filesystem::file_size(file.location) < 1000, "filestream_access: compressed file");
+
+	// the header tells the codec, the loading side doesn't need to know it.
+	loaded.load(file.location);
+	unit_test::assert_equals(true, loaded.values == original.values, "filestream_access: compressed load");
+
+	original.set_codec({});
+	original.values.assign(5, 1);
+	original.save(file.location);
+	loaded.set_codec({ .id = p3::codec_id::delta_rle });
+	loaded.load(file.location);
+	unit_test::assert_equals(true, loaded.values == original.values, "filestream_access: uncompressed load");
+
+	// a compressed file cut short doesn't pass as an empty or a text file.
+	original.values.assign(10000, 12345);
+	original.set_codec({ .id = p3::codec_id::lz });
+	original.save(file.location);
+	const auto size = std::filesystem::file_size(file.location);
+	for (const auto cut : { size - 1, std::uintmax_t{ 10 } })
+	{
+		std::filesystem::resize_file(file.location, cut);
+		bool thrown = false;
+		try
+		{
+			loaded.load(file.location);
+		}
+		catch (const p3::codec_error &)
+		{
+			thrown = true;
+		}
+		unit_test::assert_equals(true, thrown, "filestream_access: truncated compressed file");
+	}
+}
+
 #pragma endregion
\ No newline at end of file